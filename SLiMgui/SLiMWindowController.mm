@@ -2026,12 +2026,24 @@
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.mutationRefcountBuffer total:final_total attributes:menlo11_d]];
 		[content eidosAppendString:@" : refcount buffer\n" attributes:optima13_d];
 		
+		[content eidosAppendString:@"   " attributes:menlo11_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.mutationHotFieldBuffers / div total:average_total attributes:menlo11_d]];
+		[content eidosAppendString:@" / " attributes:optima13_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.mutationHotFieldBuffers total:final_total attributes:menlo11_d]];
+		[content eidosAppendString:@" : hot-field buffers\n" attributes:optima13_d];
+		
 		[content eidosAppendString:@"   " attributes:menlo11_d];
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.mutationUnusedPoolSpace / div total:average_total attributes:menlo11_d]];
 		[content eidosAppendString:@" / " attributes:optima13_d];
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.mutationUnusedPoolSpace total:final_total attributes:menlo11_d]];
 		[content eidosAppendString:@" : unused pool space\n" attributes:optima13_d];
 		
+		[content eidosAppendString:@"   " attributes:menlo11_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.mutationBlockResident / div total:average_total attributes:menlo11_d]];
+		[content eidosAppendString:@" / " attributes:optima13_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.mutationBlockResident total:final_total attributes:menlo11_d]];
+		[content eidosAppendString:@" : resident in physical memory (not additive)\n" attributes:optima13_d];
+		
 		// MutationRun
 		[content eidosAppendString:@"\n" attributes:optima8_d];
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.mutationRunObjects / div total:average_total attributes:menlo11_d]];
@@ -2083,6 +2095,24 @@
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.slimsimTreeSeqTables total:final_total attributes:menlo11_d]];
 		[content eidosAppendString:@" : tree-sequence tables\n" attributes:optima13_d];
 		
+		[content eidosAppendString:@"   " attributes:menlo11_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.slimsimTreeSeqEdgeBuffer / div total:average_total attributes:menlo11_d]];
+		[content eidosAppendString:@" / " attributes:optima13_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.slimsimTreeSeqEdgeBuffer total:final_total attributes:menlo11_d]];
+		[content eidosAppendString:@" : tree-sequence edge buffer\n" attributes:optima13_d];
+		
+		[content eidosAppendString:@"   " attributes:menlo11_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.slimsimTreeSeqSortScratch / div total:average_total attributes:menlo11_d]];
+		[content eidosAppendString:@" / " attributes:optima13_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.slimsimTreeSeqSortScratch total:final_total attributes:menlo11_d]];
+		[content eidosAppendString:@" : edge sort scratch, last simplify (not additive)\n" attributes:optima13_d];
+		
+		[content eidosAppendString:@"   " attributes:menlo11_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.slimsimTreeSeqFullSortScratch / div total:average_total attributes:menlo11_d]];
+		[content eidosAppendString:@" / " attributes:optima13_d];
+		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_last.slimsimTreeSeqFullSortScratch total:final_total attributes:menlo11_d]];
+		[content eidosAppendString:@" : edge sort scratch, full sort (not additive)\n" attributes:optima13_d];
+		
 		// Subpopulation
 		[content eidosAppendString:@"\n" attributes:optima8_d];
 		[content appendAttributedString:[NSAttributedString attributedStringForByteCount:mem_tot.subpopulationObjects / div total:average_total attributes:menlo11_d]];
@@ -0,0 +1,41 @@
+#!/bin/bash
+set -u
+
+USAGE="Usage:
+    $0 (benchmark script) [thread counts...]
+
+Runs the given SLiM benchmark script once for each thread count (default: 1 2 4 8),
+passing the count to the script as the constant THREADS, and reports the time taken.
+The slim executable is taken from \$SLIM if set, otherwise from the PATH.
+"
+
+if [ $# -lt 1 ];
+then
+    echo "$USAGE"
+    exit 0
+fi
+
+SCRIPT="$1"
+shift
+
+if [ ! -e "$SCRIPT" ]
+then
+    echo "Benchmark $SCRIPT does not exist."
+    exit 1
+fi
+
+SLIM="${SLIM:-slim}"
+THREAD_COUNTS="${*:-1 2 4 8}"
+
+echo "Benchmark: $SCRIPT"
+
+for THREADS in $THREAD_COUNTS
+do
+    START=$(date +%s.%N)
+    "$SLIM" -s 1 -d THREADS=$THREADS "$SCRIPT" > /dev/null || { echo "SLiM error"; exit 1; }
+    END=$(date +%s.%N)
+
+    echo "  threads = $THREADS: $(awk "BEGIN { printf \"%.2f\", $END - $START }") s"
+done
+
+exit 0
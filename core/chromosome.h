@@ -196,6 +196,11 @@ public:
 												   double &p_both_0, double &p_both_0_OR_mut_0_break_non0, double &p_both_0_OR_mut_0_break_non0_OR_mut_non0_break_0);
 #endif
 	
+	// draw the mutation count and/or breakpoint count from a counter-based stream, rather than from the shared RNG; these are used
+	// with initializeSLiMOptions(counterRNG=T), and since the stream is not shared, there is no reason to draw the counts jointly
+	int DrawMutationCount(IndividualSex p_sex, Eidos_CounterRNG &p_rng) const;
+	int DrawBreakpointCount(IndividualSex p_sex, Eidos_CounterRNG &p_rng) const;
+	
 	// internal methods for throwing errors from inline functions when assumptions about the configuration of maps are violated
 	void MutationMapConfigError(void) const __attribute__((__noreturn__)) __attribute__((cold)) __attribute__((analyzer_noreturn));
 	void RecombinationMapConfigError(void) const __attribute__((__noreturn__)) __attribute__((cold)) __attribute__((analyzer_noreturn));
@@ -411,6 +416,68 @@ inline __attribute__((always_inline)) void Chromosome::DrawMutationAndBreakpoint
 }
 #endif
 
+inline __attribute__((always_inline)) int Chromosome::DrawMutationCount(IndividualSex p_sex, Eidos_CounterRNG &p_rng) const
+{
+	double rate, exp_neg_rate;
+	
+	if (single_mutation_map_)
+	{
+		rate = overall_mutation_rate_H_;
+		exp_neg_rate = exp_neg_overall_mutation_rate_H_;
+	}
+	else if (p_sex == IndividualSex::kMale)
+	{
+		rate = overall_mutation_rate_M_;
+		exp_neg_rate = exp_neg_overall_mutation_rate_M_;
+	}
+	else if (p_sex == IndividualSex::kFemale)
+	{
+		rate = overall_mutation_rate_F_;
+		exp_neg_rate = exp_neg_overall_mutation_rate_F_;
+	}
+	else
+	{
+		MutationMapConfigError();
+	}
+	
+#ifdef USE_GSL_POISSON
+	exp_neg_rate = exp(-rate);		// the cached values are not set up in this case
+#endif
+	
+	return p_rng.Poisson(rate, exp_neg_rate);
+}
+
+inline __attribute__((always_inline)) int Chromosome::DrawBreakpointCount(IndividualSex p_sex, Eidos_CounterRNG &p_rng) const
+{
+	double rate, exp_neg_rate;
+	
+	if (single_recombination_map_)
+	{
+		rate = overall_recombination_rate_H_;
+		exp_neg_rate = exp_neg_overall_recombination_rate_H_;
+	}
+	else if (p_sex == IndividualSex::kMale)
+	{
+		rate = overall_recombination_rate_M_;
+		exp_neg_rate = exp_neg_overall_recombination_rate_M_;
+	}
+	else if (p_sex == IndividualSex::kFemale)
+	{
+		rate = overall_recombination_rate_F_;
+		exp_neg_rate = exp_neg_overall_recombination_rate_F_;
+	}
+	else
+	{
+		RecombinationMapConfigError();
+	}
+	
+#ifdef USE_GSL_POISSON
+	exp_neg_rate = exp(-rate);		// the cached values are not set up in this case
+#endif
+	
+	return p_rng.Poisson(rate, exp_neg_rate);
+}
+
 
 #endif /* defined(__SLiM__chromosome__) */
 
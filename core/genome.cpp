@@ -219,6 +219,49 @@ void Genome::TallyGenomeReferences(slim_refcount_t *p_mutrun_ref_tally, slim_ref
 	}
 }
 
+// Add the usage count of p_mutrun to the refcount of each mutation it contains, in the given refcount block
+static inline __attribute__((always_inline)) void _TallyMutationRunReferences(MutationRun *p_mutrun, slim_refcount_t *p_refcount_block)
+{
+	slim_refcount_t use_count = (slim_refcount_t)p_mutrun->UseCount();
+	
+	const MutationIndex *genome_iter = p_mutrun->begin_pointer_const();
+	const MutationIndex *genome_end_iter = p_mutrun->end_pointer_const();
+	
+	// Do 16 reps
+	while (genome_iter + 16 <= genome_end_iter)
+	{
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+	}
+	
+	// Do 4 reps
+	while (genome_iter + 4 <= genome_end_iter)
+	{
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+	}
+	
+	// Finish off
+	while (genome_iter != genome_end_iter)
+		*(p_refcount_block + (*genome_iter++)) += use_count;
+}
+
 void Genome::TallyGenomeMutationReferences(int64_t p_operation_id)
 {
 #ifdef DEBUG
@@ -233,50 +276,30 @@ void Genome::TallyGenomeMutationReferences(int64_t p_operation_id)
 		
 		if (mutrun->operation_id_ != p_operation_id)
 		{
-			slim_refcount_t use_count = (slim_refcount_t)mutrun->UseCount();
-			
-			const MutationIndex *genome_iter = mutrun->begin_pointer_const();
-			const MutationIndex *genome_end_iter = mutrun->end_pointer_const();
-			
-			// Do 16 reps
-			while (genome_iter + 16 <= genome_end_iter)
-			{
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-			}
-			
-			// Do 4 reps
-			while (genome_iter + 4 <= genome_end_iter)
-			{
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
-			}
-			
-			// Finish off
-			while (genome_iter != genome_end_iter)
-				*(refcount_block_ptr + (*genome_iter++)) += use_count;
+			_TallyMutationRunReferences(mutrun, refcount_block_ptr);
 			
 			mutrun->operation_id_ = p_operation_id;
 		}
 	}
 }
 
+void Genome::TallyGenomeMutationReferences_Concurrent(int64_t p_operation_id, slim_refcount_t *p_refcount_block)
+{
+#ifdef DEBUG
+	if (mutrun_count_ == 0)
+		NullGenomeAccessError();
+#endif
+	for (int run_index = 0; run_index < mutrun_count_; ++run_index)
+	{
+		MutationRun *mutrun = mutruns_[run_index].get();
+		
+		// Claim the run by swapping in our operation id; exactly one thread sees the old id come back, and tallies the run.
+		// Nothing else reads or writes operation_id_ while the tally threads are running, so this needs no ordering guarantees.
+		if (__atomic_exchange_n(&mutrun->operation_id_, p_operation_id, __ATOMIC_RELAXED) != p_operation_id)
+			_TallyMutationRunReferences(mutrun, p_refcount_block);
+	}
+}
+
 void Genome::MakeNull(void)
 {
 	if (mutrun_count_)
@@ -183,6 +183,9 @@ public:
 	// This tallies up individual Mutation references, using MutationRun usage counts for speed
 	void TallyGenomeMutationReferences(int64_t p_operation_id);
 	
+	// The same, but safe to call concurrently on different genomes; tallies go into p_refcount_block, which must be private to the calling thread
+	void TallyGenomeMutationReferences_Concurrent(int64_t p_operation_id, slim_refcount_t *p_refcount_block);
+	
 	inline __attribute__((always_inline)) int mutation_count(void) const	// used to be called size(); renamed to avoid confusion with MutationRun::size() and break code using the wrong method
 	{
 #ifdef DEBUG
@@ -217,6 +217,9 @@ public:
 	
 	// for Subpopulation::ExecuteMethod_takeMigrants()
 	friend Subpopulation;
+	
+	// for SLiMSim::WriteCheckpoint() and SLiMSim::_InitializePopulationFromCheckpoint()
+	friend SLiMSim;
 };
 
 
@@ -27,26 +27,167 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <limits>
+#include <unistd.h>
+#include <sys/mman.h>
 
 
 // All Mutation objects get allocated out of a single shared block, for speed; see SLiM_WarmUp()
 Mutation *gSLiM_Mutation_Block = nullptr;
-MutationIndex gSLiM_Mutation_Block_Capacity = 0;
+int64_t gSLiM_Mutation_Block_Capacity = 0;		// int64_t so that it can hold one more than the largest MutationIndex
 MutationIndex gSLiM_Mutation_FreeIndex = -1;
 MutationIndex gSLiM_Mutation_Block_LastUsedIndex = -1;
 
 slim_refcount_t *gSLiM_Mutation_Refcounts = nullptr;
 
+slim_position_t *gSLiM_Mutation_Positions = nullptr;
+MutationType **gSLiM_Mutation_Types = nullptr;
+slim_selcoeff_t *gSLiM_Mutation_OnePlusSel = nullptr;
+slim_selcoeff_t *gSLiM_Mutation_OnePlusDomSel = nullptr;
+
 #define SLIM_MUTATION_BLOCK_INITIAL_SIZE	16384		// makes for about a 1 MB block; not unreasonable
 
 extern std::vector<EidosValue_Object *> gEidosValue_Object_Mutation_Registry;	// this is in Eidos; see SLiM_IncreaseMutationBlockCapacity()
 
+// The mutation block and its parallel buffers are normally carved out of address space reserved up front with mmap().  The
+// reservation is large enough for the largest block that MutationIndex can address (or as large as the OS will give us), but
+// it is made with PROT_NONE, so it consumes no memory until pages are committed with mprotect() as the block grows.  Growing
+// therefore never moves the block, which means Mutation * pointers held by EidosValue_Object stay valid and do not need to be
+// patched, and nothing needs to be copied.  If the reservation fails altogether we fall back to the old realloc() scheme.
+static bool gSLiM_Mutation_Block_Reserved = false;
+static int64_t gSLiM_Mutation_Block_ReservedCapacity = 0;
+
+static inline size_t SLiM_MutationBlockPageSize(void)
+{
+	static size_t page_size = 0;
+	
+	if (!page_size)
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+	
+	return page_size;
+}
+
+static inline size_t SLiM_MutationBufferCommitSize(int64_t p_capacity, size_t p_element_size)
+{
+	size_t page_size = SLiM_MutationBlockPageSize();
+	
+	return ((p_capacity * p_element_size + page_size - 1) / page_size) * page_size;
+}
+
+static void *SLiM_ReserveMutationBuffer(int64_t p_capacity, size_t p_element_size)
+{
+	void *buffer = mmap(nullptr, SLiM_MutationBufferCommitSize(p_capacity, p_element_size), PROT_NONE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+	
+	return (buffer == MAP_FAILED) ? nullptr : buffer;
+}
+
+static void SLiM_ReleaseMutationBuffer(void *p_buffer, int64_t p_capacity, size_t p_element_size)
+{
+	if (p_buffer)
+		munmap(p_buffer, SLiM_MutationBufferCommitSize(p_capacity, p_element_size));
+}
+
+static void SLiM_CommitMutationBuffer(void *p_buffer, int64_t p_capacity, size_t p_element_size)
+{
+	// committing pages that are already committed is harmless, so we just commit everything up to the new capacity
+	if (mprotect(p_buffer, SLiM_MutationBufferCommitSize(p_capacity, p_element_size), PROT_READ | PROT_WRITE) != 0)
+		EIDOS_TERMINATION << "ERROR (SLiM_CommitMutationBuffer): could not commit memory for " << p_capacity << " mutations; the system may be out of memory." << EidosTerminate();
+}
+
+static size_t SLiM_ResidentBytesInMutationBuffer(void *p_buffer, int64_t p_capacity, size_t p_element_size)
+{
+	size_t page_size = SLiM_MutationBlockPageSize();
+	size_t commit_size = SLiM_MutationBufferCommitSize(p_capacity, p_element_size);
+	size_t page_count = commit_size / page_size;
+	std::vector<unsigned char> residency(page_count);
+	
+#if defined(__APPLE__)
+	if (mincore(p_buffer, commit_size, (char *)residency.data()) != 0)
+#else
+	if (mincore(p_buffer, commit_size, residency.data()) != 0)
+#endif
+		return 0;
+	
+	size_t resident_count = 0;
+	
+	for (unsigned char page_flags : residency)
+		if (page_flags & 0x01)
+			resident_count++;
+	
+	return resident_count * page_size;
+}
+
+static bool SLiM_ReserveMutationBlock(int64_t p_capacity)
+{
+	Mutation *block = (Mutation *)SLiM_ReserveMutationBuffer(p_capacity, sizeof(Mutation));
+	slim_refcount_t *refcounts = (slim_refcount_t *)SLiM_ReserveMutationBuffer(p_capacity, sizeof(slim_refcount_t));
+	slim_position_t *positions = (slim_position_t *)SLiM_ReserveMutationBuffer(p_capacity, sizeof(slim_position_t));
+	MutationType **types = (MutationType **)SLiM_ReserveMutationBuffer(p_capacity, sizeof(MutationType *));
+	slim_selcoeff_t *one_plus_sel = (slim_selcoeff_t *)SLiM_ReserveMutationBuffer(p_capacity, sizeof(slim_selcoeff_t));
+	slim_selcoeff_t *one_plus_dom_sel = (slim_selcoeff_t *)SLiM_ReserveMutationBuffer(p_capacity, sizeof(slim_selcoeff_t));
+	
+	if (!block || !refcounts || !positions || !types || !one_plus_sel || !one_plus_dom_sel)
+	{
+		SLiM_ReleaseMutationBuffer(block, p_capacity, sizeof(Mutation));
+		SLiM_ReleaseMutationBuffer(refcounts, p_capacity, sizeof(slim_refcount_t));
+		SLiM_ReleaseMutationBuffer(positions, p_capacity, sizeof(slim_position_t));
+		SLiM_ReleaseMutationBuffer(types, p_capacity, sizeof(MutationType *));
+		SLiM_ReleaseMutationBuffer(one_plus_sel, p_capacity, sizeof(slim_selcoeff_t));
+		SLiM_ReleaseMutationBuffer(one_plus_dom_sel, p_capacity, sizeof(slim_selcoeff_t));
+		return false;
+	}
+	
+	gSLiM_Mutation_Block = block;
+	gSLiM_Mutation_Refcounts = refcounts;
+	gSLiM_Mutation_Positions = positions;
+	gSLiM_Mutation_Types = types;
+	gSLiM_Mutation_OnePlusSel = one_plus_sel;
+	gSLiM_Mutation_OnePlusDomSel = one_plus_dom_sel;
+	gSLiM_Mutation_Block_ReservedCapacity = p_capacity;
+	gSLiM_Mutation_Block_Reserved = true;
+	return true;
+}
+
+static void SLiM_CommitMutationBlock(int64_t p_capacity)
+{
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_Block, p_capacity, sizeof(Mutation));
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_Refcounts, p_capacity, sizeof(slim_refcount_t));
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_Positions, p_capacity, sizeof(slim_position_t));
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_Types, p_capacity, sizeof(MutationType *));
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_OnePlusSel, p_capacity, sizeof(slim_selcoeff_t));
+	SLiM_CommitMutationBuffer(gSLiM_Mutation_OnePlusDomSel, p_capacity, sizeof(slim_selcoeff_t));
+}
+
 void SLiM_CreateMutationBlock(void)
 {
 	// first allocate the block; no need to zero the memory
 	gSLiM_Mutation_Block_Capacity = SLIM_MUTATION_BLOCK_INITIAL_SIZE;
-	gSLiM_Mutation_Block = (Mutation *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(Mutation));
-	gSLiM_Mutation_Refcounts = (slim_refcount_t *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(slim_refcount_t));
+	
+	// Reserve address space for the largest block MutationIndex can address; if the OS refuses (because of a ulimit on
+	// virtual memory, for example), keep halving the request until it succeeds or we are down to the initial size
+	int64_t reserve_capacity = (int64_t)std::numeric_limits<MutationIndex>::max() + 1;
+	
+	while (reserve_capacity >= gSLiM_Mutation_Block_Capacity)
+	{
+		if (SLiM_ReserveMutationBlock(reserve_capacity))
+			break;
+		
+		reserve_capacity /= 2;
+	}
+	
+	if (gSLiM_Mutation_Block_Reserved)
+	{
+		SLiM_CommitMutationBlock(gSLiM_Mutation_Block_Capacity);
+	}
+	else
+	{
+		gSLiM_Mutation_Block = (Mutation *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(Mutation));
+		gSLiM_Mutation_Refcounts = (slim_refcount_t *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(slim_refcount_t));
+		gSLiM_Mutation_Positions = (slim_position_t *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(slim_position_t));
+		gSLiM_Mutation_Types = (MutationType **)malloc(gSLiM_Mutation_Block_Capacity * sizeof(MutationType *));
+		gSLiM_Mutation_OnePlusSel = (slim_selcoeff_t *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(slim_selcoeff_t));
+		gSLiM_Mutation_OnePlusDomSel = (slim_selcoeff_t *)malloc(gSLiM_Mutation_Block_Capacity * sizeof(slim_selcoeff_t));
+	}
 	
 	//std::cout << "Allocating initial mutation block, " << SLIM_MUTATION_BLOCK_INITIAL_SIZE * sizeof(Mutation) << " bytes (sizeof(Mutation) == " << sizeof(Mutation) << ")" << std::endl;
 	
@@ -65,9 +206,10 @@ void SLiM_IncreaseMutationBlockCapacity(void)
 	if (!gSLiM_Mutation_Block)
 		EIDOS_TERMINATION << "ERROR (SLiM_IncreaseMutationBlockCapacity): (internal error) called before SLiM_CreateMutationBlock()." << EidosTerminate();
 	
-	// We need to expand the size of our Mutation block.  This has the consequence of invalidating
-	// every Mutation * in the program.  In general that is fine; we are careful to only keep
-	// pointers to Mutation temporarily, and for long-term reference we use MutationIndex.  The
+	// We need to expand the size of our Mutation block.  Normally the block lives in reserved address space (see above),
+	// so we just commit more pages and the block stays where it is.  In the fallback case, however, we have to realloc,
+	// which has the consequence of invalidating every Mutation * in the program.  In general that is fine; we are careful
+	// to only keep pointers to Mutation temporarily, and for long-term reference we use MutationIndex.  The
 	// exception to this is EidosValue_Object; the user can put references to mutations into
 	// variables that need to remain valid across reallocs like this.  We therefore have to hunt
 	// down every EidosValue_Object that contains Mutations, and fix the pointer inside each of
@@ -75,15 +217,42 @@ void SLiM_IncreaseMutationBlockCapacity(void)
 	// the moment, in SLiMgui this patching has to occur across all of the simulations, not just
 	// the one that made this call.  Yes, this is very gross.  This is why pointers are evil.  :->
 	
-	// First let's do our realloc.  We just need to note the change in value for the pointer.
+	// First let's grow the block.  We just need to note the change in value for the pointer.
 	// For now we will just double in size; we don't want to waste too much memory, but we
-	// don't want to have to realloc too often, either.
+	// don't want to have to grow too often, either.
 	std::uintptr_t old_mutation_block = reinterpret_cast<std::uintptr_t>(gSLiM_Mutation_Block);
-	MutationIndex old_block_capacity = gSLiM_Mutation_Block_Capacity;
+	MutationIndex old_block_capacity = (MutationIndex)gSLiM_Mutation_Block_Capacity;
 	
-	gSLiM_Mutation_Block_Capacity *= 2;
-	gSLiM_Mutation_Block = (Mutation *)realloc(gSLiM_Mutation_Block, gSLiM_Mutation_Block_Capacity * sizeof(Mutation));
-	gSLiM_Mutation_Refcounts = (slim_refcount_t *)realloc(gSLiM_Mutation_Refcounts, gSLiM_Mutation_Block_Capacity * sizeof(slim_refcount_t));
+	// The block can't grow beyond the range of MutationIndex; this matters mostly for builds with 16-bit indices
+	int64_t max_block_capacity = (int64_t)std::numeric_limits<MutationIndex>::max() + 1;
+	
+	if (gSLiM_Mutation_Block_Capacity >= max_block_capacity)
+	{
+#if SLIM_MUTATION_INDEX_16BIT
+		EIDOS_TERMINATION << "ERROR (SLiM_IncreaseMutationBlockCapacity): this build of SLiM uses 16-bit mutation indices, which limits a model to " << max_block_capacity << " mutations at a time; use a build without SLIM_MUTATION_INDEX_16BIT for this model." << EidosTerminate();
+#else
+		EIDOS_TERMINATION << "ERROR (SLiM_IncreaseMutationBlockCapacity): the mutation block is limited to " << max_block_capacity << " mutations at a time, and that limit has been reached." << EidosTerminate();
+#endif
+	}
+	
+	if (gSLiM_Mutation_Block_Reserved)
+	{
+		if (gSLiM_Mutation_Block_Capacity >= gSLiM_Mutation_Block_ReservedCapacity)
+			EIDOS_TERMINATION << "ERROR (SLiM_IncreaseMutationBlockCapacity): the address space reserved for the mutation block is limited to " << gSLiM_Mutation_Block_ReservedCapacity << " mutations at a time, and that limit has been reached; a limit on virtual memory (ulimit -v) may be preventing a larger reservation." << EidosTerminate();
+		
+		gSLiM_Mutation_Block_Capacity = std::min(gSLiM_Mutation_Block_Capacity * 2, gSLiM_Mutation_Block_ReservedCapacity);
+		SLiM_CommitMutationBlock(gSLiM_Mutation_Block_Capacity);
+	}
+	else
+	{
+		gSLiM_Mutation_Block_Capacity = std::min(gSLiM_Mutation_Block_Capacity * 2, max_block_capacity);
+		gSLiM_Mutation_Block = (Mutation *)realloc(gSLiM_Mutation_Block, gSLiM_Mutation_Block_Capacity * sizeof(Mutation));
+		gSLiM_Mutation_Refcounts = (slim_refcount_t *)realloc(gSLiM_Mutation_Refcounts, gSLiM_Mutation_Block_Capacity * sizeof(slim_refcount_t));
+		gSLiM_Mutation_Positions = (slim_position_t *)realloc(gSLiM_Mutation_Positions, gSLiM_Mutation_Block_Capacity * sizeof(slim_position_t));
+		gSLiM_Mutation_Types = (MutationType **)realloc(gSLiM_Mutation_Types, gSLiM_Mutation_Block_Capacity * sizeof(MutationType *));
+		gSLiM_Mutation_OnePlusSel = (slim_selcoeff_t *)realloc(gSLiM_Mutation_OnePlusSel, gSLiM_Mutation_Block_Capacity * sizeof(slim_selcoeff_t));
+		gSLiM_Mutation_OnePlusDomSel = (slim_selcoeff_t *)realloc(gSLiM_Mutation_OnePlusDomSel, gSLiM_Mutation_Block_Capacity * sizeof(slim_selcoeff_t));
+	}
 	
 	std::uintptr_t new_mutation_block = reinterpret_cast<std::uintptr_t>(gSLiM_Mutation_Block);
 	
@@ -96,7 +265,7 @@ void SLiM_IncreaseMutationBlockCapacity(void)
 	
 	gSLiM_Mutation_FreeIndex = old_block_capacity;
 	
-	// Now we go out and fix Mutation * references in EidosValue_Object in all symbol tables
+	// Now we go out and fix Mutation * references in EidosValue_Object in all symbol tables; this only happens with realloc()
 	if (new_mutation_block != old_mutation_block)
 	{
 		// This may be excessively cautious, but I want to avoid subtracting these uintptr_t values
@@ -170,6 +339,31 @@ size_t SLiM_MemoryUsageForMutationRefcounts(void)
 	return gSLiM_Mutation_Block_Capacity * sizeof(slim_refcount_t);
 }
 
+size_t SLiM_MemoryUsageForMutationHotFields(void)
+{
+	return gSLiM_Mutation_Block_Capacity * (sizeof(slim_position_t) + sizeof(MutationType *) + sizeof(slim_selcoeff_t) + sizeof(slim_selcoeff_t));
+}
+
+size_t SLiM_MemoryResidentForMutationBlock(void)
+{
+	// The three functions above report committed memory; this reports how much of it is actually resident in physical
+	// memory right now, which can be much less since the OS only supplies pages as they are first touched.  Without a
+	// reservation we can't ask, so we just report everything as resident.
+	if (!gSLiM_Mutation_Block_Reserved)
+		return SLiM_MemoryUsageForMutationBlock() + SLiM_MemoryUsageForMutationRefcounts() + SLiM_MemoryUsageForMutationHotFields();
+	
+	size_t resident = 0;
+	
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_Block, gSLiM_Mutation_Block_Capacity, sizeof(Mutation));
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_Refcounts, gSLiM_Mutation_Block_Capacity, sizeof(slim_refcount_t));
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_Positions, gSLiM_Mutation_Block_Capacity, sizeof(slim_position_t));
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_Types, gSLiM_Mutation_Block_Capacity, sizeof(MutationType *));
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_OnePlusSel, gSLiM_Mutation_Block_Capacity, sizeof(slim_selcoeff_t));
+	resident += SLiM_ResidentBytesInMutationBuffer(gSLiM_Mutation_OnePlusDomSel, gSLiM_Mutation_Block_Capacity, sizeof(slim_selcoeff_t));
+	
+	return resident;
+}
+
 
 #pragma mark -
 #pragma mark Mutation
@@ -181,12 +375,15 @@ slim_mutationid_t gSLiM_next_mutation_id = 0;
 Mutation::Mutation(MutationType *p_mutation_type_ptr, slim_position_t p_position, double p_selection_coeff, slim_objectid_t p_subpop_index, slim_generation_t p_generation) :
 mutation_type_ptr_(p_mutation_type_ptr), position_(p_position), selection_coeff_(static_cast<slim_selcoeff_t>(p_selection_coeff)), subpop_index_(p_subpop_index), origin_generation_(p_generation), mutation_id_(gSLiM_next_mutation_id++)
 {
-	// cache values used by the fitness calculation code for speed; see header
-	cached_one_plus_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + selection_coeff_);
-	cached_one_plus_dom_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + mutation_type_ptr_->dominance_coeff_ * selection_coeff_);
+	// set up our entries in the hot-field buffers used by the fitness and crossover-mutation code; see header
+	MutationIndex block_index = BlockIndex();
+	
+	gSLiM_Mutation_Positions[block_index] = position_;
+	gSLiM_Mutation_Types[block_index] = mutation_type_ptr_;
+	CacheFitnessValues();
 	
 	// zero out our refcount, which is now kept in a separate buffer
-	gSLiM_Mutation_Refcounts[BlockIndex()] = 0;
+	gSLiM_Mutation_Refcounts[block_index] = 0;
 	
 #if DEBUG_MUTATIONS
 	SLIM_OUTSTREAM << "Mutation constructed: " << this << std::endl;
@@ -196,12 +393,15 @@ mutation_type_ptr_(p_mutation_type_ptr), position_(p_position), selection_coeff_
 Mutation::Mutation(slim_mutationid_t p_mutation_id, MutationType *p_mutation_type_ptr, slim_position_t p_position, double p_selection_coeff, slim_objectid_t p_subpop_index, slim_generation_t p_generation) :
 mutation_type_ptr_(p_mutation_type_ptr), position_(p_position), selection_coeff_(static_cast<slim_selcoeff_t>(p_selection_coeff)), subpop_index_(p_subpop_index), origin_generation_(p_generation), mutation_id_(p_mutation_id)
 {
-	// cache values used by the fitness calculation code for speed; see header
-	cached_one_plus_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + selection_coeff_);
-	cached_one_plus_dom_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + mutation_type_ptr_->dominance_coeff_ * selection_coeff_);
-
+	// set up our entries in the hot-field buffers used by the fitness and crossover-mutation code; see header
+	MutationIndex block_index = BlockIndex();
+	
+	gSLiM_Mutation_Positions[block_index] = position_;
+	gSLiM_Mutation_Types[block_index] = mutation_type_ptr_;
+	CacheFitnessValues();
+	
 	// zero out our refcount, which is now kept in a separate buffer
-	gSLiM_Mutation_Refcounts[BlockIndex()] = 0;
+	gSLiM_Mutation_Refcounts[block_index] = 0;
 	
 #if DEBUG_MUTATIONS
 	SLIM_OUTSTREAM << "Mutation constructed: " << this << std::endl;
@@ -212,6 +412,14 @@ mutation_type_ptr_(p_mutation_type_ptr), position_(p_position), selection_coeff_
 		gSLiM_next_mutation_id = mutation_id_ + 1;
 }
 
+void Mutation::CacheFitnessValues(void)
+{
+	MutationIndex block_index = BlockIndex();
+	
+	gSLiM_Mutation_OnePlusSel[block_index] = (slim_selcoeff_t)std::max(0.0, 1.0 + selection_coeff_);
+	gSLiM_Mutation_OnePlusDomSel[block_index] = (slim_selcoeff_t)std::max(0.0, 1.0 + mutation_type_ptr_->dominance_coeff_ * selection_coeff_);
+}
+
 // This is unused except by debugging code and in the debugger itself
 std::ostream &operator<<(std::ostream &p_outstream, const Mutation &p_mutation)
 {
@@ -460,24 +668,19 @@ EidosValue_SP Mutation::ExecuteMethod_setSelectionCoeff(EidosGlobalStringID p_me
 		
 		sim.pure_neutral_ = false;							// let the sim know that it is no longer a pure-neutral simulation
 		mutation_type_ptr_->all_pure_neutral_DFE_ = false;	// let the mutation type for this mutation know that it is no longer pure neutral
-		
-		// If a selection coefficient has changed from zero to non-zero, or vice versa, MutationRun's nonneutral mutation caches need revalidation
-		if (old_coeff == 0.0)
-		{
-			sim.nonneutral_change_counter_++;
-		}
 	}
-	else if (old_coeff != 0.0)	// && (selection_coeff_ == 0.0) implied by the "else"
+	
+	// If a selection coefficient has changed at all, MutationRun's nonneutral mutation caches need revalidation; a change between zero
+	// and non-zero changes which mutations are cached, and any other change changes the cached fitness products (see mutation_run.h)
+	if (selection_coeff_ != old_coeff)
 	{
 		SLiMSim &sim = SLiM_GetSimFromInterpreter(p_interpreter);
 		
-		// If a selection coefficient has changed from zero to non-zero, or vice versa, MutationRun's nonneutral mutation caches need revalidation
 		sim.nonneutral_change_counter_++;
 	}
 	
 	// cache values used by the fitness calculation code for speed; see header
-	cached_one_plus_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + selection_coeff_);
-	cached_one_plus_dom_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + mutation_type_ptr_->dominance_coeff_ * selection_coeff_);
+	CacheFitnessValues();
 	
 	return gStaticEidosValueVOID;
 }
@@ -494,14 +697,17 @@ EidosValue_SP Mutation::ExecuteMethod_setMutationType(EidosGlobalStringID p_meth
 	
 	// We take just the mutation type pointer; if the user wants a new selection coefficient, they can do that themselves
 	mutation_type_ptr_ = mutation_type_ptr;
+	gSLiM_Mutation_Types[BlockIndex()] = mutation_type_ptr;
+	
+	// The dominance coefficient may have changed, changing the cached fitness products in MutationRun (see mutation_run.h)
+	sim.nonneutral_change_counter_++;
 	
 	// If we are non-neutral, make sure the mutation type knows it is now also non-neutral; I think this is unnecessary but being safe...
 	if (selection_coeff_ != 0.0)
 		mutation_type_ptr_->all_pure_neutral_DFE_ = false;
 	
 	// cache values used by the fitness calculation code for speed; see header
-	cached_one_plus_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + selection_coeff_);
-	cached_one_plus_dom_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + mutation_type_ptr_->dominance_coeff_ * selection_coeff_);
+	CacheFitnessValues();
 	
 	return gStaticEidosValueVOID;
 }
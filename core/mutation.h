@@ -46,11 +46,16 @@ extern slim_mutationid_t gSLiM_next_mutation_id;
 // Note that type int32_t is used instead of uint32_t so that -1 can be used as a "null pointer"; perhaps UINT32_MAX would be
 // better, but on the other hand using int32_t has the virtue that if we run out of room we will probably crash hard rather
 // than perhaps just silently overrunning gSLiM_Mutation_Block with mysterious memory corruption bugs that are hard to catch.
-// For small simulations, defining this as int16_t instead can produce a substantial speedup (as much as 25%), but there are no
-// safeguards in the code to check for running out of indices, so doing that is quite dangerous at present.  A way to make
-// simulations switch from 16-bit to 32-bit at runtime, to get that speedup when possible, would be nice but in practice is very
-// difficult to code since MutationRun's internal buffer of MutationIndex is accessible and used directly by many clients.
+// For small simulations, defining this as int16_t instead can produce a substantial speedup (as much as 25%).  That can be
+// done at build time by defining SLIM_MUTATION_INDEX_16BIT (see CMakeLists.txt); SLiM_IncreaseMutationBlockCapacity() then
+// refuses to grow the block beyond the range of int16_t, so a model that outgrows 16-bit indices stops with an error instead
+// of corrupting memory.  A way to make simulations switch from 16-bit to 32-bit at runtime would be nicer, but in practice
+// is very difficult to code since MutationRun's internal buffer of MutationIndex is accessible and used directly by many clients.
+#if SLIM_MUTATION_INDEX_16BIT
+typedef int16_t MutationIndex;
+#else
 typedef int32_t MutationIndex;
+#endif
 
 // forward declaration of Mutation block allocation; see bottom of header
 class Mutation;
@@ -76,12 +81,9 @@ public:
 	mutable slim_refcount_t gui_scratch_reference_count_;	// an additional refcount used for temporary tallies by SLiMgui, valid only when explicitly updated
 #endif
 	
-	// We cache values used in the fitness calculation code, for speed.  These are the final fitness effects of this mutation
-	// when it is homozygous or heterozygous, respectively.  These values are clamped to a minimum of 0.0, so that multiplying
-	// by them cannot cause the fitness of the individual to go below 0.0, avoiding slow tests in the core fitness loop.  These
-	// values use slim_selcoeff_t for speed; roundoff should not be a concern, since such differences would be inconsequential.
-	slim_selcoeff_t cached_one_plus_sel_;				// a cached value for (1 + selection_coeff_), clamped to 0.0 minimum
-	slim_selcoeff_t cached_one_plus_dom_sel_;			// a cached value for (1 + dominance_coeff * selection_coeff_), clamped to 0.0 minimum
+	// The values used by the fitness calculation code are cached for speed, but not in the Mutation object itself; they live in the
+	// hot-field buffers parallel to gSLiM_Mutation_Block (see below).  CacheFitnessValues() updates them, and must be called whenever
+	// selection_coeff_, mutation_type_ptr_, or the dominance coefficient of mutation_type_ptr_ changes.
 	
 	Mutation(const Mutation&) = delete;					// no copying
 	Mutation& operator=(const Mutation&) = delete;		// no copying
@@ -101,6 +103,7 @@ public:
 	
 	
 	inline __attribute__((always_inline)) MutationIndex BlockIndex(void) const			{ return (MutationIndex)(this - gSLiM_Mutation_Block); }
+	void CacheFitnessValues(void);
 	
 	//
 	// Eidos support
@@ -150,8 +153,9 @@ std::ostream &operator<<(std::ostream &p_outstream, const Mutation &p_mutation);
 //
 
 // All Mutation objects get allocated out of a single shared pool, for speed.  We do not use EidosObjectPool for this
-// any more, because we need the allocation to be out of a single contiguous block of memory that we realloc as needed,
-// allowing Mutation objects to be referred to using 32-bit indexes into this contiguous block.  So we have a custom
+// any more, because we need the allocation to be out of a single contiguous block of memory that we grow as needed,
+// allowing Mutation objects to be referred to using 32-bit indexes into this contiguous block.  The block normally grows
+// in place, within address space reserved for it up front, so Mutation objects never move; see mutation.cpp.  So we have a custom
 // pool, declared here and implemented in mutation.cpp.  Note that this is a global, to make it easy for users of
 // MutationIndex to look up mutations without needing to track down a pointer to the mutation block from the sim.  This
 // means that in SLiMgui a single block will be used for all mutations in all simulations; that should be harmless.
@@ -162,12 +166,27 @@ extern MutationIndex gSLiM_Mutation_FreeIndex;
 extern MutationIndex gSLiM_Mutation_Block_LastUsedIndex;
 
 extern slim_refcount_t *gSLiM_Mutation_Refcounts;	// an auxiliary buffer, parallel to gSLiM_Mutation_Block, to increase memory cache efficiency
-													// note that I tried keeping the fitness cache values and positions in separate buffers too, not a win
+
+// Hot-field buffers, also parallel to gSLiM_Mutation_Block.  The inner loops of fitness calculation and crossover-mutation
+// touch only a mutation's position, type, and fitness effects; reading those out of the much larger Mutation objects wastes
+// most of every cache line fetched, so these small fields are mirrored here in dense arrays indexed by MutationIndex.  The
+// position and mutation type are copies of the fields in Mutation, set by the constructor and by setMutationType(); the
+// fitness values are the final fitness effects of the mutation when homozygous or heterozygous, respectively, and exist only
+// here.  The fitness values are clamped to a minimum of 0.0, so that multiplying by them cannot cause the fitness of the
+// individual to go below 0.0, avoiding slow tests in the core fitness loop.  They use slim_selcoeff_t for speed; roundoff
+// should not be a concern, since such differences would be inconsequential.  Entries for free slots in the block are garbage.
+extern slim_position_t *gSLiM_Mutation_Positions;		// a copy of position_ for each mutation
+extern MutationType **gSLiM_Mutation_Types;				// a copy of mutation_type_ptr_ for each mutation
+extern slim_selcoeff_t *gSLiM_Mutation_OnePlusSel;		// (1 + selection_coeff_), clamped to 0.0 minimum
+extern slim_selcoeff_t *gSLiM_Mutation_OnePlusDomSel;	// (1 + dominance_coeff * selection_coeff_), clamped to 0.0 minimum
+
 void SLiM_CreateMutationBlock(void);
 void SLiM_IncreaseMutationBlockCapacity(void);
 void SLiM_ZeroRefcountBlock(MutationRun &p_mutation_registry);
 size_t SLiM_MemoryUsageForMutationBlock(void);
 size_t SLiM_MemoryUsageForMutationRefcounts(void);
+size_t SLiM_MemoryUsageForMutationHotFields(void);
+size_t SLiM_MemoryResidentForMutationBlock(void);	// the part of the three buffers above that is resident in physical memory
 
 inline __attribute__((always_inline)) MutationIndex SLiM_NewMutationFromBlock(void)
 {
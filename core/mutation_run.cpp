@@ -65,9 +65,8 @@ bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 // binary search
 bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 {
-	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
-	Mutation *mutation = gSLiM_Mutation_Block + p_mutation_index;
-	slim_position_t position = mutation->position_;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	slim_position_t position = position_ptr[p_mutation_index];
 	int mut_count = size();
 	const MutationIndex *mut_ptr = begin_pointer_const();
 	int mut_index;
@@ -85,7 +84,7 @@ bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 					return false;
 				
 				mut_index = (L + R) >> 1;	// overflow-safe because base positions have a max of 1000000000L
-				mut_pos = (mut_block_ptr + mut_ptr[mut_index])->position_;
+				mut_pos = position_ptr[mut_ptr[mut_index]];
 				
 				if (mut_pos < position)
 				{
@@ -118,7 +117,7 @@ bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 		{
 			const MutationIndex scan_mut_index = mut_ptr[--back_scan];
 			
-			if ((mut_block_ptr + scan_mut_index)->position_ != position)
+			if (position_ptr[scan_mut_index] != position)
 				break;
 			if (scan_mut_index == p_mutation_index)
 				return true;
@@ -132,7 +131,7 @@ bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 		{
 			const MutationIndex scan_mut_index = mut_ptr[++forward_scan];
 			
-			if ((mut_block_ptr + scan_mut_index)->position_ != position)
+			if (position_ptr[scan_mut_index] != position)
 				break;
 			if (scan_mut_index == p_mutation_index)
 				return true;
@@ -146,6 +145,8 @@ bool MutationRun::contains_mutation(MutationIndex p_mutation_index)
 Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type, slim_position_t p_position, slim_position_t p_last_position)
 {
 	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	MutationType **mut_type_ptr = gSLiM_Mutation_Types;
 	int mut_count = size();
 	const MutationIndex *mut_ptr = begin_pointer_const();
 	int mut_index;
@@ -157,10 +158,10 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 		if (mut_count == 0)
 			return nullptr;
 		
-		if ((mut_block_ptr + mut_ptr[0])->position_ > 0)
+		if (position_ptr[mut_ptr[0]] > 0)
 			return nullptr;
 		
-		if ((mut_block_ptr + mut_ptr[0])->mutation_type_ptr_ == p_mut_type)
+		if (mut_type_ptr[mut_ptr[0]] == p_mut_type)
 			return (mut_block_ptr + mut_ptr[0]);
 		
 		mut_index = 0;	// drop through to forward scan
@@ -174,10 +175,10 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 		
 		mut_index = mut_count - 1;
 		
-		if ((mut_block_ptr + mut_ptr[mut_index])->position_ < p_last_position)
+		if (position_ptr[mut_ptr[mut_index]] < p_last_position)
 			return nullptr;
 		
-		if ((mut_block_ptr + mut_ptr[mut_index])->mutation_type_ptr_ == p_mut_type)
+		if (mut_type_ptr[mut_ptr[mut_index]] == p_mut_type)
 			return (mut_block_ptr + mut_ptr[mut_index]);
 		
 		// drop through to backward scan
@@ -196,7 +197,7 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 					return nullptr;
 				
 				mut_index = (L + R) >> 1;	// overflow-safe because base positions have a max of 1000000000L
-				mut_pos = (mut_block_ptr + mut_ptr[mut_index])->position_;
+				mut_pos = position_ptr[mut_ptr[mut_index]];
 				
 				if (mut_pos < p_position)
 				{
@@ -217,7 +218,7 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 		
 		// The mutation at mut_index is at p_position, but it may not be the only such
 		// We check it first, then we check before it scanning backwards, and check after it scanning forwards
-		if ((mut_block_ptr + mut_ptr[mut_index])->mutation_type_ptr_ == p_mut_type)
+		if (mut_type_ptr[mut_ptr[mut_index]] == p_mut_type)
 			return (mut_block_ptr + mut_ptr[mut_index]);
 	}
 	
@@ -229,9 +230,9 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 		{
 			const MutationIndex scan_mut_index = mut_ptr[--back_scan];
 			
-			if ((mut_block_ptr + scan_mut_index)->position_ != p_position)
+			if (position_ptr[scan_mut_index] != p_position)
 				break;
-			if ((mut_block_ptr + scan_mut_index)->mutation_type_ptr_ == p_mut_type)
+			if (mut_type_ptr[scan_mut_index] == p_mut_type)
 				return (mut_block_ptr + scan_mut_index);
 		}
 	}
@@ -243,9 +244,9 @@ Mutation *MutationRun::mutation_with_type_and_position(MutationType *p_mut_type,
 		{
 			const MutationIndex scan_mut_index = mut_ptr[++forward_scan];
 			
-			if ((mut_block_ptr + scan_mut_index)->position_ != p_position)
+			if (position_ptr[scan_mut_index] != p_position)
 				break;
-			if ((mut_block_ptr + scan_mut_index)->mutation_type_ptr_ == p_mut_type)
+			if (mut_type_ptr[scan_mut_index] == p_mut_type)
 				return (mut_block_ptr + scan_mut_index);
 		}
 	}
@@ -347,7 +348,8 @@ bool MutationRun::_EnforceStackPolicyForAddition(slim_position_t p_position, Mut
 {
 	MutationIndex *begin_ptr = begin_pointer();
 	MutationIndex *end_ptr = end_pointer();
-	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	MutationType **mut_type_ptr = gSLiM_Mutation_Types;
 	
 	if (p_policy == MutationStackPolicy::kKeepFirst)
 	{
@@ -355,10 +357,10 @@ bool MutationRun::_EnforceStackPolicyForAddition(slim_position_t p_position, Mut
 		// We scan in reverse order, because usually we're adding mutations on the end with emplace_back()
 		for (MutationIndex *mut_ptr = end_ptr - 1; mut_ptr >= begin_ptr; --mut_ptr)
 		{
-			Mutation *mut = mut_block_ptr + *mut_ptr;
-			slim_position_t mut_position = mut->position_;
+			MutationIndex mut_index = *mut_ptr;
+			slim_position_t mut_position = position_ptr[mut_index];
 			
-			if ((mut_position == p_position) && (mut->mutation_type_ptr_->stack_group_ == p_stack_group))
+			if ((mut_position == p_position) && (mut_type_ptr[mut_index]->stack_group_ == p_stack_group))
 				return false;
 			else if (mut_position < p_position)
 				return true;
@@ -374,10 +376,10 @@ bool MutationRun::_EnforceStackPolicyForAddition(slim_position_t p_position, Mut
 		
 		for (MutationIndex *mut_ptr = end_ptr - 1; mut_ptr >= begin_ptr; --mut_ptr)
 		{
-			Mutation *mut = mut_block_ptr + *mut_ptr;
-			slim_position_t mut_position = mut->position_;
+			MutationIndex mut_index = *mut_ptr;
+			slim_position_t mut_position = position_ptr[mut_index];
 			
-			if ((mut_position == p_position) && (mut->mutation_type_ptr_->stack_group_ == p_stack_group))
+			if ((mut_position == p_position) && (mut_type_ptr[mut_index]->stack_group_ == p_stack_group))
 				first_match_ptr = mut_ptr;	// set repeatedly as we scan backwards, until we exit
 			else if (mut_position < p_position)
 				break;
@@ -392,10 +394,9 @@ bool MutationRun::_EnforceStackPolicyForAddition(slim_position_t p_position, Mut
 			for ( ; mut_ptr < end_ptr; ++mut_ptr)
 			{
 				MutationIndex mut_index = *mut_ptr;
-				Mutation *mut = mut_block_ptr + mut_index;
-				slim_position_t mut_position = mut->position_;
+				slim_position_t mut_position = position_ptr[mut_index];
 				
-				if ((mut_position == p_position) && (mut->mutation_type_ptr_->stack_group_ == p_stack_group))
+				if ((mut_position == p_position) && (mut_type_ptr[mut_index]->stack_group_ == p_stack_group))
 				{
 					// The current scan position is a mutation that needs to be removed, so scan forward to skip copying it backward
 					continue;
@@ -423,8 +424,10 @@ void MutationRun::split_run(MutationRun **p_first_half, MutationRun **p_second_h
 	MutationRun *second_half = NewMutationRun();
 	int32_t second_half_start;
 	
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	
 	for (second_half_start = 0; second_half_start < mutation_count_; ++second_half_start)
-		if ((gSLiM_Mutation_Block + mutations_[second_half_start])->position_ >= p_split_first_position)
+		if (position_ptr[mutations_[second_half_start]] >= p_split_first_position)
 			break;
 	
 	if (second_half_start > 0)
@@ -613,61 +616,45 @@ void MutationRun::clear_set_and_merge(MutationRun &p_mutations_to_set, MutationR
 	}
 	
 	// then interleave mutations together, effectively setting p_mutations_to_set and then adding in p_mutations_to_add
-	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	MutationType **mut_type_ptr = gSLiM_Mutation_Types;
 	const MutationIndex *mutation_iter		= p_mutations_to_add.begin_pointer_const();
 	const MutationIndex *mutation_iter_max	= p_mutations_to_add.end_pointer_const();
-	MutationIndex mutation_iter_mutation_index = *mutation_iter;
-	slim_position_t mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
 	
 	const MutationIndex *parent_iter		= p_mutations_to_set.begin_pointer_const();
 	const MutationIndex *parent_iter_max	= p_mutations_to_set.end_pointer_const();
-	MutationIndex parent_iter_mutation_index = *parent_iter;
-	slim_position_t parent_iter_pos = (mut_block_ptr + parent_iter_mutation_index)->position_;
 	
-	// this loop runs while we are still interleaving mutations from both sources
+	// this loop runs while we are still interleaving mutations from both sources; new mutations are usually few and far between,
+	// so we copy the whole stretch of parent mutations at or before the next new mutation in bulk (parent mutations come first
+	// when positions are equal), and then add the new mutation itself
 	do
 	{
-		if (parent_iter_pos <= mutation_iter_pos)
-		{
-			// we have a parent mutation that comes first, so copy it
-			emplace_back(*parent_iter);
-			
-			parent_iter++;
-			if (parent_iter == parent_iter_max)
-				break;
-			
-			parent_iter_mutation_index = *parent_iter;
-			parent_iter_pos = (mut_block_ptr + parent_iter_mutation_index)->position_;
-		}
-		else
-		{
-			// we have a new mutation to add, which we know is not already present; check the stacking policy
-			if (enforce_stack_policy_for_addition(mutation_iter_pos, (mut_block_ptr + mutation_iter_mutation_index)->mutation_type_ptr_))
-				emplace_back(mutation_iter_mutation_index);
-			
-			mutation_iter++;
-			if (mutation_iter == mutation_iter_max)
-				break;
-			
-			mutation_iter_mutation_index = *mutation_iter;
-			mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
-		}
+		MutationIndex mutation_iter_mutation_index = *mutation_iter;
+		slim_position_t mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
+		const MutationIndex *parent_segment_end = position_lower_bound(parent_iter, parent_iter_max, mutation_iter_pos + 1);
+		
+		emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+		parent_iter = parent_segment_end;
+		
+		if (parent_iter == parent_iter_max)
+			break;
+		
+		// we have a new mutation to add, which we know is not already present; check the stacking policy
+		if (enforce_stack_policy_for_addition(mutation_iter_pos, mut_type_ptr[mutation_iter_mutation_index]))
+			emplace_back(mutation_iter_mutation_index);
+		
+		mutation_iter++;
 	}
-	while (true);
+	while (mutation_iter != mutation_iter_max);
 	
 	// one source is exhausted, but there are still mutations left in the other source
-	while (parent_iter != parent_iter_max)
-	{
-		emplace_back(*parent_iter);
-		parent_iter++;
-	}
+	emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 	
 	while (mutation_iter != mutation_iter_max)
 	{
-		mutation_iter_mutation_index = *mutation_iter;
-		mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+		MutationIndex mutation_iter_mutation_index = *mutation_iter;
 		
-		if (enforce_stack_policy_for_addition(mutation_iter_pos, (mut_block_ptr + mutation_iter_mutation_index)->mutation_type_ptr_))
+		if (enforce_stack_policy_for_addition(position_ptr[mutation_iter_mutation_index], mut_type_ptr[mutation_iter_mutation_index]))
 			emplace_back(mutation_iter_mutation_index);
 		
 		mutation_iter++;
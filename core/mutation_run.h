@@ -136,12 +136,23 @@ private:
 	// These caches are only used for mutation runs that are accessed by the FitnessOfParentWithGenomeIndices...()
 	// suite of methods; pure neutral models and non-chromosome-dependent models will never touch these caches
 	// and the buffer will never be allocated.
+	//
+	// Along with the nonneutral cache, we keep the products of the cached homozygous and heterozygous fitness
+	// effects of the mutations in it, computed whenever the cache is rebuilt.  In the no-callback case these let
+	// FitnessOfParentWithGenomeIndices_NoCallbacks() skip the merge walk when both genomes share the same run
+	// (every mutation is homozygous) or when one genome's run has no nonneutral mutations (every mutation in the
+	// other run is heterozygous).  Since the products depend on the fitness effects themselves, and not just on
+	// neutral versus nonneutral, nonneutral_change_counter_ is also incremented whenever the selection coefficient,
+	// mutation type, or dominance coefficient of an existing mutation changes, so that the products get recomputed.
 	
 	int32_t nonneutral_mutation_capacity_ = 0;					// the capacity of nonneutral_mutations_
 	int32_t nonneutral_mutations_count_ = -1;					// the number of entries currently used; -1 indicates an invalid cache
 	MutationIndex *nonneutral_mutations_ = nullptr;				// OWNED POINTER: a pointer to MutationIndex for non-neutral mutations
 	
 	int32_t nonneutral_change_validation_ = 0;					// compared to sim.nonneutral_change_counter_ to detect changes
+	
+	double nonneutral_homozygous_product_ = 1.0;				// product of gSLiM_Mutation_OnePlusSel over nonneutral_mutations_
+	double nonneutral_heterozygous_product_ = 1.0;				// product of gSLiM_Mutation_OnePlusDomSel over nonneutral_mutations_
 
 #if defined(SLIMGUI) && (SLIMPROFILING == 1)
 // PROFILING
@@ -516,6 +527,50 @@ public:
 	// must be guaranteed that none of the mutations in the two given runs are the same.
 	void clear_set_and_merge(MutationRun &p_mutations_to_set, MutationRun &p_mutations_to_add);
 	
+	// Find the first mutation in [p_begin, p_end) with a position >= p_position; the range must be sorted by position, as in any
+	// mutation run.  This lets merges and crossovers find the end of a segment and then copy it with emplace_back_bulk(), instead
+	// of looking up the position of every mutation in the segment.  We gallop forward (probing 1, 2, 4, ... ahead) and then binary
+	// search, so short segments, which are the common case, cost only a few lookups, and long segments cost O(log n) lookups.
+	static inline __attribute__((always_inline)) const MutationIndex *position_lower_bound(const MutationIndex *p_begin, const MutationIndex *p_end, slim_position_t p_position)
+	{
+		slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+		ptrdiff_t count = p_end - p_begin;
+		
+		if ((count == 0) || (position_ptr[*p_begin] >= p_position))
+			return p_begin;
+		
+		// the mutation at low is known to be before p_position; the mutation at high (if high < count) is known to be at or after it
+		ptrdiff_t low = 0, high, step = 1;
+		
+		while (true)
+		{
+			high = low + step;
+			
+			if (high >= count)
+			{
+				high = count;
+				break;
+			}
+			if (position_ptr[p_begin[high]] >= p_position)
+				break;
+			
+			low = high;
+			step <<= 1;
+		}
+		
+		while (high - low > 1)
+		{
+			ptrdiff_t mid = low + ((high - low) >> 1);
+			
+			if (position_ptr[p_begin[mid]] >= p_position)
+				high = mid;
+			else
+				low = mid;
+		}
+		
+		return p_begin + high;
+	}
+	
 	// This is used by the tree sequence recording code to get the full derived state at a given position.
 	// Note that the vector returned is cached internally and reused with each call, for speed.
 	const std::vector<Mutation *> *derived_mutation_ids_at_position(slim_position_t p_position) const;
@@ -632,7 +687,27 @@ public:
 	
 	void check_nonneutral_mutation_cache();
 	
-	inline __attribute__((always_inline)) void beginend_nonneutral_pointers(const MutationIndex **p_mutptr_iter, const MutationIndex **p_mutptr_max, int32_t p_nonneutral_change_counter, int32_t p_nonneutral_regime)
+	inline __attribute__((always_inline)) void cache_nonneutral_fitness_products(void)
+	{
+		const MutationIndex *mut_iter = nonneutral_mutations_;
+		const MutationIndex *mut_iter_max = nonneutral_mutations_ + nonneutral_mutations_count_;
+		slim_selcoeff_t *one_plus_sel_ptr = gSLiM_Mutation_OnePlusSel;
+		slim_selcoeff_t *one_plus_dom_sel_ptr = gSLiM_Mutation_OnePlusDomSel;
+		double homozygous_product = 1.0, heterozygous_product = 1.0;
+		
+		while (mut_iter != mut_iter_max)
+		{
+			MutationIndex mut_index = *mut_iter++;
+			
+			homozygous_product *= one_plus_sel_ptr[mut_index];
+			heterozygous_product *= one_plus_dom_sel_ptr[mut_index];
+		}
+		
+		nonneutral_homozygous_product_ = homozygous_product;
+		nonneutral_heterozygous_product_ = heterozygous_product;
+	}
+	
+	inline __attribute__((always_inline)) void validate_nonneutral_cache(int32_t p_nonneutral_change_counter, int32_t p_nonneutral_regime)
 	{
 		if ((nonneutral_change_validation_ != p_nonneutral_change_counter) || (nonneutral_mutations_count_ == -1))
 		{
@@ -647,11 +722,18 @@ public:
 				case 3: cache_nonneutral_mutations_REGIME_3(); break;
 			}
 			
+			cache_nonneutral_fitness_products();
+			
 #if defined(SLIMGUI) && (SLIMPROFILING == 1)
 			// PROFILING
 			recached_run_ = true;
 #endif
 		}
+	}
+	
+	inline __attribute__((always_inline)) void beginend_nonneutral_pointers(const MutationIndex **p_mutptr_iter, const MutationIndex **p_mutptr_max, int32_t p_nonneutral_change_counter, int32_t p_nonneutral_regime)
+	{
+		validate_nonneutral_cache(p_nonneutral_change_counter, p_nonneutral_regime);
 		
 #if DEBUG
 		check_nonneutral_mutation_cache();
@@ -662,6 +744,12 @@ public:
 		*p_mutptr_max = nonneutral_mutations_ + nonneutral_mutations_count_;
 	}
 	
+	// These return the cached fitness products described above; the cache must have been validated already, with
+	// validate_nonneutral_cache() or beginend_nonneutral_pointers(), in the current regime
+	inline __attribute__((always_inline)) double nonneutral_homozygous_product(void) const { return nonneutral_homozygous_product_; }
+	inline __attribute__((always_inline)) double nonneutral_heterozygous_product(void) const { return nonneutral_heterozygous_product_; }
+	inline __attribute__((always_inline)) int32_t nonneutral_count(void) const { return nonneutral_mutations_count_; }
+	
 #if defined(SLIMGUI) && (SLIMPROFILING == 1)
 	// PROFILING
 	inline __attribute__((always_inline)) void tally_nonneutral_mutations(int64_t *p_mutation_count, int64_t *p_nonneutral_count, int64_t *p_recached_count)
@@ -26,6 +26,7 @@
 #include <cmath>
 #include <utility>
 #include <unordered_map>
+#include <thread>
 
 #include "slim_sim.h"
 #include "slim_global.h"
@@ -860,6 +861,94 @@ bool Population::ApplyModifyChildCallbacks(Individual *p_child, Genome *p_child_
 }
 
 #ifdef SLIM_WF_ONLY
+// Below this many queued crossovers per thread, the cost of starting threads outweighs the benefit of parallel assembly
+#define SLIM_MIN_DEFERRED_CROSSOVERS_PER_THREAD		256
+
+void Population::AssembleDeferredCrossovers(int p_thread_count)
+{
+	size_t job_count = deferred_crossovers_.size();
+	int thread_count = p_thread_count;
+	
+	if (job_count / SLIM_MIN_DEFERRED_CROSSOVERS_PER_THREAD < (size_t)thread_count)
+		thread_count = (int)(job_count / SLIM_MIN_DEFERRED_CROSSOVERS_PER_THREAD);
+	
+	if (thread_count <= 1)
+	{
+		// Not enough work to be worth threading; assemble on the main thread using the normal refcounted path
+		for (DeferredCrossover &job : deferred_crossovers_)
+			InterleaveParentalGenomes(*job.child_genome_, job.parent_genome_1_, job.parent_genome_2_, deferred_breakpoints_.data() + job.breakpoints_start_, job.breakpoints_count_, nullptr);
+	}
+	else
+	{
+		// Split the jobs into contiguous chunks, one per thread, and give each thread a private stock of free mutation runs taken
+		// from the shared pool.  A job creates at most one new run per breakpoint, which gives us an upper bound on what each
+		// thread will need; if the shared pool runs short, the workers fall back to allocating new runs themselves.
+		std::vector<std::vector<MutationRun *>> worker_free_runs(thread_count);
+		std::vector<size_t> chunk_starts(thread_count + 1);
+		std::vector<MutationRun *> &shared_free_runs = MutationRun::s_freed_mutation_runs_;
+		
+		for (int thread_index = 0; thread_index <= thread_count; ++thread_index)
+			chunk_starts[thread_index] = (job_count * thread_index) / thread_count;
+		
+		for (int thread_index = 0; thread_index < thread_count; ++thread_index)
+		{
+			size_t runs_needed = 0;
+			
+			for (size_t job_index = chunk_starts[thread_index]; job_index < chunk_starts[thread_index + 1]; ++job_index)
+				runs_needed += deferred_crossovers_[job_index].breakpoints_count_;
+			
+			size_t runs_given = std::min(runs_needed, shared_free_runs.size());
+			std::vector<MutationRun *> &free_runs = worker_free_runs[thread_index];
+			
+			free_runs.insert(free_runs.end(), shared_free_runs.end() - runs_given, shared_free_runs.end());
+			shared_free_runs.resize(shared_free_runs.size() - runs_given);
+		}
+		
+		auto assemble_chunk = [this, &chunk_starts, &worker_free_runs](int p_thread_index) {
+			std::vector<MutationRun *> *free_runs = &worker_free_runs[p_thread_index];
+			
+			for (size_t job_index = chunk_starts[p_thread_index]; job_index < chunk_starts[p_thread_index + 1]; ++job_index)
+			{
+				DeferredCrossover &job = deferred_crossovers_[job_index];
+				
+				InterleaveParentalGenomes(*job.child_genome_, job.parent_genome_1_, job.parent_genome_2_, deferred_breakpoints_.data() + job.breakpoints_start_, job.breakpoints_count_, free_runs);
+			}
+		};
+		
+		std::vector<std::thread> workers;
+		
+		workers.reserve(thread_count - 1);
+		
+		for (int thread_index = 1; thread_index < thread_count; ++thread_index)
+			workers.emplace_back(assemble_chunk, thread_index);
+		
+		assemble_chunk(0);
+		
+		for (std::thread &worker : workers)
+			worker.join();
+		
+		// Return unused runs to the shared pool, and then take the references that the workers were not allowed to take
+		for (std::vector<MutationRun *> &free_runs : worker_free_runs)
+			shared_free_runs.insert(shared_free_runs.end(), free_runs.begin(), free_runs.end());
+		
+		for (DeferredCrossover &job : deferred_crossovers_)
+		{
+			Genome &child_genome = *job.child_genome_;
+			
+			for (int run_index = 0; run_index < child_genome.mutrun_count_; ++run_index)
+			{
+				MutationRun *mutrun = child_genome.mutruns_[run_index].get();
+				
+				if (mutrun)
+					Eidos_intrusive_ptr_add_ref(mutrun);
+			}
+		}
+	}
+	
+	deferred_crossovers_.clear();
+	deferred_breakpoints_.clear();
+}
+
 // generate children for subpopulation p_subpop_id, drawing from all source populations, handling crossover and mutation
 void Population::EvolveSubpopulation(Subpopulation &p_subpop, bool p_mate_choice_callbacks_present, bool p_modify_child_callbacks_present, bool p_recombination_callbacks_present)
 {
@@ -1703,6 +1792,16 @@ void Population::EvolveSubpopulation(Subpopulation &p_subpop, bool p_mate_choice
 		// some setup overhead, including the gsl_ran_shuffle() call.  All code that accesses individuals within a subpopulation needs to be aware of
 		// the fact that the individuals might be in a non-random order, because of this code path.  BEWARE!
 		
+		// If threads were requested with initializeSLiMOptions(threads=...), crossovers are queued by DoCrossoverMutation() and assembled in
+		// parallel at the end; see AssembleDeferredCrossovers().  All random draws are still made here, on the main thread, in the usual order,
+		// so the result is identical to a single-threaded run regardless of the thread count.  This is only possible without callbacks, since
+		// mateChoice(), modifyChild() and recombination() callbacks could inspect child genomes that have not yet been assembled.
+		int thread_count = sim_.ThreadCount();
+		
+		deferred_crossovers_.clear();
+		deferred_breakpoints_.clear();
+		defer_crossover_assembly_ = (thread_count > 1);
+		
 		// We loop to generate females first (sex_index == 0) and males second (sex_index == 1).
 		// In nonsexual simulations number_of_sexes == 1 and this loops just once.
 		slim_popsize_t child_count = 0;	// counter over all subpop_size_ children
@@ -1924,6 +2023,12 @@ void Population::EvolveSubpopulation(Subpopulation &p_subpop, bool p_mate_choice
 				}
 			}
 		}
+		
+		if (defer_crossover_assembly_)
+		{
+			defer_crossover_assembly_ = false;
+			AssembleDeferredCrossovers(thread_count);
+		}
 	}
 }
 #endif	// SLIM_WF_ONLY
@@ -2137,6 +2242,147 @@ bool Population::ApplyRecombinationCallbacks(slim_popsize_t p_parent_index, Geno
 }
 
 // generate a child genome from parental genomes, with recombination, gene conversion, and mutation
+// Interleave two parental genomes into a child genome at the given breakpoints, with no new mutations.  This is the most common
+// case in DoCrossoverMutation(), and it is factored out here so that threaded offspring generation can run it on worker threads;
+// see AssembleDeferredCrossovers().  When p_worker_free_runs is nullptr this behaves exactly as the inline code used to.  When it
+// is non-null we are on a worker thread, so new runs are taken from that private free list instead of the shared pool, and runs
+// are placed into the child genome *without* incrementing their refcounts, since Eidos_intrusive_ptr refcounting is not atomic;
+// the caller is responsible for fixing up the refcounts of the child genome afterwards, on the main thread.
+void Population::InterleaveParentalGenomes(Genome &p_child_genome, Genome *p_parent_genome_1, Genome *p_parent_genome_2, const slim_position_t *p_breakpoints, int p_breakpoint_count, std::vector<MutationRun *> *p_worker_free_runs)
+{
+	// start with a clean slate in the child genome; we now expect child genomes to be cleared for us
+#if DEBUG
+	p_child_genome.check_cleared_to_nullptr();
+#endif
+	
+	Genome *parent_genome_1 = p_parent_genome_1;
+	Genome *parent_genome_2 = p_parent_genome_2;
+	Genome *parent_genome = parent_genome_1;
+	slim_position_t mutrun_length = p_child_genome.mutrun_length_;
+	int mutrun_count = p_child_genome.mutrun_count_;
+	int first_uncompleted_mutrun = 0;
+	int break_index_max = p_breakpoint_count;
+	
+	for (int break_index = 0; break_index < break_index_max; break_index++)
+	{
+		slim_position_t breakpoint = p_breakpoints[break_index];
+		slim_mutrun_index_t break_mutrun_index = (slim_mutrun_index_t)(breakpoint / mutrun_length);
+		
+		// Copy over mutation runs until we arrive at the run in which the breakpoint occurs
+		while (break_mutrun_index > first_uncompleted_mutrun)
+		{
+			if (p_worker_free_runs)
+				p_child_genome.mutruns_[first_uncompleted_mutrun].reset(parent_genome->mutruns_[first_uncompleted_mutrun].get(), false);
+			else
+				p_child_genome.mutruns_[first_uncompleted_mutrun] = parent_genome->mutruns_[first_uncompleted_mutrun];
+			++first_uncompleted_mutrun;
+			
+			if (first_uncompleted_mutrun >= mutrun_count)
+				break;
+		}
+		
+		// Now we are supposed to process a breakpoint in first_uncompleted_mutrun; check whether that means we're done
+		if (first_uncompleted_mutrun >= mutrun_count)
+			break;
+		
+		// The break occurs to the left of the base position of the breakpoint; check whether that is between runs
+		if (breakpoint > break_mutrun_index * mutrun_length)
+		{
+			// The breakpoint occurs *inside* the run, so process the run by copying mutations and switching strands
+			int this_mutrun_index = first_uncompleted_mutrun;
+			const MutationIndex *parent1_iter		= parent_genome_1->mutruns_[this_mutrun_index]->begin_pointer_const();
+			const MutationIndex *parent2_iter		= parent_genome_2->mutruns_[this_mutrun_index]->begin_pointer_const();
+			const MutationIndex *parent1_iter_max	= parent_genome_1->mutruns_[this_mutrun_index]->end_pointer_const();
+			const MutationIndex *parent2_iter_max	= parent_genome_2->mutruns_[this_mutrun_index]->end_pointer_const();
+			const MutationIndex *parent_iter		= parent1_iter;
+			const MutationIndex *parent_iter_max	= parent1_iter_max;
+			MutationRun *child_mutrun;
+			
+			if (p_worker_free_runs)
+			{
+				if (p_worker_free_runs->size())
+				{
+					child_mutrun = p_worker_free_runs->back();
+					p_worker_free_runs->pop_back();
+				}
+				else
+				{
+					child_mutrun = new MutationRun();
+				}
+				
+				p_child_genome.mutruns_[this_mutrun_index].reset(child_mutrun, false);
+			}
+			else
+			{
+				child_mutrun = p_child_genome.WillCreateRun(this_mutrun_index);
+			}
+			
+			while (true)
+			{
+				// copy the old mutations in the parent before the current breakpoint in bulk; no need to check for duplicates here since
+				// the parental genome is already duplicate-free
+				const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
+				
+				child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+				parent_iter = parent_segment_end;
+				
+				// we have reached the breakpoint, so swap parents; we want the "current strand" variables to change, so no std::swap()
+				parent1_iter = parent2_iter;	parent1_iter_max = parent2_iter_max;	parent_genome_1 = parent_genome_2;
+				parent2_iter = parent_iter;		parent2_iter_max = parent_iter_max;		parent_genome_2 = parent_genome;
+				parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = parent_genome_1;
+				
+				// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
+				parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
+				
+				// we have now handled the current breakpoint, so move on to the next breakpoint; advance the enclosing for loop here
+				break_index++;
+				
+				// if we just handled the last breakpoint, which is guaranteed to be at or beyond lastPosition+1, then we are done
+				if (break_index == break_index_max)
+					break;
+				
+				// otherwise, figure out the new breakpoint, and continue looping on the current mutation run, which needs to be finished
+				breakpoint = p_breakpoints[break_index];
+				break_mutrun_index = (slim_mutrun_index_t)(breakpoint / mutrun_length);
+				
+				// if the next breakpoint is outside this mutation run, then finish the run and break out
+				if (break_mutrun_index > this_mutrun_index)
+				{
+					child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
+					
+					break_index--;	// the outer loop will want to handle the current breakpoint again at the mutation-run level
+					break;
+				}
+			}
+			
+			// We have completed this run
+			++first_uncompleted_mutrun;
+		}
+		else
+		{
+			// The breakpoint occurs *between* runs, so just switch parent strands and the breakpoint is handled
+			parent_genome_1 = parent_genome_2;
+			parent_genome_2 = parent_genome;
+			parent_genome = parent_genome_1;
+		}
+	}
+}
+
+// With initializeSLiMOptions(counterRNG=T), the mutation and breakpoint counts of each new gamete are drawn from a counter-based
+// stream of its own, identified by the generation, the child's subpopulation, and the index of the child genome within that
+// subpopulation (which is known at this point only in WF models), and keyed by the last seed set.  The counts for a gamete thus
+// do not depend on the draws made for any other gamete, or on the order in which gametes are generated.  All other draws are
+// still made from the shared taus2 generator as usual.
+#define SLIM_COUNTER_RNG_PURPOSE_GAMETE_COUNTS	1
+
+Eidos_CounterRNG Population::GameteCountsRNG(const Genome &p_child_genome) const
+{
+	const Individual *child = p_child_genome.individual_;
+	uint32_t genome_index = (uint32_t)child->index_ * 2 + ((child->genome1_ == &p_child_genome) ? 0 : 1);
+	
+	return Eidos_CounterRNG(gEidos_RNG.rng_last_seed_, SLIM_COUNTER_RNG_PURPOSE_GAMETE_COUNTS, genome_index, (uint32_t)p_child_genome.subpop_->subpopulation_id_, (uint32_t)sim_.Generation());
+}
+
 void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_child_genome, slim_popsize_t p_parent_index, IndividualSex p_child_sex, IndividualSex p_parent_sex, std::vector<SLiMEidosBlock*> *p_recombination_callbacks)
 {
 	slim_popsize_t parent_genome_1_index = p_parent_index * 2;
@@ -2304,7 +2550,17 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 	if (use_only_strand_1)
 	{
 		num_breakpoints = 0;
-		num_mutations = chromosome.DrawMutationCount(p_parent_sex);
+		
+		if (sim_.UsingCounterRNG())
+		{
+			Eidos_CounterRNG counts_rng = GameteCountsRNG(p_child_genome);
+			
+			num_mutations = chromosome.DrawMutationCount(p_parent_sex, counts_rng);
+		}
+		else
+		{
+			num_mutations = chromosome.DrawMutationCount(p_parent_sex);
+		}
 		
 		// no call to recombination() callbacks here, since recombination is not possible
 		
@@ -2313,15 +2569,26 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 	}
 	else
 	{
+		if (sim_.UsingCounterRNG())
+		{
+			// the counts come from this gamete's own stream, so they do not depend on any other draws that have been made
+			Eidos_CounterRNG counts_rng = GameteCountsRNG(p_child_genome);
+			
+			num_mutations = chromosome.DrawMutationCount(p_parent_sex, counts_rng);
+			num_breakpoints = chromosome.DrawBreakpointCount(p_parent_sex, counts_rng);
+		}
+		else
+		{
 #ifdef USE_GSL_POISSON
-		// When using the GSL's poisson draw, we have to draw the mutation count and breakpoint count separately;
-		// the DrawMutationAndBreakpointCounts() method does not support USE_GSL_POISSON
-		num_mutations = p_chromosome.DrawMutationCount(p_parent_sex);
-		num_breakpoints = p_chromosome.DrawBreakpointCount(p_parent_sex);
+			// When using the GSL's poisson draw, we have to draw the mutation count and breakpoint count separately;
+			// the DrawMutationAndBreakpointCounts() method does not support USE_GSL_POISSON
+			num_mutations = p_chromosome.DrawMutationCount(p_parent_sex);
+			num_breakpoints = p_chromosome.DrawBreakpointCount(p_parent_sex);
 #else
-		// get both the number of mutations and the number of breakpoints here; this allows us to draw both jointly, super fast!
-		chromosome.DrawMutationAndBreakpointCounts(p_parent_sex, &num_mutations, &num_breakpoints);
+			// get both the number of mutations and the number of breakpoints here; this allows us to draw both jointly, super fast!
+			chromosome.DrawMutationAndBreakpointCounts(p_parent_sex, &num_mutations, &num_breakpoints);
 #endif
+		}
 		
 		//std::cout << num_mutations << " mutations, " << num_breakpoints << " breakpoints" << std::endl;
 		
@@ -2501,107 +2768,16 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 			// no mutations, but we do have crossovers, so we just need to interleave the two parental genomes
 			//
 			
-			// start with a clean slate in the child genome; we now expect child genomes to be cleared for us
-#if DEBUG
-			p_child_genome.check_cleared_to_nullptr();
-#endif
-			
-			Mutation *mut_block_ptr = gSLiM_Mutation_Block;
-			Genome *parent_genome = parent_genome_1;
-			slim_position_t mutrun_length = p_child_genome.mutrun_length_;
-			int mutrun_count = p_child_genome.mutrun_count_;
-			int first_uncompleted_mutrun = 0;
-			int break_index_max = static_cast<int>(all_breakpoints.size());	// can be != num_breakpoints+1 due to gene conversion and dup removal!
-			
-			for (int break_index = 0; break_index < break_index_max; break_index++)
+			if (defer_crossover_assembly_)
 			{
-				slim_position_t breakpoint = all_breakpoints[break_index];
-				slim_mutrun_index_t break_mutrun_index = (slim_mutrun_index_t)(breakpoint / mutrun_length);
-				
-				// Copy over mutation runs until we arrive at the run in which the breakpoint occurs
-				while (break_mutrun_index > first_uncompleted_mutrun)
-				{
-					p_child_genome.mutruns_[first_uncompleted_mutrun] = parent_genome->mutruns_[first_uncompleted_mutrun];
-					++first_uncompleted_mutrun;
-					
-					if (first_uncompleted_mutrun >= mutrun_count)
-						break;
-				}
-				
-				// Now we are supposed to process a breakpoint in first_uncompleted_mutrun; check whether that means we're done
-				if (first_uncompleted_mutrun >= mutrun_count)
-					break;
-				
-				// The break occurs to the left of the base position of the breakpoint; check whether that is between runs
-				if (breakpoint > break_mutrun_index * mutrun_length)
-				{
-					// The breakpoint occurs *inside* the run, so process the run by copying mutations and switching strands
-					int this_mutrun_index = first_uncompleted_mutrun;
-					const MutationIndex *parent1_iter		= parent_genome_1->mutruns_[this_mutrun_index]->begin_pointer_const();
-					const MutationIndex *parent2_iter		= parent_genome_2->mutruns_[this_mutrun_index]->begin_pointer_const();
-					const MutationIndex *parent1_iter_max	= parent_genome_1->mutruns_[this_mutrun_index]->end_pointer_const();
-					const MutationIndex *parent2_iter_max	= parent_genome_2->mutruns_[this_mutrun_index]->end_pointer_const();
-					const MutationIndex *parent_iter		= parent1_iter;
-					const MutationIndex *parent_iter_max	= parent1_iter_max;
-					MutationRun *child_mutrun = p_child_genome.WillCreateRun(this_mutrun_index);
-					
-					while (true)
-					{
-						// while there are still old mutations in the parent before the current breakpoint...
-						while (parent_iter != parent_iter_max)
-						{
-							MutationIndex current_mutation = *parent_iter;
-							
-							if ((mut_block_ptr + current_mutation)->position_ >= breakpoint)
-								break;
-							
-							// add the old mutation; no need to check for a duplicate here since the parental genome is already duplicate-free
-							child_mutrun->emplace_back(current_mutation);
-							
-							parent_iter++;
-						}
-						
-						// we have reached the breakpoint, so swap parents; we want the "current strand" variables to change, so no std::swap()
-						parent1_iter = parent2_iter;	parent1_iter_max = parent2_iter_max;	parent_genome_1 = parent_genome_2;
-						parent2_iter = parent_iter;		parent2_iter_max = parent_iter_max;		parent_genome_2 = parent_genome;
-						parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = parent_genome_1;
-						
-						// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-						while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-							parent_iter++;
-						
-						// we have now handled the current breakpoint, so move on to the next breakpoint; advance the enclosing for loop here
-						break_index++;
-						
-						// if we just handled the last breakpoint, which is guaranteed to be at or beyond lastPosition+1, then we are done
-						if (break_index == break_index_max)
-							break;
-						
-						// otherwise, figure out the new breakpoint, and continue looping on the current mutation run, which needs to be finished
-						breakpoint = all_breakpoints[break_index];
-						break_mutrun_index = (slim_mutrun_index_t)(breakpoint / mutrun_length);
-						
-						// if the next breakpoint is outside this mutation run, then finish the run and break out
-						if (break_mutrun_index > this_mutrun_index)
-						{
-							while (parent_iter != parent_iter_max)
-								child_mutrun->emplace_back(*(parent_iter++));
-							
-							break_index--;	// the outer loop will want to handle the current breakpoint again at the mutation-run level
-							break;
-						}
-					}
-					
-					// We have completed this run
-					++first_uncompleted_mutrun;
-				}
-				else
-				{
-					// The breakpoint occurs *between* runs, so just switch parent strands and the breakpoint is handled
-					parent_genome_1 = parent_genome_2;
-					parent_genome_2 = parent_genome;
-					parent_genome = parent_genome_1;
-				}
+				// Threaded offspring generation is active, so we just record what needs to be done; all RNG draws for this
+				// child genome have already been made above, so the assembly can be done later in any order, on any thread
+				deferred_crossovers_.emplace_back(DeferredCrossover{&p_child_genome, parent_genome_1, parent_genome_2, deferred_breakpoints_.size(), (int)all_breakpoints.size()});
+				deferred_breakpoints_.insert(deferred_breakpoints_.end(), all_breakpoints.begin(), all_breakpoints.end());
+			}
+			else
+			{
+				InterleaveParentalGenomes(p_child_genome, parent_genome_1, parent_genome_2, all_breakpoints.data(), (int)all_breakpoints.size(), nullptr);
 			}
 		}
 	}
@@ -2632,6 +2808,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 		}
 		
 		Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+		slim_position_t *position_ptr = gSLiM_Mutation_Positions;
 		const MutationIndex *mutation_iter		= mutations_to_add.begin_pointer_const();
 		const MutationIndex *mutation_iter_max	= mutations_to_add.end_pointer_const();
 		
@@ -2640,7 +2817,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 		
 		if (mutation_iter != mutation_iter_max) {
 			mutation_iter_mutation_index = *mutation_iter;
-			mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+			mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 		} else {
 			mutation_iter_mutation_index = -1;
 			mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -2681,18 +2858,11 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 				// add any additional new mutations that occur before the end of the mutation run; there is at least one
 				do
 				{
-					// add any parental mutations that occur before or at the next new mutation's position
-					while (parent_iter != parent_iter_max)
-					{
-						MutationIndex current_mutation = *parent_iter;
-						slim_position_t current_mutation_pos = (mut_block_ptr + current_mutation)->position_;
-						
-						if (current_mutation_pos > mutation_iter_pos)
-							break;
-						
-						child_mutrun->emplace_back(current_mutation);
-						parent_iter++;
-					}
+					// add any parental mutations that occur before or at the next new mutation's position, in bulk
+					const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, mutation_iter_pos + 1);
+					
+					child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+					parent_iter = parent_segment_end;
 					
 					// add the new mutation, which might overlap with the last added old mutation
 					Mutation *new_mut = mut_block_ptr + mutation_iter_mutation_index;
@@ -2723,7 +2893,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 					
 					if (++mutation_iter != mutation_iter_max) {
 						mutation_iter_mutation_index = *mutation_iter;
-						mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+						mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 					} else {
 						mutation_iter_mutation_index = -1;
 						mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -2734,8 +2904,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 				while (mutation_mutrun_index == this_mutrun_index);
 				
 				// finish up any parental mutations that come after the last new mutation in the mutation run
-				while (parent_iter != parent_iter_max)
-					child_mutrun->emplace_back(*(parent_iter++));
+				child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 				
 				// We have completed this run
 				++first_uncompleted_mutrun;
@@ -2834,7 +3003,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 							while (parent_iter != parent_iter_max)
 							{
 								MutationIndex current_mutation = *parent_iter;
-								slim_position_t current_mutation_pos = (mut_block_ptr + current_mutation)->position_;
+								slim_position_t current_mutation_pos = position_ptr[current_mutation];
 								
 								if (current_mutation_pos >= breakpoint)
 									break;
@@ -2870,7 +3039,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 									
 									if (++mutation_iter != mutation_iter_max) {
 										mutation_iter_mutation_index = *mutation_iter;
-										mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+										mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 									} else {
 										mutation_iter_mutation_index = -1;
 										mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -2916,7 +3085,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 								
 								if (++mutation_iter != mutation_iter_max) {
 									mutation_iter_mutation_index = *mutation_iter;
-									mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+									mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 								} else {
 									mutation_iter_mutation_index = -1;
 									mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -2936,8 +3105,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 							parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = parent_genome_1;
 							
 							// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-							while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-								parent_iter++;
+							parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
 							
 							// we have now handled the current breakpoint, so move on; if we just handled the last breakpoint, then we are done
 							if (++break_index == break_index_max)
@@ -2963,19 +3131,12 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 						
 						while (true)
 						{
-							// while there are still old mutations in the parent before the current breakpoint...
-							while (parent_iter != parent_iter_max)
-							{
-								MutationIndex current_mutation = *parent_iter;
-								
-								if ((mut_block_ptr + current_mutation)->position_ >= breakpoint)
-									break;
-								
-								// add the old mutation; no need to check for a duplicate here since the parental genome is already duplicate-free
-								child_mutrun->emplace_back(current_mutation);
-								
-								parent_iter++;
-							}
+							// copy the old mutations in the parent before the current breakpoint in bulk; no need to check for duplicates here since
+							// the parental genome is already duplicate-free
+							const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
+							
+							child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+							parent_iter = parent_segment_end;
 							
 							// we have reached the breakpoint, so swap parents; we want the "current strand" variables to change, so no std::swap()
 							parent1_iter = parent2_iter;	parent1_iter_max = parent2_iter_max;	parent_genome_1 = parent_genome_2;
@@ -2983,8 +3144,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 							parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = parent_genome_1;
 							
 							// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-							while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-								parent_iter++;
+							parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
 							
 							// we have now handled the current breakpoint, so move on; if we just handled the last breakpoint, then we are done
 							if (++break_index == break_index_max)
@@ -2997,8 +3157,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 							// if the next breakpoint is outside this mutation run, then finish the run and break out
 							if (break_mutrun_index > this_mutrun_index)
 							{
-								while (parent_iter != parent_iter_max)
-									child_mutrun->emplace_back(*(parent_iter++));
+								child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 								
 								break;	// the outer loop will want to handle this breakpoint again at the mutation-run level
 							}
@@ -3021,18 +3180,11 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 					// add any additional new mutations that occur before the end of the mutation run; there is at least one
 					do
 					{
-						// add any parental mutations that occur before or at the next new mutation's position
-						while (parent_iter != parent_iter_max)
-						{
-							MutationIndex current_mutation = *parent_iter;
-							slim_position_t current_mutation_pos = (mut_block_ptr + current_mutation)->position_;
-							
-							if (current_mutation_pos > mutation_iter_pos)
-								break;
-							
-							child_mutrun->emplace_back(current_mutation);
-							parent_iter++;
-						}
+						// add any parental mutations that occur before or at the next new mutation's position, in bulk
+						const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, mutation_iter_pos + 1);
+						
+						child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+						parent_iter = parent_segment_end;
 						
 						// add the new mutation, which might overlap with the last added old mutation
 						Mutation *new_mut = mut_block_ptr + mutation_iter_mutation_index;
@@ -3063,7 +3215,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 						
 						if (++mutation_iter != mutation_iter_max) {
 							mutation_iter_mutation_index = *mutation_iter;
-							mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+							mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 						} else {
 							mutation_iter_mutation_index = -1;
 							mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -3074,8 +3226,7 @@ void Population::DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_c
 					while (mutation_mutrun_index == this_mutrun_index);
 					
 					// finish up any parental mutations that come after the last new mutation in the mutation run
-					while (parent_iter != parent_iter_max)
-						child_mutrun->emplace_back(*(parent_iter++));
+					child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 					
 					// We have completed this run
 					++first_uncompleted_mutrun;
@@ -3143,7 +3294,6 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 		p_child_genome.check_cleared_to_nullptr();
 #endif
 		
-		Mutation *mut_block_ptr = gSLiM_Mutation_Block;
 		Genome *parent_genome = p_parent_genome_1;
 		slim_position_t mutrun_length = p_child_genome.mutrun_length_;
 		int mutrun_count = p_child_genome.mutrun_count_;
@@ -3184,19 +3334,12 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 				
 				while (true)
 				{
-					// while there are still old mutations in the parent before the current breakpoint...
-					while (parent_iter != parent_iter_max)
-					{
-						MutationIndex current_mutation = *parent_iter;
-						
-						if ((mut_block_ptr + current_mutation)->position_ >= breakpoint)
-							break;
-						
-						// add the old mutation; no need to check for a duplicate here since the parental genome is already duplicate-free
-						child_mutrun->emplace_back(current_mutation);
-						
-						parent_iter++;
-					}
+					// copy the old mutations in the parent before the current breakpoint in bulk; no need to check for duplicates here since
+					// the parental genome is already duplicate-free
+					const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
+					
+					child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+					parent_iter = parent_segment_end;
 					
 					// we have reached the breakpoint, so swap parents; we want the "current strand" variables to change, so no std::swap()
 					parent1_iter = parent2_iter;	parent1_iter_max = parent2_iter_max;	p_parent_genome_1 = p_parent_genome_2;
@@ -3204,8 +3347,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 					parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = p_parent_genome_1;
 					
 					// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-					while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-						parent_iter++;
+					parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
 					
 					// we have now handled the current breakpoint, so move on to the next breakpoint; advance the enclosing for loop here
 					break_index++;
@@ -3221,8 +3363,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 					// if the next breakpoint is outside this mutation run, then finish the run and break out
 					if (break_mutrun_index > this_mutrun_index)
 					{
-						while (parent_iter != parent_iter_max)
-							child_mutrun->emplace_back(*(parent_iter++));
+						child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 						
 						break_index--;	// the outer loop will want to handle the current breakpoint again at the mutation-run level
 						break;
@@ -3268,6 +3409,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 		}
 		
 		Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+		slim_position_t *position_ptr = gSLiM_Mutation_Positions;
 		const MutationIndex *mutation_iter		= mutations_to_add.begin_pointer_const();
 		const MutationIndex *mutation_iter_max	= mutations_to_add.end_pointer_const();
 		
@@ -3276,7 +3418,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 		
 		if (mutation_iter != mutation_iter_max) {
 			mutation_iter_mutation_index = *mutation_iter;
-			mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+			mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 		} else {
 			mutation_iter_mutation_index = -1;
 			mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -3369,7 +3511,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 						while (parent_iter != parent_iter_max)
 						{
 							MutationIndex current_mutation = *parent_iter;
-							slim_position_t current_mutation_pos = (mut_block_ptr + current_mutation)->position_;
+							slim_position_t current_mutation_pos = position_ptr[current_mutation];
 							
 							if (current_mutation_pos >= breakpoint)
 								break;
@@ -3405,7 +3547,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 								
 								if (++mutation_iter != mutation_iter_max) {
 									mutation_iter_mutation_index = *mutation_iter;
-									mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+									mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 								} else {
 									mutation_iter_mutation_index = -1;
 									mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -3451,7 +3593,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 							
 							if (++mutation_iter != mutation_iter_max) {
 								mutation_iter_mutation_index = *mutation_iter;
-								mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+								mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 							} else {
 								mutation_iter_mutation_index = -1;
 								mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -3471,8 +3613,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 						parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = p_parent_genome_1;
 						
 						// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-						while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-							parent_iter++;
+						parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
 						
 						// we have now handled the current breakpoint, so move on; if we just handled the last breakpoint, then we are done
 						if (++break_index == break_index_max)
@@ -3498,19 +3639,12 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 					
 					while (true)
 					{
-						// while there are still old mutations in the parent before the current breakpoint...
-						while (parent_iter != parent_iter_max)
-						{
-							MutationIndex current_mutation = *parent_iter;
-							
-							if ((mut_block_ptr + current_mutation)->position_ >= breakpoint)
-								break;
-							
-							// add the old mutation; no need to check for a duplicate here since the parental genome is already duplicate-free
-							child_mutrun->emplace_back(current_mutation);
-							
-							parent_iter++;
-						}
+						// copy the old mutations in the parent before the current breakpoint in bulk; no need to check for duplicates here since
+						// the parental genome is already duplicate-free
+						const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
+						
+						child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+						parent_iter = parent_segment_end;
 						
 						// we have reached the breakpoint, so swap parents; we want the "current strand" variables to change, so no std::swap()
 						parent1_iter = parent2_iter;	parent1_iter_max = parent2_iter_max;	p_parent_genome_1 = p_parent_genome_2;
@@ -3518,8 +3652,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 						parent_iter = parent1_iter;		parent_iter_max = parent1_iter_max;		parent_genome = p_parent_genome_1;
 						
 						// skip over anything in the new parent that occurs prior to the breakpoint; it was not the active strand
-						while (parent_iter != parent_iter_max && (mut_block_ptr + *parent_iter)->position_ < breakpoint)
-							parent_iter++;
+						parent_iter = MutationRun::position_lower_bound(parent_iter, parent_iter_max, breakpoint);
 						
 						// we have now handled the current breakpoint, so move on; if we just handled the last breakpoint, then we are done
 						if (++break_index == break_index_max)
@@ -3532,8 +3665,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 						// if the next breakpoint is outside this mutation run, then finish the run and break out
 						if (break_mutrun_index > this_mutrun_index)
 						{
-							while (parent_iter != parent_iter_max)
-								child_mutrun->emplace_back(*(parent_iter++));
+							child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 							
 							break;	// the outer loop will want to handle this breakpoint again at the mutation-run level
 						}
@@ -3556,18 +3688,11 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 				// add any additional new mutations that occur before the end of the mutation run; there is at least one
 				do
 				{
-					// add any parental mutations that occur before or at the next new mutation's position
-					while (parent_iter != parent_iter_max)
-					{
-						MutationIndex current_mutation = *parent_iter;
-						slim_position_t current_mutation_pos = (mut_block_ptr + current_mutation)->position_;
-						
-						if (current_mutation_pos > mutation_iter_pos)
-							break;
-						
-						child_mutrun->emplace_back(current_mutation);
-						parent_iter++;
-					}
+					// add any parental mutations that occur before or at the next new mutation's position, in bulk
+					const MutationIndex *parent_segment_end = MutationRun::position_lower_bound(parent_iter, parent_iter_max, mutation_iter_pos + 1);
+					
+					child_mutrun->emplace_back_bulk(parent_iter, parent_segment_end - parent_iter);
+					parent_iter = parent_segment_end;
 					
 					// add the new mutation, which might overlap with the last added old mutation
 					Mutation *new_mut = mut_block_ptr + mutation_iter_mutation_index;
@@ -3598,7 +3723,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 					
 					if (++mutation_iter != mutation_iter_max) {
 						mutation_iter_mutation_index = *mutation_iter;
-						mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+						mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 					} else {
 						mutation_iter_mutation_index = -1;
 						mutation_iter_pos = SLIM_INF_BASE_POSITION;
@@ -3609,8 +3734,7 @@ void Population::DoRecombinantMutation(Subpopulation *p_mutorigin_subpop, Genome
 				while (mutation_mutrun_index == this_mutrun_index);
 				
 				// finish up any parental mutations that come after the last new mutation in the mutation run
-				while (parent_iter != parent_iter_max)
-					child_mutrun->emplace_back(*(parent_iter++));
+				child_mutrun->emplace_back_bulk(parent_iter, parent_iter_max - parent_iter);
 				
 				// We have completed this run
 				++first_uncompleted_mutrun;
@@ -3663,7 +3787,18 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 	
 	// determine how many mutations and breakpoints we have
 	Chromosome &chromosome = sim_.TheChromosome();
-	int num_mutations = chromosome.DrawMutationCount(p_child_sex);	// the parent sex is the same as the child sex
+	int num_mutations;
+	
+	if (sim_.UsingCounterRNG())
+	{
+		Eidos_CounterRNG counts_rng = GameteCountsRNG(p_child_genome);
+		
+		num_mutations = chromosome.DrawMutationCount(p_child_sex, counts_rng);	// the parent sex is the same as the child sex
+	}
+	else
+	{
+		num_mutations = chromosome.DrawMutationCount(p_child_sex);	// the parent sex is the same as the child sex
+	}
 	
 	// mutations are usually rare, so let's streamline the case where none occur
 	if (num_mutations == 0)
@@ -3694,6 +3829,7 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 		
 		// loop over mutation runs and either (1) copy the mutrun pointer from the parent, or (2) make a new mutrun by modifying that of the parent
 		Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+		slim_position_t *position_ptr = gSLiM_Mutation_Positions;
 		
 		int mutrun_count = p_child_genome.mutrun_count_;
 		slim_position_t mutrun_length = p_child_genome.mutrun_length_;
@@ -3701,7 +3837,7 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 		const MutationIndex *mutation_iter		= mutations_to_add.begin_pointer_const();
 		const MutationIndex *mutation_iter_max	= mutations_to_add.end_pointer_const();
 		MutationIndex mutation_iter_mutation_index = *mutation_iter;
-		slim_position_t mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+		slim_position_t mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 		slim_mutrun_index_t mutation_iter_mutrun_index = (slim_mutrun_index_t)(mutation_iter_pos / mutrun_length);
 		
 		for (int run_index = 0; run_index < mutrun_count; ++run_index)
@@ -3723,7 +3859,7 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 				do
 				{
 					// while an old mutation in the parent is before or at the next new mutation...
-					while ((parent_iter != parent_iter_max) && ((mut_block_ptr + *parent_iter)->position_ <= mutation_iter_pos))
+					while ((parent_iter != parent_iter_max) && (position_ptr[*parent_iter] <= mutation_iter_pos))
 					{
 						// we know the mutation is not already present, since mutations on the parent strand are already uniqued,
 						// and new mutations are, by definition, new and thus cannot match the existing mutations
@@ -3732,7 +3868,7 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 					}
 					
 					// while a new mutation in this run is before the next old mutation in the parent... (which we know is true when we first reach here)
-					slim_position_t parent_iter_pos = (parent_iter == parent_iter_max) ? (SLIM_INF_BASE_POSITION) : (mut_block_ptr + *parent_iter)->position_;
+					slim_position_t parent_iter_pos = (parent_iter == parent_iter_max) ? (SLIM_INF_BASE_POSITION) : position_ptr[*parent_iter];
 					
 					do
 					{
@@ -3775,7 +3911,7 @@ void Population::DoClonalMutation(Subpopulation *p_mutorigin_subpop, Genome &p_c
 						else
 						{
 							mutation_iter_mutation_index = *mutation_iter;
-							mutation_iter_pos = (mut_block_ptr + mutation_iter_mutation_index)->position_;
+							mutation_iter_pos = position_ptr[mutation_iter_mutation_index];
 						}
 						
 						mutation_iter_mutrun_index = (slim_mutrun_index_t)(mutation_iter_pos / mutrun_length);
@@ -3931,19 +4067,24 @@ void Population::AddTallyForMutationTypeAndBinNumber(int p_mutation_type_index,
 void Population::ValidateMutationFitnessCaches(void)
 {
 	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	MutationType **mut_type_ptr = gSLiM_Mutation_Types;
+	slim_selcoeff_t *one_plus_sel_ptr = gSLiM_Mutation_OnePlusSel;
+	slim_selcoeff_t *one_plus_dom_sel_ptr = gSLiM_Mutation_OnePlusDomSel;
 	const MutationIndex *registry_iter = mutation_registry_.begin_pointer_const();
 	const MutationIndex *registry_iter_end = mutation_registry_.end_pointer_const();
 	
 	while (registry_iter != registry_iter_end)
 	{
 		MutationIndex mut_index = (*registry_iter++);
-		Mutation *mut = mut_block_ptr + mut_index;
-		slim_selcoeff_t sel_coeff = mut->selection_coeff_;
-		slim_selcoeff_t dom_coeff = mut->mutation_type_ptr_->dominance_coeff_;
+		slim_selcoeff_t sel_coeff = (mut_block_ptr + mut_index)->selection_coeff_;
+		slim_selcoeff_t dom_coeff = mut_type_ptr[mut_index]->dominance_coeff_;
 		
-		mut->cached_one_plus_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + sel_coeff);
-		mut->cached_one_plus_dom_sel_ = (slim_selcoeff_t)std::max(0.0, 1.0 + dom_coeff * sel_coeff);
+		one_plus_sel_ptr[mut_index] = (slim_selcoeff_t)std::max(0.0, 1.0 + sel_coeff);
+		one_plus_dom_sel_ptr[mut_index] = (slim_selcoeff_t)std::max(0.0, 1.0 + dom_coeff * sel_coeff);
 	}
+	
+	// The fitness products cached by MutationRun alongside its nonneutral cache are now stale (see mutation_run.h)
+	sim_.nonneutral_change_counter_++;
 }
 
 void Population::RecalculateFitness(slim_generation_t p_generation)
@@ -5131,6 +5272,10 @@ slim_refcount_t Population::TallyMutationReferences(std::vector<Subpopulation*>
 	}
 }
 
+// The minimum number of genomes for each thread in a threaded tally; below this, the cost of zeroing and reducing the per-thread
+// partial refcount arrays outweighs the gain.  See TallyGenomeMutationReferences_Threaded().
+#define SLIM_MIN_TALLY_GENOMES_PER_THREAD		1024
+
 slim_refcount_t Population::TallyMutationReferences_FAST(void)
 {
 	// first zero out the refcounts in all registered Mutation objects
@@ -5139,6 +5284,45 @@ slim_refcount_t Population::TallyMutationReferences_FAST(void)
 	// then increment the refcounts through all pointers to Mutation in all genomes
 	slim_refcount_t total_genome_count = 0;
 	int64_t operation_id = ++gSLiM_MutationRun_OperationID;
+	int thread_count = sim_.ThreadCount();
+	
+	if (thread_count > 1)
+	{
+		// Gather up all of the non-null genomes so that they can be divided among threads
+		tally_genomes_.clear();
+		
+		for (const std::pair<const slim_objectid_t,Subpopulation*> &subpop_pair : *this)
+		{
+			Subpopulation *subpop = subpop_pair.second;
+			slim_popsize_t subpop_genome_count = subpop->CurrentGenomeCount();
+			std::vector<Genome *> &subpop_genomes = subpop->CurrentGenomes();
+			
+			for (slim_popsize_t i = 0; i < subpop_genome_count; i++)
+			{
+				Genome *genome = subpop_genomes[i];
+				
+				if (!genome->IsNull())
+					tally_genomes_.emplace_back(genome);
+			}
+		}
+		
+		total_genome_count = (slim_refcount_t)tally_genomes_.size();
+		
+		if (tally_genomes_.size() / SLIM_MIN_TALLY_GENOMES_PER_THREAD < (size_t)thread_count)
+			thread_count = (int)(tally_genomes_.size() / SLIM_MIN_TALLY_GENOMES_PER_THREAD);
+		
+		if (thread_count > 1)
+		{
+			TallyGenomeMutationReferences_Threaded(thread_count, operation_id);
+		}
+		else
+		{
+			for (Genome *genome : tally_genomes_)
+				genome->TallyGenomeMutationReferences(operation_id);
+		}
+		
+		return total_genome_count;
+	}
 	
 	for (const std::pair<const slim_objectid_t,Subpopulation*> &subpop_pair : *this)
 	{
@@ -5177,6 +5361,67 @@ slim_refcount_t Population::TallyMutationReferences_FAST(void)
 	return total_genome_count;
 }
 
+// Tally the genomes in tally_genomes_ on p_thread_count threads.  Each thread tallies a contiguous chunk of genomes into its own
+// partial refcount array (the first thread uses gSLiM_Mutation_Refcounts itself, which has already been zeroed), and each mutation
+// run is still visited just once, by whichever thread claims it first with p_operation_id.  The partial arrays are then summed into
+// gSLiM_Mutation_Refcounts, again on p_thread_count threads, each handling a contiguous range of mutation indices.  Integer sums do
+// not depend on the order of summation, so the result is identical to a single-threaded tally.
+void Population::TallyGenomeMutationReferences_Threaded(int p_thread_count, int64_t p_operation_id)
+{
+	size_t genome_count = tally_genomes_.size();
+	size_t refcount_count = (size_t)(gSLiM_Mutation_Block_LastUsedIndex + 1);
+	slim_refcount_t *refcount_block_ptr = gSLiM_Mutation_Refcounts;
+	
+	tally_thread_refcounts_.resize(p_thread_count - 1);
+	
+	for (std::vector<slim_refcount_t> &thread_refcounts : tally_thread_refcounts_)
+		thread_refcounts.assign(refcount_count, 0);
+	
+	auto tally_chunk = [this, p_thread_count, p_operation_id, genome_count, refcount_block_ptr](int p_thread_index) {
+		slim_refcount_t *thread_refcounts = (p_thread_index == 0) ? refcount_block_ptr : tally_thread_refcounts_[p_thread_index - 1].data();
+		size_t chunk_start = (genome_count * p_thread_index) / p_thread_count;
+		size_t chunk_end = (genome_count * (p_thread_index + 1)) / p_thread_count;
+		
+		for (size_t genome_index = chunk_start; genome_index < chunk_end; ++genome_index)
+			tally_genomes_[genome_index]->TallyGenomeMutationReferences_Concurrent(p_operation_id, thread_refcounts);
+	};
+	
+	auto reduce_chunk = [this, p_thread_count, refcount_count, refcount_block_ptr](int p_thread_index) {
+		size_t chunk_start = (refcount_count * p_thread_index) / p_thread_count;
+		size_t chunk_end = (refcount_count * (p_thread_index + 1)) / p_thread_count;
+		
+		for (std::vector<slim_refcount_t> &thread_refcounts : tally_thread_refcounts_)
+		{
+			const slim_refcount_t *thread_refcounts_ptr = thread_refcounts.data();
+			
+			for (size_t refcount_index = chunk_start; refcount_index < chunk_end; ++refcount_index)
+				refcount_block_ptr[refcount_index] += thread_refcounts_ptr[refcount_index];
+		}
+	};
+	
+	std::vector<std::thread> workers;
+	
+	workers.reserve(p_thread_count - 1);
+	
+	for (int thread_index = 1; thread_index < p_thread_count; ++thread_index)
+		workers.emplace_back(tally_chunk, thread_index);
+	
+	tally_chunk(0);
+	
+	for (std::thread &worker : workers)
+		worker.join();
+	
+	workers.clear();
+	
+	for (int thread_index = 1; thread_index < p_thread_count; ++thread_index)
+		workers.emplace_back(reduce_chunk, thread_index);
+	
+	reduce_chunk(0);
+	
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
 // handle negative fixation (remove from the registry) and positive fixation (convert to Substitution), using reference counts from TallyMutationReferences()
 // TallyMutationReferences() must have cached tallies across the whole population before this is called, or it will malfunction!
 void Population::RemoveAllFixedMutations(void)
@@ -5686,6 +5931,61 @@ void Population::PrintAll(std::ostream &p_out, bool p_output_spatial_positions,
 	}
 }
 
+// print the header section of a binary population file, which is shared by all versions of the format
+void Population::PrintBinaryHeader(std::ostream &p_out, int32_t p_version_tag, int32_t p_spatial_output_count) const
+{
+	// This header is shared by PrintAllBinary() (versions 3 and 4) and SLiMSim::WriteCheckpoint() (version 5); it is
+	// terminated with a section end tag like the other sections.
+	int32_t section_end_tag = 0xFFFF0000;
+	
+	// Write a 32-bit endianness tag
+	int32_t endianness_tag = 0x12345678;
+	
+	p_out.write(reinterpret_cast<char *>(&endianness_tag), sizeof endianness_tag);
+	
+	// Write a format version tag
+	p_out.write(reinterpret_cast<char *>(&p_version_tag), sizeof p_version_tag);
+	
+	// Write the size of a double
+	int32_t double_size = sizeof(double);
+	
+	p_out.write(reinterpret_cast<char *>(&double_size), sizeof double_size);
+	
+	// Write a test double, to ensure the same format is used on the reading machine
+	double double_test = 1234567890.0987654321;
+	
+	p_out.write(reinterpret_cast<char *>(&double_test), sizeof double_test);
+	
+	// Write the sizes of the various SLiM types
+	int32_t slim_generation_t_size = sizeof(slim_generation_t);
+	int32_t slim_position_t_size = sizeof(slim_position_t);
+	int32_t slim_objectid_t_size = sizeof(slim_objectid_t);
+	int32_t slim_popsize_t_size = sizeof(slim_popsize_t);
+	int32_t slim_refcount_t_size = sizeof(slim_refcount_t);
+	int32_t slim_selcoeff_t_size = sizeof(slim_selcoeff_t);
+	int32_t slim_mutationid_t_size = sizeof(slim_mutationid_t);													// Added in version 2
+	int32_t slim_polymorphismid_t_size = sizeof(slim_polymorphismid_t);											// Added in version 2
+	
+	p_out.write(reinterpret_cast<char *>(&slim_generation_t_size), sizeof slim_generation_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_position_t_size), sizeof slim_position_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_objectid_t_size), sizeof slim_objectid_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_popsize_t_size), sizeof slim_popsize_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_refcount_t_size), sizeof slim_refcount_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_selcoeff_t_size), sizeof slim_selcoeff_t_size);
+	p_out.write(reinterpret_cast<char *>(&slim_mutationid_t_size), sizeof slim_mutationid_t_size);				// Added in version 2
+	p_out.write(reinterpret_cast<char *>(&slim_polymorphismid_t_size), sizeof slim_polymorphismid_t_size);		// Added in version 2
+	
+	// Write the generation
+	slim_generation_t generation = sim_.Generation();
+	
+	p_out.write(reinterpret_cast<char *>(&generation), sizeof generation);
+	
+	// Write the number of spatial coordinates we will write per individual.  Added in version 3.
+	p_out.write(reinterpret_cast<char *>(&p_spatial_output_count), sizeof p_spatial_output_count);
+	
+	p_out.write(reinterpret_cast<char *>(&section_end_tag), sizeof section_end_tag);
+}
+
 // print all mutations and all genomes to a stream in binary, for maximum reading speed
 void Population::PrintAllBinary(std::ostream &p_out, bool p_output_spatial_positions, bool p_output_ages) const
 {
@@ -5702,58 +6002,9 @@ void Population::PrintAllBinary(std::ostream &p_out, bool p_output_spatial_posit
 	int32_t section_end_tag = 0xFFFF0000;
 	
 	// Header section
-	{
-		// Write a 32-bit endianness tag
-		int32_t endianness_tag = 0x12345678;
-		
-		p_out.write(reinterpret_cast<char *>(&endianness_tag), sizeof endianness_tag);
-		
-		// Write a format version tag
-		int32_t version_tag = (age_output_count ? 4 : 3);							// version 2 started with SLiM 2.1
+	PrintBinaryHeader(p_out, (age_output_count ? 4 : 3), spatial_output_count);		// version 2 started with SLiM 2.1
 																					// version 3 started with SLiM 2.3
 																					// version 4 started with SLiM 3.0, only when individual age is output
-		p_out.write(reinterpret_cast<char *>(&version_tag), sizeof version_tag);
-		
-		// Write the size of a double
-		int32_t double_size = sizeof(double);
-		
-		p_out.write(reinterpret_cast<char *>(&double_size), sizeof double_size);
-		
-		// Write a test double, to ensure the same format is used on the reading machine
-		double double_test = 1234567890.0987654321;
-		
-		p_out.write(reinterpret_cast<char *>(&double_test), sizeof double_test);
-		
-		// Write the sizes of the various SLiM types
-		int32_t slim_generation_t_size = sizeof(slim_generation_t);
-		int32_t slim_position_t_size = sizeof(slim_position_t);
-		int32_t slim_objectid_t_size = sizeof(slim_objectid_t);
-		int32_t slim_popsize_t_size = sizeof(slim_popsize_t);
-		int32_t slim_refcount_t_size = sizeof(slim_refcount_t);
-		int32_t slim_selcoeff_t_size = sizeof(slim_selcoeff_t);
-		int32_t slim_mutationid_t_size = sizeof(slim_mutationid_t);													// Added in version 2
-		int32_t slim_polymorphismid_t_size = sizeof(slim_polymorphismid_t);											// Added in version 2
-		
-		p_out.write(reinterpret_cast<char *>(&slim_generation_t_size), sizeof slim_generation_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_position_t_size), sizeof slim_position_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_objectid_t_size), sizeof slim_objectid_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_popsize_t_size), sizeof slim_popsize_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_refcount_t_size), sizeof slim_refcount_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_selcoeff_t_size), sizeof slim_selcoeff_t_size);
-		p_out.write(reinterpret_cast<char *>(&slim_mutationid_t_size), sizeof slim_mutationid_t_size);				// Added in version 2
-		p_out.write(reinterpret_cast<char *>(&slim_polymorphismid_t_size), sizeof slim_polymorphismid_t_size);		// Added in version 2
-		
-		// Write the generation
-		slim_generation_t generation = sim_.Generation();
-		
-		p_out.write(reinterpret_cast<char *>(&generation), sizeof generation);
-		
-		// Write the number of spatial coordinates we will write per individual.  Added in version 3.
-		p_out.write(reinterpret_cast<char *>(&spatial_output_count), sizeof spatial_output_count);
-	}
-	
-	// Write a tag indicating the section has ended
-	p_out.write(reinterpret_cast<char *>(&section_end_tag), sizeof section_end_tag);
 	
 	// Populations section
 	for (const std::pair<const slim_objectid_t,Subpopulation*> &subpop_pair : *this)
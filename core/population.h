@@ -88,6 +88,10 @@ public:
 	std::vector<Subpopulation*> last_tallied_subpops_;		// NOT OWNED POINTERS
 	slim_refcount_t cached_tally_genome_count_ = 0;
 	
+	// Scratch buffers for threaded tallying in TallyMutationReferences_FAST(); kept around to avoid reallocation every generation
+	std::vector<Genome *> tally_genomes_;							// NOT OWNED POINTERS
+	std::vector<std::vector<slim_refcount_t>> tally_thread_refcounts_;	// per-thread partial refcounts, indexed by MutationIndex
+	
 	std::vector<Substitution*> substitutions_;				// OWNED POINTERS: Substitution objects for all fixed mutations
 	std::unordered_multimap<slim_position_t, Substitution*> treeseq_substitutions_map_;	// TREE SEQUENCE RECORDING; keeps all fixed mutations, hashed by position
 
@@ -97,6 +101,21 @@ public:
 	
 	std::vector<Subpopulation*> removed_subpops_;			// OWNED POINTERS: Subpops which are set to size 0 (and thus removed) are kept here until the end of the generation
 	
+	// Threaded offspring generation; see EvolveSubpopulation() and AssembleDeferredCrossovers().  While defer_crossover_assembly_
+	// is set, DoCrossoverMutation() makes all of its RNG draws as usual but queues the interleaving of parental genomes (for child
+	// genomes with no new mutations) here, to be done in parallel once all children in the subpopulation have been planned.
+	typedef struct {
+		Genome *child_genome_;
+		Genome *parent_genome_1_;
+		Genome *parent_genome_2_;
+		size_t breakpoints_start_;							// index into deferred_breakpoints_
+		int breakpoints_count_;
+	} DeferredCrossover;
+	
+	bool defer_crossover_assembly_ = false;
+	std::vector<DeferredCrossover> deferred_crossovers_;
+	std::vector<slim_position_t> deferred_breakpoints_;
+	
 #ifdef SLIMGUI
 	// information-gathering for various graphs in SLiMgui
 	slim_generation_t *mutation_loss_times_ = nullptr;		// histogram bins: {1 bin per mutation-type} for 10 generations, realloced outward to add new generation bins as needed
@@ -129,6 +148,12 @@ public:
 	// apply recombination() callbacks to a generated child; a return of true means the breakpoints were changed
 	bool ApplyRecombinationCallbacks(slim_popsize_t p_parent_index, Genome *p_genome1, Genome *p_genome2, Subpopulation *p_source_subpop, std::vector<slim_position_t> &p_crossovers, std::vector<slim_position_t> &p_gc_starts, std::vector<slim_position_t> &p_gc_ends, std::vector<SLiMEidosBlock*> &p_recombination_callbacks);
 	
+	// interleave two parental genomes at the given breakpoints, with no new mutations; thread-safe if p_worker_free_runs is supplied
+	static void InterleaveParentalGenomes(Genome &p_child_genome, Genome *p_parent_genome_1, Genome *p_parent_genome_2, const slim_position_t *p_breakpoints, int p_breakpoint_count, std::vector<MutationRun *> *p_worker_free_runs);
+	
+	// the counter-based stream for the mutation and breakpoint counts of the gamete that forms p_child_genome; see initializeSLiMOptions(counterRNG=T)
+	Eidos_CounterRNG GameteCountsRNG(const Genome &p_child_genome) const;
+	
 	// generate a child genome from parental genomes, with recombination, gene conversion, and mutation
 	void DoCrossoverMutation(Subpopulation *p_source_subpop, Genome &p_child_genome, slim_popsize_t p_parent_index, IndividualSex p_child_sex, IndividualSex p_parent_sex, std::vector<SLiMEidosBlock*> *p_recombination_callbacks);
 	
@@ -157,6 +182,7 @@ public:
 	// count the total number of times that each Mutation in the registry is referenced by a population, and set total_genome_count_ to the maximum possible number of references (i.e. fixation)
 	slim_refcount_t TallyMutationReferences(std::vector<Subpopulation*> *p_subpops_to_tally, bool p_force_recache);
 	slim_refcount_t TallyMutationReferences_FAST(void);
+	void TallyGenomeMutationReferences_Threaded(int p_thread_count, int64_t p_operation_id);
 	
 	// handle negative fixation (remove from the registry) and positive fixation (convert to Substitution), using reference counts from TallyMutationReferences()
 	void RemoveAllFixedMutations(void);
@@ -180,6 +206,9 @@ public:
 	// apply mateChoice() callbacks to a mating event with a chosen first parent; the return is the second parent index, or -1 to force a redraw
 	slim_popsize_t ApplyMateChoiceCallbacks(slim_popsize_t p_parent1_index, Subpopulation *p_subpop, Subpopulation *p_source_subpop, std::vector<SLiMEidosBlock*> &p_mate_choice_callbacks);
 	
+	// run the crossovers queued by DoCrossoverMutation() while defer_crossover_assembly_ is set, using up to p_thread_count threads
+	void AssembleDeferredCrossovers(int p_thread_count);
+	
 	// generate children for subpopulation p_subpop_id, drawing from all source populations, handling crossover and mutation
 	void EvolveSubpopulation(Subpopulation &p_subpop, bool p_mate_choice_callbacks_present, bool p_modify_child_callbacks_present, bool p_recombination_callbacks_present);
 	
@@ -197,6 +226,7 @@ public:
 
 	// print all mutations and all genomes to a stream
 	void PrintAll(std::ostream &p_out, bool p_output_spatial_positions, bool p_output_ages) const;
+	void PrintBinaryHeader(std::ostream &p_out, int32_t p_version_tag, int32_t p_spatial_output_count) const;	// print the header shared by the binary formats
 	void PrintAllBinary(std::ostream &p_out, bool p_output_spatial_positions, bool p_output_ages) const;
 	
 	// print sample of p_sample_size genomes from subpopulation p_subpop_id, using SLiM's own format
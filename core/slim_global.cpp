@@ -680,6 +680,9 @@ const std::string gStr_treeSeqCoalesced = "treeSeqCoalesced";
 const std::string gStr_treeSeqSimplify = "treeSeqSimplify";
 const std::string gStr_treeSeqRememberIndividuals = "treeSeqRememberIndividuals";
 const std::string gStr_treeSeqOutput = "treeSeqOutput";
+const std::string gStr_treeSeqDiversity = "treeSeqDiversity";
+const std::string gStr_treeSeqTajimasD = "treeSeqTajimasD";
+const std::string gStr_treeSeqAFS = "treeSeqAFS";
 const std::string gStr_setMigrationRates = "setMigrationRates";
 const std::string gStr_pointInBounds = "pointInBounds";
 const std::string gStr_pointReflected = "pointReflected";
@@ -980,6 +983,9 @@ void SLiM_RegisterGlobalStringsAndIDs(void)
 		Eidos_RegisterStringForGlobalID(gStr_treeSeqSimplify, gID_treeSeqSimplify);
 		Eidos_RegisterStringForGlobalID(gStr_treeSeqRememberIndividuals, gID_treeSeqRememberIndividuals);
 		Eidos_RegisterStringForGlobalID(gStr_treeSeqOutput, gID_treeSeqOutput);
+		Eidos_RegisterStringForGlobalID(gStr_treeSeqDiversity, gID_treeSeqDiversity);
+		Eidos_RegisterStringForGlobalID(gStr_treeSeqTajimasD, gID_treeSeqTajimasD);
+		Eidos_RegisterStringForGlobalID(gStr_treeSeqAFS, gID_treeSeqAFS);
 		Eidos_RegisterStringForGlobalID(gStr_setMigrationRates, gID_setMigrationRates);
 		Eidos_RegisterStringForGlobalID(gStr_pointInBounds, gID_pointInBounds);
 		Eidos_RegisterStringForGlobalID(gStr_pointReflected, gID_pointReflected);
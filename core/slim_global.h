@@ -520,6 +520,9 @@ extern const std::string gStr_treeSeqCoalesced;
 extern const std::string gStr_treeSeqSimplify;
 extern const std::string gStr_treeSeqRememberIndividuals;
 extern const std::string gStr_treeSeqOutput;
+extern const std::string gStr_treeSeqDiversity;
+extern const std::string gStr_treeSeqTajimasD;
+extern const std::string gStr_treeSeqAFS;
 extern const std::string gStr_setMigrationRates;
 extern const std::string gStr_pointInBounds;
 extern const std::string gStr_pointReflected;
@@ -784,6 +787,9 @@ enum _SLiMGlobalStringID : int {
 	gID_treeSeqSimplify,
 	gID_treeSeqRememberIndividuals,
 	gID_treeSeqOutput,
+	gID_treeSeqDiversity,
+	gID_treeSeqTajimasD,
+	gID_treeSeqAFS,
 	gID_setMigrationRates,
 	gID_pointInBounds,
 	gID_pointReflected,
@@ -38,9 +38,13 @@
 #include <utility>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <unordered_set>
 #include <unordered_map>
+#include <functional>
+#include <thread>
 #include <float.h>
 
 //TREE SEQUENCE
@@ -59,6 +63,7 @@ extern "C" {
 #include "../treerec/tskit/trees.h"
 #include "../treerec/tskit/text_input.h"
 #include "../treerec/tskit/tables.h"
+#include "../treerec/tskit/uuid.h"
 #ifdef __cplusplus
 }
 #endif
@@ -839,31 +844,35 @@ slim_generation_t SLiMSim::_InitializePopulationFromBinaryFile(const char *p_fil
 	int32_t spatial_output_count;
 	int age_output_count = 0;
 	
-	// Read file into buf
-	std::ifstream infile(p_file, std::ios::in | std::ios::binary);
+	// Map the file into memory, rather than reading it into a buffer; the pages are read in by the kernel as we touch them, and
+	// a large checkpoint (see WriteCheckpoint()) is never copied in its entirety.  The mapping is private and read-only.
+	int fd = open(p_file, O_RDONLY);
 	
-	if (!infile.is_open() || infile.eof())
+	if (fd == -1)
 		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): could not open initialization file." << EidosTerminate();
 	
-	// Determine the file length
-	infile.seekg(0, std::ios_base::end);
-	file_size = infile.tellg();
+	struct stat statbuf;
 	
-	// Read in the entire file; we assume we have enough memory, for now
-	std::unique_ptr<char[]> raii_buf(new char[file_size]);
-	char *buf = raii_buf.get();
+	if ((fstat(fd, &statbuf) != 0) || (statbuf.st_size <= 0))
+	{
+		close(fd);
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): could not open initialization file." << EidosTerminate();
+	}
+	
+	file_size = (std::size_t)statbuf.st_size;
 	
-	if (!buf)
-		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): could not allocate input buffer." << EidosTerminate();
+	void *mapped_file = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
 	
-	char *buf_end = buf + file_size;
-	char *p = buf;
+	// Close the file; the mapping stays valid until it is unmapped
+	close(fd);
 	
-	infile.seekg(0, std::ios_base::beg);
-	infile.read(buf, file_size);
+	if (mapped_file == MAP_FAILED)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): could not map initialization file." << EidosTerminate();
 	
-	// Close the file; we will work only with our buffer from here on
-	infile.close();
+	std::unique_ptr<void, std::function<void(void *)>> raii_mapping(mapped_file, [file_size](void *p_mapping) { munmap(p_mapping, file_size); });
+	const char *buf = (const char *)mapped_file;
+	const char *buf_end = buf + file_size;
+	const char *p = buf;
 	
 	int32_t section_end_tag;
 	int32_t file_version;
@@ -891,7 +900,8 @@ slim_generation_t SLiMSim::_InitializePopulationFromBinaryFile(const char *p_fil
 			version_tag = 3;
 		}
 		
-		if ((version_tag != 1) && (version_tag != 2) && (version_tag != 3))
+		// version 5 is a checkpoint; its header is the same as version 3, but everything after that is different
+		if ((version_tag != 1) && (version_tag != 2) && (version_tag != 3) && (version_tag != 5))
 			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): unrecognized version." << EidosTerminate();
 		
 		file_version = version_tag;
@@ -983,18 +993,37 @@ slim_generation_t SLiMSim::_InitializePopulationFromBinaryFile(const char *p_fil
 			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): spatial output count out of range." << EidosTerminate();
 		if ((spatial_output_count > 0) && (spatial_output_count != spatial_dimensionality_))
 			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): output spatial dimensionality does not match that of the simulation." << EidosTerminate();
-		if (age_output_count && (ModelType() == SLiMModelType::kModelTypeWF))
-			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): age information is present but the simulation is using a WF model." << EidosTerminate();
-		if (!age_output_count && (ModelType() == SLiMModelType::kModelTypeNonWF))
-			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): age information is not present but the simulation is using a nonWF model; age information must be included." << EidosTerminate();
 		if (section_end_tag != (int32_t)0xFFFF0000)
 			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): missing section end after header." << EidosTerminate();
+		
+		if (file_version == 5)
+		{
+			// checkpoints always contain all spatial dimensions, and ages in nonWF models; they cannot be restored with tree-sequence recording
+			if (spatial_output_count != spatial_dimensionality_)
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): output spatial dimensionality does not match that of the simulation." << EidosTerminate();
+			if (RecordingTreeSequence())
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): checkpoints cannot be restored when tree-sequence recording is enabled; use treeSeqOutput() and readFromPopulationFile() with a .trees file instead." << EidosTerminate();
+		}
+		else
+		{
+			if (age_output_count && (ModelType() == SLiMModelType::kModelTypeWF))
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): age information is present but the simulation is using a WF model." << EidosTerminate();
+			if (!age_output_count && (ModelType() == SLiMModelType::kModelTypeNonWF))
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromBinaryFile): age information is not present but the simulation is using a nonWF model; age information must be included." << EidosTerminate();
+		}
 	}
 	
 	// As of SLiM 2.1, we change the generation as a side effect of loading; otherwise we can't correctly update our state here!
 	// As of SLiM 3, we set the generation up here, before making any individuals, because we need it to be correct for the tree-seq recording code.
 	SetGeneration(file_generation);
 	
+	// Checkpoints are restored by their own method, working directly from the mapped file
+	if (file_version == 5)
+	{
+		_InitializePopulationFromCheckpoint(p, buf_end, p_interpreter);
+		return file_generation;
+	}
+	
 	// Populations section
 	while (true)
 	{
@@ -1429,209 +1458,1070 @@ slim_generation_t SLiMSim::_InitializePopulationFromBinaryFile(const char *p_fil
 }
 #endif
 
-void SLiMSim::ValidateScriptBlockCaches(void)
+// Checkpoint files are binary population files with version 5.  After the usual header (see Population::PrintBinaryHeader()),
+// a checkpoint consists of a series of sections, each of which is an int32_t tag, an int64_t payload length in bytes, and the
+// payload; a section end tag (0xFFFF0000) terminates the file.  Sections with unknown tags are skipped, so that sections can be
+// added later without breaking older checkpoints.  The payloads are flat arrays wherever possible (the mutations, the unique
+// mutation runs, the individuals, and the run indices of each genome), so that restoring a checkpoint works directly from the
+// mapped file; in particular, each unique MutationRun is built only once and then shared by every genome that refers to it.
+static const int32_t kCheckpointSection_State = (int32_t)0xFFFF0101;			// RNG state, ID counters, and global tag values
+static const int32_t kCheckpointSection_Subpops = (int32_t)0xFFFF0102;			// subpopulation records
+static const int32_t kCheckpointSection_Mutations = (int32_t)0xFFFF0103;		// SLiMCheckpointMutationRec records, in registry order
+static const int32_t kCheckpointSection_Substitutions = (int32_t)0xFFFF0104;	// SLiMCheckpointMutationRec records
+static const int32_t kCheckpointSection_MutationRuns = (int32_t)0xFFFF0105;		// unique mutation runs, as offsets into a mutation index array
+static const int32_t kCheckpointSection_Individuals = (int32_t)0xFFFF0106;		// SLiMCheckpointIndividualRec records
+static const int32_t kCheckpointSection_Genomes = (int32_t)0xFFFF0107;			// mutation run indices for each genome
+static const int32_t kCheckpointSection_ScriptBlocks = (int32_t)0xFFFF0108;		// the script block schedule
+
+typedef struct
 {
-#if DEBUG_BLOCK_REG_DEREG
-	std::cout << "Generation " << generation_ << ": ValidateScriptBlockCaches() called..." << std::endl;
-#endif
+	slim_mutationid_t mutation_id_;
+	slim_usertag_t tag_value_;
+	slim_objectid_t mutation_type_id_;
+	slim_position_t position_;
+	slim_objectid_t subpop_index_;
+	slim_generation_t origin_generation_;
+	slim_generation_t fixation_generation_;		// used only for substitutions
+	slim_selcoeff_t selection_coeff_;
+} SLiMCheckpointMutationRec;
+
+typedef struct
+{
+	slim_pedigreeid_t pedigree_id_, pedigree_p1_, pedigree_p2_, pedigree_g1_, pedigree_g2_, pedigree_g3_, pedigree_g4_;
+	slim_usertag_t tag_value_;
+	double tagF_value_;
+	double spatial_x_, spatial_y_, spatial_z_;
+	slim_usertag_t genome1_tag_value_, genome2_tag_value_;
+	slim_age_t age_;
+	int32_t reserved_;
+} SLiMCheckpointIndividualRec;
+
+template <typename T> static inline void SLiM_WriteCheckpointValue(std::ostream &p_out, const T &p_value)
+{
+	p_out.write(reinterpret_cast<const char *>(&p_value), sizeof(T));
+}
+
+static std::streampos SLiM_BeginCheckpointSection(std::ostream &p_out, int32_t p_section_tag)
+{
+	int64_t section_length = 0;		// patched by SLiM_EndCheckpointSection()
 	
-	if (!script_block_types_cached_)
+	SLiM_WriteCheckpointValue(p_out, p_section_tag);
+	
+	std::streampos length_position = p_out.tellp();
+	
+	SLiM_WriteCheckpointValue(p_out, section_length);
+	return length_position;
+}
+
+static void SLiM_EndCheckpointSection(std::ostream &p_out, std::streampos p_length_position)
+{
+	std::streampos end_position = p_out.tellp();
+	int64_t section_length = (int64_t)(end_position - p_length_position) - (int64_t)sizeof(int64_t);
+	
+	p_out.seekp(p_length_position);
+	SLiM_WriteCheckpointValue(p_out, section_length);
+	p_out.seekp(end_position);
+}
+
+template <typename T> static inline T SLiM_ReadCheckpointValue(const char *&p, const char *p_end)
+{
+	T value;
+	
+	if (p + sizeof(T) > p_end)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): unexpected end of checkpoint section." << EidosTerminate();
+	
+	memcpy(&value, p, sizeof(T));
+	p += sizeof(T);
+	return value;
+}
+
+static inline const char *SLiM_ReadCheckpointArray(const char *&p, const char *p_end, int64_t p_byte_count)
+{
+	const char *array = p;
+	
+	if ((p_byte_count < 0) || (p_byte_count > p_end - p))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): unexpected end of checkpoint section." << EidosTerminate();
+	
+	p += p_byte_count;
+	return array;
+}
+
+void SLiMSim::WriteCheckpoint(std::ostream &p_out)
+{
+	// The parental generation must be the current generation, so that a restored checkpoint can put the individuals back there
+	if (population_.child_generation_valid_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::WriteCheckpoint): a checkpoint cannot be written while the child generation is active; write checkpoints from early() or late() events." << EidosTerminate();
+	if (RecordingTreeSequence())
+		EIDOS_TERMINATION << "ERROR (SLiMSim::WriteCheckpoint): checkpoints cannot be written when tree-sequence recording is enabled; use treeSeqOutput() instead." << EidosTerminate();
+	
+	population_.PrintBinaryHeader(p_out, 5, (int32_t)spatial_dimensionality_);		// version 5 started with SLiM 3.2, for checkpoints
+	
+	// State section: everything needed to continue the run identically that is not part of the population itself
 	{
-		cached_early_events_.clear();
-		cached_late_events_.clear();
-		cached_initialize_callbacks_.clear();
-		cached_fitness_callbacks_.clear();
-		cached_fitnessglobal_callbacks_onegen_.clear();
-		cached_fitnessglobal_callbacks_multigen_.clear();
-		cached_interaction_callbacks_.clear();
-		cached_matechoice_callbacks_.clear();
-		cached_modifychild_callbacks_.clear();
-		cached_recombination_callbacks_.clear();
-		cached_reproduction_callbacks_.clear();
-		cached_userdef_functions_.clear();
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_State);
 		
-		std::vector<SLiMEidosBlock*> &script_blocks = AllScriptBlocks();
+		SLiM_WriteCheckpointValue(p_out, (int32_t)model_type_);
+		SLiM_WriteCheckpointValue(p_out, (int32_t)sex_enabled_);
+		SLiM_WriteCheckpointValue(p_out, (int32_t)modeled_chromosome_type_);
+		SLiM_WriteCheckpointValue(p_out, gSLiM_next_mutation_id);
+		SLiM_WriteCheckpointValue(p_out, gSLiM_next_pedigree_id);
+		SLiM_WriteCheckpointValue(p_out, tag_value_);
 		
-#if DEBUG_BLOCK_REG_DEREG
-		std::cout << "   ValidateScriptBlockCaches() recaching, AllScriptBlocks() is:" << std::endl;
-		for (SLiMEidosBlock *script_block : script_blocks)
-		{
-			std::cout << "      ";
-			script_block->Print(std::cout);
-			std::cout << std::endl;
-		}
-#endif
+		// the RNG state: the last seed (which keys the counter-based RNG), the taus2 state, the MT64 state, and the coin-flip buffer
+		int64_t taus_state_size = (int64_t)gsl_rng_size(EIDOS_GSL_RNG);
 		
-		for (auto script_block : script_blocks)
+		SLiM_WriteCheckpointValue(p_out, (uint64_t)gEidos_RNG.rng_last_seed_);
+		SLiM_WriteCheckpointValue(p_out, taus_state_size);
+		p_out.write(reinterpret_cast<const char *>(gsl_rng_state(EIDOS_GSL_RNG)), taus_state_size);
+		p_out.write(reinterpret_cast<const char *>(gEidos_RNG.mt_), Eidos_MT64_NN * sizeof(uint64_t));
+		SLiM_WriteCheckpointValue(p_out, (int32_t)gEidos_RNG.mti_);
+		SLiM_WriteCheckpointValue(p_out, (int32_t)gEidos_RNG.random_bool_bit_counter_);
+		SLiM_WriteCheckpointValue(p_out, gEidos_RNG.random_bool_bit_buffer_);
+		
+		// tag values of mutation types and genomic element types
+		SLiM_WriteCheckpointValue(p_out, (int32_t)mutation_types_.size());
+		
+		for (auto &muttype_pair : mutation_types_)
 		{
-			switch (script_block->type_)
-			{
-				case SLiMEidosBlockType::SLiMEidosEventEarly:				cached_early_events_.push_back(script_block);				break;
-				case SLiMEidosBlockType::SLiMEidosEventLate:				cached_late_events_.push_back(script_block);				break;
-				case SLiMEidosBlockType::SLiMEidosInitializeCallback:		cached_initialize_callbacks_.push_back(script_block);		break;
-				case SLiMEidosBlockType::SLiMEidosFitnessCallback:			cached_fitness_callbacks_.push_back(script_block);			break;
-				case SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback:
-				{
-					// Global fitness callbacks are not order-dependent, so we don't have to preserve their order
-					// of declaration the way we do with other types of callbacks.  This allows us to be very efficient
-					// in how we look them up, which is good since sometimes we have a very large number of them.
-					// We put those that are registered for just a single generation in a separate vector, which
-					// we sort by generation, allowing us to look
-					slim_generation_t start = script_block->start_generation_;
-					slim_generation_t end = script_block->end_generation_;
-					
-					if (start == end)
-					{
-						cached_fitnessglobal_callbacks_onegen_.insert(std::pair<slim_generation_t, SLiMEidosBlock*>(start, script_block));
-					}
-					else
-					{
-						cached_fitnessglobal_callbacks_multigen_.push_back(script_block);
-					}
-					break;
-				}
-				case SLiMEidosBlockType::SLiMEidosInteractionCallback:		cached_interaction_callbacks_.push_back(script_block);		break;
-				case SLiMEidosBlockType::SLiMEidosMateChoiceCallback:		cached_matechoice_callbacks_.push_back(script_block);		break;
-				case SLiMEidosBlockType::SLiMEidosModifyChildCallback:		cached_modifychild_callbacks_.push_back(script_block);		break;
-				case SLiMEidosBlockType::SLiMEidosRecombinationCallback:	cached_recombination_callbacks_.push_back(script_block);	break;
-				case SLiMEidosBlockType::SLiMEidosReproductionCallback:		cached_reproduction_callbacks_.push_back(script_block);		break;
-				case SLiMEidosBlockType::SLiMEidosUserDefinedFunction:		cached_userdef_functions_.push_back(script_block);			break;
-				case SLiMEidosBlockType::SLiMEidosNoBlockType:				break;	// never hit
-			}
+			SLiM_WriteCheckpointValue(p_out, muttype_pair.first);
+			SLiM_WriteCheckpointValue(p_out, muttype_pair.second->tag_value_);
 		}
 		
-		script_block_types_cached_ = true;
+		SLiM_WriteCheckpointValue(p_out, (int32_t)genomic_element_types_.size());
 		
-#if DEBUG_BLOCK_REG_DEREG
-		std::cout << "   ValidateScriptBlockCaches() recached, late() events cached are:" << std::endl;
-		for (SLiMEidosBlock *script_block : cached_late_events_)
+		for (auto &getype_pair : genomic_element_types_)
 		{
-			std::cout << "      ";
-			script_block->Print(std::cout);
-			std::cout << std::endl;
+			SLiM_WriteCheckpointValue(p_out, getype_pair.first);
+			SLiM_WriteCheckpointValue(p_out, getype_pair.second->tag_value_);
 		}
-#endif
+		
+		SLiM_EndCheckpointSection(p_out, section);
 	}
-}
-
-std::vector<SLiMEidosBlock*> SLiMSim::ScriptBlocksMatching(slim_generation_t p_generation, SLiMEidosBlockType p_event_type, slim_objectid_t p_mutation_type_id, slim_objectid_t p_interaction_type_id, slim_objectid_t p_subpopulation_id)
-{
-	if (!script_block_types_cached_)
-		ValidateScriptBlockCaches();
-	
-	std::vector<SLiMEidosBlock*> *block_list = nullptr;
 	
-	switch (p_event_type)
+	// Subpopulations section
 	{
-		case SLiMEidosBlockType::SLiMEidosEventEarly:				block_list = &cached_early_events_;						break;
-		case SLiMEidosBlockType::SLiMEidosEventLate:				block_list = &cached_late_events_;						break;
-		case SLiMEidosBlockType::SLiMEidosInitializeCallback:		block_list = &cached_initialize_callbacks_;				break;
-		case SLiMEidosBlockType::SLiMEidosFitnessCallback:			block_list = &cached_fitness_callbacks_;				break;
-		case SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback:	block_list = &cached_fitnessglobal_callbacks_multigen_;	break;
-		case SLiMEidosBlockType::SLiMEidosInteractionCallback:		block_list = &cached_interaction_callbacks_;			break;
-		case SLiMEidosBlockType::SLiMEidosMateChoiceCallback:		block_list = &cached_matechoice_callbacks_;				break;
-		case SLiMEidosBlockType::SLiMEidosModifyChildCallback:		block_list = &cached_modifychild_callbacks_;			break;
-		case SLiMEidosBlockType::SLiMEidosRecombinationCallback:	block_list = &cached_recombination_callbacks_;			break;
-		case SLiMEidosBlockType::SLiMEidosReproductionCallback:		block_list = &cached_reproduction_callbacks_;			break;
-		case SLiMEidosBlockType::SLiMEidosUserDefinedFunction:		block_list = &cached_userdef_functions_;				break;
-		case SLiMEidosBlockType::SLiMEidosNoBlockType:				break;	// never hit
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_Subpops);
+		
+		SLiM_WriteCheckpointValue(p_out, (int32_t)population_.size());
+		
+		for (auto &subpop_pair : population_)
+		{
+			Subpopulation *subpop = subpop_pair.second;
+			
+			SLiM_WriteCheckpointValue(p_out, subpop_pair.first);
+			SLiM_WriteCheckpointValue(p_out, subpop->parent_subpop_size_);
+			SLiM_WriteCheckpointValue(p_out, subpop->parent_first_male_index_);
+			SLiM_WriteCheckpointValue(p_out, subpop->parent_sex_ratio_);
+			SLiM_WriteCheckpointValue(p_out, subpop->child_subpop_size_);
+			SLiM_WriteCheckpointValue(p_out, subpop->child_sex_ratio_);
+			SLiM_WriteCheckpointValue(p_out, subpop->tag_value_);
+			SLiM_WriteCheckpointValue(p_out, subpop->selfing_fraction_);
+			SLiM_WriteCheckpointValue(p_out, subpop->female_clone_fraction_);
+			SLiM_WriteCheckpointValue(p_out, subpop->male_clone_fraction_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_x0_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_x1_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_y0_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_y1_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_z0_);
+			SLiM_WriteCheckpointValue(p_out, subpop->bounds_z1_);
+			SLiM_WriteCheckpointValue(p_out, (int32_t)subpop->migrant_fractions_.size());
+			
+			for (auto &migrant_pair : subpop->migrant_fractions_)
+			{
+				SLiM_WriteCheckpointValue(p_out, migrant_pair.first);
+				SLiM_WriteCheckpointValue(p_out, migrant_pair.second);
+			}
+		}
+		
+		SLiM_EndCheckpointSection(p_out, section);
 	}
 	
-	std::vector<SLiMEidosBlock*> matches;
+	// Mutations section, in registry order; the index of a mutation in this section is used to refer to it below
+	std::vector<int32_t> checkpoint_index_for_block_index(gSLiM_Mutation_Block_LastUsedIndex + 1, -1);
 	
-	for (SLiMEidosBlock *script_block : *block_list)
 	{
-		// check that the generation is in range
-		if ((script_block->start_generation_ > p_generation) || (script_block->end_generation_ < p_generation))
-			continue;
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_Mutations);
+		const MutationIndex *registry_iter = population_.mutation_registry_.begin_pointer_const();
+		const MutationIndex *registry_iter_end = population_.mutation_registry_.end_pointer_const();
+		std::vector<SLiMCheckpointMutationRec> records;
 		
-		// check that the script type matches (event, callback, etc.) - now guaranteed by the caching mechanism
-		//if (script_block->type_ != p_event_type)
-		//	continue;
+		records.reserve(registry_iter_end - registry_iter);
 		
-		// check that the mutation type id matches, if requested
-		// this is now a bit tricky, with the NULL mut-type option, indicated by -2.  The rules now are:
-		//
-		//    if -2 is requested, -2 callbacks are all you get
-		//    if anything other than -2 is requested (including -1), -2 callbacks will not be returned
-		//
-		// so -2 callbacks are treated in a completely separate manner; they are never returned with other callbacks
-		slim_objectid_t mutation_type_id = script_block->mutation_type_id_;
+		for (; registry_iter != registry_iter_end; ++registry_iter)
+		{
+			const Mutation *mutation = gSLiM_Mutation_Block + *registry_iter;
+			SLiMCheckpointMutationRec record = {mutation->mutation_id_, mutation->tag_value_, mutation->mutation_type_ptr_->mutation_type_id_, mutation->position_, mutation->subpop_index_, mutation->origin_generation_, 0, mutation->selection_coeff_};
+			
+			checkpoint_index_for_block_index[*registry_iter] = (int32_t)records.size();
+			records.emplace_back(record);
+		}
 		
-		if ((p_mutation_type_id == -2) && (mutation_type_id != -2))
-			continue;
-		if ((p_mutation_type_id != -2) && (mutation_type_id == -2))
-			continue;
+		SLiM_WriteCheckpointValue(p_out, (int64_t)records.size());
+		p_out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SLiMCheckpointMutationRec));
+		SLiM_EndCheckpointSection(p_out, section);
+	}
+	
+	// Substitutions section
+	{
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_Substitutions);
+		std::vector<SLiMCheckpointMutationRec> records;
 		
-		if (p_mutation_type_id != -1)
+		records.reserve(population_.substitutions_.size());
+		
+		for (const Substitution *substitution : population_.substitutions_)
 		{
-			if ((mutation_type_id != -1) && (p_mutation_type_id != mutation_type_id))
-				continue;
+			SLiMCheckpointMutationRec record = {substitution->mutation_id_, substitution->tag_value_, substitution->mutation_type_ptr_->mutation_type_id_, substitution->position_, substitution->subpop_index_, substitution->origin_generation_, substitution->fixation_generation_, substitution->selection_coeff_};
+			
+			records.emplace_back(record);
 		}
 		
-		// check that the interaction type id matches, if requested
-		if (p_interaction_type_id != -1)
+		SLiM_WriteCheckpointValue(p_out, (int64_t)records.size());
+		p_out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SLiMCheckpointMutationRec));
+		SLiM_EndCheckpointSection(p_out, section);
+	}
+	
+	// Find the unique mutation runs and the runs used by each genome; null genomes get -1 for each of their runs
+	std::unordered_map<const MutationRun *, int32_t> run_index_for_run;
+	std::vector<const MutationRun *> unique_runs;
+	std::vector<int32_t> genome_run_indices;
+	int32_t mutrun_count = chromosome_.mutrun_count_;
+	slim_position_t mutrun_length = chromosome_.mutrun_length_;
+	int64_t individual_count = 0;
+	
+	for (auto &subpop_pair : population_)
+		individual_count += subpop_pair.second->CurrentSubpopSize();
+	
+	genome_run_indices.reserve(individual_count * 2 * mutrun_count);
+	
+	for (auto &subpop_pair : population_)
+	{
+		for (const Genome *genome : subpop_pair.second->CurrentGenomes())
 		{
-			slim_objectid_t interaction_type_id = script_block->interaction_type_id_;
-			
-			if ((interaction_type_id != -1) && (p_interaction_type_id != interaction_type_id))
+			if (genome->IsNull())
+			{
+				genome_run_indices.insert(genome_run_indices.end(), mutrun_count, -1);
 				continue;
+			}
+			
+			if ((genome->mutrun_count_ != mutrun_count) || (genome->mutrun_length_ != mutrun_length))
+				EIDOS_TERMINATION << "ERROR (SLiMSim::WriteCheckpoint): (internal error) genome mutation run configuration does not match the chromosome." << EidosTerminate();
+			
+			for (int32_t run_index = 0; run_index < mutrun_count; ++run_index)
+			{
+				const MutationRun *mutrun = genome->mutruns_[run_index].get();
+				auto found_run = run_index_for_run.find(mutrun);
+				
+				if (found_run == run_index_for_run.end())
+				{
+					int32_t unique_index = (int32_t)unique_runs.size();
+					
+					run_index_for_run.emplace(mutrun, unique_index);
+					unique_runs.emplace_back(mutrun);
+					genome_run_indices.emplace_back(unique_index);
+				}
+				else
+				{
+					genome_run_indices.emplace_back(found_run->second);
+				}
+			}
 		}
+	}
+	
+	// Mutation runs section: the unique runs, as offsets into one array of mutation indices (indices into the mutations section)
+	{
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_MutationRuns);
+		std::vector<int64_t> run_offsets;
+		std::vector<int32_t> run_mutations;
 		
-		// check that the subpopulation id matches, if requested
-		if (p_subpopulation_id != -1)
+		run_offsets.reserve(unique_runs.size() + 1);
+		run_offsets.emplace_back(0);
+		
+		for (const MutationRun *mutrun : unique_runs)
 		{
-			slim_objectid_t subpopulation_id = script_block->subpopulation_id_;
+			if (mutrun)
+			{
+				for (const MutationIndex *mut_iter = mutrun->begin_pointer_const(); mut_iter != mutrun->end_pointer_const(); ++mut_iter)
+				{
+					int32_t checkpoint_index = checkpoint_index_for_block_index[*mut_iter];
+					
+					if (checkpoint_index == -1)
+						EIDOS_TERMINATION << "ERROR (SLiMSim::WriteCheckpoint): (internal error) mutation not found in the mutation registry." << EidosTerminate();
+					
+					run_mutations.emplace_back(checkpoint_index);
+				}
+			}
 			
-			if ((subpopulation_id != -1) && (p_subpopulation_id != subpopulation_id))
-				continue;
+			run_offsets.emplace_back((int64_t)run_mutations.size());
 		}
 		
-		// OK, everything matches, so we want to return this script block
-		matches.emplace_back(script_block);
+		SLiM_WriteCheckpointValue(p_out, mutrun_count);
+		SLiM_WriteCheckpointValue(p_out, mutrun_length);
+		SLiM_WriteCheckpointValue(p_out, (int64_t)unique_runs.size());
+		SLiM_WriteCheckpointValue(p_out, (int64_t)run_mutations.size());
+		p_out.write(reinterpret_cast<const char *>(run_offsets.data()), run_offsets.size() * sizeof(int64_t));
+		p_out.write(reinterpret_cast<const char *>(run_mutations.data()), run_mutations.size() * sizeof(int32_t));
+		SLiM_EndCheckpointSection(p_out, section);
 	}
 	
-	// add in any single-generation global fitness callbacks
-	if (p_event_type == SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback)
+	// Individuals section, in subpopulation order
 	{
-		auto find_range = cached_fitnessglobal_callbacks_onegen_.equal_range(p_generation);
-		auto find_start = find_range.first;
-		auto find_end = find_range.second;
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_Individuals);
+		std::vector<SLiMCheckpointIndividualRec> records;
 		
-		for (auto block_iter = find_start; block_iter != find_end; ++block_iter)
+		records.reserve(individual_count);
+		
+		for (auto &subpop_pair : population_)
 		{
-			SLiMEidosBlock *script_block = block_iter->second;
-			
-			// check that the subpopulation id matches, if requested
-			if (p_subpopulation_id != -1)
+			for (const Individual *individual : subpop_pair.second->CurrentIndividuals())
 			{
-				slim_objectid_t subpopulation_id = script_block->subpopulation_id_;
+				SLiMCheckpointIndividualRec record = {individual->pedigree_id_, individual->pedigree_p1_, individual->pedigree_p2_, individual->pedigree_g1_, individual->pedigree_g2_, individual->pedigree_g3_, individual->pedigree_g4_,
+					individual->tag_value_, individual->tagF_value_, individual->spatial_x_, individual->spatial_y_, individual->spatial_z_,
+					individual->genome1_->tag_value_, individual->genome2_->tag_value_, individual->age_, 0};
 				
-				if ((subpopulation_id != -1) && (p_subpopulation_id != subpopulation_id))
-					continue;
+				records.emplace_back(record);
 			}
-			
-			// OK, everything matches, so we want to return this script block
-			matches.emplace_back(script_block);
 		}
+		
+		SLiM_WriteCheckpointValue(p_out, (int64_t)records.size());
+		p_out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SLiMCheckpointIndividualRec));
+		SLiM_EndCheckpointSection(p_out, section);
 	}
 	
-	return matches;
-}
-
-std::vector<SLiMEidosBlock*> &SLiMSim::AllScriptBlocks()
-{
-	return script_blocks_;
-}
-
-void SLiMSim::OptimizeScriptBlock(SLiMEidosBlock *p_script_block)
-{
-	// The goal here is to look for specific structures in callbacks that we are able to optimize by short-circuiting
-	// the callback interpretation entirely and replacing it with equivalent C++ code.  This is extremely messy, so
-	// we're not going to do this for very many cases, but sometimes it is worth it.
-	if (!p_script_block->has_cached_optimization_)
+	// Genomes section: mutrun_count run indices for each genome, two genomes per individual
 	{
-		if (p_script_block->type_ == SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback)
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_Genomes);
+		
+		SLiM_WriteCheckpointValue(p_out, individual_count * 2);
+		SLiM_WriteCheckpointValue(p_out, mutrun_count);
+		p_out.write(reinterpret_cast<const char *>(genome_run_indices.data()), genome_run_indices.size() * sizeof(int32_t));
+		SLiM_EndCheckpointSection(p_out, section);
+	}
+	
+	// Script blocks section: the current schedule of every event and callback, including blocks registered or rescheduled by the
+	// script.  Blocks from the model script are identified by the position of their body in the script; blocks created at runtime
+	// are recreated from their source.  Blocks that are scheduled for deregistration are omitted, since they are already gone.
+	{
+		std::streampos section = SLiM_BeginCheckpointSection(p_out, kCheckpointSection_ScriptBlocks);
+		std::vector<SLiMEidosBlock *> saved_blocks;
+		
+		for (SLiMEidosBlock *block : script_blocks_)
+		{
+			if ((block->type_ == SLiMEidosBlockType::SLiMEidosUserDefinedFunction) || (block->type_ == SLiMEidosBlockType::SLiMEidosInitializeCallback))
+				continue;
+			if (std::find(scheduled_deregistrations_.begin(), scheduled_deregistrations_.end(), block) != scheduled_deregistrations_.end())
+				continue;
+			if (std::find(scheduled_interaction_deregs_.begin(), scheduled_interaction_deregs_.end(), block) != scheduled_interaction_deregs_.end())
+				continue;
+			
+			saved_blocks.emplace_back(block);
+		}
+		
+		SLiM_WriteCheckpointValue(p_out, (int32_t)saved_blocks.size());
+		
+		for (SLiMEidosBlock *block : saved_blocks)
+		{
+			const EidosToken *body_token = block->compound_statement_node_->token_;
+			int64_t script_position = (block->script_ ? -1 : (int64_t)body_token->token_start_);
+			
+			SLiM_WriteCheckpointValue(p_out, (int32_t)block->type_);
+			SLiM_WriteCheckpointValue(p_out, block->block_id_);
+			SLiM_WriteCheckpointValue(p_out, block->start_generation_);
+			SLiM_WriteCheckpointValue(p_out, block->end_generation_);
+			SLiM_WriteCheckpointValue(p_out, block->mutation_type_id_);
+			SLiM_WriteCheckpointValue(p_out, block->subpopulation_id_);
+			SLiM_WriteCheckpointValue(p_out, block->interaction_type_id_);
+			SLiM_WriteCheckpointValue(p_out, (int32_t)block->sex_specificity_);
+			SLiM_WriteCheckpointValue(p_out, block->tag_value_);
+			SLiM_WriteCheckpointValue(p_out, script_position);
+			SLiM_WriteCheckpointValue(p_out, (int64_t)body_token->token_string_.length());
+			p_out.write(body_token->token_string_.data(), body_token->token_string_.length());
+		}
+		
+		SLiM_EndCheckpointSection(p_out, section);
+	}
+	
+	int32_t section_end_tag = 0xFFFF0000;
+	
+	p_out.write(reinterpret_cast<char *>(&section_end_tag), sizeof section_end_tag);
+}
+
+slim_generation_t SLiMSim::_InitializePopulationFromCheckpoint(const char *p_buf, const char *p_buf_end, EidosInterpreter *p_interpreter)
+{
+	// Find all of the sections first, since they depend upon each other; unknown sections are skipped
+	std::unordered_map<int32_t, std::pair<const char *, const char *>> sections;
+	const char *p = p_buf;
+	
+	while (true)
+	{
+		int32_t section_tag = SLiM_ReadCheckpointValue<int32_t>(p, p_buf_end);
+		
+		if (section_tag == (int32_t)0xFFFF0000)
+			break;
+		
+		int64_t section_length = SLiM_ReadCheckpointValue<int64_t>(p, p_buf_end);
+		const char *section_start = SLiM_ReadCheckpointArray(p, p_buf_end, section_length);
+		
+		sections[section_tag] = std::pair<const char *, const char *>(section_start, p);
+	}
+	
+	for (int32_t required_tag : {kCheckpointSection_State, kCheckpointSection_Subpops, kCheckpointSection_Mutations, kCheckpointSection_Substitutions, kCheckpointSection_MutationRuns, kCheckpointSection_Individuals, kCheckpointSection_Genomes, kCheckpointSection_ScriptBlocks})
+		if (sections.find(required_tag) == sections.end())
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): checkpoint is missing a required section." << EidosTerminate();
+	
+	// State section; the RNG state and the ID counters are restored at the very end, since making subpopulations uses them
+	const char *state_end = sections[kCheckpointSection_State].second;
+	p = sections[kCheckpointSection_State].first;
+	
+	if (SLiM_ReadCheckpointValue<int32_t>(p, state_end) != (int32_t)model_type_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): the checkpoint model type (WF or nonWF) does not match that of the simulation." << EidosTerminate();
+	if (SLiM_ReadCheckpointValue<int32_t>(p, state_end) != (int32_t)sex_enabled_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): sex vs. hermaphroditism mismatch between checkpoint and simulation." << EidosTerminate();
+	if (SLiM_ReadCheckpointValue<int32_t>(p, state_end) != (int32_t)modeled_chromosome_type_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): the checkpoint modeled chromosome type does not match that of the simulation." << EidosTerminate();
+	
+	slim_mutationid_t next_mutation_id = SLiM_ReadCheckpointValue<slim_mutationid_t>(p, state_end);
+	slim_pedigreeid_t next_pedigree_id = SLiM_ReadCheckpointValue<slim_pedigreeid_t>(p, state_end);
+	slim_usertag_t sim_tag_value = SLiM_ReadCheckpointValue<slim_usertag_t>(p, state_end);
+	uint64_t rng_last_seed = SLiM_ReadCheckpointValue<uint64_t>(p, state_end);
+	int64_t taus_state_size = SLiM_ReadCheckpointValue<int64_t>(p, state_end);
+	
+	if (taus_state_size != (int64_t)gsl_rng_size(EIDOS_GSL_RNG))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): the checkpoint RNG state does not match the RNG in use." << EidosTerminate();
+	
+	const char *taus_state = SLiM_ReadCheckpointArray(p, state_end, taus_state_size);
+	const char *mt_state = SLiM_ReadCheckpointArray(p, state_end, Eidos_MT64_NN * sizeof(uint64_t));
+	int32_t mt_index = SLiM_ReadCheckpointValue<int32_t>(p, state_end);
+	int32_t random_bool_bit_counter = SLiM_ReadCheckpointValue<int32_t>(p, state_end);
+	uint64_t random_bool_bit_buffer = SLiM_ReadCheckpointValue<uint64_t>(p, state_end);
+	
+	int32_t muttype_count = SLiM_ReadCheckpointValue<int32_t>(p, state_end);
+	
+	for (int32_t muttype_index = 0; muttype_index < muttype_count; ++muttype_index)
+	{
+		slim_objectid_t muttype_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, state_end);
+		slim_usertag_t muttype_tag = SLiM_ReadCheckpointValue<slim_usertag_t>(p, state_end);
+		auto found_muttype_pair = mutation_types_.find(muttype_id);
+		
+		if (found_muttype_pair != mutation_types_.end())
+			found_muttype_pair->second->tag_value_ = muttype_tag;
+	}
+	
+	int32_t getype_count = SLiM_ReadCheckpointValue<int32_t>(p, state_end);
+	
+	for (int32_t getype_index = 0; getype_index < getype_count; ++getype_index)
+	{
+		slim_objectid_t getype_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, state_end);
+		slim_usertag_t getype_tag = SLiM_ReadCheckpointValue<slim_usertag_t>(p, state_end);
+		auto found_getype_pair = genomic_element_types_.find(getype_id);
+		
+		if (found_getype_pair != genomic_element_types_.end())
+			found_getype_pair->second->tag_value_ = getype_tag;
+	}
+	
+	// Subpopulations section
+	const char *subpops_end = sections[kCheckpointSection_Subpops].second;
+	p = sections[kCheckpointSection_Subpops].first;
+	
+	int32_t subpop_count = SLiM_ReadCheckpointValue<int32_t>(p, subpops_end);
+	int64_t individual_count = 0;
+	
+	for (int32_t subpop_index = 0; subpop_index < subpop_count; ++subpop_index)
+	{
+		slim_objectid_t subpop_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, subpops_end);
+		slim_popsize_t parent_subpop_size = SLiM_ReadCheckpointValue<slim_popsize_t>(p, subpops_end);
+		slim_popsize_t parent_first_male_index = SLiM_ReadCheckpointValue<slim_popsize_t>(p, subpops_end);
+		double parent_sex_ratio = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		slim_popsize_t child_subpop_size = SLiM_ReadCheckpointValue<slim_popsize_t>(p, subpops_end);
+		double child_sex_ratio = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		
+		// Create the subpopulation with exactly the saved number of females; the sex ratio is restored afterwards
+		double creation_sex_ratio = ((sex_enabled_ && (parent_subpop_size > 0)) ? (parent_subpop_size - parent_first_male_index) / (double)parent_subpop_size : 0.0);
+		Subpopulation *new_subpop = population_.AddSubpopulation(subpop_id, parent_subpop_size, creation_sex_ratio);
+		
+		if (sex_enabled_ && (new_subpop->parent_first_male_index_ != parent_first_male_index))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): (internal error) the number of females in subpopulation p" << subpop_id << " could not be restored." << EidosTerminate();
+		
+		new_subpop->tag_value_ = SLiM_ReadCheckpointValue<slim_usertag_t>(p, subpops_end);
+		new_subpop->selfing_fraction_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->female_clone_fraction_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->male_clone_fraction_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_x0_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_x1_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_y0_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_y1_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_z0_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		new_subpop->bounds_z1_ = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+		
+		int32_t migrant_count = SLiM_ReadCheckpointValue<int32_t>(p, subpops_end);
+		
+		for (int32_t migrant_index = 0; migrant_index < migrant_count; ++migrant_index)
+		{
+			slim_objectid_t source_subpop_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, subpops_end);
+			double migrant_fraction = SLiM_ReadCheckpointValue<double>(p, subpops_end);
+			
+			new_subpop->migrant_fractions_[source_subpop_id] = migrant_fraction;
+		}
+		
+		if (model_type_ == SLiMModelType::kModelTypeWF)
+		{
+			new_subpop->parent_sex_ratio_ = parent_sex_ratio;
+			
+			// a pending setSubpopulationSize() or setSexRatio() needs the child generation to be regenerated to fit
+			if ((child_subpop_size != new_subpop->child_subpop_size_) || (child_sex_ratio != new_subpop->child_sex_ratio_))
+			{
+				new_subpop->child_subpop_size_ = child_subpop_size;
+				new_subpop->child_sex_ratio_ = child_sex_ratio;
+				new_subpop->GenerateChildrenToFitWF();
+			}
+		}
+		
+		individual_count += parent_subpop_size;
+		
+		// define a new Eidos variable to refer to the new subpopulation
+		EidosSymbolTableEntry &symbol_entry = new_subpop->SymbolTableEntry();
+		
+		if (p_interpreter && p_interpreter->SymbolTable().ContainsSymbol(symbol_entry.first))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): new subpopulation symbol " << Eidos_StringForGlobalStringID(symbol_entry.first) << " was already defined prior to its definition here." << EidosTerminate();
+		
+		simulation_constants_->InitializeConstantSymbolEntry(symbol_entry);
+	}
+	
+	// Mutations section; the registry is rebuilt in the saved order, since that order is visible to the model (sim.mutations, etc.)
+	const char *mutations_end = sections[kCheckpointSection_Mutations].second;
+	p = sections[kCheckpointSection_Mutations].first;
+	
+	int64_t mutation_count = SLiM_ReadCheckpointValue<int64_t>(p, mutations_end);
+	const char *mutation_records = SLiM_ReadCheckpointArray(p, mutations_end, mutation_count * (int64_t)sizeof(SLiMCheckpointMutationRec));
+	std::vector<MutationIndex> mutations;
+	
+	mutations.reserve(mutation_count);
+	
+#ifdef SLIM_KEEP_MUTTYPE_REGISTRIES
+	if (population_.keeping_muttype_registries_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): (internal error) separate muttype registries set up during pop load." << EidosTerminate();
+#endif
+	
+	for (int64_t mutation_index = 0; mutation_index < mutation_count; ++mutation_index)
+	{
+		SLiMCheckpointMutationRec record;
+		
+		memcpy(&record, mutation_records + mutation_index * sizeof(SLiMCheckpointMutationRec), sizeof(SLiMCheckpointMutationRec));
+		
+		auto found_muttype_pair = mutation_types_.find(record.mutation_type_id_);
+		
+		if (found_muttype_pair == mutation_types_.end())
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): mutation type m" << record.mutation_type_id_ << " has not been defined." << EidosTerminate();
+		
+		MutationType *mutation_type_ptr = found_muttype_pair->second;
+		MutationIndex new_mut_index = SLiM_NewMutationFromBlock();
+		Mutation *new_mut = new (gSLiM_Mutation_Block + new_mut_index) Mutation(record.mutation_id_, mutation_type_ptr, record.position_, record.selection_coeff_, record.subpop_index_, record.origin_generation_);
+		
+		new_mut->tag_value_ = record.tag_value_;
+		mutations.emplace_back(new_mut_index);
+		population_.mutation_registry_.emplace_back(new_mut_index);
+		
+		if (record.selection_coeff_ != 0.0)
+		{
+			pure_neutral_ = false;
+			mutation_type_ptr->all_pure_neutral_DFE_ = false;
+		}
+	}
+	
+	// Substitutions section
+	const char *substitutions_end = sections[kCheckpointSection_Substitutions].second;
+	p = sections[kCheckpointSection_Substitutions].first;
+	
+	int64_t substitution_count = SLiM_ReadCheckpointValue<int64_t>(p, substitutions_end);
+	const char *substitution_records = SLiM_ReadCheckpointArray(p, substitutions_end, substitution_count * (int64_t)sizeof(SLiMCheckpointMutationRec));
+	
+	population_.substitutions_.reserve(substitution_count);
+	
+	for (int64_t substitution_index = 0; substitution_index < substitution_count; ++substitution_index)
+	{
+		SLiMCheckpointMutationRec record;
+		
+		memcpy(&record, substitution_records + substitution_index * sizeof(SLiMCheckpointMutationRec), sizeof(SLiMCheckpointMutationRec));
+		
+		auto found_muttype_pair = mutation_types_.find(record.mutation_type_id_);
+		
+		if (found_muttype_pair == mutation_types_.end())
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): mutation type m" << record.mutation_type_id_ << " has not been defined." << EidosTerminate();
+		
+		Substitution *substitution = new Substitution(record.mutation_id_, found_muttype_pair->second, record.position_, record.selection_coeff_, record.subpop_index_, record.origin_generation_, record.fixation_generation_);
+		
+		substitution->tag_value_ = record.tag_value_;
+		population_.substitutions_.emplace_back(substitution);
+	}
+	
+	// Mutation runs section; each unique run is built once, translating mutation indices from the checkpoint into the mutation block
+	const char *runs_end = sections[kCheckpointSection_MutationRuns].second;
+	p = sections[kCheckpointSection_MutationRuns].first;
+	
+	int32_t mutrun_count = SLiM_ReadCheckpointValue<int32_t>(p, runs_end);
+	slim_position_t mutrun_length = SLiM_ReadCheckpointValue<slim_position_t>(p, runs_end);
+	int64_t run_count = SLiM_ReadCheckpointValue<int64_t>(p, runs_end);
+	int64_t run_mutation_count = SLiM_ReadCheckpointValue<int64_t>(p, runs_end);
+	const char *run_offsets_bytes = SLiM_ReadCheckpointArray(p, runs_end, (run_count + 1) * (int64_t)sizeof(int64_t));
+	const char *run_mutations_bytes = SLiM_ReadCheckpointArray(p, runs_end, run_mutation_count * (int64_t)sizeof(int32_t));
+	std::vector<int64_t> run_offsets(run_count + 1);
+	std::vector<MutationRun_SP> runs;
+	std::vector<MutationIndex> run_buffer;
+	
+	memcpy(run_offsets.data(), run_offsets_bytes, (run_count + 1) * sizeof(int64_t));
+	runs.reserve(run_count);
+	
+	for (int64_t run_index = 0; run_index < run_count; ++run_index)
+	{
+		int64_t run_start = run_offsets[run_index];
+		int64_t run_end = run_offsets[run_index + 1];
+		
+		if ((run_start < 0) || (run_end < run_start) || (run_end > run_mutation_count))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): mutation run out of range." << EidosTerminate();
+		
+		run_buffer.resize(run_end - run_start);
+		
+		for (int64_t mut_index = run_start; mut_index < run_end; ++mut_index)
+		{
+			int32_t checkpoint_index;
+			
+			memcpy(&checkpoint_index, run_mutations_bytes + mut_index * sizeof(int32_t), sizeof(int32_t));
+			
+			if ((checkpoint_index < 0) || (checkpoint_index >= mutation_count))
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): mutation " << checkpoint_index << " has not been defined." << EidosTerminate();
+			
+			run_buffer[mut_index - run_start] = mutations[checkpoint_index];
+		}
+		
+		MutationRun *new_run = MutationRun::NewMutationRun();
+		
+		new_run->emplace_back_bulk(run_buffer.data(), (long)run_buffer.size());
+		runs.emplace_back(MutationRun_SP(new_run));
+	}
+	
+	// Individuals and genomes sections, in subpopulation order
+	const char *individuals_end = sections[kCheckpointSection_Individuals].second;
+	p = sections[kCheckpointSection_Individuals].first;
+	
+	if (SLiM_ReadCheckpointValue<int64_t>(p, individuals_end) != individual_count)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): the number of individuals does not match the subpopulation sizes." << EidosTerminate();
+	
+	const char *individual_records = SLiM_ReadCheckpointArray(p, individuals_end, individual_count * (int64_t)sizeof(SLiMCheckpointIndividualRec));
+	
+	const char *genomes_end = sections[kCheckpointSection_Genomes].second;
+	p = sections[kCheckpointSection_Genomes].first;
+	
+	if ((SLiM_ReadCheckpointValue<int64_t>(p, genomes_end) != individual_count * 2) || (SLiM_ReadCheckpointValue<int32_t>(p, genomes_end) != mutrun_count))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): the genome section does not match the individuals and mutation runs." << EidosTerminate();
+	
+	const char *genome_run_indices = SLiM_ReadCheckpointArray(p, genomes_end, individual_count * 2 * mutrun_count * (int64_t)sizeof(int32_t));
+	int64_t record_index = 0;
+	bool runs_were_rebuilt = false;
+	
+	for (auto &subpop_pair : population_)
+	{
+		Subpopulation *subpop = subpop_pair.second;
+		
+		for (slim_popsize_t individual_index = 0; individual_index < subpop->parent_subpop_size_; ++individual_index, ++record_index)
+		{
+			Individual &individual = *subpop->parent_individuals_[individual_index];
+			SLiMCheckpointIndividualRec record;
+			
+			memcpy(&record, individual_records + record_index * sizeof(SLiMCheckpointIndividualRec), sizeof(SLiMCheckpointIndividualRec));
+			
+			individual.pedigree_id_ = record.pedigree_id_;
+			individual.pedigree_p1_ = record.pedigree_p1_;
+			individual.pedigree_p2_ = record.pedigree_p2_;
+			individual.pedigree_g1_ = record.pedigree_g1_;
+			individual.pedigree_g2_ = record.pedigree_g2_;
+			individual.pedigree_g3_ = record.pedigree_g3_;
+			individual.pedigree_g4_ = record.pedigree_g4_;
+			individual.tag_value_ = record.tag_value_;
+			individual.tagF_value_ = record.tagF_value_;
+			individual.spatial_x_ = record.spatial_x_;
+			individual.spatial_y_ = record.spatial_y_;
+			individual.spatial_z_ = record.spatial_z_;
+			
+			if (model_type_ == SLiMModelType::kModelTypeNonWF)
+				individual.age_ = record.age_;
+			
+			for (int genome_offset = 0; genome_offset < 2; ++genome_offset)
+			{
+				Genome &genome = *subpop->parent_genomes_[individual_index * 2 + genome_offset];
+				const char *run_indices = genome_run_indices + (record_index * 2 + genome_offset) * mutrun_count * sizeof(int32_t);
+				int32_t first_run_index;
+				
+				genome.genome_id_ = record.pedigree_id_ * 2 + genome_offset;
+				genome.tag_value_ = (genome_offset ? record.genome2_tag_value_ : record.genome1_tag_value_);
+				
+				memcpy(&first_run_index, run_indices, sizeof(int32_t));
+				
+				if (first_run_index == -1)
+				{
+					if (!genome.IsNull())
+						EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): genome is specified as null, but the instantiated genome is non-null." << EidosTerminate();
+					continue;
+				}
+				
+				if (genome.IsNull())
+					EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): genome is specified as non-null, but the instantiated genome is null." << EidosTerminate();
+				
+				for (int32_t run_index = 0; run_index < mutrun_count; ++run_index)
+				{
+					int32_t unique_run_index;
+					
+					memcpy(&unique_run_index, run_indices + run_index * sizeof(int32_t), sizeof(int32_t));
+					
+					if ((unique_run_index < 0) || (unique_run_index >= run_count))
+						EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): mutation run index out of range." << EidosTerminate();
+					
+					if ((genome.mutrun_count_ == mutrun_count) && (genome.mutrun_length_ == mutrun_length))
+					{
+						// the usual case: the genome shares the restored run
+						genome.mutruns_[run_index] = runs[unique_run_index];
+					}
+					else
+					{
+						// the mutation run configuration has changed since the checkpoint was written; add the mutations one run at a time
+						const MutationRun *saved_run = runs[unique_run_index].get();
+						slim_mutrun_index_t current_mutrun_index = -1;
+						MutationRun *current_mutrun = nullptr;
+						
+						for (const MutationIndex *mut_iter = saved_run->begin_pointer_const(); mut_iter != saved_run->end_pointer_const(); ++mut_iter)
+						{
+							slim_mutrun_index_t mutrun_index = (slim_mutrun_index_t)((gSLiM_Mutation_Block + *mut_iter)->position_ / genome.mutrun_length_);
+							
+							if (mutrun_index != current_mutrun_index)
+							{
+								current_mutrun_index = mutrun_index;
+								genome.WillModifyRun(current_mutrun_index);
+								current_mutrun = genome.mutruns_[mutrun_index].get();
+							}
+							
+							current_mutrun->emplace_back(*mut_iter);
+						}
+						
+						runs_were_rebuilt = true;
+					}
+				}
+			}
+		}
+	}
+	
+	// Script blocks section.  Each saved block is matched to a block of the same type, id, and source; blocks from the model script
+	// must also be at the same position in the script, so the checkpoint must be restored by the model that wrote it.  Matched blocks
+	// get the saved schedule, saved blocks with no match are registered anew, and unmatched blocks are scheduled for deregistration.
+	const char *blocks_end = sections[kCheckpointSection_ScriptBlocks].second;
+	p = sections[kCheckpointSection_ScriptBlocks].first;
+	
+	std::vector<SLiMEidosBlock *> unmatched_blocks;
+	
+	for (SLiMEidosBlock *block : script_blocks_)
+	{
+		if ((block->type_ == SLiMEidosBlockType::SLiMEidosUserDefinedFunction) || (block->type_ == SLiMEidosBlockType::SLiMEidosInitializeCallback))
+			continue;
+		if (std::find(scheduled_deregistrations_.begin(), scheduled_deregistrations_.end(), block) != scheduled_deregistrations_.end())
+			continue;
+		if (std::find(scheduled_interaction_deregs_.begin(), scheduled_interaction_deregs_.end(), block) != scheduled_interaction_deregs_.end())
+			continue;
+		
+		unmatched_blocks.emplace_back(block);
+	}
+	
+	int32_t block_count = SLiM_ReadCheckpointValue<int32_t>(p, blocks_end);
+	
+	for (int32_t block_index = 0; block_index < block_count; ++block_index)
+	{
+		SLiMEidosBlockType block_type = (SLiMEidosBlockType)SLiM_ReadCheckpointValue<int32_t>(p, blocks_end);
+		slim_objectid_t block_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, blocks_end);
+		slim_generation_t start_generation = SLiM_ReadCheckpointValue<slim_generation_t>(p, blocks_end);
+		slim_generation_t end_generation = SLiM_ReadCheckpointValue<slim_generation_t>(p, blocks_end);
+		slim_objectid_t mutation_type_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, blocks_end);
+		slim_objectid_t subpopulation_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, blocks_end);
+		slim_objectid_t interaction_type_id = SLiM_ReadCheckpointValue<slim_objectid_t>(p, blocks_end);
+		IndividualSex sex_specificity = (IndividualSex)SLiM_ReadCheckpointValue<int32_t>(p, blocks_end);
+		slim_usertag_t block_tag_value = SLiM_ReadCheckpointValue<slim_usertag_t>(p, blocks_end);
+		int64_t script_position = SLiM_ReadCheckpointValue<int64_t>(p, blocks_end);
+		int64_t source_length = SLiM_ReadCheckpointValue<int64_t>(p, blocks_end);
+		const char *source_bytes = SLiM_ReadCheckpointArray(p, blocks_end, source_length);
+		std::string source(source_bytes, source_length);
+		SLiMEidosBlock *block = nullptr;
+		
+		for (auto block_iter = unmatched_blocks.begin(); block_iter != unmatched_blocks.end(); ++block_iter)
+		{
+			SLiMEidosBlock *candidate = *block_iter;
+			const EidosToken *body_token = candidate->compound_statement_node_->token_;
+			
+			if ((candidate->type_ != block_type) || (candidate->block_id_ != block_id) || (body_token->token_string_ != source))
+				continue;
+			if ((script_position == -1) ? (candidate->script_ == nullptr) : ((candidate->script_ != nullptr) || (body_token->token_start_ != script_position)))
+				continue;
+			
+			block = candidate;
+			unmatched_blocks.erase(block_iter);
+			break;
+		}
+		
+		if (!block)
+		{
+			if (script_position != -1)
+				EIDOS_TERMINATION << "ERROR (SLiMSim::_InitializePopulationFromCheckpoint): a script block in the checkpoint was not found in the model script; checkpoints must be restored by the same model script that wrote them." << EidosTerminate();
+			
+			block = new SLiMEidosBlock(block_id, source, block_type, start_generation, end_generation);
+			block->mutation_type_id_ = mutation_type_id;
+			block->subpopulation_id_ = subpopulation_id;
+			block->interaction_type_id_ = interaction_type_id;
+			block->sex_specificity_ = sex_specificity;
+			
+			AddScriptBlock(block, p_interpreter, nullptr);		// takes ownership from us
+		}
+		
+		block->start_generation_ = start_generation;
+		block->end_generation_ = end_generation;
+		block->mutation_type_id_ = mutation_type_id;
+		block->subpopulation_id_ = subpopulation_id;
+		block->interaction_type_id_ = interaction_type_id;
+		block->sex_specificity_ = sex_specificity;
+		block->tag_value_ = block_tag_value;
+	}
+	
+	for (SLiMEidosBlock *block : unmatched_blocks)
+	{
+		if (block->type_ == SLiMEidosBlockType::SLiMEidosInteractionCallback)
+			scheduled_interaction_deregs_.emplace_back(block);
+		else
+			scheduled_deregistrations_.emplace_back(block);
+	}
+	
+	last_script_block_gen_cached_ = false;
+	script_block_types_cached_ = false;
+	scripts_changed_ = true;
+	
+	// Re-tally mutation references so we have accurate frequency counts for our new mutations
+	population_.cached_tally_genome_count_ = 0;
+	
+	if (runs_were_rebuilt)
+		population_.UniqueMutationRuns();
+	
+	population_.TallyMutationReferences(nullptr, true);
+	
+	// Finally, restore the ID counters and the RNG state, so that the run continues exactly as it would have
+	gSLiM_next_mutation_id = next_mutation_id;
+	gSLiM_next_pedigree_id = next_pedigree_id;
+	tag_value_ = sim_tag_value;
+	
+	gEidos_RNG.rng_last_seed_ = (unsigned long int)rng_last_seed;
+	memcpy(gsl_rng_state(EIDOS_GSL_RNG), taus_state, taus_state_size);
+	memcpy(gEidos_RNG.mt_, mt_state, Eidos_MT64_NN * sizeof(uint64_t));
+	gEidos_RNG.mti_ = mt_index;
+	gEidos_RNG.random_bool_bit_counter_ = random_bool_bit_counter;
+	gEidos_RNG.random_bool_bit_buffer_ = random_bool_bit_buffer;
+	
+	return generation_;
+}
+
+void SLiMSim::ValidateScriptBlockCaches(void)
+{
+#if DEBUG_BLOCK_REG_DEREG
+	std::cout << "Generation " << generation_ << ": ValidateScriptBlockCaches() called..." << std::endl;
+#endif
+	
+	if (!script_block_types_cached_)
+	{
+		cached_early_events_.clear();
+		cached_late_events_.clear();
+		cached_initialize_callbacks_.clear();
+		cached_fitness_callbacks_.clear();
+		cached_fitnessglobal_callbacks_onegen_.clear();
+		cached_fitnessglobal_callbacks_multigen_.clear();
+		cached_interaction_callbacks_.clear();
+		cached_matechoice_callbacks_.clear();
+		cached_modifychild_callbacks_.clear();
+		cached_recombination_callbacks_.clear();
+		cached_reproduction_callbacks_.clear();
+		cached_userdef_functions_.clear();
+		
+		std::vector<SLiMEidosBlock*> &script_blocks = AllScriptBlocks();
+		
+#if DEBUG_BLOCK_REG_DEREG
+		std::cout << "   ValidateScriptBlockCaches() recaching, AllScriptBlocks() is:" << std::endl;
+		for (SLiMEidosBlock *script_block : script_blocks)
+		{
+			std::cout << "      ";
+			script_block->Print(std::cout);
+			std::cout << std::endl;
+		}
+#endif
+		
+		for (auto script_block : script_blocks)
+		{
+			switch (script_block->type_)
+			{
+				case SLiMEidosBlockType::SLiMEidosEventEarly:				cached_early_events_.push_back(script_block);				break;
+				case SLiMEidosBlockType::SLiMEidosEventLate:				cached_late_events_.push_back(script_block);				break;
+				case SLiMEidosBlockType::SLiMEidosInitializeCallback:		cached_initialize_callbacks_.push_back(script_block);		break;
+				case SLiMEidosBlockType::SLiMEidosFitnessCallback:			cached_fitness_callbacks_.push_back(script_block);			break;
+				case SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback:
+				{
+					// Global fitness callbacks are not order-dependent, so we don't have to preserve their order
+					// of declaration the way we do with other types of callbacks.  This allows us to be very efficient
+					// in how we look them up, which is good since sometimes we have a very large number of them.
+					// We put those that are registered for just a single generation in a separate vector, which
+					// we sort by generation, allowing us to look
+					slim_generation_t start = script_block->start_generation_;
+					slim_generation_t end = script_block->end_generation_;
+					
+					if (start == end)
+					{
+						cached_fitnessglobal_callbacks_onegen_.insert(std::pair<slim_generation_t, SLiMEidosBlock*>(start, script_block));
+					}
+					else
+					{
+						cached_fitnessglobal_callbacks_multigen_.push_back(script_block);
+					}
+					break;
+				}
+				case SLiMEidosBlockType::SLiMEidosInteractionCallback:		cached_interaction_callbacks_.push_back(script_block);		break;
+				case SLiMEidosBlockType::SLiMEidosMateChoiceCallback:		cached_matechoice_callbacks_.push_back(script_block);		break;
+				case SLiMEidosBlockType::SLiMEidosModifyChildCallback:		cached_modifychild_callbacks_.push_back(script_block);		break;
+				case SLiMEidosBlockType::SLiMEidosRecombinationCallback:	cached_recombination_callbacks_.push_back(script_block);	break;
+				case SLiMEidosBlockType::SLiMEidosReproductionCallback:		cached_reproduction_callbacks_.push_back(script_block);		break;
+				case SLiMEidosBlockType::SLiMEidosUserDefinedFunction:		cached_userdef_functions_.push_back(script_block);			break;
+				case SLiMEidosBlockType::SLiMEidosNoBlockType:				break;	// never hit
+			}
+		}
+		
+		script_block_types_cached_ = true;
+		
+#if DEBUG_BLOCK_REG_DEREG
+		std::cout << "   ValidateScriptBlockCaches() recached, late() events cached are:" << std::endl;
+		for (SLiMEidosBlock *script_block : cached_late_events_)
+		{
+			std::cout << "      ";
+			script_block->Print(std::cout);
+			std::cout << std::endl;
+		}
+#endif
+	}
+}
+
+std::vector<SLiMEidosBlock*> SLiMSim::ScriptBlocksMatching(slim_generation_t p_generation, SLiMEidosBlockType p_event_type, slim_objectid_t p_mutation_type_id, slim_objectid_t p_interaction_type_id, slim_objectid_t p_subpopulation_id)
+{
+	if (!script_block_types_cached_)
+		ValidateScriptBlockCaches();
+	
+	std::vector<SLiMEidosBlock*> *block_list = nullptr;
+	
+	switch (p_event_type)
+	{
+		case SLiMEidosBlockType::SLiMEidosEventEarly:				block_list = &cached_early_events_;						break;
+		case SLiMEidosBlockType::SLiMEidosEventLate:				block_list = &cached_late_events_;						break;
+		case SLiMEidosBlockType::SLiMEidosInitializeCallback:		block_list = &cached_initialize_callbacks_;				break;
+		case SLiMEidosBlockType::SLiMEidosFitnessCallback:			block_list = &cached_fitness_callbacks_;				break;
+		case SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback:	block_list = &cached_fitnessglobal_callbacks_multigen_;	break;
+		case SLiMEidosBlockType::SLiMEidosInteractionCallback:		block_list = &cached_interaction_callbacks_;			break;
+		case SLiMEidosBlockType::SLiMEidosMateChoiceCallback:		block_list = &cached_matechoice_callbacks_;				break;
+		case SLiMEidosBlockType::SLiMEidosModifyChildCallback:		block_list = &cached_modifychild_callbacks_;			break;
+		case SLiMEidosBlockType::SLiMEidosRecombinationCallback:	block_list = &cached_recombination_callbacks_;			break;
+		case SLiMEidosBlockType::SLiMEidosReproductionCallback:		block_list = &cached_reproduction_callbacks_;			break;
+		case SLiMEidosBlockType::SLiMEidosUserDefinedFunction:		block_list = &cached_userdef_functions_;				break;
+		case SLiMEidosBlockType::SLiMEidosNoBlockType:				break;	// never hit
+	}
+	
+	std::vector<SLiMEidosBlock*> matches;
+	
+	for (SLiMEidosBlock *script_block : *block_list)
+	{
+		// check that the generation is in range
+		if ((script_block->start_generation_ > p_generation) || (script_block->end_generation_ < p_generation))
+			continue;
+		
+		// check that the script type matches (event, callback, etc.) - now guaranteed by the caching mechanism
+		//if (script_block->type_ != p_event_type)
+		//	continue;
+		
+		// check that the mutation type id matches, if requested
+		// this is now a bit tricky, with the NULL mut-type option, indicated by -2.  The rules now are:
+		//
+		//    if -2 is requested, -2 callbacks are all you get
+		//    if anything other than -2 is requested (including -1), -2 callbacks will not be returned
+		//
+		// so -2 callbacks are treated in a completely separate manner; they are never returned with other callbacks
+		slim_objectid_t mutation_type_id = script_block->mutation_type_id_;
+		
+		if ((p_mutation_type_id == -2) && (mutation_type_id != -2))
+			continue;
+		if ((p_mutation_type_id != -2) && (mutation_type_id == -2))
+			continue;
+		
+		if (p_mutation_type_id != -1)
+		{
+			if ((mutation_type_id != -1) && (p_mutation_type_id != mutation_type_id))
+				continue;
+		}
+		
+		// check that the interaction type id matches, if requested
+		if (p_interaction_type_id != -1)
+		{
+			slim_objectid_t interaction_type_id = script_block->interaction_type_id_;
+			
+			if ((interaction_type_id != -1) && (p_interaction_type_id != interaction_type_id))
+				continue;
+		}
+		
+		// check that the subpopulation id matches, if requested
+		if (p_subpopulation_id != -1)
+		{
+			slim_objectid_t subpopulation_id = script_block->subpopulation_id_;
+			
+			if ((subpopulation_id != -1) && (p_subpopulation_id != subpopulation_id))
+				continue;
+		}
+		
+		// OK, everything matches, so we want to return this script block
+		matches.emplace_back(script_block);
+	}
+	
+	// add in any single-generation global fitness callbacks
+	if (p_event_type == SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback)
+	{
+		auto find_range = cached_fitnessglobal_callbacks_onegen_.equal_range(p_generation);
+		auto find_start = find_range.first;
+		auto find_end = find_range.second;
+		
+		for (auto block_iter = find_start; block_iter != find_end; ++block_iter)
+		{
+			SLiMEidosBlock *script_block = block_iter->second;
+			
+			// check that the subpopulation id matches, if requested
+			if (p_subpopulation_id != -1)
+			{
+				slim_objectid_t subpopulation_id = script_block->subpopulation_id_;
+				
+				if ((subpopulation_id != -1) && (p_subpopulation_id != subpopulation_id))
+					continue;
+			}
+			
+			// OK, everything matches, so we want to return this script block
+			matches.emplace_back(script_block);
+		}
+	}
+	
+	return matches;
+}
+
+std::vector<SLiMEidosBlock*> &SLiMSim::AllScriptBlocks()
+{
+	return script_blocks_;
+}
+
+void SLiMSim::OptimizeScriptBlock(SLiMEidosBlock *p_script_block)
+{
+	// The goal here is to look for specific structures in callbacks that we are able to optimize by short-circuiting
+	// the callback interpretation entirely and replacing it with equivalent C++ code.  This is extremely messy, so
+	// we're not going to do this for very many cases, but sometimes it is worth it.
+	if (!p_script_block->has_cached_optimization_)
+	{
+		if (p_script_block->type_ == SLiMEidosBlockType::SLiMEidosFitnessGlobalCallback)
 		{
 			const EidosASTNode *base_node = p_script_block->compound_statement_node_;
 			
@@ -3981,7 +4871,11 @@ void SLiMSim::TabulateMemoryUsage(SLiM_MemoryUsage *p_usage, EidosSymbolTable *p
 		
 		p_usage->mutationRefcountBuffer = SLiM_MemoryUsageForMutationRefcounts();
 		
+		p_usage->mutationHotFieldBuffers = SLiM_MemoryUsageForMutationHotFields();
+		
 		p_usage->mutationUnusedPoolSpace = SLiM_MemoryUsageForMutationBlock() - p_usage->mutationObjects;
+		
+		p_usage->mutationBlockResident = SLiM_MemoryResidentForMutationBlock();
 	}
 	
 	// MutationRun
@@ -4039,6 +4933,9 @@ void SLiMSim::TabulateMemoryUsage(SLiM_MemoryUsage *p_usage, EidosSymbolTable *p
 		p_usage->slimsimObjects = (sizeof(SLiMSim) - sizeof(Chromosome)) * p_usage->slimsimObjects_count;	// Chromosome is handled separately above
 		
 		p_usage->slimsimTreeSeqTables = recording_tree_ ? MemoryUsageForTables(tables_) : 0;
+		p_usage->slimsimTreeSeqEdgeBuffer = edge_buffer_.capacity() * sizeof(BufferedEdgeRec) + edge_buffer_ends_.capacity() * sizeof(std::pair<edge_id_t, edge_id_t>) + edge_buffer_parents_.capacity() * sizeof(node_id_t) + edge_runs_.capacity() * sizeof(BufferedEdgeRunRec);
+		p_usage->slimsimTreeSeqSortScratch = last_sort_scratch_;
+		p_usage->slimsimTreeSeqFullSortScratch = last_full_sort_scratch_;
 	}
 	
 	// Subpopulation
@@ -4096,9 +4993,9 @@ void SLiMSim::TabulateMemoryUsage(SLiM_MemoryUsage *p_usage, EidosSymbolTable *p
 	/*
 	 Subpopulation:
 	 
-	gsl_ran_discrete_t *lookup_parent_ = nullptr;			// OWNED POINTER: lookup table for drawing a parent based upon fitness
-	gsl_ran_discrete_t *lookup_female_parent_ = nullptr;	// OWNED POINTER: lookup table for drawing a female parent based upon fitness, SEX ONLY
-	gsl_ran_discrete_t *lookup_male_parent_ = nullptr;		// OWNED POINTER: lookup table for drawing a male parent based upon fitness, SEX ONLY
+	Eidos_AliasTable lookup_parent_;						// lookup table for drawing a parent based upon fitness; reused across generations
+	Eidos_AliasTable lookup_female_parent_;					// lookup table for drawing a female parent based upon fitness, SEX ONLY
+	Eidos_AliasTable lookup_male_parent_;					// lookup table for drawing a male parent based upon fitness, SEX ONLY
 
 	 */
 	
@@ -4147,6 +5044,7 @@ void SLiMSim::TabulateMemoryUsage(SLiM_MemoryUsage *p_usage, EidosSymbolTable *p
 	
 	total_usage += p_usage->mutationObjects;
 	total_usage += p_usage->mutationRefcountBuffer;
+	total_usage += p_usage->mutationHotFieldBuffers;
 	total_usage += p_usage->mutationUnusedPoolSpace;
 	
 	total_usage += p_usage->mutationRunObjects;
@@ -4159,6 +5057,7 @@ void SLiMSim::TabulateMemoryUsage(SLiM_MemoryUsage *p_usage, EidosSymbolTable *p
 	
 	total_usage += p_usage->slimsimObjects;
 	total_usage += p_usage->slimsimTreeSeqTables;
+	total_usage += p_usage->slimsimTreeSeqEdgeBuffer;
 	
 	total_usage += p_usage->subpopulationObjects;
 	total_usage += p_usage->subpopulationFitnessCaches;
@@ -4211,7 +5110,9 @@ void SLiMSim::CollectSLiMguiMemoryUsageProfileInfo(void)
 	profile_total_memory_usage_.mutationObjects_count += profile_last_memory_usage_.mutationObjects_count;
 	profile_total_memory_usage_.mutationObjects += profile_last_memory_usage_.mutationObjects;
 	profile_total_memory_usage_.mutationRefcountBuffer += profile_last_memory_usage_.mutationRefcountBuffer;
+	profile_total_memory_usage_.mutationHotFieldBuffers += profile_last_memory_usage_.mutationHotFieldBuffers;
 	profile_total_memory_usage_.mutationUnusedPoolSpace += profile_last_memory_usage_.mutationUnusedPoolSpace;
+	profile_total_memory_usage_.mutationBlockResident += profile_last_memory_usage_.mutationBlockResident;
 	
 	profile_total_memory_usage_.mutationRunObjects_count += profile_last_memory_usage_.mutationRunObjects_count;
 	profile_total_memory_usage_.mutationRunObjects += profile_last_memory_usage_.mutationRunObjects;
@@ -4226,6 +5127,9 @@ void SLiMSim::CollectSLiMguiMemoryUsageProfileInfo(void)
 	profile_total_memory_usage_.slimsimObjects_count += profile_last_memory_usage_.slimsimObjects_count;
 	profile_total_memory_usage_.slimsimObjects += profile_last_memory_usage_.slimsimObjects;
 	profile_total_memory_usage_.slimsimTreeSeqTables += profile_last_memory_usage_.slimsimTreeSeqTables;
+	profile_total_memory_usage_.slimsimTreeSeqEdgeBuffer += profile_last_memory_usage_.slimsimTreeSeqEdgeBuffer;
+	profile_total_memory_usage_.slimsimTreeSeqSortScratch += profile_last_memory_usage_.slimsimTreeSeqSortScratch;
+	profile_total_memory_usage_.slimsimTreeSeqFullSortScratch += profile_last_memory_usage_.slimsimTreeSeqFullSortScratch;
 	
 	profile_total_memory_usage_.subpopulationObjects_count += profile_last_memory_usage_.subpopulationObjects_count;
 	profile_total_memory_usage_.subpopulationObjects += profile_last_memory_usage_.subpopulationObjects;
@@ -4261,30 +5165,42 @@ void SLiMSim::handle_error(std::string msg, int err)
 	EIDOS_TERMINATION << msg << ": " << msp_strerror(err) << EidosTerminate();
 }
 
-void SLiMSim::ReorderIndividualTable(table_collection_t *p_tables, std::vector<int> p_individual_map, bool p_keep_unmapped)
+void SLiMSim::ReorderIndividualTable(table_collection_t *p_tables, const std::vector<int> &p_individual_map, bool p_keep_unmapped)
 {
 	// Modifies the tables in place so that individual number individual_map[k] becomes the k-th individual in the new tables.
 	// Discard unmapped individuals unless p_keep_unmapped is true, in which case put them at the end.
 	size_t num_individuals = p_tables->individuals->num_rows;
 	std::vector<individual_id_t> inverse_map(num_individuals, MSP_NULL_INDIVIDUAL);
+	std::vector<individual_id_t> unmapped_individuals;
 	
 	for (individual_id_t j = 0; (size_t)j < p_individual_map.size(); j++)
 		inverse_map[p_individual_map[j]] = j;
 	
-	// If p_keep_unmapped is true, use the inverse table to add all unmapped individuals to the end of p_individual_map
+	// If p_keep_unmapped is true, use the inverse table to add all unmapped individuals after those in p_individual_map
 	if (p_keep_unmapped)
 	{
 		for (individual_id_t j = 0; (size_t)j < inverse_map.size(); j++)
 		{
 			if (inverse_map[j] == MSP_NULL_INDIVIDUAL)
 			{
-				inverse_map[j] = (individual_id_t)p_individual_map.size();
-				p_individual_map.push_back(j);
+				inverse_map[j] = (individual_id_t)(p_individual_map.size() + unmapped_individuals.size());
+				unmapped_individuals.push_back(j);
 			}
 		}
-        assert(p_individual_map.size() == p_tables->individuals->num_rows);
+        assert(p_individual_map.size() + unmapped_individuals.size() == p_tables->individuals->num_rows);
 	}
 	
+	// Rows that stay where they are need not be moved; commonly the remembered individuals are already at the start of the
+	// table, in order, so only the rows after them need to be rewritten
+	table_size_t unmoved_count = 0;
+	
+	while ((unmoved_count < p_individual_map.size()) && (p_individual_map[unmoved_count] == (individual_id_t)unmoved_count))
+		unmoved_count++;
+	
+	// If every row stays where it is, there is nothing to do; the unmapped rows are then necessarily the rows that follow
+	if ((unmoved_count == p_individual_map.size()) && (unmoved_count + unmapped_individuals.size() == num_individuals))
+		return;
+	
 	// Make a copy of p_tables->individuals, from which we will copy rows back to p_tables->individuals
 	individual_table_t individuals_copy;
 	int ret = individual_table_alloc(&individuals_copy, 0, 0, 0);
@@ -4292,10 +5208,11 @@ void SLiMSim::ReorderIndividualTable(table_collection_t *p_tables, std::vector<i
 	ret = individual_table_copy(p_tables->individuals, &individuals_copy);
 	if (ret < 0) handle_error("reorder_individuals", ret);
 	
-	// Clear p_tables->individuals and copy rows into it in the requested order
-	individual_table_clear(p_tables->individuals);
+	// Truncate p_tables->individuals to the unmoved rows and copy the remaining rows into it in the requested order
+	ret = individual_table_truncate(p_tables->individuals, unmoved_count);
+	if (ret < 0) handle_error("reorder_individuals", ret);
 	
-	for (individual_id_t k : p_individual_map)
+	auto copy_row = [&](individual_id_t k)
 	{
 		assert((size_t) k < individuals_copy.num_rows);
 		
@@ -4306,9 +5223,16 @@ void SLiMSim::ReorderIndividualTable(table_collection_t *p_tables, std::vector<i
 		size_t metadata_length = individuals_copy.metadata_offset[k+1] - individuals_copy.metadata_offset[k];
 		
 		individual_table_add_row(p_tables->individuals, flags, location, location_length, metadata, metadata_length);
-	}
+	};
+	
+	for (size_t j = unmoved_count; j < p_individual_map.size(); j++)
+		copy_row(p_individual_map[j]);
+	for (individual_id_t k : unmapped_individuals)
+		copy_row(k);
 	
-	assert(p_tables->individuals->num_rows == p_individual_map.size());
+	individual_table_free(&individuals_copy);
+	
+	assert(p_tables->individuals->num_rows == p_individual_map.size() + unmapped_individuals.size());
 	
 	// Fix the individual indices in the nodes table to point to the new rows
 	for (size_t j = 0; j < p_tables->nodes->num_rows; j++)
@@ -4320,6 +5244,169 @@ void SLiMSim::ReorderIndividualTable(table_collection_t *p_tables, std::vector<i
 	}
 }
 
+// the edge ordering required by simplify(): by parent time, then parent, then child, then left; this must match cmp_edge() in tables.c
+struct SLiM_SortEdge { double left, right; node_id_t parent, child; };
+
+static inline __attribute__((always_inline)) SLiM_SortEdge SLiM_EdgeAt(const edge_table_t *p_edges, table_size_t p_index)
+{
+	return SLiM_SortEdge{p_edges->left[p_index], p_edges->right[p_index], p_edges->parent[p_index], p_edges->child[p_index]};
+}
+
+static inline __attribute__((always_inline)) bool SLiM_EdgeLessThan(const double *p_node_time, const SLiM_SortEdge &p_a, const SLiM_SortEdge &p_b)
+{
+	if (p_a.parent != p_b.parent)
+	{
+		double time_a = p_node_time[p_a.parent], time_b = p_node_time[p_b.parent];
+		
+		if (time_a != time_b)
+			return (time_a < time_b);
+		return (p_a.parent < p_b.parent);
+	}
+	if (p_a.child != p_b.child)
+		return (p_a.child < p_b.child);
+	return (p_a.left < p_b.left);
+}
+
+static inline __attribute__((always_inline)) bool SLiM_EdgeLessThan(const double *p_node_time, const edge_table_t *p_edges, table_size_t p_a, table_size_t p_b)
+{
+	return SLiM_EdgeLessThan(p_node_time, SLiM_EdgeAt(p_edges, p_a), SLiM_EdgeAt(p_edges, p_b));
+}
+
+// sort edges [p_start, p_end), all of which have parents of the same time, into simplify() order
+static void SLiM_SortEdgesOfEqualTime(edge_table_t *p_edges, table_size_t p_start, table_size_t p_end)
+{
+	std::vector<SLiM_SortEdge> run;
+	
+	run.reserve(p_end - p_start);
+	
+	for (table_size_t edge_index = p_start; edge_index < p_end; ++edge_index)
+		run.emplace_back(SLiM_EdgeAt(p_edges, edge_index));
+	
+	std::sort(run.begin(), run.end(), [](const SLiM_SortEdge &a, const SLiM_SortEdge &b) {
+		if (a.parent != b.parent) return (a.parent < b.parent);
+		if (a.child != b.child) return (a.child < b.child);
+		return (a.left < b.left);
+	});
+	
+	for (table_size_t edge_index = p_start; edge_index < p_end; ++edge_index)
+	{
+		const SLiM_SortEdge &edge = run[edge_index - p_start];
+		
+		p_edges->left[edge_index] = edge.left;
+		p_edges->right[edge_index] = edge.right;
+		p_edges->parent[edge_index] = edge.parent;
+		p_edges->child[edge_index] = edge.child;
+	}
+}
+
+void SLiMSim::SortTreeSequenceTables(table_collection_t *p_tables, table_size_t p_sorted_edge_count)
+{
+	// Sort the table collection in preparation for simplify().  The first p_sorted_edge_count edges are normally the output of the
+	// last simplification, and the edges after them were appended by FlushEdgeBuffer(), already sorted; in that case nothing needs
+	// sorting, and we just merge the two sorted runs in linear time.  If the edges after the prefix are not sorted (if they were
+	// flushed in more than one batch, for example), only they are sorted before the merge.  Since the edge ordering is total, the
+	// result is identical to a full sort either way, but we avoid re-sorting the retained ancestry, which dominates the edge table in
+	// long runs with frequent simplification.  The new edges cannot just be moved to the front, because in nonWF models an old
+	// individual can still reproduce, so some new edges can have parents older than edges in the prefix.
+	edge_table_t *edges = p_tables->edges;
+	const double *node_time = p_tables->nodes->time;
+	table_size_t edge_count = edges->num_rows;
+	size_t scratch = 0;
+	
+	// for outputUsage(), note the temporary space that table_collection_sort() would take to sort all the edges (its edge_sort_t has a time)
+	last_full_sort_scratch_ = edge_count * (sizeof(SLiM_SortEdge) + sizeof(double));
+	
+	if (p_sorted_edge_count > edge_count)
+		p_sorted_edge_count = 0;
+	
+	// simplify() emits edges in order of parent time, but the samples are renumbered to the front of the node table, so among parents
+	// of the same time the parent ids may be out of order (in nonWF models, where samples of different ages are parents); we fix such
+	// runs of equal time individually, which is cheap since they are short.  If the prefix is not even in time order, the tables have
+	// been replaced since we last looked at them, and we fall back to a full sort.
+	table_size_t run_start = 0;
+	bool run_sorted = true;
+	
+	for (table_size_t edge_index = 1; edge_index <= p_sorted_edge_count; ++edge_index)
+	{
+		if (edge_index < p_sorted_edge_count)
+		{
+			double previous_time = node_time[edges->parent[edge_index - 1]];
+			double time = node_time[edges->parent[edge_index]];
+			
+			if (time < previous_time)
+			{
+				p_sorted_edge_count = 0;
+				break;
+			}
+			
+			if (time == previous_time)
+			{
+				if (run_sorted && SLiM_EdgeLessThan(node_time, edges, edge_index, edge_index - 1))
+					run_sorted = false;
+				continue;
+			}
+		}
+		
+		if (!run_sorted)
+		{
+			SLiM_SortEdgesOfEqualTime(edges, run_start, edge_index);
+			scratch = std::max(scratch, (edge_index - run_start) * sizeof(SLiM_SortEdge));
+		}
+		
+		run_start = edge_index;
+		run_sorted = true;
+	}
+	
+	// check whether the edges after the prefix are already sorted; if not, table_collection_sort() sorts them
+	table_size_t edge_start = edge_count;
+	
+	for (table_size_t edge_index = p_sorted_edge_count + 1; edge_index < edge_count; ++edge_index)
+		if (SLiM_EdgeLessThan(node_time, edges, edge_index, edge_index - 1))
+		{
+			edge_start = p_sorted_edge_count;
+			scratch = std::max(scratch, (edge_count - edge_start) * (sizeof(SLiM_SortEdge) + sizeof(double)));
+			break;
+		}
+	
+	int ret = table_collection_sort(p_tables, edge_start, /* flags */ 0);
+	if (ret < 0) handle_error("table_collection_sort", ret);
+	
+	// if there is both a sorted prefix and a sorted suffix, and they overlap in order, merge them; we copy out the suffix, which is
+	// usually much the smaller, and merge backward from the end of the table, so the merge never overwrites prefix edges not yet read
+	if ((p_sorted_edge_count > 0) && (p_sorted_edge_count < edge_count) && SLiM_EdgeLessThan(node_time, edges, p_sorted_edge_count, p_sorted_edge_count - 1))
+	{
+		std::vector<SLiM_SortEdge> suffix;
+		
+		suffix.reserve(edge_count - p_sorted_edge_count);
+		
+		for (table_size_t edge_index = p_sorted_edge_count; edge_index < edge_count; ++edge_index)
+			suffix.emplace_back(SLiM_EdgeAt(edges, edge_index));
+		
+		scratch = std::max(scratch, suffix.size() * sizeof(SLiM_SortEdge));
+		
+		table_size_t prefix_remaining = p_sorted_edge_count, suffix_remaining = (table_size_t)suffix.size(), merged_index = edge_count;
+		
+		while (suffix_remaining > 0)
+		{
+			// on a tie the prefix edge goes first; ties do not occur in practice, since SLiM never records duplicate edges
+			SLiM_SortEdge edge;
+			
+			if ((prefix_remaining > 0) && SLiM_EdgeLessThan(node_time, suffix[suffix_remaining - 1], SLiM_EdgeAt(edges, prefix_remaining - 1)))
+				edge = SLiM_EdgeAt(edges, --prefix_remaining);
+			else
+				edge = suffix[--suffix_remaining];
+			
+			--merged_index;
+			edges->left[merged_index] = edge.left;
+			edges->right[merged_index] = edge.right;
+			edges->parent[merged_index] = edge.parent;
+			edges->child[merged_index] = edge.child;
+		}
+	}
+	
+	last_sort_scratch_ = scratch;
+}
+
 void SLiMSim::SimplifyTreeSequence(void)
 {
 #if DEBUG
@@ -4330,6 +5417,9 @@ void SLiMSim::SimplifyTreeSequence(void)
 	if (tables_.nodes->num_rows == 0)
 		return;
 	
+	// time the simplification, for CheckCostModelSimplification()
+	clock_t start_clock = clock();
+	
 	std::vector<node_id_t> samples;
 	
 	// the remembered_genomes_ come first in the list of samples
@@ -4339,6 +5429,14 @@ void SLiMSim::SimplifyTreeSequence(void)
 	// and then come all the genomes of the extant individuals
 	node_id_t newValueInNodeTable = (node_id_t)remembered_genomes_.size();
 	
+	// the remembered genomes compacted by the last simplification are nodes 0, 1, 2, ..., and any extant genome with one of
+	// those node ids is one of them; only the genomes remembered since then need to be looked up
+	node_id_t compacted_count = (node_id_t)remembered_genomes_compacted_;
+	std::unordered_map<node_id_t, node_id_t> recently_remembered;
+	
+	for (size_t remembered_index = remembered_genomes_compacted_; remembered_index < remembered_genomes_.size(); ++remembered_index)
+		recently_remembered.emplace(remembered_genomes_[remembered_index], (node_id_t)remembered_index);
+	
 	for (auto it = population_.begin(); it != population_.end(); it++)
 	{
 		std::vector<Genome *> &subpopulationGenomes = it->second->parent_genomes_;
@@ -4349,16 +5447,22 @@ void SLiMSim::SimplifyTreeSequence(void)
 			
 			// check if this sample is already being remembered, and assign the correct msp_node_id_
 			// if not remembered, it is currently alive, so we need to mark it as a sample so it persists through simplify()
-			auto iter = std::find(remembered_genomes_.begin(), remembered_genomes_.end(), M);
+			if (M < compacted_count)
+			{
+				genome->msp_node_id_ = M;
+				continue;
+			}
 			
-			if (iter == remembered_genomes_.end())
+			auto iter = recently_remembered.find(M);
+			
+			if (iter == recently_remembered.end())
 			{
 				samples.push_back(M);
 				genome->msp_node_id_ = newValueInNodeTable++;
 			}
 			else
 			{
-				genome->msp_node_id_ = (node_id_t)(iter - remembered_genomes_.begin());
+				genome->msp_node_id_ = iter->second;
 			}
 		}
 	}
@@ -4366,27 +5470,35 @@ void SLiMSim::SimplifyTreeSequence(void)
 	// the tables need to have a population table to be able to sort it
 	WritePopulationTable(&tables_);
 	
-	// sort the table collection
-	int ret = table_collection_sort(&tables_, /* edge_start */ 0, /* flags */ 0);
-	if (ret < 0) handle_error("table_collection_sort", ret);
+	// sort the table collection; the edges recorded since the last simplification are flushed in order, and just need merging
+	FlushEdgeBuffer();
+	SortTreeSequenceTables(&tables_, sorted_edge_count_);
 
     // remove redundant sites we added
-    ret = table_collection_deduplicate_sites(&tables_, 0);
+    int ret = table_collection_deduplicate_sites(&tables_, 0);
     if (ret < 0) handle_error("deduplicate_sites", ret);
 	
 	// simplify
 	ret = table_collection_simplify(&tables_, samples.data(), samples.size(), MSP_FILTER_SITES | MSP_FILTER_INDIVIDUALS, NULL);
     if (ret != 0) handle_error("simplifier_run", ret);
 	
+	// the simplified edges are sorted, and form the sorted prefix for the next simplification
+	sorted_edge_count_ = tables_.edges->num_rows;
+	
     // update map of remembered_genomes_, which are now the first n entries in the node table
 	for (node_id_t i = 0; i < (node_id_t)remembered_genomes_.size(); i++)
         remembered_genomes_[i] = i;
 	
+	remembered_genomes_compacted_ = remembered_genomes_.size();
+	
     // reset current position, used to rewind individuals that are rejected by modifyChild()
 	RecordTablePosition();
 	
 	// and reset our elapsed time since last simplification, for auto-simplification
 	simplify_elapsed_ = 0;
+	simplify_last_post_bytes_ = TreeSeqTableBytesInUse();
+	simplify_last_end_clock_ = clock();
+	simplify_last_duration_ = (simplify_last_end_clock_ - start_clock) / (double)CLOCKS_PER_SEC;
 	
 	// as a side effect of simplification, update a "model has coalesced" flag that the user can consult, if requested
 	if (running_coalescence_checks_)
@@ -4506,6 +5618,7 @@ void SLiMSim::RecordTablePosition(void)
 {
 	// keep the current table position for rewinding if a proposed child is rejected
 	table_collection_record_position(&tables_, &table_position_);
+	edge_buffer_position_ = edge_buffer_.size();
 }
 
 void SLiMSim::AllocateTreeSequenceTables(void)
@@ -4524,6 +5637,8 @@ void SLiMSim::AllocateTreeSequenceTables(void)
 	tables_.sequence_length = (double)chromosome_.last_position_ + 1;
 	
 	RecordTablePosition();
+	
+	simplify_last_end_clock_ = clock();
 }
 
 void SLiMSim::SetCurrentNewIndividual(__attribute__((unused))Individual *p_individual)
@@ -4559,6 +5674,227 @@ void SLiMSim::RetractNewIndividual()
 	//current_new_individual_ = nullptr;
 	
     table_collection_reset_position(&tables_, &table_position_);
+	
+	// The rejected child's edges are still in the edge buffer; they are at its end, but they are linked into the lists of their
+	// parents, so we just mark them as dead, and FlushEdgeBuffer() skips them.
+	for (size_t edge_index = edge_buffer_position_; edge_index < edge_buffer_.size(); ++edge_index)
+	{
+		BufferedEdgeRec &edge = edge_buffer_[edge_index];
+		
+		if (edge.child_ != MSP_NULL_NODE)
+		{
+			edge.child_ = MSP_NULL_NODE;
+			edge_buffer_live_count_--;
+		}
+	}
+	
+	// The rejected child's full-span edges are at the end of the last runs, since the runs are in order of child; its genomes were
+	// the last nodes added, just removed by the reset above, so we trim the runs back to the first of those nodes.
+	node_id_t first_retracted_node = (node_id_t)tables_.nodes->num_rows;
+	
+	while (edge_runs_.size())
+	{
+		BufferedEdgeRunRec &run = edge_runs_.back();
+		
+		if (run.child_ + run.length_ <= first_retracted_node)
+			break;
+		
+		int32_t kept_length = std::max(first_retracted_node - run.child_, 0);
+		
+		edge_buffer_live_count_ -= (run.length_ - kept_length);
+		edge_run_edge_count_ -= (run.length_ - kept_length);
+		
+		if (kept_length == 0)
+		{
+			edge_runs_.pop_back();
+		}
+		else
+		{
+			run.length_ = kept_length;
+			run.width_ = std::min(run.width_, kept_length);
+			break;
+		}
+	}
+}
+
+void SLiMSim::BufferNewEdge(node_id_t p_parent, double p_left, double p_right, node_id_t p_child)
+{
+	// Edges are buffered in a list for each parent rather than appended to the edge table, so that they can be flushed in sorted order
+	// without a sort; see FlushEdgeBuffer().  The edge table uses 32-bit ids, so we flush early if the buffer would outgrow them; the
+	// edges flushed in separate batches are then sorted by SortTreeSequenceTables(), as usual.
+	if (edge_buffer_.size() >= (size_t)INT32_MAX)
+		FlushEdgeBuffer();
+	
+	edge_id_t edge_index = (edge_id_t)edge_buffer_.size();
+	
+	if ((size_t)p_parent >= edge_buffer_ends_.size())
+		edge_buffer_ends_.resize(tables_.nodes->num_rows, std::pair<edge_id_t, edge_id_t>(-1, -1));
+	
+	std::pair<edge_id_t, edge_id_t> &ends = edge_buffer_ends_[p_parent];
+	
+	if (ends.first == -1)
+	{
+		ends.first = edge_index;
+		edge_buffer_parents_.push_back(p_parent);
+	}
+	else
+	{
+		edge_buffer_[ends.second].next_ = edge_index;
+	}
+	
+	ends.second = edge_index;
+	edge_buffer_.emplace_back(BufferedEdgeRec{p_left, p_right, p_child, -1});
+	edge_buffer_live_count_++;
+}
+
+void SLiMSim::BufferNewFullSpanEdge(node_id_t p_parent, node_id_t p_child)
+{
+	// A full-span edge extends the last run if its child follows the last child of the run, and its parent is the next in the run's
+	// cycle of parents; while the run has not yet started over at its first parent, the parent after its last parent widens the cycle.
+	// For clonal children the two genomes of the parent are consecutive nodes, as are the two genomes of the child, so each clonal
+	// individual extends a run by two edges whenever it is the next clone of the same parent.  Otherwise a new run is started.
+	if (edge_runs_.size())
+	{
+		BufferedEdgeRunRec &run = edge_runs_.back();
+		
+		if ((p_child == run.child_ + run.length_) && (run.length_ < INT32_MAX))
+		{
+			if (p_parent == run.parent_ + (run.length_ % run.width_))
+			{
+				run.length_++;
+				edge_buffer_live_count_++;
+				edge_run_edge_count_++;
+				return;
+			}
+			if ((run.length_ == run.width_) && (p_parent == run.parent_ + run.width_))
+			{
+				run.width_++;
+				run.length_++;
+				edge_buffer_live_count_++;
+				edge_run_edge_count_++;
+				return;
+			}
+		}
+	}
+	
+	edge_runs_.emplace_back(BufferedEdgeRunRec{p_parent, p_child, 1, 1});
+	edge_buffer_live_count_++;
+	edge_run_edge_count_++;
+}
+
+void SLiMSim::FlushEdgeBuffer(void)
+{
+	// Append the buffered edges to the edge table, grouped by parent, with parents in order of time and then node id.  Within each
+	// parent the edges are already in order of child and then left, since new nodes get increasing ids and RecordNewGenome() records
+	// the edges of each new node from left to right.  That is the order simplify() requires, so the flushed edges need no sorting;
+	// SortTreeSequenceTables() just merges them with the edges retained by the last simplification.  This must be called before
+	// anything looks at tables_.edges.
+	if ((edge_buffer_.size() == 0) && (edge_runs_.size() == 0))
+		return;
+	
+	const double *node_time = tables_.nodes->time;
+	
+	// The full-span edges in runs are bucketed by parent with a counting sort; run_child_end[parent] ends up as the end of the
+	// parent's bucket in run_children, and the start of the next parent's bucket.  Within each bucket the children are in order,
+	// since the runs are in order of child.  Parents with full-span edges but no other buffered edges are added to the parent list.
+	std::vector<table_size_t> run_child_end;
+	std::vector<node_id_t> run_children;
+	
+	if (edge_runs_.size())
+	{
+		run_child_end.resize(tables_.nodes->num_rows + 1, 0);
+		
+		for (const BufferedEdgeRunRec &run : edge_runs_)
+		{
+			for (int32_t parent_offset = 0; parent_offset < run.width_; ++parent_offset)
+			{
+				node_id_t parent = run.parent_ + parent_offset;
+				
+				if ((run_child_end[parent + 1] == 0) && (((size_t)parent >= edge_buffer_ends_.size()) || (edge_buffer_ends_[parent].first == -1)))
+					edge_buffer_parents_.push_back(parent);
+				
+				run_child_end[parent + 1] += (table_size_t)((run.length_ - parent_offset + run.width_ - 1) / run.width_);
+			}
+		}
+		
+		for (size_t parent = 1; parent < run_child_end.size(); ++parent)
+			run_child_end[parent] += run_child_end[parent - 1];
+		
+		run_children.resize(edge_run_edge_count_);
+		
+		for (const BufferedEdgeRunRec &run : edge_runs_)
+		{
+			int32_t parent_offset = 0;
+			
+			for (int32_t edge_offset = 0; edge_offset < run.length_; ++edge_offset)
+			{
+				run_children[run_child_end[run.parent_ + parent_offset]++] = run.child_ + edge_offset;
+				
+				if (++parent_offset == run.width_)
+					parent_offset = 0;
+			}
+		}
+	}
+	
+	std::sort(edge_buffer_parents_.begin(), edge_buffer_parents_.end(), [node_time](node_id_t a, node_id_t b) {
+		return (node_time[a] < node_time[b]) || ((node_time[a] == node_time[b]) && (a < b));
+	});
+	
+	double full_span_right = (double)chromosome_.last_position_ + 1;
+	
+	for (node_id_t parent : edge_buffer_parents_)
+	{
+		edge_id_t edge_index = ((size_t)parent < edge_buffer_ends_.size()) ? edge_buffer_ends_[parent].first : -1;
+		table_size_t run_child_index = 0, run_child_index_end = 0;
+		
+		if (run_children.size())
+		{
+			run_child_index = ((parent == 0) ? 0 : run_child_end[parent - 1]);
+			run_child_index_end = run_child_end[parent];
+		}
+		
+		// merge the parent's full-span edges with its other edges, by child; a child's edges are either all full-span or all not
+		while ((edge_index != -1) || (run_child_index < run_child_index_end))
+		{
+			int ret;
+			
+			if ((edge_index == -1) || ((run_child_index < run_child_index_end) && (run_children[run_child_index] < edge_buffer_[edge_index].child_)))
+			{
+				ret = edge_table_add_row(tables_.edges, 0.0, full_span_right, parent, run_children[run_child_index++]);
+			}
+			else
+			{
+				const BufferedEdgeRec &edge = edge_buffer_[edge_index];
+				
+				edge_index = edge.next_;
+				
+				if (edge.child_ == MSP_NULL_NODE)
+					continue;
+				
+				ret = edge_table_add_row(tables_.edges, edge.left_, edge.right_, parent, edge.child_);
+			}
+			
+			if (ret < 0) handle_error("add_edge", ret);
+		}
+		
+		if ((size_t)parent < edge_buffer_ends_.size())
+		{
+			std::pair<edge_id_t, edge_id_t> &ends = edge_buffer_ends_[parent];
+			
+			ends.first = -1;
+			ends.second = -1;
+		}
+	}
+	
+	edge_buffer_.clear();
+	edge_buffer_parents_.clear();
+	edge_buffer_position_ = 0;
+	edge_buffer_live_count_ = 0;
+	edge_runs_.clear();
+	edge_run_edge_count_ = 0;
+	
+	// the flushed edges all belong to individuals that can no longer be retracted, so the rewind position moves past them
+	table_position_.edges = tables_.edges->num_rows;
 }
 
 void SLiMSim::RecordNewGenome(std::vector<slim_position_t> *p_breakpoints, Genome *p_new_genome, 
@@ -4604,27 +5940,109 @@ void SLiMSim::RecordNewGenome(std::vector<slim_position_t> *p_breakpoints, Genom
 	if (breakpoint_count && (p_breakpoints->back() > chromosome_.last_position_))
 		breakpoint_count--;
 	
-	// add an edge for each interval between breakpoints
-	double left = 0.0;
-	double right;
-	bool polarity = true;
+	// a genome inherited without recombination, as by a clonal child, gets a single full-span edge, which is buffered in a run
+	if (breakpoint_count == 0)
+	{
+		BufferNewFullSpanEdge(genome1MSPID, offspringMSPID);
+		return;
+	}
+	
+	// add an edge for each interval between breakpoints
+	double left = 0.0;
+	double right;
+	bool polarity = true;
+	
+	for (size_t i = 0; i < breakpoint_count; i++)
+	{
+		right = (*p_breakpoints)[i];
+
+		node_id_t parent = (node_id_t) (polarity ? genome1MSPID : genome2MSPID);
+		BufferNewEdge(parent, left, right, offspringMSPID);
+		
+		polarity = !polarity;
+		left = right;
+	}
+	
+	right = (double)chromosome_.last_position_+1;
+	node_id_t parent = (node_id_t) (polarity ? genome1MSPID : genome2MSPID);
+	BufferNewEdge(parent, left, right, offspringMSPID);
+}
+
+// Derived states are kept in memory in a compact binary encoding: each mutation id in the state is stored as the zigzag-encoded
+// difference from the previous id (the first from zero), written as a little-endian base-128 varint.  Stacked ids are usually
+// close together, and even a lone id rarely needs more than three or four bytes, versus eight for a raw slim_mutationid_t.  The
+// encoding is deterministic, so two derived states are equal exactly when their bytes are equal, which vargen relies upon, and
+// an empty derived state is still zero-length.  Mutation ids are decoded only for text/.trees output, loading, and crosschecks.
+static const size_t SLIM_DERIVED_STATE_MAX_BYTES_PER_ID = 10;
+
+static size_t SLiM_EncodeDerivedState(const slim_mutationid_t *p_mutation_ids, size_t p_count, char *p_buffer)
+{
+	uint8_t *out = (uint8_t *)p_buffer;
+	uint64_t previous = 0;
+	
+	for (size_t id_index = 0; id_index < p_count; ++id_index)
+	{
+		uint64_t current = (uint64_t)p_mutation_ids[id_index];
+		int64_t delta = (int64_t)(current - previous);
+		uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+		
+		while (zigzag >= 0x80)
+		{
+			*(out++) = (uint8_t)(zigzag | 0x80);
+			zigzag >>= 7;
+		}
+		*(out++) = (uint8_t)zigzag;
+		
+		previous = current;
+	}
+	
+	return (size_t)(out - (uint8_t *)p_buffer);
+}
+
+static void SLiM_DecodeDerivedState(const char *p_bytes, table_size_t p_length, std::vector<slim_mutationid_t> &p_mutation_ids)
+{
+	const uint8_t *in = (const uint8_t *)p_bytes;
+	const uint8_t *in_end = in + p_length;
+	uint64_t previous = 0;
+	
+	p_mutation_ids.clear();
+	
+	while (in < in_end)
+	{
+		uint64_t zigzag = 0;
+		int shift = 0;
+		uint8_t byte;
+		
+		do
+		{
+			if ((in == in_end) || (shift > 63))
+				EIDOS_TERMINATION << "ERROR (SLiM_DecodeDerivedState): (internal error) malformed derived state." << EidosTerminate();
+			
+			byte = *(in++);
+			zigzag |= (uint64_t)(byte & 0x7F) << shift;
+			shift += 7;
+		}
+		while (byte & 0x80);
+		
+		uint64_t delta = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+		
+		previous += delta;
+		p_mutation_ids.push_back((slim_mutationid_t)previous);
+	}
+}
+
+static void SLiM_AppendDerivedStateAscii(const char *p_bytes, table_size_t p_length, std::string &p_ascii)
+{
+	// appends the comma-separated ASCII form of an encoded derived state, which is what is written to disk
+	static std::vector<slim_mutationid_t> mutation_ids;
+	
+	SLiM_DecodeDerivedState(p_bytes, p_length, mutation_ids);
 	
-	for (size_t i = 0; i < breakpoint_count; i++)
+	for (size_t i = 0; i < mutation_ids.size(); i++)
 	{
-		right = (*p_breakpoints)[i];
-
-		node_id_t parent = (node_id_t) (polarity ? genome1MSPID : genome2MSPID);
-		int ret = edge_table_add_row(tables_.edges,left,right,parent,offspringMSPID);
-		if (ret < 0) handle_error("add_edge", ret);
-		
-		polarity = !polarity;
-		left = right;
+		if (i != 0) p_ascii.append(",");
+		p_ascii.append(std::to_string(mutation_ids[i]));
 	}
-	
-	right = (double)chromosome_.last_position_+1;
-	node_id_t parent = (node_id_t) (polarity ? genome1MSPID : genome2MSPID);
-	int ret = edge_table_add_row(tables_.edges,left,right,parent,offspringMSPID);
-	if (ret < 0) handle_error("add_edge", ret);
 }
 
 void SLiMSim::RecordNewDerivedState(const Genome *p_genome, slim_position_t p_position, const std::vector<Mutation *> &p_derived_mutations)
@@ -4690,9 +6108,14 @@ void SLiMSim::RecordNewDerivedState(const Genome *p_genome, slim_position_t p_po
 		mutation_metadata.push_back(metadata_rec);
 	}
 	
-	// add the mutation table row with the final derived state and metadata
-    char *derived_muts_bytes = (char *)(derived_mutation_ids.data());
-    size_t derived_state_length = derived_mutation_ids.size() * sizeof(slim_mutationid_t);
+	// add the mutation table row with the final derived state, in our compact encoding, and metadata
+	static std::vector<char> derived_muts_buffer;
+	
+	if (derived_muts_buffer.size() < derived_mutation_ids.size() * SLIM_DERIVED_STATE_MAX_BYTES_PER_ID)
+		derived_muts_buffer.resize(derived_mutation_ids.size() * SLIM_DERIVED_STATE_MAX_BYTES_PER_ID);
+	
+    char *derived_muts_bytes = derived_muts_buffer.data();
+    size_t derived_state_length = SLiM_EncodeDerivedState(derived_mutation_ids.data(), derived_mutation_ids.size(), derived_muts_bytes);
     char *mutation_metadata_bytes = (char *)(mutation_metadata.data());
     size_t mutation_metadata_length = mutation_metadata.size() * sizeof(MutationMetadataRec);
 
@@ -4714,9 +6137,15 @@ void SLiMSim::CheckAutoSimplification(void)
 	// time we simplify, we ask whether we simplified too early, too late, or just the right time by comparing
 	// the pre:post ratio of the tree recording table sizes to the desired pre:post ratio, simplification_ratio_,
 	// as set up in initializeTreeSeq().  Note that a simplification_ratio_ value of INF means "never simplify
-	// automatically"; we check for that up front.
+	// automatically"; we check for that up front.  If a memory limit was set, CheckCostModelSimplification() decides instead.
 	++simplify_elapsed_;
 	
+	if (simplification_memory_limit_ > 0.0)
+	{
+		CheckCostModelSimplification();
+		return;
+	}
+	
 	if (!std::isinf(simplification_ratio_))
 	{
 		if (simplify_elapsed_ >= simplify_interval_)
@@ -4726,6 +6155,7 @@ void SLiMSim::CheckAutoSimplification(void)
 			// reasonable proxy, and this whole thing is just a heuristic that needs to be tailored anyway.
 			uint64_t old_table_size = (uint64_t)tables_.nodes->num_rows;
             old_table_size += (uint64_t)tables_.edges->num_rows;
+            old_table_size += (uint64_t)edge_buffer_live_count_;
             old_table_size += (uint64_t)tables_.sites->num_rows;
             old_table_size += (uint64_t)tables_.mutations->num_rows;
 			
@@ -4770,6 +6200,86 @@ void SLiMSim::CheckAutoSimplification(void)
 	}
 }
 
+void SLiMSim::CheckCostModelSimplification(void)
+{
+	// This is the auto-simplification scheduler used when initializeTreeSeq() is given a simplificationMemoryLimit.  A simplification
+	// takes time roughly proportional to the size of the tables, which is the ancestry R retained by the last simplification plus
+	// g bytes of growth per generation since then.  Simplifying every k generations therefore costs about c*R/k + c*g per generation,
+	// for some cost c per byte; the second term does not depend on k, so waiting longer always helps, but only until the tables hit
+	// the memory limit.  Simplifying makes a copy of the tables, so the peak is about twice their size, and it is the peak that we
+	// keep under the limit.  Waiting also stops paying once c*R/k is a small part of the time a generation takes anyway, so we stop
+	// there, to save memory; we measure c, R, g, and the generation time at every simplification and plan the next one from them.
+	// Since processor time is measured, the timing of simplifications can differ between runs; that does not affect the model.
+	size_t current_bytes = TreeSeqTableBytesInUse();
+	bool at_memory_limit = (2.0 * current_bytes >= simplification_memory_limit_);
+	
+	if (!at_memory_limit && (simplify_elapsed_ < simplify_interval_))
+		return;
+	
+	slim_generation_t elapsed = simplify_elapsed_;
+	double generation_seconds = ((clock() - simplify_last_end_clock_) / (double)CLOCKS_PER_SEC) / elapsed;
+	double growth = (current_bytes > simplify_last_post_bytes_) ? (current_bytes - simplify_last_post_bytes_) / (double)elapsed : 0.0;
+	
+	SimplifyTreeSequence();
+	
+	size_t retained_bytes = simplify_last_post_bytes_;
+	double cost_per_byte = (current_bytes > 0) ? (simplify_last_duration_ / current_bytes) : 0.0;
+	double memory_interval = (growth > 0.0) ? ((simplification_memory_limit_ / 2.0 - retained_bytes) / growth) : std::numeric_limits<double>::infinity();
+	double time_interval = (generation_seconds > 0.0) ? ((cost_per_byte * retained_bytes) / (0.05 * generation_seconds)) : std::numeric_limits<double>::infinity();
+	const char *limited_by;
+	
+	if (memory_interval <= time_interval)
+	{
+		simplify_interval_ = memory_interval;
+		limited_by = "memory";
+	}
+	else
+	{
+		simplify_interval_ = time_interval;
+		limited_by = "time";
+	}
+	
+	// as in CheckAutoSimplification(), keep the interval between 1 and 1000 generations
+	if (simplify_interval_ > 1000.0)
+	{
+		simplify_interval_ = 1000.0;
+		limited_by = "maximum interval";
+	}
+	if (simplify_interval_ < 1.0)
+		simplify_interval_ = 1.0;
+	
+	if (SLiM_verbose_output)
+	{
+		SLIM_OUTSTREAM << "// ++ Simplified in generation " << generation_ << " after " << elapsed << " generation(s)" << (at_memory_limit ? " (memory limit reached)" : "") << ": " << current_bytes << " bytes before, " << retained_bytes << " bytes after, " << simplify_last_duration_ << " s" << std::endl;
+		SLIM_OUTSTREAM << "// ++    growth " << growth << " bytes/generation, generation time " << generation_seconds << " s; next simplification in " << (slim_generation_t)ceil(simplify_interval_) << " generation(s), limited by " << limited_by << std::endl;
+	}
+}
+
+size_t SLiMSim::TreeSeqTableBytesInUse(void)
+{
+	// The bytes used by the rows of the tables, including the buffered edges; unlike MemoryUsageForTables(), this does not count
+	// capacity that has been allocated but not used, which would make the cost model's estimate of growth jumpy
+	size_t usage = 0;
+	
+	usage += tables_.nodes->num_rows * (sizeof(uint32_t) + sizeof(double) + sizeof(population_id_t) + sizeof(individual_id_t) + sizeof(table_size_t));
+	usage += tables_.nodes->metadata_length;
+	
+	usage += tables_.edges->num_rows * (2 * sizeof(double) + 2 * sizeof(node_id_t));
+	usage += (edge_buffer_live_count_ - edge_run_edge_count_) * sizeof(BufferedEdgeRec);
+	usage += edge_runs_.size() * sizeof(BufferedEdgeRunRec);
+	
+	usage += tables_.sites->num_rows * (sizeof(double) + 2 * sizeof(table_size_t));
+	usage += tables_.sites->ancestral_state_length + tables_.sites->metadata_length;
+	
+	usage += tables_.mutations->num_rows * (sizeof(node_id_t) + sizeof(site_id_t) + sizeof(mutation_id_t) + 2 * sizeof(table_size_t));
+	usage += tables_.mutations->derived_state_length + tables_.mutations->metadata_length;
+	
+	usage += tables_.individuals->num_rows * (sizeof(uint32_t) + 2 * sizeof(table_size_t));
+	usage += tables_.individuals->location_length * sizeof(double) + tables_.individuals->metadata_length;
+	
+	return usage;
+}
+
 void SLiMSim::TreeSequenceDataFromAscii(std::string NodeFileName,
 										std::string EdgeFileName,
 										std::string SiteFileName,
@@ -4820,9 +6330,9 @@ void SLiMSim::TreeSequenceDataFromAscii(std::string NodeFileName,
 		// Mutation derived state
 		const char *derived_state = tables_.mutations->derived_state;
 		table_size_t *derived_state_offset = tables_.mutations->derived_state_offset;
-		std::vector<slim_mutationid_t> binary_derived_state;
+		std::vector<char> binary_derived_state;
 		std::vector<table_size_t> binary_derived_state_offset;
-		size_t derived_state_total_part_count = 0;
+		std::vector<slim_mutationid_t> derived_state_ids;
 		
 		// Mutation metadata
 		const char *mutation_metadata = tables_.mutations->metadata;
@@ -4839,12 +6349,16 @@ void SLiMSim::TreeSequenceDataFromAscii(std::string NodeFileName,
 			// Mutation derived state
 			std::string string_derived_state(derived_state + derived_state_offset[j], derived_state_offset[j+1] - derived_state_offset[j]);
 			std::vector<std::string> derived_state_parts = Eidos_string_split(string_derived_state, ",");
+			size_t binary_derived_state_length = binary_derived_state.size();
 			
+			derived_state_ids.clear();
 			for (std::string &derived_state_part : derived_state_parts)
-				binary_derived_state.emplace_back((slim_mutationid_t)std::stoll(derived_state_part));
+				derived_state_ids.emplace_back((slim_mutationid_t)std::stoll(derived_state_part));
 			
-			derived_state_total_part_count += derived_state_parts.size();
-			binary_derived_state_offset.push_back((table_size_t)(derived_state_total_part_count * sizeof(slim_mutationid_t)));
+			binary_derived_state.resize(binary_derived_state_length + derived_state_ids.size() * SLIM_DERIVED_STATE_MAX_BYTES_PER_ID);
+			binary_derived_state_length += SLiM_EncodeDerivedState(derived_state_ids.data(), derived_state_ids.size(), binary_derived_state.data() + binary_derived_state_length);
+			binary_derived_state.resize(binary_derived_state_length);
+			binary_derived_state_offset.push_back((table_size_t)binary_derived_state_length);
 			
 			// Mutation metadata
 			std::string string_mutation_metadata(mutation_metadata + mutation_metadata_offset[j], mutation_metadata_offset[j+1] - mutation_metadata_offset[j]);
@@ -4885,7 +6399,7 @@ void SLiMSim::TreeSequenceDataFromAscii(std::string NodeFileName,
 										 tables_copy.mutations->site,
 										 tables_copy.mutations->node,
 										 tables_copy.mutations->parent,
-										 (char *)binary_derived_state.data(),
+										 binary_derived_state.data(),
 										 binary_derived_state_offset.data(),
 										 (char *)binary_mutation_metadata.data(),
 										 binary_mutation_metadata_offset.data());
@@ -5095,6 +6609,7 @@ void SLiMSim::TreeSequenceDataToAscii(table_collection_t *p_tables)
 		table_size_t *derived_state_offset = p_tables->mutations->derived_state_offset;
 		std::string text_derived_state;
 		std::vector<table_size_t> text_derived_state_offset;
+		std::vector<slim_mutationid_t> int_derived_state;
 		
 		// Mutation metadata
 		const char *mutation_metadata = p_tables->mutations->metadata;
@@ -5108,8 +6623,8 @@ void SLiMSim::TreeSequenceDataToAscii(table_collection_t *p_tables)
 		for (size_t j = 0; j < p_tables->mutations->num_rows; j++)
 		{
 			// Mutation derived state
-			slim_mutationid_t *int_derived_state = (slim_mutationid_t *)(derived_state + derived_state_offset[j]);
-			size_t cur_derived_state_length = (derived_state_offset[j+1] - derived_state_offset[j])/sizeof(slim_mutationid_t);
+			SLiM_DecodeDerivedState(derived_state + derived_state_offset[j], derived_state_offset[j+1] - derived_state_offset[j], int_derived_state);
+			size_t cur_derived_state_length = int_derived_state.size();
 			
 			for (size_t i = 0; i < cur_derived_state_length; i++)
 			{
@@ -5315,7 +6830,7 @@ void SLiMSim::TreeSequenceDataToAscii(table_collection_t *p_tables)
 
 void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 {
-	// This modifies p_tables in place, replacing the derived_state column of p_tables with a binary version.
+	// This modifies p_tables in place, replacing the derived_state column of p_tables with our compact binary encoding.
 	// See TreeSequenceDataFromAscii() for comments; this is basically just a pruned version of that method.
 	mutation_table_t mutations_copy;
 	
@@ -5330,9 +6845,9 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 		
 		const char *derived_state = p_tables->mutations->derived_state;
 		table_size_t *derived_state_offset = p_tables->mutations->derived_state_offset;
-		std::vector<slim_mutationid_t> binary_derived_state;
+		std::vector<char> binary_derived_state;
 		std::vector<table_size_t> binary_derived_state_offset;
-		size_t derived_state_total_part_count = 0;
+		std::vector<slim_mutationid_t> derived_state_ids;
 		
 		binary_derived_state_offset.push_back(0);
 		
@@ -5340,6 +6855,8 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 		{
 			std::string string_derived_state(derived_state + derived_state_offset[j], derived_state_offset[j+1] - derived_state_offset[j]);
 			
+			derived_state_ids.clear();
+			
 			if (string_derived_state.size() == 0)
 			{
 				// nothing to do for an empty derived state
@@ -5347,8 +6864,7 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 			else if (string_derived_state.find(",") == std::string::npos)
 			{
 				// a single mutation can be handled more efficiently, and this is the common case so it's worth optimizing
-				binary_derived_state.emplace_back((slim_mutationid_t)std::stoll(string_derived_state));
-				derived_state_total_part_count++;
+				derived_state_ids.emplace_back((slim_mutationid_t)std::stoll(string_derived_state));
 			}
 			else
 			{
@@ -5356,12 +6872,15 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 				std::vector<std::string> derived_state_parts = Eidos_string_split(string_derived_state, ",");
 				
 				for (std::string &derived_state_part : derived_state_parts)
-					binary_derived_state.emplace_back((slim_mutationid_t)std::stoll(derived_state_part));
-				
-				derived_state_total_part_count += derived_state_parts.size();
+					derived_state_ids.emplace_back((slim_mutationid_t)std::stoll(derived_state_part));
 			}
 			
-			binary_derived_state_offset.push_back((table_size_t)(derived_state_total_part_count * sizeof(slim_mutationid_t)));
+			size_t binary_derived_state_length = binary_derived_state.size();
+			
+			binary_derived_state.resize(binary_derived_state_length + derived_state_ids.size() * SLIM_DERIVED_STATE_MAX_BYTES_PER_ID);
+			binary_derived_state_length += SLiM_EncodeDerivedState(derived_state_ids.data(), derived_state_ids.size(), binary_derived_state.data() + binary_derived_state_length);
+			binary_derived_state.resize(binary_derived_state_length);
+			binary_derived_state_offset.push_back((table_size_t)binary_derived_state_length);
 		}
 		
 		if (binary_derived_state.size() == 0)
@@ -5372,7 +6891,7 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 										 mutations_copy.site,
 										 mutations_copy.node,
 										 mutations_copy.parent,
-										 (char *)binary_derived_state.data(),
+										 binary_derived_state.data(),
 										 binary_derived_state_offset.data(),
 										 mutations_copy.metadata,
 										 mutations_copy.metadata_offset);
@@ -5382,56 +6901,6 @@ void SLiMSim::DerivedStatesFromAscii(table_collection_t *p_tables)
 	mutation_table_free(&mutations_copy);
 }
 
-void SLiMSim::DerivedStatesToAscii(table_collection_t *p_tables)
-{
-	// This modifies p_tables in place, replacing the derived_state column of p_tables with an ASCII version.
-	// See TreeSequenceDataToAscii() for comments; this is basically just a pruned version of that method.
-	mutation_table_t mutations_copy;
-	
-	int ret = mutation_table_alloc(&mutations_copy, 0, 0, 0);
-	if (ret < 0) handle_error("derived_to_ascii", ret);
-	
-	ret = mutation_table_copy(p_tables->mutations, &mutations_copy);
-	if (ret < 0) handle_error("derived_to_ascii", ret);
-	
-	{
-		static_assert(sizeof(MutationMetadataRec) == 16, "MutationMetadataRec has changed size; this code probably needs to be updated");
-		
-		const char *derived_state = p_tables->mutations->derived_state;
-		table_size_t *derived_state_offset = p_tables->mutations->derived_state_offset;
-		std::string text_derived_state;
-		std::vector<table_size_t> text_derived_state_offset;
-		
-		text_derived_state_offset.push_back(0);
-		
-		for (size_t j = 0; j < p_tables->mutations->num_rows; j++)
-		{
-			slim_mutationid_t *int_derived_state = (slim_mutationid_t *)(derived_state + derived_state_offset[j]);
-			size_t cur_derived_state_length = (derived_state_offset[j+1] - derived_state_offset[j])/sizeof(slim_mutationid_t);
-			
-			for (size_t i = 0; i < cur_derived_state_length; i++)
-			{
-				if (i != 0) text_derived_state.append(",");
-				text_derived_state.append(std::to_string(int_derived_state[i]));
-			}
-			text_derived_state_offset.push_back((table_size_t)text_derived_state.size());
-		}
-		
-		ret = mutation_table_set_columns(p_tables->mutations,
-										 mutations_copy.num_rows,
-										 mutations_copy.site,
-										 mutations_copy.node,
-										 mutations_copy.parent,
-										 text_derived_state.c_str(),
-										 text_derived_state_offset.data(),
-										 mutations_copy.metadata,
-										 mutations_copy.metadata_offset);
-		if (ret < 0) handle_error("derived_to_ascii", ret);
-	}
-	
-	mutation_table_free(&mutations_copy);
-}
-
 void SLiMSim::AddIndividualsToTable(Individual * const *p_individual, size_t p_num_individuals, table_collection_t *p_tables, uint32_t p_flags)
 {
     // We use currently use this function in three ways, depending on p_flags:
@@ -5450,19 +6919,8 @@ void SLiMSim::AddIndividualsToTable(Individual * const *p_individual, size_t p_n
 	if (p_tables == nullptr)
 		p_tables = &tables_;
 	
-	// construct the map of currently remembered individuals first; these are not really just those
-	// that are "remembered", but all individuals that are currently in the tables
-    std::vector<slim_pedigreeid_t> remembered_individuals;
-	
-    for (node_id_t nid : remembered_genomes_) 
-    {
-        individual_id_t msp_individual = p_tables->nodes->individual[nid];
-        assert((msp_individual >= 0) && ((table_size_t)msp_individual < p_tables->individuals->num_rows));
-        IndividualMetadataRec *metadata_rec = (IndividualMetadataRec *)(p_tables->individuals->metadata + p_tables->individuals->metadata_offset[msp_individual]);
-        
-		if ((remembered_individuals.size() == 0) || (metadata_rec->pedigree_id_ != remembered_individuals.back()))
-			remembered_individuals.push_back(metadata_rec->pedigree_id_);
-    }
+	// the individuals that are currently in the tables are the remembered (and first-generation) individuals, whose rows are
+	// kept in remembered_individual_rows_; p_tables is either tables_ or a copy of it, so the rows are the same in either case
 	
 	// loop over individuals and add entries to the individual table; if they are already
 	// there, we just need to update their metadata, location, etc.
@@ -5478,9 +6936,9 @@ void SLiMSim::AddIndividualsToTable(Individual * const *p_individual, size_t p_n
         
         IndividualMetadataRec metadata_rec;
         MetadataForIndividual(ind, &metadata_rec);
-        auto ind_pos = std::find(remembered_individuals.begin(), remembered_individuals.end(), ped_id);
+        auto ind_pos = remembered_individual_rows_.find(ped_id);
         
-        if (ind_pos == remembered_individuals.end()) {
+        if (ind_pos == remembered_individual_rows_.end()) {
             // This individual is not already in the tables.
             individual_id_t msp_individual = individual_table_add_row(p_tables->individuals,
                     p_flags, location.data(), (uint32_t)location.size(), 
@@ -5498,10 +6956,11 @@ void SLiMSim::AddIndividualsToTable(Individual * const *p_individual, size_t p_n
             {
                 remembered_genomes_.push_back(ind->genome1_->msp_node_id_);
                 remembered_genomes_.push_back(ind->genome2_->msp_node_id_);
+                remembered_individual_rows_.emplace(ped_id, msp_individual);
             }
         } else {
             // This individual is already there; we need to update the information.
-            size_t msp_individual = std::distance(remembered_individuals.begin(), ind_pos);
+            size_t msp_individual = (size_t)ind_pos->second;
             assert((msp_individual < p_tables->individuals->num_rows)
                    && (location.size()
                        == (p_tables->individuals->location_offset[msp_individual + 1]
@@ -5542,29 +7001,33 @@ void SLiMSim::AddCurrentGenerationToIndividuals(table_collection_t *p_tables)
 	}
 }
 
-void SLiMSim::UnmarkFirstGenerationSamples(table_collection_t *p_tables)
+static inline uint32_t SLiM_UnmarkedNodeFlags(uint32_t p_node_flags, individual_id_t p_individual, const individual_table_t *p_individuals)
 {
-	// remove the "is sample" flag from first-generation individuals that were
-	// retained in the individuals table (for recapitation, ancestry, etc.)
-	for (size_t j = 0; j < p_tables->nodes->num_rows; j++)
+	// the flags a node is written out with by UnmarkFirstGenerationSamples() and WriteTreeSequenceToKastore()
+	if (p_node_flags & MSP_NODE_IS_SAMPLE)
 	{
-		if (p_tables->nodes->flags[j] & MSP_NODE_IS_SAMPLE)
+		// nodes may be samples and yet not have an indiviual, if we have not called simplify() before writing out (simplify=F)
+		if (p_individual >= 0)
 		{
-			individual_id_t ind = p_tables->nodes->individual[j];
-			
-			// nodes may be samples and yet not have an indiviual, if we have not called simplify() before writing out (simplify=F)
-			if (ind >= 0)
+			assert((table_size_t)p_individual < p_individuals->num_rows);
+			if ((p_individuals->flags[p_individual] & SLIM_TSK_INDIVIDUAL_FIRST_GEN)
+				&& !(p_individuals->flags[p_individual] & SLIM_TSK_INDIVIDUAL_REMEMBERED)
+				&& !(p_individuals->flags[p_individual] & SLIM_TSK_INDIVIDUAL_ALIVE))
 			{
-				assert((table_size_t)ind < p_tables->individuals->num_rows);
-				if ((p_tables->individuals->flags[ind] & SLIM_TSK_INDIVIDUAL_FIRST_GEN)
-					&& !(p_tables->individuals->flags[ind] & SLIM_TSK_INDIVIDUAL_REMEMBERED)
-					&& !(p_tables->individuals->flags[ind] & SLIM_TSK_INDIVIDUAL_ALIVE))
-				{
-					p_tables->nodes->flags[j] = (p_tables->nodes->flags[j] & !MSP_NODE_IS_SAMPLE);
-				}
+				return (p_node_flags & !MSP_NODE_IS_SAMPLE);
 			}
 		}
 	}
+	
+	return p_node_flags;
+}
+
+void SLiMSim::UnmarkFirstGenerationSamples(table_collection_t *p_tables)
+{
+	// remove the "is sample" flag from first-generation individuals that were
+	// retained in the individuals table (for recapitation, ancestry, etc.)
+	for (size_t j = 0; j < p_tables->nodes->num_rows; j++)
+		p_tables->nodes->flags[j] = SLiM_UnmarkedNodeFlags(p_tables->nodes->flags[j], p_tables->nodes->individual[j], p_tables->individuals);
 }
 
 void SLiMSim::RemarkFirstGenerationSamples(table_collection_t *p_tables)
@@ -5884,81 +7347,521 @@ void SLiMSim::ReadProvenanceTable(table_collection_t *p_tables, slim_generation_
 		}
 	}
 	
-	if (slim_record_index == -1)
-		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): no SLiM provenance table entry found; this file cannot be read." << EidosTerminate();
+	if (slim_record_index == -1)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): no SLiM provenance table entry found; this file cannot be read." << EidosTerminate();
+	
+	//char *slim_timestamp = provenance_table.timestamp + provenance_table.timestamp_offset[slim_record_index];
+	char *slim_record = provenance_table.record + provenance_table.record_offset[slim_record_index];
+	table_size_t slim_record_len = provenance_table.record_offset[slim_record_index + 1] - provenance_table.record_offset[slim_record_index];
+	std::string slim_record_str(slim_record, slim_record_len);
+	auto j = nlohmann::json::parse(slim_record_str);
+	
+	//std::cout << "Read provenance:\n" << slim_record_str << std::endl;
+	
+	auto file_version_01 = j["file_version"];
+	auto file_version_02 = j["slim"]["file_version"];
+	
+	std::string model_type_str;
+	long long gen_ll;
+	
+	if (file_version_01.is_string() && (file_version_01 == "0.1"))
+	{
+		// We actually don't have any chance of being able to read SLiM 3.0 .trees files in, I guess;
+		// all the new individuals table stuff, the addition of the population table, etc., mean that
+		// it would just be a huge headache to try to do this.  So let's throw an error up front.
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): file_version is 0.1 in .trees file; this file cannot be read.  SLiM 3.1 and later cannot read saved .trees files from prior versions of SLiM; sorry." << EidosTerminate();
+		
+		/*
+		try {
+			model_type_str = j["model_type"];
+			gen_ll = j["generation"];
+			//rem_count_ll = j["remembered_node_count"];	// no longer using this key
+		}
+		catch (...)
+		{
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): error reading provenance value (file_version 0.1); this file cannot be read." << EidosTerminate();
+		}
+		 */
+	}
+	else if (file_version_02.is_string() && (file_version_02 == "0.2"))
+	{
+		try {
+			model_type_str = j["parameters"]["model_type"];
+			gen_ll = j["slim"]["generation"];
+			//rem_count_ll = j["slim"]["remembered_node_count"];	// no longer using this key
+		}
+		catch (...)
+		{
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): error reading provenance value (file_version 0.2); this file cannot be read." << EidosTerminate();
+		}
+	}
+	else
+	{
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): this .trees file was generated by an unrecognized version of SLiM; this file cannot be read." << EidosTerminate();
+	}
+	
+	// check the model type; at the moment we do not require the model type to match what we are running, but we issue a warning on a mismatch
+	if ((model_type_str != "WF") && (model_type_str != "nonWF"))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): unrecognized model type; this file cannot be read." << EidosTerminate();
+	
+	if (((model_type_str == "WF") && (ModelType() != SLiMModelType::kModelTypeWF)) ||
+		((model_type_str == "nonWF") && (ModelType() != SLiMModelType::kModelTypeNonWF)))
+	{
+		if (!gEidosSuppressWarnings)
+			SLIM_OUTSTREAM << "#WARNING (SLiMSim::ReadProvenanceTable): the model type of the .trees file does not match the current model type." << std::endl;
+	}
+	
+	if (model_type_str == "WF")
+		*p_model_type = SLiMModelType::kModelTypeWF;
+	else if (model_type_str == "nonWF")
+		*p_model_type = SLiMModelType::kModelTypeNonWF;
+	
+	// bounds-check the generation
+	if ((gen_ll < 1) || (gen_ll > SLIM_MAX_GENERATION))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): generation value out of range; this file cannot be read." << EidosTerminate();
+	
+	*p_generation = (slim_generation_t)gen_ll;
+#endif
+}
+
+// WriteTreeSequenceToKastore() writes the kastore format used for .trees files itself, rather than through kastore_t, because
+// kastore_put() copies every array it is given; here each column is instead written straight from the live tables when it is
+// written out unmodified, or produced in chunks by a generator when it must be transformed on the way out.
+class SLiM_KastoreStream
+{
+public:
+	FILE *file_;
+	size_t bytes_written_ = 0;
+	bool failed_ = false;
+	
+	explicit SLiM_KastoreStream(FILE *p_file) : file_(p_file) {}
+	
+	void Write(const void *p_bytes, size_t p_size)
+	{
+		if (failed_ || (p_size == 0))
+			return;
+		if (fwrite(p_bytes, p_size, 1, file_) != 1)
+			failed_ = true;
+		bytes_written_ += p_size;
+	}
+};
+
+struct SLiM_KastoreColumn
+{
+	std::string key_;
+	int type_;
+	size_t length_;												// in elements of type_
+	const void *data_;											// the column's contents, or nullptr if generator_ produces them
+	std::function<void(SLiM_KastoreStream &)> generator_;
+};
+
+template <typename T, typename F>
+static void SLiM_GenerateKastoreColumn(SLiM_KastoreStream &p_stream, size_t p_count, F p_element)
+{
+	// produce p_count elements from p_element(index), a chunk at a time, so the transformed column never exists in full
+	static const size_t chunk_size = 16384;
+	std::vector<T> chunk(std::min(p_count, chunk_size));
+	
+	for (size_t chunk_start = 0; chunk_start < p_count; chunk_start += chunk_size)
+	{
+		size_t chunk_count = std::min(p_count - chunk_start, chunk_size);
+		
+		for (size_t i = 0; i < chunk_count; ++i)
+			chunk[i] = p_element(chunk_start + i);
+		
+		p_stream.Write(chunk.data(), chunk_count * sizeof(T));
+	}
+}
+
+static void SLiM_BuildEdgeIndexes(const table_collection_t *p_tables, std::vector<edge_id_t> &p_insertion_order, std::vector<edge_id_t> &p_removal_order)
+{
+	// produces the same orders as table_collection_build_indexes(), which sorts a buffer of 32-byte sort keys per edge; here
+	// the edge ids are sorted directly, so the two index columns themselves are the only memory needed
+	const edge_table_t *edges = p_tables->edges;
+	const double *time = p_tables->nodes->time;
+	
+	p_insertion_order.resize(edges->num_rows);
+	p_removal_order.resize(edges->num_rows);
+	
+	for (edge_id_t j = 0; (table_size_t)j < edges->num_rows; ++j)
+		p_insertion_order[j] = p_removal_order[j] = j;
+	
+	// the insertion order is by left, then increasing parent time, parent, and child
+	std::sort(p_insertion_order.begin(), p_insertion_order.end(), [edges, time](edge_id_t a, edge_id_t b) {
+		if (edges->left[a] != edges->left[b]) return edges->left[a] < edges->left[b];
+		double time_a = time[edges->parent[a]], time_b = time[edges->parent[b]];
+		if (time_a != time_b) return time_a < time_b;
+		if (edges->parent[a] != edges->parent[b]) return edges->parent[a] < edges->parent[b];
+		return edges->child[a] < edges->child[b];
+	});
+	
+	// the removal order is by right, then decreasing parent time, parent, and child
+	std::sort(p_removal_order.begin(), p_removal_order.end(), [edges, time](edge_id_t a, edge_id_t b) {
+		if (edges->right[a] != edges->right[b]) return edges->right[a] < edges->right[b];
+		double time_a = time[edges->parent[a]], time_b = time[edges->parent[b]];
+		if (time_a != time_b) return time_a > time_b;
+		if (edges->parent[a] != edges->parent[b]) return edges->parent[a] > edges->parent[b];
+		return edges->child[a] > edges->child[b];
+	});
+}
+
+static std::string SLiM_WriteKastoreColumns(const std::string &p_path, std::vector<SLiM_KastoreColumn> &p_columns)
+{
+	// write p_columns to p_path in the kastore format, returning an error description, or an empty string on success
+	static const size_t type_sizes[KAS_NUM_TYPES] = {1, 1, 2, 2, 4, 4, 8, 8, 4, 8};
+	
+	std::sort(p_columns.begin(), p_columns.end(), [](const SLiM_KastoreColumn &a, const SLiM_KastoreColumn &b) { return a.key_ < b.key_; });
+	
+	// pack the keys and then the arrays, each array aligned to KAS_ARRAY_ALIGN, exactly as kastore_pack_items() does
+	size_t column_count = p_columns.size();
+	std::vector<uint64_t> array_starts(column_count);
+	uint64_t offset = KAS_HEADER_SIZE + column_count * KAS_ITEM_DESCRIPTOR_SIZE;
+	
+	for (SLiM_KastoreColumn &column : p_columns)
+		offset += column.key_.size();
+	
+	for (size_t j = 0; j < column_count; ++j)
+	{
+		if (offset % KAS_ARRAY_ALIGN)
+			offset += KAS_ARRAY_ALIGN - (offset % KAS_ARRAY_ALIGN);
+		array_starts[j] = offset;
+		offset += p_columns[j].length_ * type_sizes[p_columns[j].type_];
+	}
+	
+	FILE *file = fopen(p_path.c_str(), "wb");
+	
+	if (!file)
+		return "could not open the file for writing";
+	
+	SLiM_KastoreStream stream(file);
+	
+	{
+		char header[KAS_HEADER_SIZE];
+		uint16_t version_major = KAS_FILE_VERSION_MAJOR;
+		uint16_t version_minor = KAS_FILE_VERSION_MINOR;
+		uint32_t num_items = (uint32_t)column_count;
+		uint64_t file_size = offset;
+		
+		memset(header, 0, sizeof(header));
+		memcpy(header, KAS_MAGIC, 8);
+		memcpy(header + 8, &version_major, 2);
+		memcpy(header + 10, &version_minor, 2);
+		memcpy(header + 12, &num_items, 4);
+		memcpy(header + 16, &file_size, 8);
+		stream.Write(header, sizeof(header));
+	}
+	
+	uint64_t key_start = KAS_HEADER_SIZE + column_count * KAS_ITEM_DESCRIPTOR_SIZE;
+	
+	for (size_t j = 0; j < column_count; ++j)
+	{
+		char descriptor[KAS_ITEM_DESCRIPTOR_SIZE];
+		uint8_t type = (uint8_t)p_columns[j].type_;
+		uint64_t key_len = p_columns[j].key_.size();
+		uint64_t array_len = p_columns[j].length_;
+		
+		memset(descriptor, 0, sizeof(descriptor));
+		memcpy(descriptor, &type, 1);
+		memcpy(descriptor + 8, &key_start, 8);
+		memcpy(descriptor + 16, &key_len, 8);
+		memcpy(descriptor + 24, &array_starts[j], 8);
+		memcpy(descriptor + 32, &array_len, 8);
+		stream.Write(descriptor, sizeof(descriptor));
+		
+		key_start += key_len;
+	}
+	
+	for (SLiM_KastoreColumn &column : p_columns)
+		stream.Write(column.key_.data(), column.key_.size());
+	
+	std::string error;
+	
+	for (size_t j = 0; j < column_count; ++j)
+	{
+		SLiM_KastoreColumn &column = p_columns[j];
+		static const char padding[KAS_ARRAY_ALIGN] = {0};
+		size_t array_size = column.length_ * type_sizes[column.type_];
+		
+		stream.Write(padding, array_starts[j] - stream.bytes_written_);
+		
+		if (column.data_)
+			stream.Write(column.data_, array_size);
+		else if (column.generator_)
+			column.generator_(stream);
+		
+		if (!stream.failed_ && (stream.bytes_written_ != array_starts[j] + array_size))
+		{
+			error = "(internal error) column " + column.key_ + " was written with an incorrect length";
+			break;
+		}
+	}
+	
+	if (fclose(file) != 0)
+		stream.failed_ = true;
+	if (stream.failed_ && error.empty())
+		error = "the file could not be written";
+	
+	return error;
+}
+
+void SLiMSim::WriteTreeSequenceToKastore(const std::string &p_path)
+{
+	// Write the tables to a binary .trees file at p_path, without copying the table collection as the text path does.  Columns
+	// that go out unmodified are written directly from tables_.  The current generation is added to the individuals table in
+	// place, and the rows and node references that touches are saved beforehand and restored afterwards; the individual table
+	// reordering, node time rebasing, first-generation sample unmarking, and derived-state ASCII conversion are all done as the
+	// columns are written.  The edge indexes and mutation parents that valid files need are computed here and discarded after;
+	// those, the individual reordering maps, and the saved current-generation state are the main extra memory used.
+	int ret = 0;
+	
+	// Build the edge indexes, and compute mutation parents from them into a separate column, since our tables keep parents null;
+	// both are swapped into tables_ only for the duration of table_collection_compute_mutation_parents()
+	std::vector<edge_id_t> edge_insertion_order, edge_removal_order;
 	
-	//char *slim_timestamp = provenance_table.timestamp + provenance_table.timestamp_offset[slim_record_index];
-	char *slim_record = provenance_table.record + provenance_table.record_offset[slim_record_index];
-	table_size_t slim_record_len = provenance_table.record_offset[slim_record_index + 1] - provenance_table.record_offset[slim_record_index];
-	std::string slim_record_str(slim_record, slim_record_len);
-	auto j = nlohmann::json::parse(slim_record_str);
+	SLiM_BuildEdgeIndexes(&tables_, edge_insertion_order, edge_removal_order);
 	
-	//std::cout << "Read provenance:\n" << slim_record_str << std::endl;
+	table_size_t mutation_count = tables_.mutations->num_rows;
+	std::vector<mutation_id_t> mutation_parents(std::max(mutation_count, (table_size_t)1), MSP_NULL_MUTATION);
+	mutation_id_t *running_parents = tables_.mutations->parent;
+	auto running_indexes = tables_.indexes;
 	
-	auto file_version_01 = j["file_version"];
-	auto file_version_02 = j["slim"]["file_version"];
+	tables_.mutations->parent = mutation_parents.data();
+	tables_.indexes.edge_insertion_order = edge_insertion_order.data();
+	tables_.indexes.edge_removal_order = edge_removal_order.data();
+	tables_.indexes.malloced_locally = false;
+	ret = table_collection_compute_mutation_parents(&tables_, 0);
+	tables_.mutations->parent = running_parents;
+	tables_.indexes = running_indexes;
+	if (ret < 0) handle_error("compute_mutation_parents", ret);
 	
-	std::string model_type_str;
-	long long gen_ll;
+	// Save what AddCurrentGenerationToIndividuals() will modify: the individual of each extant genome's node, and the rows of
+	// extant individuals that are already in the table (remembered individuals), which get updated location/metadata/flags
+	individual_table_t &individuals = *tables_.individuals;
+	table_size_t original_individual_count = individuals.num_rows;
+	table_size_t original_provenance_count = tables_.provenances->num_rows;
+	std::vector<std::pair<node_id_t, individual_id_t>> saved_node_individuals;
+	std::vector<individual_id_t> saved_rows;
+	std::vector<uint32_t> saved_flags;
+	std::vector<double> saved_locations;
+	std::vector<char> saved_metadata;
 	
-	if (file_version_01.is_string() && (file_version_01 == "0.1"))
+	for (const std::pair<const slim_objectid_t,Subpopulation*> &subpop_pair : population_)
 	{
-		// We actually don't have any chance of being able to read SLiM 3.0 .trees files in, I guess;
-		// all the new individuals table stuff, the addition of the population table, etc., mean that
-		// it would just be a huge headache to try to do this.  So let's throw an error up front.
-		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): file_version is 0.1 in .trees file; this file cannot be read.  SLiM 3.1 and later cannot read saved .trees files from prior versions of SLiM; sorry." << EidosTerminate();
-		
-		/*
-		try {
-			model_type_str = j["model_type"];
-			gen_ll = j["generation"];
-			//rem_count_ll = j["remembered_node_count"];	// no longer using this key
-		}
-		catch (...)
+		for (Individual *individual : subpop_pair.second->parent_individuals_)
 		{
-			EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): error reading provenance value (file_version 0.1); this file cannot be read." << EidosTerminate();
+			node_id_t node1 = individual->genome1_->msp_node_id_;
+			node_id_t node2 = individual->genome2_->msp_node_id_;
+			individual_id_t row = tables_.nodes->individual[node1];
+			
+			saved_node_individuals.emplace_back(node1, row);
+			saved_node_individuals.emplace_back(node2, tables_.nodes->individual[node2]);
+			
+			if ((row >= 0) && ((table_size_t)row < original_individual_count))
+			{
+				saved_rows.push_back(row);
+				saved_flags.push_back(individuals.flags[row]);
+				saved_locations.insert(saved_locations.end(), individuals.location + individuals.location_offset[row], individuals.location + individuals.location_offset[row + 1]);
+				saved_metadata.insert(saved_metadata.end(), individuals.metadata + individuals.metadata_offset[row], individuals.metadata + individuals.metadata_offset[row + 1]);
+			}
 		}
-		 */
 	}
-	else if (file_version_02.is_string() && (file_version_02 == "0.2"))
+	
+	AddCurrentGenerationToIndividuals(&tables_);
+	
+	// Determine the output order of the individuals; see ReorderIndividualTable(), which does this to a copy for text output
+	table_size_t individual_count = individuals.num_rows;
+	std::vector<individual_id_t> individual_order;
+	std::vector<individual_id_t> inverse_individual_order(individual_count, MSP_NULL_INDIVIDUAL);
+	
+	for (const std::pair<const slim_objectid_t,Subpopulation*> &subpop_pair : population_)
+		for (Individual *individual : subpop_pair.second->parent_individuals_)
+			individual_order.push_back(tables_.nodes->individual[individual->genome1_->msp_node_id_]);
+	
+	for (individual_id_t j = 0; (size_t)j < individual_order.size(); j++)
+		inverse_individual_order[individual_order[j]] = j;
+	
+	for (individual_id_t j = 0; (table_size_t)j < individual_count; j++)
 	{
-		try {
-			model_type_str = j["parameters"]["model_type"];
-			gen_ll = j["slim"]["generation"];
-			//rem_count_ll = j["slim"]["remembered_node_count"];	// no longer using this key
-		}
-		catch (...)
+		if (inverse_individual_order[j] == MSP_NULL_INDIVIDUAL)
 		{
-			EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): error reading provenance value (file_version 0.2); this file cannot be read." << EidosTerminate();
+			inverse_individual_order[j] = (individual_id_t)individual_order.size();
+			individual_order.push_back(j);
 		}
 	}
-	else
-	{
-		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): this .trees file was generated by an unrecognized version of SLiM; this file cannot be read." << EidosTerminate();
-	}
 	
-	// check the model type; at the moment we do not require the model type to match what we are running, but we issue a warning on a mismatch
-	if ((model_type_str != "WF") && (model_type_str != "nonWF"))
-		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): unrecognized model type; this file cannot be read." << EidosTerminate();
+	// Add a row to the Provenance table to record current state; this is removed again below
+	WriteProvenanceTable(&tables_, /* p_use_newlines */ true);
 	
-	if (((model_type_str == "WF") && (ModelType() != SLiMModelType::kModelTypeWF)) ||
-		((model_type_str == "nonWF") && (ModelType() != SLiMModelType::kModelTypeNonWF)))
-	{
-		if (!gEidosSuppressWarnings)
-			SLIM_OUTSTREAM << "#WARNING (SLiMSim::ReadProvenanceTable): the model type of the .trees file does not match the current model type." << std::endl;
-	}
+	// Set up the columns, in the same set written by table_collection_dump()
+	std::vector<SLiM_KastoreColumn> columns;
+	char format_name[MSP_FILE_FORMAT_NAME_LENGTH];
+	uint32_t format_version[2] = {MSP_FILE_FORMAT_VERSION_MAJOR, MSP_FILE_FORMAT_VERSION_MINOR};
+	char uuid[TSK_UUID_SIZE + 1];
 	
-	if (model_type_str == "WF")
-		*p_model_type = SLiMModelType::kModelTypeWF;
-	else if (model_type_str == "nonWF")
-		*p_model_type = SLiMModelType::kModelTypeNonWF;
+	memcpy(format_name, MSP_FILE_FORMAT_NAME, sizeof(format_name));
+	ret = tsk_generate_uuid(uuid, 0);
 	
-	// bounds-check the generation
-	if ((gen_ll < 1) || (gen_ll > SLIM_MAX_GENERATION))
-		EIDOS_TERMINATION << "ERROR (SLiMSim::ReadProvenanceTable): generation value out of range; this file cannot be read." << EidosTerminate();
+	columns.push_back({"format/name", KAS_INT8, sizeof(format_name), format_name, nullptr});
+	columns.push_back({"format/version", KAS_UINT32, 2, format_version, nullptr});
+	columns.push_back({"sequence_length", KAS_FLOAT64, 1, &tables_.sequence_length, nullptr});
+	columns.push_back({"uuid", KAS_INT8, TSK_UUID_SIZE, uuid, nullptr});
 	
-	*p_generation = (slim_generation_t)gen_ll;
-#endif
+	node_table_t &nodes = *tables_.nodes;
+	double generation_offset = generation_;
+	
+	columns.push_back({"nodes/time", KAS_FLOAT64, nodes.num_rows, nullptr, [&](SLiM_KastoreStream &stream) {
+		// rebase the times in the nodes to be in msprime-land; see _InstantiateSLiMObjectsFromTables() for the inverse operation
+		SLiM_GenerateKastoreColumn<double>(stream, nodes.num_rows, [&](size_t j) { return nodes.time[j] + generation_offset; });
+	}});
+	columns.push_back({"nodes/flags", KAS_UINT32, nodes.num_rows, nullptr, [&](SLiM_KastoreStream &stream) {
+		SLiM_GenerateKastoreColumn<uint32_t>(stream, nodes.num_rows, [&](size_t j) { return SLiM_UnmarkedNodeFlags(nodes.flags[j], nodes.individual[j], &individuals); });
+	}});
+	columns.push_back({"nodes/population", KAS_INT32, nodes.num_rows, nodes.population, nullptr});
+	columns.push_back({"nodes/individual", KAS_INT32, nodes.num_rows, nullptr, [&](SLiM_KastoreStream &stream) {
+		SLiM_GenerateKastoreColumn<individual_id_t>(stream, nodes.num_rows, [&](size_t j) { individual_id_t ind = nodes.individual[j]; return (ind >= 0) ? inverse_individual_order[ind] : ind; });
+	}});
+	columns.push_back({"nodes/metadata", KAS_UINT8, nodes.metadata_length, nodes.metadata, nullptr});
+	columns.push_back({"nodes/metadata_offset", KAS_UINT32, nodes.num_rows + 1, nodes.metadata_offset, nullptr});
+	
+	edge_table_t &edges = *tables_.edges;
+	
+	columns.push_back({"edges/left", KAS_FLOAT64, edges.num_rows, edges.left, nullptr});
+	columns.push_back({"edges/right", KAS_FLOAT64, edges.num_rows, edges.right, nullptr});
+	columns.push_back({"edges/parent", KAS_INT32, edges.num_rows, edges.parent, nullptr});
+	columns.push_back({"edges/child", KAS_INT32, edges.num_rows, edges.child, nullptr});
+	columns.push_back({"indexes/edge_insertion_order", KAS_INT32, edges.num_rows, edge_insertion_order.data(), nullptr});
+	columns.push_back({"indexes/edge_removal_order", KAS_INT32, edges.num_rows, edge_removal_order.data(), nullptr});
+	
+	site_table_t &sites = *tables_.sites;
+	
+	columns.push_back({"sites/position", KAS_FLOAT64, sites.num_rows, sites.position, nullptr});
+	columns.push_back({"sites/ancestral_state", KAS_UINT8, sites.ancestral_state_length, sites.ancestral_state, nullptr});
+	columns.push_back({"sites/ancestral_state_offset", KAS_UINT32, sites.num_rows + 1, sites.ancestral_state_offset, nullptr});
+	columns.push_back({"sites/metadata", KAS_UINT8, sites.metadata_length, sites.metadata, nullptr});
+	columns.push_back({"sites/metadata_offset", KAS_UINT32, sites.num_rows + 1, sites.metadata_offset, nullptr});
+	
+	migration_table_t &migrations = *tables_.migrations;
+	
+	columns.push_back({"migrations/left", KAS_FLOAT64, migrations.num_rows, migrations.left, nullptr});
+	columns.push_back({"migrations/right", KAS_FLOAT64, migrations.num_rows, migrations.right, nullptr});
+	columns.push_back({"migrations/node", KAS_INT32, migrations.num_rows, migrations.node, nullptr});
+	columns.push_back({"migrations/source", KAS_INT32, migrations.num_rows, migrations.source, nullptr});
+	columns.push_back({"migrations/dest", KAS_INT32, migrations.num_rows, migrations.dest, nullptr});
+	columns.push_back({"migrations/time", KAS_FLOAT64, migrations.num_rows, migrations.time, nullptr});
+	
+	// derived state data must be in ASCII (or unicode) on disk, according to tskit policy; we convert it row by row, which takes
+	// one pass to size the column and then one pass each to write the column and its offsets
+	mutation_table_t &mutations = *tables_.mutations;
+	size_t ascii_derived_state_length = 0;
+	std::string ascii_derived_state;
+	
+	for (table_size_t j = 0; j < mutation_count; j++)
+	{
+		ascii_derived_state.clear();
+		SLiM_AppendDerivedStateAscii(mutations.derived_state + mutations.derived_state_offset[j], mutations.derived_state_offset[j + 1] - mutations.derived_state_offset[j], ascii_derived_state);
+		ascii_derived_state_length += ascii_derived_state.size();
+	}
+	
+	columns.push_back({"mutations/site", KAS_INT32, mutation_count, mutations.site, nullptr});
+	columns.push_back({"mutations/node", KAS_INT32, mutation_count, mutations.node, nullptr});
+	columns.push_back({"mutations/parent", KAS_INT32, mutation_count, mutation_parents.data(), nullptr});
+	columns.push_back({"mutations/derived_state", KAS_UINT8, ascii_derived_state_length, nullptr, [&](SLiM_KastoreStream &stream) {
+		for (table_size_t j = 0; j < mutation_count; j++)
+		{
+			ascii_derived_state.clear();
+			SLiM_AppendDerivedStateAscii(mutations.derived_state + mutations.derived_state_offset[j], mutations.derived_state_offset[j + 1] - mutations.derived_state_offset[j], ascii_derived_state);
+			stream.Write(ascii_derived_state.data(), ascii_derived_state.size());
+		}
+	}});
+	columns.push_back({"mutations/derived_state_offset", KAS_UINT32, mutation_count + 1, nullptr, [&](SLiM_KastoreStream &stream) {
+		table_size_t ascii_offset = 0;
+		
+		SLiM_GenerateKastoreColumn<table_size_t>(stream, mutation_count + 1, [&](size_t j) {
+			table_size_t row_offset = ascii_offset;
+			
+			if (j < mutation_count)
+			{
+				ascii_derived_state.clear();
+				SLiM_AppendDerivedStateAscii(mutations.derived_state + mutations.derived_state_offset[j], mutations.derived_state_offset[j + 1] - mutations.derived_state_offset[j], ascii_derived_state);
+				ascii_offset += (table_size_t)ascii_derived_state.size();
+			}
+			return row_offset;
+		});
+	}});
+	columns.push_back({"mutations/metadata", KAS_UINT8, mutations.metadata_length, mutations.metadata, nullptr});
+	columns.push_back({"mutations/metadata_offset", KAS_UINT32, mutation_count + 1, mutations.metadata_offset, nullptr});
+	
+	// the individuals table is written in individual_order, rebuilding the ragged columns' offsets as we go
+	columns.push_back({"individuals/flags", KAS_UINT32, individual_count, nullptr, [&](SLiM_KastoreStream &stream) {
+		SLiM_GenerateKastoreColumn<uint32_t>(stream, individual_count, [&](size_t j) { return individuals.flags[individual_order[j]]; });
+	}});
+	columns.push_back({"individuals/location", KAS_FLOAT64, individuals.location_length, nullptr, [&](SLiM_KastoreStream &stream) {
+		for (individual_id_t row : individual_order)
+			stream.Write(individuals.location + individuals.location_offset[row], (individuals.location_offset[row + 1] - individuals.location_offset[row]) * sizeof(double));
+	}});
+	columns.push_back({"individuals/location_offset", KAS_UINT32, individual_count + 1, nullptr, [&](SLiM_KastoreStream &stream) {
+		table_size_t location_offset = 0;
+		
+		SLiM_GenerateKastoreColumn<table_size_t>(stream, individual_count + 1, [&](size_t j) {
+			table_size_t row_offset = location_offset;
+			
+			if (j < individual_count)
+				location_offset += individuals.location_offset[individual_order[j] + 1] - individuals.location_offset[individual_order[j]];
+			return row_offset;
+		});
+	}});
+	columns.push_back({"individuals/metadata", KAS_UINT8, individuals.metadata_length, nullptr, [&](SLiM_KastoreStream &stream) {
+		for (individual_id_t row : individual_order)
+			stream.Write(individuals.metadata + individuals.metadata_offset[row], individuals.metadata_offset[row + 1] - individuals.metadata_offset[row]);
+	}});
+	columns.push_back({"individuals/metadata_offset", KAS_UINT32, individual_count + 1, nullptr, [&](SLiM_KastoreStream &stream) {
+		table_size_t metadata_offset = 0;
+		
+		SLiM_GenerateKastoreColumn<table_size_t>(stream, individual_count + 1, [&](size_t j) {
+			table_size_t row_offset = metadata_offset;
+			
+			if (j < individual_count)
+				metadata_offset += individuals.metadata_offset[individual_order[j] + 1] - individuals.metadata_offset[individual_order[j]];
+			return row_offset;
+		});
+	}});
+	
+	population_table_t &populations = *tables_.populations;
+	provenance_table_t &provenances = *tables_.provenances;
+	
+	columns.push_back({"populations/metadata", KAS_UINT8, populations.metadata_length, populations.metadata, nullptr});
+	columns.push_back({"populations/metadata_offset", KAS_UINT32, populations.num_rows + 1, populations.metadata_offset, nullptr});
+	columns.push_back({"provenances/timestamp", KAS_UINT8, provenances.timestamp_length, provenances.timestamp, nullptr});
+	columns.push_back({"provenances/timestamp_offset", KAS_UINT32, provenances.num_rows + 1, provenances.timestamp_offset, nullptr});
+	columns.push_back({"provenances/record", KAS_UINT8, provenances.record_length, provenances.record, nullptr});
+	columns.push_back({"provenances/record_offset", KAS_UINT32, provenances.num_rows + 1, provenances.record_offset, nullptr});
+	
+	std::string error = (ret == 0) ? SLiM_WriteKastoreColumns(p_path, columns) : "a file uuid could not be generated";
+	
+	// Restore the tables to their running state before reporting any error
+	ret = provenance_table_truncate(tables_.provenances, original_provenance_count);
+	if (ret < 0) handle_error("provenance_table_truncate", ret);
+	ret = individual_table_truncate(tables_.individuals, original_individual_count);
+	if (ret < 0) handle_error("individual_table_truncate", ret);
+	
+	for (size_t saved_index = 0, location_index = 0, metadata_index = 0; saved_index < saved_rows.size(); ++saved_index)
+	{
+		individual_id_t row = saved_rows[saved_index];
+		table_size_t location_length = individuals.location_offset[row + 1] - individuals.location_offset[row];
+		table_size_t metadata_length = individuals.metadata_offset[row + 1] - individuals.metadata_offset[row];
+		
+		individuals.flags[row] = saved_flags[saved_index];
+		memcpy(individuals.location + individuals.location_offset[row], saved_locations.data() + location_index, location_length * sizeof(double));
+		memcpy(individuals.metadata + individuals.metadata_offset[row], saved_metadata.data() + metadata_index, metadata_length);
+		location_index += location_length;
+		metadata_index += metadata_length;
+	}
+	
+	for (const std::pair<node_id_t, individual_id_t> &saved_node : saved_node_individuals)
+		tables_.nodes->individual[saved_node.first] = saved_node.second;
+	
+	if (error.size())
+		EIDOS_TERMINATION << "ERROR (SLiMSim::WriteTreeSequenceToKastore): unable to write " << p_path << " for treeSeqOutput(): " << error << "." << EidosTerminate();
 }
 
 void SLiMSim::WriteTreeSequence(std::string &p_recording_tree_path, bool p_binary, bool p_simplify)
@@ -5980,6 +7883,9 @@ void SLiMSim::WriteTreeSequence(std::string &p_recording_tree_path, bool p_binar
 	// comes from the time of output.  This needs to happen before simplify/sort.
 	WritePopulationTable(&tables_);
 	
+	// Move buffered edges into the edge table
+	FlushEdgeBuffer();
+	
 	// First we simplify, on the original table collection; we considered doing this on the copy,
 	// but then the copy takes longer and the simplify's work is lost, and there doesn't seem to
 	// be a compelling case for leaving the original tables unsimplified.
@@ -5990,15 +7896,22 @@ void SLiMSim::WriteTreeSequence(std::string &p_recording_tree_path, bool p_binar
 	else
 	{
         // this is done by SimplifyTreeSequence() but we need to do in any case
-		ret = table_collection_sort(&tables_, /* edge_start */ 0, /* flags */ 0);
-        if (ret < 0) handle_error("table_collection_sort", ret);
+		SortTreeSequenceTables(&tables_, sorted_edge_count_);
+		sorted_edge_count_ = tables_.edges->num_rows;
 		
         // Remove redundant sites we added
         ret = table_collection_deduplicate_sites(&tables_, 0);
         if (ret < 0) handle_error("deduplicate_sites", ret);
     }
 	
-	// Copy the table collection so that modifications we do for writing don't affect the original tables
+	// Binary output is streamed straight from the original tables, which can be too large to copy
+	if (p_binary)
+	{
+		WriteTreeSequenceToKastore(path);
+		return;
+	}
+	
+	// For text output, copy the table collection so that modifications we do for writing don't affect the original tables
 	table_collection_t output_tables;
 	ret = table_collection_alloc(&output_tables, MSP_ALLOC_TABLES);
 	if (ret < 0) handle_error("table_collection_alloc", ret);
@@ -6046,63 +7959,53 @@ void SLiMSim::WriteTreeSequence(std::string &p_recording_tree_path, bool p_binar
 	
 	// Add a row to the Provenance table to record current state; text format does not allow newlines in the entry,
 	// so we don't prettyprint the JSON when going to text, as a quick fix that avoids quoting the newlines etc.
-    WriteProvenanceTable(&output_tables, /* p_use_newlines */ p_binary);
+    WriteProvenanceTable(&output_tables, /* p_use_newlines */ false);
 	
 	// Write out the copied tables
-    if (p_binary)
-	{
-		// derived state data must in ASCII (or unicode) on disk, according to tskit policy
-		DerivedStatesToAscii(&output_tables);
-		
-		table_collection_dump(&output_tables, path.c_str(), 0);
-    }
+	std::string error_string;
+	bool success = Eidos_CreateDirectory(path, &error_string);
+	
+	if (success)
+	{
+		// first translate the bytes we've put into mutation derived state into printable ascii
+		TreeSequenceDataToAscii(&output_tables);
+		
+		std::string NodeFileName = path + "/NodeTable.txt";
+		std::string EdgeFileName = path + "/EdgeTable.txt";
+		std::string SiteFileName = path + "/SiteTable.txt";
+		std::string MutationFileName = path + "/MutationTable.txt";
+		std::string IndividualFileName = path + "/IndividualTable.txt";
+		std::string PopulationFileName = path + "/PopulationTable.txt";
+		std::string ProvenanceFileName = path + "/ProvenanceTable.txt";
+		
+		FILE *MspTxtNodeTable = fopen(NodeFileName.c_str(), "w");
+		FILE *MspTxtEdgeTable = fopen(EdgeFileName.c_str(), "w");
+		FILE *MspTxtSiteTable = fopen(SiteFileName.c_str(), "w");
+		FILE *MspTxtMutationTable = fopen(MutationFileName.c_str(), "w");
+		FILE *MspTxtIndividualTable = fopen(IndividualFileName.c_str(), "w");
+		FILE *MspTxtPopulationTable = fopen(PopulationFileName.c_str(), "w");
+		FILE *MspTxtProvenanceTable = fopen(ProvenanceFileName.c_str(), "w");
+		
+		node_table_dump_text(output_tables.nodes, MspTxtNodeTable);
+		edge_table_dump_text(output_tables.edges, MspTxtEdgeTable);
+		site_table_dump_text(output_tables.sites, MspTxtSiteTable);
+		mutation_table_dump_text(output_tables.mutations, MspTxtMutationTable);
+		individual_table_dump_text(output_tables.individuals, MspTxtIndividualTable);
+		population_table_dump_text(output_tables.populations, MspTxtPopulationTable);
+		provenance_table_dump_text(output_tables.provenances, MspTxtProvenanceTable);
+		
+		fclose(MspTxtNodeTable);
+		fclose(MspTxtEdgeTable);
+		fclose(MspTxtSiteTable);
+		fclose(MspTxtMutationTable);
+		fclose(MspTxtIndividualTable);
+		fclose(MspTxtPopulationTable);
+		fclose(MspTxtProvenanceTable);
+	}
 	else
 	{
-        std::string error_string;
-        bool success = Eidos_CreateDirectory(path, &error_string);
-		
-		if (success)
-		{
-            // first translate the bytes we've put into mutation derived state into printable ascii
-            TreeSequenceDataToAscii(&output_tables);
-			
-			std::string NodeFileName = path + "/NodeTable.txt";
-			std::string EdgeFileName = path + "/EdgeTable.txt";
-			std::string SiteFileName = path + "/SiteTable.txt";
-			std::string MutationFileName = path + "/MutationTable.txt";
-			std::string IndividualFileName = path + "/IndividualTable.txt";
-			std::string PopulationFileName = path + "/PopulationTable.txt";
-			std::string ProvenanceFileName = path + "/ProvenanceTable.txt";
-			
-			FILE *MspTxtNodeTable = fopen(NodeFileName.c_str(), "w");
-			FILE *MspTxtEdgeTable = fopen(EdgeFileName.c_str(), "w");
-			FILE *MspTxtSiteTable = fopen(SiteFileName.c_str(), "w");
-			FILE *MspTxtMutationTable = fopen(MutationFileName.c_str(), "w");
-			FILE *MspTxtIndividualTable = fopen(IndividualFileName.c_str(), "w");
-			FILE *MspTxtPopulationTable = fopen(PopulationFileName.c_str(), "w");
-			FILE *MspTxtProvenanceTable = fopen(ProvenanceFileName.c_str(), "w");
-			
-			node_table_dump_text(output_tables.nodes, MspTxtNodeTable);
-			edge_table_dump_text(output_tables.edges, MspTxtEdgeTable);
-			site_table_dump_text(output_tables.sites, MspTxtSiteTable);
-			mutation_table_dump_text(output_tables.mutations, MspTxtMutationTable);
-			individual_table_dump_text(output_tables.individuals, MspTxtIndividualTable);
-			population_table_dump_text(output_tables.populations, MspTxtPopulationTable);
-			provenance_table_dump_text(output_tables.provenances, MspTxtProvenanceTable);
-			
-			fclose(MspTxtNodeTable);
-			fclose(MspTxtEdgeTable);
-			fclose(MspTxtSiteTable);
-			fclose(MspTxtMutationTable);
-			fclose(MspTxtIndividualTable);
-			fclose(MspTxtPopulationTable);
-			fclose(MspTxtProvenanceTable);
-		}
-		else
-		{
-			EIDOS_TERMINATION << "ERROR (SLiMSim::WriteTreeSequence): unable to create output folder for treeSeqOutput() (" << error_string << ")" << EidosTerminate();
-		}
-    }
+		EIDOS_TERMINATION << "ERROR (SLiMSim::WriteTreeSequence): unable to create output folder for treeSeqOutput() (" << error_string << ")" << EidosTerminate();
+	}
 	
 	// Done with our tables copy
 	table_collection_free(&output_tables);
@@ -6119,8 +8022,19 @@ void SLiMSim::FreeTreeSequence(void)
 	// Free any tree-sequence recording stuff that has been allocated; called when SLiMSim is getting deallocated,
 	// and also when we're wiping the slate clean with something like readFromPopulationFile().
 	table_collection_free(&tables_);
+	sorted_edge_count_ = 0;
+	
+	edge_buffer_.clear();
+	edge_buffer_ends_.clear();
+	edge_buffer_parents_.clear();
+	edge_buffer_position_ = 0;
+	edge_buffer_live_count_ = 0;
+	edge_runs_.clear();
+	edge_run_edge_count_ = 0;
 	
 	remembered_genomes_.clear();
+	remembered_genomes_compacted_ = 0;
+	remembered_individual_rows_.clear();
 }
 
 void SLiMSim::RecordAllDerivedStatesFromSLiM(void)
@@ -6237,6 +8151,9 @@ void SLiMSim::DumpMutationTable(void)
 		mutation_id_t parent_id = mutations.parent[mutindex];
 		char *derived_state = mutations.derived_state + mutations.derived_state_offset[mutindex];
 		table_size_t derived_state_length = mutations.derived_state_offset[mutindex + 1] - mutations.derived_state_offset[mutindex];
+		std::vector<slim_mutationid_t> derived_state_ids;
+		
+		SLiM_DecodeDerivedState(derived_state, derived_state_length, derived_state_ids);
 		//char *metadata_state = mutations.metadata + mutations.metadata_offset[mutindex];
 		table_size_t metadata_length = mutations.metadata_offset[mutindex + 1] - mutations.metadata_offset[mutindex];
 		
@@ -6244,8 +8161,8 @@ void SLiMSim::DumpMutationTable(void)
 		{
 			bool contains_id = false;
 			
-			for (size_t mutid_index = 0; mutid_index < derived_state_length / sizeof(slim_mutationid_t); ++mutid_index)
-				if (((slim_mutationid_t *)derived_state)[mutid_index] == 72)
+			for (slim_mutationid_t mutid : derived_state_ids)
+				if (mutid == 72)
 					contains_id = true;
 			
 			if (!contains_id)
@@ -6256,12 +8173,82 @@ void SLiMSim::DumpMutationTable(void)
 		std::cout << "Mutation index " << mutindex << " has node_id " << node_id << ", site_id " << site_id << ", position " << tables_.sites->position[site_id] << ", parent id " << parent_id << ", derived state length " << derived_state_length << ", metadata length " << metadata_length << std::endl;
 		
 		std::cout << "   derived state: ";
-		for (size_t mutid_index = 0; mutid_index < derived_state_length / sizeof(slim_mutationid_t); ++mutid_index)
-			std::cout << ((slim_mutationid_t *)derived_state)[mutid_index] << " ";
+		for (slim_mutationid_t mutid : derived_state_ids)
+			std::cout << mutid << " ";
 		std::cout << std::endl;
 	}
 }
 
+// Visits the derived alleles carried by extant genomes, in a single left-to-right pass over the trees and the sites in them.
+// p_nodeMap maps node ids to the objects representing extant genomes (Genome or GenomeWalker), with nullptr for other nodes.
+// For each site, p_visit_site(site, genome_alleles) is called with a vector of (object, mutation index) pairs, one for each
+// extant genome that carries a derived allele at the site, where the mutation index is the index into site->mutations of the
+// mutation whose derived state the genome carries; every site is visited, even if no extant genome carries a derived allele
+// there.  Genomes carrying the ancestral state are not included in genome_alleles, so the work done is
+// proportional to the size of the subtrees below the mutations, not to the number of sites times the number of samples, as
+// it would be with a vargen_t.  This relies on the tskit requirement that a mutation's parent precedes it in the mutation table,
+// so that a mutation stacked below another overwrites the state set by the mutation above it.
+template <typename T, typename F>
+static void SLiM_VisitExtantAllelesInTreeSequence(tree_sequence_t *p_ts, std::vector<T *> &p_nodeMap, F p_visit_site)
+{
+	sparse_tree_t tree;
+	int ret = sparse_tree_alloc(&tree, p_ts, 0);
+	if (ret != 0) SLiMSim::handle_error("SLiM_VisitExtantAllelesInTreeSequence sparse_tree_alloc()", ret);
+	
+	// node_state holds, for each node below a mutation at the current site, the index of that mutation, or -1; touched_nodes
+	// records which entries have been set, so that they can be reset after each site without clearing the whole vector
+	std::vector<int32_t> node_state(tree.num_nodes, -1);
+	std::vector<node_id_t> touched_nodes;
+	std::vector<node_id_t> traversal_stack;
+	std::vector<std::pair<T *, table_size_t>> genome_alleles;
+	
+	for (ret = sparse_tree_first(&tree); ret == 1; ret = sparse_tree_next(&tree))
+	{
+		for (table_size_t site_index = 0; site_index < tree.sites_length; ++site_index)
+		{
+			site_t *site = tree.sites + site_index;
+			
+			for (table_size_t mutation_index = 0; mutation_index < site->mutations_length; ++mutation_index)
+			{
+				traversal_stack.push_back(site->mutations[mutation_index].node);
+				
+				while (traversal_stack.size())
+				{
+					node_id_t node = traversal_stack.back();
+					
+					traversal_stack.pop_back();
+					
+					if (p_nodeMap[node])
+					{
+						if (node_state[node] == -1)
+							touched_nodes.push_back(node);
+						node_state[node] = (int32_t)mutation_index;
+					}
+					
+					for (node_id_t child = tree.left_child[node]; child != MSP_NULL_NODE; child = tree.right_sib[child])
+						traversal_stack.push_back(child);
+				}
+			}
+			
+			genome_alleles.clear();
+			
+			for (node_id_t node : touched_nodes)
+			{
+				genome_alleles.emplace_back(p_nodeMap[node], (table_size_t)node_state[node]);
+				node_state[node] = -1;
+			}
+			
+			touched_nodes.clear();
+			
+			p_visit_site(site, genome_alleles);
+		}
+	}
+	if (ret < 0) SLiMSim::handle_error("SLiM_VisitExtantAllelesInTreeSequence sparse_tree_next()", ret);
+	
+	ret = sparse_tree_free(&tree);
+	if (ret != 0) SLiMSim::handle_error("SLiM_VisitExtantAllelesInTreeSequence sparse_tree_free()", ret);
+}
+
 void SLiMSim::CrosscheckTreeSeqIntegrity(void)
 {
 #if DEBUG
@@ -6320,6 +8307,8 @@ void SLiMSim::CrosscheckTreeSeqIntegrity(void)
 		int ret;
 		table_collection_t *tables_copy;
 		
+		FlushEdgeBuffer();
+		
 		tables_copy = (table_collection_t *)malloc(sizeof(table_collection_t));
 		ret = table_collection_alloc(tables_copy, MSP_ALLOC_TABLES);
 		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity table_collection_alloc()", ret);
@@ -6342,8 +8331,7 @@ void SLiMSim::CrosscheckTreeSeqIntegrity(void)
 				for (Genome *genome : iter->second->parent_genomes_)
 					samples.push_back(genome->msp_node_id_);
 			
-			ret = table_collection_sort(tables_copy, /* edge_start */ 0, /* flags */ 0);
-			if (ret < 0) handle_error("table_collection_sort", ret);
+			SortTreeSequenceTables(tables_copy, sorted_edge_count_);
 			
 			ret = table_collection_deduplicate_sites(tables_copy, 0);
 			if (ret < 0) handle_error("deduplicate_sites", ret);
@@ -6354,208 +8342,430 @@ void SLiMSim::CrosscheckTreeSeqIntegrity(void)
 		// must build indexes before compute mutation parents
 		ret = table_collection_build_indexes(tables_copy, 0);
 		if (ret < 0) handle_error("table_collection_build_indexes", ret);
-
+
+		ret = table_collection_compute_mutation_parents(tables_copy, 0);
+		if (ret < 0) handle_error("table_collection_compute_mutation_parents", ret);
+			
+		}
+		
+		// allocate and set up the tree_sequence object that contains all the tree sequences
+		tree_sequence_t *ts;
+		
+		ts = (tree_sequence_t *)malloc(sizeof(tree_sequence_t));
+		ret = tree_sequence_load_tables(ts, tables_copy, MSP_BUILD_INDEXES);
+		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity tree_sequence_load_tables()", ret);
+		
+		// map the nodes of the tree sequence to the walkers for the corresponding genomes; the samples of the simplified
+		// tree sequence are the extant genomes, in the same order as genomes, and all other nodes map to nullptr
+		if (ts->num_samples != genome_count)
+			EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq sample count does not match the genome count." << EidosTerminate();
+		
+		std::vector<GenomeWalker *> node_to_walker(ts->tables->nodes->num_rows, nullptr);
+		size_t nonnull_genome_count = 0;
+		
+		for (size_t genome_index = 0; genome_index < genome_count; genome_index++)
+		{
+			node_to_walker[ts->samples[genome_index]] = &genome_walkers[genome_index];
+			
+			if (!genomes[genome_index]->IsNull())
+				nonnull_genome_count++;
+		}
+		
+		// crosscheck by looping through sites
+		SLiM_VisitExtantAllelesInTreeSequence(ts, node_to_walker, [&](site_t *site, std::vector<std::pair<GenomeWalker *, table_size_t>> &walker_alleles) {
+			// We have a new site; check it against SLiM.  We are given the genomes that carry a derived allele at this site, and
+			// the mutation whose derived state each of them carries.  We will then check that each of those genomes has the allele
+			// the tree sequence attributes to it.  Genomes that carry the ancestral state (no mutations) are not visited; if such
+			// a genome does have a mutation at this site, it will be caught when its walker is found to lag behind at a later site,
+			// or at the end.  The sites are visited in sorted order by position, so we can keep pointers into every extant genome's
+			// mutruns, advance those pointers a step at a time, and check that everything matches at every step.  This visits only
+			// the subtrees below mutations, rather than every genome at every site as a vargen_t would, which makes crosschecks
+			// affordable in large models.  Keep in mind that some mutations may have been fixed (substituted) or lost.
+			slim_position_t variant_pos_int = (slim_position_t)site->position;		// should be no loss of precision, fingers crossed
+			
+			// Get all the substitutions involved at this site, which should be present in every sample
+			auto substitution_range_iter = population_.treeseq_substitutions_map_.equal_range(variant_pos_int);
+			static std::vector<slim_mutationid_t> fixed_mutids;
+			
+			fixed_mutids.clear();
+			for (auto substitution_iter = substitution_range_iter.first; substitution_iter != substitution_range_iter.second; ++substitution_iter)
+				fixed_mutids.push_back(substitution_iter->second->mutation_id_);
+			
+			// If there are fixed mutations here, every non-null genome must carry a derived allele; null genomes never do
+			if (fixed_mutids.size())
+			{
+				size_t visited_nonnull_count = 0;
+				
+				for (auto &walker_allele : walker_alleles)
+					if (!walker_allele.first->WalkerGenome()->IsNull())
+						visited_nonnull_count++;
+				
+				if (visited_nonnull_count != nonnull_genome_count)
+					EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has 0 mutations at position " << variant_pos_int << ", SLiM has " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+			}
+			
+			// Check the visited genomes against the tree sequence's belief about this site
+			for (auto &walker_allele : walker_alleles)
+			{
+				GenomeWalker &genome_walker = *walker_allele.first;
+				mutation_t &mutation = site->mutations[walker_allele.second];
+				static std::vector<slim_mutationid_t> genome_allele_ids;
+				
+				SLiM_DecodeDerivedState(mutation.derived_state, mutation.derived_state_length, genome_allele_ids);
+				table_size_t genome_allele_length = (table_size_t)genome_allele_ids.size();
+				
+				// BCH 4/29/2018: null genomes shouldn't ever contain any mutations, including fixed mutations
+				if (genome_walker.WalkerGenome()->IsNull())
+				{
+					if (genome_allele_length == 0)
+						continue;
+					
+					EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) null genome has non-zero treeseq allele length " << genome_allele_length << "." << EidosTerminate();
+				}
+				
+				// (1) if the variant's allele is zero-length, we do nothing (if it incorrectly claims that a genome contains no
+				// mutation, we'll catch that later)  (2) if the variant's allele is the length of one mutation id, we can simply
+				// check that the next mutation in the genome in question exists and has the right mutation id; (3) if the variant's
+				// allele has more than one mutation id, we have to check them all against all the mutations at the given position
+				// in the genome in question, which is a bit annoying since the lists may not be in the same order.  Note that if
+				// the variant is for a mutation that has fixed, it will not be present in the genome; we check for a substitution
+				// with the right ID.
+				slim_mutationid_t *genome_allele = genome_allele_ids.data();
+				
+				if (genome_allele_length == 0)
+				{
+					// If there are no fixed mutations at this site, we can continue; genomes that have a mutation at this site will
+					// raise later when they realize they have been skipped over, so we don't have to check for that now...
+					if (fixed_mutids.size() == 0)
+						continue;
+					
+					EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has 0 mutations at position " << variant_pos_int << ", SLiM has " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+				}
+				else if (genome_allele_length == 1)
+				{
+					// The tree has just one mutation at this site; this is the common case, so we try to handle it quickly
+					slim_mutationid_t allele_mutid = *genome_allele;
+					Mutation *current_mut = genome_walker.CurrentMutation();
+					
+					if (current_mut)
+					{
+						slim_position_t current_mut_pos = current_mut->position_;
+						
+						if (current_mut_pos < variant_pos_int)
+							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome mutation was not represented in trees (single case)." << EidosTerminate();
+						if (current_mut->position_ > variant_pos_int)
+							current_mut = nullptr;	// not a candidate for this position, we'll see it again later
+					}
+					
+					if (!current_mut && (fixed_mutids.size() == 1))
+					{
+						// We have one fixed mutation and no segregating mutation, versus one mutation in the tree; crosscheck
+						if (allele_mutid != fixed_mutids[0])
+							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has mutid " << allele_mutid << " at position " << variant_pos_int << ", SLiM has a fixed mutation of id " << fixed_mutids[0] << EidosTerminate();
+						
+						continue;	// the match was against a fixed mutation, so don't go to the next mutation
+					}
+					else if (current_mut && (fixed_mutids.size() == 0))
+					{
+						// We have one segregating mutation and no fixed mutation, versus one mutation in the tree; crosscheck
+						if (allele_mutid != current_mut->mutation_id_)
+							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has mutid " << allele_mutid << " at position " << variant_pos_int << ", SLiM has a segregating mutation of id " << current_mut->mutation_id_ << EidosTerminate();
+					}
+					else
+					{
+						// We have a count mismatch; there is one mutation in the tree, but we have !=1 in SLiM including substitutions
+						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele size mismatch at position " << variant_pos_int << ": the treeseq has 1 mutation of mutid " << allele_mutid << ", SLiM has " << (current_mut ? 1 : 0) << " segregating and " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+					}
+					
+					genome_walker.NextMutation();
+					
+					// Check the next mutation to see if it's at this position as well, and is missing from the tree;
+					// this would get caught downstream, but for debugging it is clearer to catch it here
+					Mutation *next_mut = genome_walker.CurrentMutation();
+					
+					if (next_mut && next_mut->position_ == variant_pos_int)
+						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq is missing a stacked mutation with mutid " << next_mut->mutation_id_ << " at position " << variant_pos_int << "." << EidosTerminate();
+				}
+				else // (genome_allele_length > 1)
+				{
+					static std::vector<slim_mutationid_t> allele_mutids;
+					static std::vector<slim_mutationid_t> genome_mutids;
+					allele_mutids.clear();
+					genome_mutids.clear();
+					
+					// tabulate all tree mutations
+					for (table_size_t mutid_index = 0; mutid_index < genome_allele_length; ++mutid_index)
+						allele_mutids.push_back(genome_allele[mutid_index]);
+					
+					// tabulate segregating SLiM mutations
+					while (true)
+					{
+						Mutation *current_mut = genome_walker.CurrentMutation();
+						
+						if (current_mut)
+						{
+							slim_position_t current_mut_pos = current_mut->position_;
+							
+							if (current_mut_pos < variant_pos_int)
+								EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome mutation was not represented in trees (bulk case)." << EidosTerminate();
+							else if (current_mut_pos == variant_pos_int)
+							{
+								genome_mutids.push_back(current_mut->mutation_id_);
+								genome_walker.NextMutation();
+							}
+							else break;
+						}
+						else break;
+					}
+					
+					// tabulate fixed SLiM mutations
+					genome_mutids.insert(genome_mutids.end(), fixed_mutids.begin(), fixed_mutids.end());
+					
+					// crosscheck, sorting so there is no order-dependency
+					if (allele_mutids.size() != genome_mutids.size())
+						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele size mismatch at position " << variant_pos_int << ": the treeseq has " << allele_mutids.size() << " mutations, SLiM has " << (genome_mutids.size() - fixed_mutids.size()) << " segregating and " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+					
+					std::sort(allele_mutids.begin(), allele_mutids.end());
+					std::sort(genome_mutids.begin(), genome_mutids.end());
+					
+					for (table_size_t mutid_index = 0; mutid_index < genome_allele_length; ++mutid_index)
+						if (allele_mutids[mutid_index] != genome_mutids[mutid_index])
+							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele bulk mutid mismatch." << EidosTerminate();
+				}
+			}
+		});
+		
+		// we have finished all sites, so all the genomes we're tracking should be at their ends; any left-over mutations
+		// should have been in the trees but weren't, so this is an error
+		for (size_t genome_index = 0; genome_index < genome_count; genome_index++)
+			if (!genome_walkers[genome_index].Finished())
+				EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) mutations left in genome beyond those in tree." << EidosTerminate();
+		
+		// free
+		ret = tree_sequence_free(ts);
+		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity tree_sequence_free()", ret);
+		free(ts);
+		
+		ret = table_collection_free(tables_copy);
+		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity table_collection_free()", ret);
+		free(tables_copy);
+	}
+}
+
+void SLiMSim::TreeSequenceStatistics(std::vector<Subpopulation *> &p_subpops, bool p_branch_mode, size_t *p_sample_count, double *p_diversity, double *p_segregating, std::vector<double> *p_afs)
+{
+#if DEBUG
+	if (!recording_tree_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::TreeSequenceStatistics): (internal error) tree sequence recording method called with recording off." << EidosTerminate();
+#endif
+	
+	// This computes summary statistics for the non-null genomes of the given subpopulations directly from the recorded tables,
+	// so that models do not need to write out a .trees file and post-process it just to get diversity or the AFS.  Alleles are
+	// defined by derived states, as in tskit, so a stacked mutation is an allele distinct from the mutation beneath it.  In site
+	// mode each site contributes its alleles; in branch mode each branch contributes its length times the span of its tree, so
+	// that a site statistic is expected to be the mutation rate times the corresponding branch statistic.  The diversity and
+	// segregating-site values returned are totals over the chromosome; the AFS is polarized, indexed by derived allele count.
+	std::vector<node_id_t> samples;
+	
+	for (Subpopulation *subpop : p_subpops)
+		for (Genome *genome : subpop->parent_genomes_)
+			if (!genome->IsNull())
+				samples.push_back(genome->msp_node_id_);
+	
+	size_t sample_count = samples.size();
+	double diversity = 0.0, segregating = 0.0;
+	std::vector<double> afs(sample_count + 1, 0.0);
+	
+	if (sample_count)
+	{
+		// make a copy of the full table collection and simplify it down to our samples; this is the same preparation done by
+		// CrosscheckTreeSeqIntegrity(), except that the samples are the requested genomes; the live tables are not modified
+		int ret;
+		table_collection_t *tables_copy;
+		
+		FlushEdgeBuffer();
+		
+		tables_copy = (table_collection_t *)malloc(sizeof(table_collection_t));
+		ret = table_collection_alloc(tables_copy, MSP_ALLOC_TABLES);
+		if (ret != 0) handle_error("TreeSequenceStatistics table_collection_alloc()", ret);
+		
+		ret = table_collection_copy(&tables_, tables_copy);
+		if (ret != 0) handle_error("TreeSequenceStatistics table_collection_copy()", ret);
+		
+		WritePopulationTable(tables_copy);
+		SortTreeSequenceTables(tables_copy, sorted_edge_count_);
+		
+		ret = table_collection_deduplicate_sites(tables_copy, 0);
+		if (ret < 0) handle_error("deduplicate_sites", ret);
+		
+		ret = table_collection_simplify(tables_copy, samples.data(), samples.size(), MSP_FILTER_SITES | MSP_FILTER_INDIVIDUALS, NULL);
+		if (ret != 0) handle_error("simplifier_run", ret);
+		
+		// must build indexes before compute mutation parents; we need the mutation parents to know which samples carry each allele
+		ret = table_collection_build_indexes(tables_copy, 0);
+		if (ret < 0) handle_error("table_collection_build_indexes", ret);
+		
 		ret = table_collection_compute_mutation_parents(tables_copy, 0);
 		if (ret < 0) handle_error("table_collection_compute_mutation_parents", ret);
-			
-		}
 		
-		// allocate and set up the tree_sequence object that contains all the tree sequences
 		tree_sequence_t *ts;
 		
 		ts = (tree_sequence_t *)malloc(sizeof(tree_sequence_t));
 		ret = tree_sequence_load_tables(ts, tables_copy, MSP_BUILD_INDEXES);
-		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity tree_sequence_load_tables()", ret);
+		if (ret != 0) handle_error("TreeSequenceStatistics tree_sequence_load_tables()", ret);
 		
-		// allocate and set up the vargen object we'll use to walk through variants
-		vargen_t *vg;
+		// walk the trees, with sample counts maintained for us by the tree iterator
+		double n = (double)sample_count;
+		double pair_weight = (sample_count > 1) ? 1.0 / (n * (n - 1.0)) : 0.0;
+		double *node_times = ts->tables->nodes->time;
+		sparse_tree_t tree;
 		
-		vg = (vargen_t *)malloc(sizeof(vargen_t));
-		ret = vargen_alloc(vg, ts, ts->samples, ts->num_samples, MSP_16_BIT_GENOTYPES);
-		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity vargen_alloc()", ret);
+		ret = sparse_tree_alloc(&tree, ts, MSP_SAMPLE_COUNTS);
+		if (ret != 0) handle_error("TreeSequenceStatistics sparse_tree_alloc()", ret);
 		
-		// crosscheck by looping through variants
-		do
+		std::vector<node_id_t> stack;
+		std::vector<double> allele_counts;
+		std::vector<std::pair<const char *, table_size_t>> allele_states;
+		
+		for (ret = sparse_tree_first(&tree); ret == 1; ret = sparse_tree_next(&tree))
 		{
-			variant_t *variant;
-			
-			ret = vargen_next(vg, &variant);
-			if (ret < 0) handle_error("CrosscheckTreeSeqIntegrity vargen_next()", ret);
-			
-			if (ret == 1)
+			if (p_branch_mode)
 			{
-				// We have a new variant; check it against SLiM.  A variant represents a site at which a tracked mutation exists.
-				// The variant_t will tell us all the allelic states involved at that site, what the alleles are, and which genomes
-				// in the sample are using them.  We will then check that all the genomes that the variant claims to involve have
-				// the allele the variant attributes to them, and that no genomes contain any alleles at the position that are not
-				// described by the variant.  The variants are returned in sorted order by position, so we can keep pointers into
-				// every extant genome's mutruns, advance those pointers a step at a time, and check that everything matches at every
-				// step.  Keep in mind that some mutations may have been fixed (substituted) or lost.
-				slim_position_t variant_pos_int = (slim_position_t)variant->site->position;		// should be no loss of precision, fingers crossed
-				
-				// Get all the substitutions involved at this site, which should be present in every sample
-				auto substitution_range_iter = population_.treeseq_substitutions_map_.equal_range(variant_pos_int);
-				static std::vector<slim_mutationid_t> fixed_mutids;
+				// every branch subtending k samples splits the samples k : n - k, over an area of its length times the tree span
+				double span = tree.right - tree.left;
 				
-				fixed_mutids.clear();
-				for (auto substitution_iter = substitution_range_iter.first; substitution_iter != substitution_range_iter.second; ++substitution_iter)
-					fixed_mutids.push_back(substitution_iter->second->mutation_id_);
-				
-				// Check all the genomes against the vargen_t's belief about this site
-				for (size_t genome_index = 0; genome_index < genome_count; genome_index++)
+				for (node_id_t root = tree.left_root; root != MSP_NULL_NODE; root = tree.right_sib[root])
+				{
+					stack.push_back(root);
+					
+					while (stack.size())
+					{
+						node_id_t u = stack.back();
+						node_id_t parent = tree.parent[u];
+						
+						stack.pop_back();
+						
+						for (node_id_t child = tree.left_child[u]; child != MSP_NULL_NODE; child = tree.right_sib[child])
+							stack.push_back(child);
+						
+						if (parent != MSP_NULL_NODE)
+						{
+							double k = tree.num_samples[u];
+							double area = span * (node_times[parent] - node_times[u]);
+							
+							afs[(size_t)k] += area;
+							
+							if ((k > 0) && (k < n))
+							{
+								diversity += 2.0 * k * (n - k) * pair_weight * area;
+								segregating += area;
+							}
+						}
+					}
+				}
+			}
+			else
+			{
+				for (table_size_t site_index = 0; site_index < tree.sites_length; ++site_index)
 				{
-					GenomeWalker &genome_walker = genome_walkers[genome_index];
-					uint16_t genome_variant = variant->genotypes.u16[genome_index];
-					table_size_t genome_allele_length = variant->allele_lengths[genome_variant];
+					site_t &site = tree.sites[site_index];
+					mutation_t *mutations = site.mutations;
+					table_size_t mutations_length = site.mutations_length;
 					
-					if (genome_allele_length % sizeof(slim_mutationid_t) != 0)
-						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) variant allele had length that was not a multiple of sizeof(slim_mutationid_t)." << EidosTerminate();
-					genome_allele_length /= sizeof(slim_mutationid_t);
+					if (mutations_length == 0)
+						continue;
 					
-					//std::cout << "variant for genome: " << (int)genome_variant << " (allele length == " << genome_allele_length << ")" << std::endl;
+					// each mutation's state is carried by the samples below it, except those below a later mutation at this site
+					allele_counts.resize(mutations_length);
 					
-					// BCH 4/29/2018: null genomes shouldn't ever contain any mutations, including fixed mutations
-					if (genome_walker.WalkerGenome()->IsNull())
+					for (table_size_t mut_index = 0; mut_index < mutations_length; ++mut_index)
+						allele_counts[mut_index] = tree.num_samples[mutations[mut_index].node];
+					
+					for (table_size_t mut_index = 0; mut_index < mutations_length; ++mut_index)
 					{
-						if (genome_allele_length == 0)
-							continue;
+						mutation_id_t parent = mutations[mut_index].parent;
 						
-						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) null genome has non-zero treeseq allele length " << genome_allele_length << "." << EidosTerminate();
+						if (parent != MSP_NULL_MUTATION)
+							allele_counts[parent - mutations[0].id] -= tree.num_samples[mutations[mut_index].node];
 					}
 					
-					// (1) if the variant's allele is zero-length, we do nothing (if it incorrectly claims that a genome contains no
-					// mutation, we'll catch that later)  (2) if the variant's allele is the length of one mutation id, we can simply
-					// check that the next mutation in the genome in question exists and has the right mutation id; (3) if the variant's
-					// allele has more than one mutation id, we have to check them all against all the mutations at the given position
-					// in the genome in question, which is a bit annoying since the lists may not be in the same order.  Note that if
-					// the variant is for a mutation that has fixed, it will not be present in the genome; we check for a substitution
-					// with the right ID.
-					slim_mutationid_t *genome_allele = (slim_mutationid_t *)variant->alleles[genome_variant];
+					// merge mutations that share a derived state into one allele; a state matching the ancestral state is not
+					// derived, and the ancestral allele is carried by whatever samples are not carrying a derived allele
+					allele_states.clear();
 					
-					if (genome_allele_length == 0)
+					double ancestral_count = n;
+					size_t allele_count = 0;
+					
+					for (table_size_t mut_index = 0; mut_index < mutations_length; ++mut_index)
 					{
-						// If there are no fixed mutations at this site, we can continue; genomes that have a mutation at this site will
-						// raise later when they realize they have been skipped over, so we don't have to check for that now...
-						if (fixed_mutids.size() == 0)
+						mutation_t &mutation = mutations[mut_index];
+						
+						if ((mutation.derived_state_length == site.ancestral_state_length) && (memcmp(mutation.derived_state, site.ancestral_state, site.ancestral_state_length) == 0))
 							continue;
 						
-						EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has 0 mutations at position " << variant_pos_int << ", SLiM has " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
-					}
-					else if (genome_allele_length == 1)
-					{
-						// The tree has just one mutation at this site; this is the common case, so we try to handle it quickly
-						slim_mutationid_t allele_mutid = *genome_allele;
-						Mutation *current_mut = genome_walker.CurrentMutation();
+						double count = allele_counts[mut_index];
+						size_t state_index;
 						
-						if (current_mut)
-						{
-							slim_position_t current_mut_pos = current_mut->position_;
-							
-							if (current_mut_pos < variant_pos_int)
-								EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome mutation was not represented in trees (single case)." << EidosTerminate();
-							if (current_mut->position_ > variant_pos_int)
-								current_mut = nullptr;	// not a candidate for this position, we'll see it again later
-						}
+						ancestral_count -= count;
 						
-						if (!current_mut && (fixed_mutids.size() == 1))
-						{
-							// We have one fixed mutation and no segregating mutation, versus one mutation in the tree; crosscheck
-							if (allele_mutid != fixed_mutids[0])
-								EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has mutid " << allele_mutid << " at position " << variant_pos_int << ", SLiM has a fixed mutation of id " << fixed_mutids[0] << EidosTerminate();
-							
-							continue;	// the match was against a fixed mutation, so don't go to the next mutation
-						}
-						else if (current_mut && (fixed_mutids.size() == 0))
+						for (state_index = 0; state_index < allele_count; ++state_index)
+							if ((allele_states[state_index].second == mutation.derived_state_length) && (memcmp(allele_states[state_index].first, mutation.derived_state, mutation.derived_state_length) == 0))
+								break;
+						
+						if (state_index == allele_count)
 						{
-							// We have one segregating mutation and no fixed mutation, versus one mutation in the tree; crosscheck
-							if (allele_mutid != current_mut->mutation_id_)
-								EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq has mutid " << allele_mutid << " at position " << variant_pos_int << ", SLiM has a segregating mutation of id " << current_mut->mutation_id_ << EidosTerminate();
+							allele_states.emplace_back(mutation.derived_state, mutation.derived_state_length);
+							allele_counts[allele_count++] = count;		// safe, since allele_count <= mut_index here
 						}
 						else
 						{
-							// We have a count mismatch; there is one mutation in the tree, but we have !=1 in SLiM including substitutions
-							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele size mismatch at position " << variant_pos_int << ": the treeseq has 1 mutation of mutid " << allele_mutid << ", SLiM has " << (current_mut ? 1 : 0) << " segregating and " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+							allele_counts[state_index] += count;
 						}
-						
-						genome_walker.NextMutation();
-						
-						// Check the next mutation to see if it's at this position as well, and is missing from the tree;
-						// this would get caught downstream, but for debugging it is clearer to catch it here
-						Mutation *next_mut = genome_walker.CurrentMutation();
-						
-						if (next_mut && next_mut->position_ == variant_pos_int)
-							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) the treeseq is missing a stacked mutation with mutid " << next_mut->mutation_id_ << " at position " << variant_pos_int << "." << EidosTerminate();
 					}
-					else // (genome_allele_length > 1)
+					
+					size_t alleles_present = (ancestral_count > 0) ? 1 : 0;
+					
+					diversity += ancestral_count * (n - ancestral_count) * pair_weight;
+					
+					for (size_t state_index = 0; state_index < allele_count; ++state_index)
 					{
-						static std::vector<slim_mutationid_t> allele_mutids;
-						static std::vector<slim_mutationid_t> genome_mutids;
-						allele_mutids.clear();
-						genome_mutids.clear();
-						
-						// tabulate all tree mutations
-						for (table_size_t mutid_index = 0; mutid_index < genome_allele_length; ++mutid_index)
-							allele_mutids.push_back(genome_allele[mutid_index]);
-						
-						// tabulate segregating SLiM mutations
-						while (true)
-						{
-							Mutation *current_mut = genome_walker.CurrentMutation();
-							
-							if (current_mut)
-							{
-								slim_position_t current_mut_pos = current_mut->position_;
-								
-								if (current_mut_pos < variant_pos_int)
-									EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome mutation was not represented in trees (bulk case)." << EidosTerminate();
-								else if (current_mut_pos == variant_pos_int)
-								{
-									genome_mutids.push_back(current_mut->mutation_id_);
-									genome_walker.NextMutation();
-								}
-								else break;
-							}
-							else break;
-						}
-						
-						// tabulate fixed SLiM mutations
-						genome_mutids.insert(genome_mutids.end(), fixed_mutids.begin(), fixed_mutids.end());
+						double k = allele_counts[state_index];
 						
-						// crosscheck, sorting so there is no order-dependency
-						if (allele_mutids.size() != genome_mutids.size())
-							EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele size mismatch at position " << variant_pos_int << ": the treeseq has " << allele_mutids.size() << " mutations, SLiM has " << (genome_mutids.size() - fixed_mutids.size()) << " segregating and " << fixed_mutids.size() << " fixed mutation(s)." << EidosTerminate();
+						afs[(size_t)k] += 1.0;
+						diversity += k * (n - k) * pair_weight;
 						
-						std::sort(allele_mutids.begin(), allele_mutids.end());
-						std::sort(genome_mutids.begin(), genome_mutids.end());
-						
-						for (table_size_t mutid_index = 0; mutid_index < genome_allele_length; ++mutid_index)
-							if (allele_mutids[mutid_index] != genome_mutids[mutid_index])
-								EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) genome/allele bulk mutid mismatch." << EidosTerminate();
+						if (k > 0)
+							alleles_present++;
 					}
+					
+					if (alleles_present > 1)
+						segregating += alleles_present - 1;
 				}
 			}
 		}
-		while (ret != 0);
-		
-		// we have finished all variants, so all the genomes we're tracking should be at their ends; any left-over mutations
-		// should have been in the trees but weren't, so this is an error
-		for (size_t genome_index = 0; genome_index < genome_count; genome_index++)
-			if (!genome_walkers[genome_index].Finished())
-				EIDOS_TERMINATION << "ERROR (SLiMSim::CrosscheckTreeSeqIntegrity): (internal error) mutations left in genome beyond those in tree." << EidosTerminate();
+		if (ret < 0) handle_error("TreeSequenceStatistics sparse_tree_next()", ret);
 		
 		// free
-		ret = vargen_free(vg);
-		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity vargen_free()", ret);
-		free(vg);
+		ret = sparse_tree_free(&tree);
+		if (ret != 0) handle_error("TreeSequenceStatistics sparse_tree_free()", ret);
 		
 		ret = tree_sequence_free(ts);
-		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity tree_sequence_free()", ret);
+		if (ret != 0) handle_error("TreeSequenceStatistics tree_sequence_free()", ret);
 		free(ts);
 		
 		ret = table_collection_free(tables_copy);
-		if (ret != 0) handle_error("CrosscheckTreeSeqIntegrity table_collection_free()", ret);
+		if (ret != 0) handle_error("TreeSequenceStatistics table_collection_free()", ret);
 		free(tables_copy);
 	}
+	
+	if (p_sample_count)
+		*p_sample_count = sample_count;
+	if (p_diversity)
+		*p_diversity = diversity;
+	if (p_segregating)
+		*p_segregating = segregating;
+	if (p_afs)
+		p_afs->swap(afs);
 }
 
 void SLiMSim::TSXC_Enable(void)
@@ -6736,11 +8946,11 @@ void SLiMSim::__TabulateSubpopulationsFromTreeSequence(std::unordered_map<slim_o
 	}
 }
 
-void SLiMSim::__CreateSubpopulationsFromTabulation(std::unordered_map<slim_objectid_t, ts_subpop_info> &p_subpopInfoMap, EidosInterpreter *p_interpreter, std::unordered_map<node_id_t, Genome *> &p_nodeToGenomeMap)
+void SLiMSim::__CreateSubpopulationsFromTabulation(std::unordered_map<slim_objectid_t, ts_subpop_info> &p_subpopInfoMap, EidosInterpreter *p_interpreter, std::vector<Genome *> &p_nodeToGenomeMap)
 {
 	gSLiM_next_pedigree_id = 0;
 	
-	for (auto subpop_info_iter : p_subpopInfoMap)
+	for (auto &subpop_info_iter : p_subpopInfoMap)
 	{
 		slim_objectid_t subpop_id = subpop_info_iter.first;
 		ts_subpop_info &subpop_info = subpop_info_iter.second;
@@ -6797,8 +9007,8 @@ void SLiMSim::__CreateSubpopulationsFromTabulation(std::unordered_map<slim_objec
 				individual->genome1_->msp_node_id_ = node_id_0;
 				individual->genome2_->msp_node_id_ = node_id_1;
 				
-				p_nodeToGenomeMap.insert(std::pair<node_id_t, Genome *>(node_id_0, individual->genome1_));
-				p_nodeToGenomeMap.insert(std::pair<node_id_t, Genome *>(node_id_1, individual->genome2_));
+				p_nodeToGenomeMap[node_id_0] = individual->genome1_;
+				p_nodeToGenomeMap[node_id_1] = individual->genome2_;
 				
 				slim_pedigreeid_t pedigree_id = subpop_info.pedigreeID_[tabulation_index];
 				individual->SetPedigreeID(pedigree_id);
@@ -6963,12 +9173,27 @@ void SLiMSim::__ConfigureSubpopulationsFromTables(EidosInterpreter *p_interprete
 }
 
 typedef struct ts_mut_info {
+	slim_mutationid_t mutation_id;
 	slim_position_t position;
 	MutationMetadataRec *metadata;
 	slim_refcount_t ref_count;
+	MutationIndex mut_index;		// the instantiated mutation, or -1 if it became a substitution
 } ts_mut_info;
 
-void SLiMSim::__TabulateMutationsFromTables(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutMap)
+// The tabulation of mutations is kept in a vector sorted by mutation id, rather than in a hash table; mutation ids are sparse,
+// so they cannot index a vector directly, but a binary search over a flat sorted vector is cheaper than hashing, and the
+// per-variant lookups below resolve each allele only once in any case.  Returns nullptr if the id was not tabulated.
+static inline ts_mut_info *SLiM_FindTabulatedMutation(std::vector<ts_mut_info> &p_mutInfo, slim_mutationid_t p_mut_id)
+{
+	auto mut_info_iter = std::lower_bound(p_mutInfo.begin(), p_mutInfo.end(), p_mut_id, [](const ts_mut_info &info, slim_mutationid_t mut_id) { return info.mutation_id < mut_id; });
+	
+	if ((mut_info_iter == p_mutInfo.end()) || (mut_info_iter->mutation_id != p_mut_id))
+		return nullptr;
+	
+	return &(*mut_info_iter);
+}
+
+void SLiMSim::__TabulateMutationsFromTables(std::vector<ts_mut_info> &p_mutInfo)
 {
 	mutation_table_t &mut_table = *tables_.mutations;
 	table_size_t mut_count = mut_table.num_rows;
@@ -6983,15 +9208,16 @@ void SLiMSim::__TabulateMutationsFromTables(std::unordered_map<slim_mutationid_t
 		const char *metadata_bytes = mut_table.metadata + mut_table.metadata_offset[mut_index];
 		table_size_t metadata_length = mut_table.metadata_offset[mut_index + 1] - mut_table.metadata_offset[mut_index];
 		
-		if (derived_state_length % sizeof(slim_mutationid_t) != 0)
-			EIDOS_TERMINATION << "ERROR (SLiMSim::__TabulateMutationsFromTables): unexpected mutation derived state length; this file cannot be read." << EidosTerminate();
+		static std::vector<slim_mutationid_t> derived_state_vec;
+		
+		SLiM_DecodeDerivedState(derived_state_bytes, derived_state_length, derived_state_vec);
+		
 		if (metadata_length % sizeof(MutationMetadataRec) != 0)
 			EIDOS_TERMINATION << "ERROR (SLiMSim::__TabulateMutationsFromTables): unexpected mutation metadata length; this file cannot be read." << EidosTerminate();
-		if (derived_state_length / sizeof(slim_mutationid_t) != metadata_length / sizeof(MutationMetadataRec))
+		if (derived_state_vec.size() != metadata_length / sizeof(MutationMetadataRec))
 			EIDOS_TERMINATION << "ERROR (SLiMSim::__TabulateMutationsFromTables): (internal error) mutation metadata length does not match derived state length." << EidosTerminate();
 		
-		int stack_count = derived_state_length / sizeof(slim_mutationid_t);
-		slim_mutationid_t *derived_state_vec = (slim_mutationid_t *)derived_state_bytes;
+		int stack_count = (int)derived_state_vec.size();
 		MutationMetadataRec *metadata_vec = (MutationMetadataRec *)metadata_bytes;
 		site_id_t site_id = mut_table.site[mut_index];
 		double position_double = tables_.sites->position[site_id];
@@ -7002,107 +9228,67 @@ void SLiMSim::__TabulateMutationsFromTables(std::unordered_map<slim_mutationid_t
 		
 		slim_position_t position = (slim_position_t)position_double_round;
 		
-		// tabulate the mutations referenced by this entry, overwriting previous tabulations (last state wins)
+		// tabulate the mutations referenced by this entry, in table order; duplicates are resolved below
 		for (int stack_index = 0; stack_index < stack_count; ++stack_index)
-		{
-			slim_mutationid_t mut_id = derived_state_vec[stack_index];
-			MutationMetadataRec *metadata = metadata_vec + stack_index;
-			auto mut_info_insert = p_mutMap.insert(std::pair<slim_mutationid_t, ts_mut_info>(mut_id, ts_mut_info()));
-			ts_mut_info &mut_info = (mut_info_insert.first)->second;
-			
-			mut_info.position = position;
-			mut_info.metadata = metadata;
-		}
+			p_mutInfo.emplace_back(ts_mut_info{derived_state_vec[stack_index], position, metadata_vec + stack_index, 0, -1});
 	}
-}
-
-void SLiMSim::__TallyMutationReferencesWithTreeSequence(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutMap, std::unordered_map<node_id_t, Genome *> p_nodeToGenomeMap, tree_sequence_t *p_ts)
-{
-	// allocate and set up the vargen object we'll use to walk through variants
-	vargen_t *vg;
 	
-	vg = (vargen_t *)malloc(sizeof(vargen_t));
-	int ret = vargen_alloc(vg, p_ts, p_ts->samples, p_ts->num_samples, MSP_16_BIT_GENOTYPES);
-	if (ret != 0) handle_error("__TallyMutationReferencesWithTreeSequence vargen_alloc()", ret);
+	// sort by mutation id and keep only the last tabulation of each id (last state wins); the sort is stable, so within
+	// a run of equal ids the entries are still in table order, and the last entry of each run is the one we want
+	std::stable_sort(p_mutInfo.begin(), p_mutInfo.end(), [](const ts_mut_info &info1, const ts_mut_info &info2) { return info1.mutation_id < info2.mutation_id; });
 	
-	// set up a map from sample indices in the vargen to Genome objects; the sample
-	// may contain nodes that are ancestral and need to be excluded
-	std::vector<Genome *> indexToGenomeMap;
-	size_t sample_count = vg->num_samples;
+	size_t tabulated_count = p_mutInfo.size();
+	size_t kept_count = 0;
 	
-	for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+	for (size_t tabulated_index = 0; tabulated_index < tabulated_count; ++tabulated_index)
 	{
-		node_id_t sample_node_id = vg->samples[sample_index];
-		auto sample_nodeToGenome_iter = p_nodeToGenomeMap.find(sample_node_id);
+		if ((tabulated_index + 1 < tabulated_count) && (p_mutInfo[tabulated_index + 1].mutation_id == p_mutInfo[tabulated_index].mutation_id))
+			continue;
 		
-		if (sample_nodeToGenome_iter != p_nodeToGenomeMap.end())
-			indexToGenomeMap.push_back(sample_nodeToGenome_iter->second);
-		else
-			indexToGenomeMap.push_back(nullptr);	// this sample is not extant; no corresponding genome
+		p_mutInfo[kept_count++] = p_mutInfo[tabulated_index];
 	}
 	
-	// add mutations to genomes by looping through variants
-	do
-	{
-		variant_t *variant;
+	p_mutInfo.resize(kept_count);
+}
+
+void SLiMSim::__TallyMutationReferencesWithTreeSequence(std::vector<ts_mut_info> &p_mutInfo, std::vector<Genome *> &p_nodeToGenomeMap, tree_sequence_t *p_ts)
+{
+	// We want to find any mutations that are shared across all non-null genomes, so we count the number of extant genomes
+	// that reference each mutation at each site, and then add that count to every mutation id in the mutation's derived state.
+	std::vector<int32_t> allele_refs;
+	
+	SLiM_VisitExtantAllelesInTreeSequence(p_ts, p_nodeToGenomeMap, [&p_mutInfo, &allele_refs](site_t *site, std::vector<std::pair<Genome *, table_size_t>> &genome_alleles) {
+		allele_refs.assign(site->mutations_length, 0);
 		
-		ret = vargen_next(vg, &variant);
-		if (ret < 0) handle_error("__TallyMutationReferencesWithTreeSequence vargen_next()", ret);
+		for (auto &genome_allele : genome_alleles)
+			allele_refs[genome_allele.second]++;
 		
-		if (ret == 1)
+		for (table_size_t mutation_index = 0; mutation_index < site->mutations_length; ++mutation_index)
 		{
-			// We have a new variant; set it into SLiM.  A variant represents a site at which a tracked mutation exists.
-			// The variant_t will tell us all the allelic states involved at that site, what the alleles are, and which genomes
-			// in the sample are using them.  We want to find any mutations that are shared across all non-null genomes.
-			for (table_size_t allele_index = 0; allele_index < variant->num_alleles; ++allele_index)
+			mutation_t &mutation = site->mutations[mutation_index];
+			
+			if ((mutation.derived_state_length > 0) && allele_refs[mutation_index])
 			{
-				table_size_t allele_length = variant->allele_lengths[allele_index];
+				static std::vector<slim_mutationid_t> allele;
+				
+				SLiM_DecodeDerivedState(mutation.derived_state, mutation.derived_state_length, allele);
 				
-				if (allele_length > 0)
+				for (slim_mutationid_t mut_id : allele)
 				{
-					// Calculate the number of extant genomes that reference this allele
-					int32_t allele_refs = 0;
+					ts_mut_info *mut_info = SLiM_FindTabulatedMutation(p_mutInfo, mut_id);
 					
-					for (size_t sample_index = 0; sample_index < sample_count; sample_index++)
-						if ((variant->genotypes.u16[sample_index] == allele_index) && (indexToGenomeMap[sample_index] != nullptr))
-							allele_refs++;
+					if (!mut_info)
+						EIDOS_TERMINATION << "ERROR (SLiMSim::__TallyMutationReferencesWithTreeSequence): mutation id " << mut_id << " was referenced but does not exist." << EidosTerminate();
 					
-					// If that count is greater than zero (might be zero if only non-extant nodes reference the allele), tally it
-					if (allele_refs)
-					{
-						if (allele_length % sizeof(slim_mutationid_t) != 0)
-							EIDOS_TERMINATION << "ERROR (SLiMSim::__TallyMutationReferencesWithTreeSequence): (internal error) variant allele had length that was not a multiple of sizeof(slim_mutationid_t)." << EidosTerminate();
-						allele_length /= sizeof(slim_mutationid_t);
-						
-						slim_mutationid_t *allele = (slim_mutationid_t *)variant->alleles[allele_index];
-						
-						for (table_size_t mutid_index = 0; mutid_index < allele_length; ++mutid_index)
-						{
-							slim_mutationid_t mut_id = allele[mutid_index];
-							auto mut_info_iter = p_mutMap.find(mut_id);
-							
-							if (mut_info_iter == p_mutMap.end())
-								EIDOS_TERMINATION << "ERROR (SLiMSim::__TallyMutationReferencesWithTreeSequence): mutation id " << mut_id << " was referenced but does not exist." << EidosTerminate();
-							
-							// Add allele_refs to the refcount for this mutation
-							ts_mut_info &mut_info = mut_info_iter->second;
-							
-							mut_info.ref_count += allele_refs;
-						}
-					}
+					// Add allele_refs to the refcount for this mutation
+					mut_info->ref_count += allele_refs[mutation_index];
 				}
 			}
 		}
-	}
-	while (ret != 0);
-	
-	// free
-	ret = vargen_free(vg);
-	if (ret != 0) handle_error("__TallyMutationReferencesWithTreeSequence vargen_free()", ret);
-	free(vg);
+	});
 }
 
-void SLiMSim::__CreateMutationsFromTabulation(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutInfoMap, std::unordered_map<slim_mutationid_t, MutationIndex> &p_mutIndexMap)
+void SLiMSim::__CreateMutationsFromTabulation(std::vector<ts_mut_info> &p_mutInfo)
 {
 	// count the number of non-null genomes there are; this is the count that would represent fixation
 	slim_refcount_t fixation_count = 0;
@@ -7113,10 +9299,9 @@ void SLiMSim::__CreateMutationsFromTabulation(std::unordered_map<slim_mutationid
 				fixation_count++;
 	
 	// instantiate mutations
-	for (auto mut_info_iter : p_mutInfoMap)
+	for (ts_mut_info &mut_info : p_mutInfo)
 	{
-		slim_mutationid_t mutation_id = mut_info_iter.first;
-		ts_mut_info &mut_info = mut_info_iter.second;
+		slim_mutationid_t mutation_id = mut_info.mutation_id;
 		MutationMetadataRec *metadata = mut_info.metadata;
 		slim_position_t position = mut_info.position;
 		
@@ -7141,8 +9326,8 @@ void SLiMSim::__CreateMutationsFromTabulation(std::unordered_map<slim_mutationid
 			population_.treeseq_substitutions_map_.insert(std::pair<slim_position_t, Substitution *>(position, sub));
 			population_.substitutions_.emplace_back(sub);
 			
-			// add -1 to our local map, so we know there's an entry but we also know it's a substitution
-			p_mutIndexMap[mutation_id] = -1;
+			// record -1 in the tabulation, so we know there's an entry but we also know it's a substitution
+			mut_info.mut_index = -1;
 		}
 		else
 		{
@@ -7151,8 +9336,8 @@ void SLiMSim::__CreateMutationsFromTabulation(std::unordered_map<slim_mutationid
 			
 			new (gSLiM_Mutation_Block + new_mut_index) Mutation(mutation_id, mutation_type_ptr, position, metadata->selection_coeff_, metadata->subpop_index_, metadata->origin_generation_);
 			
-			// add it to our local map, so we can find it when making genomes, and to the population's mutation registry
-			p_mutIndexMap[mutation_id] = new_mut_index;
+			// record it in the tabulation, so we can find it when making genomes, and add it to the population's mutation registry
+			mut_info.mut_index = new_mut_index;
 			population_.mutation_registry_.emplace_back(new_mut_index);
 			
 #ifdef SLIM_KEEP_MUTTYPE_REGISTRIES
@@ -7170,109 +9355,77 @@ void SLiMSim::__CreateMutationsFromTabulation(std::unordered_map<slim_mutationid
 	}
 }
 
-void SLiMSim::__AddMutationsFromTreeSequenceToGenomes(std::unordered_map<slim_mutationid_t, MutationIndex> &p_mutIndexMap, std::unordered_map<node_id_t, Genome *> p_nodeToGenomeMap, tree_sequence_t *p_ts)
+void SLiMSim::__AddMutationsFromTreeSequenceToGenomes(std::vector<ts_mut_info> &p_mutInfo, std::vector<Genome *> &p_nodeToGenomeMap, tree_sequence_t *p_ts)
 {
 	// This code is based on SLiMSim::CrosscheckTreeSeqIntegrity(), but it can be much simpler.
 	// We also don't need to sort/deduplicate/simplify; the tables read in should be simplified already.
 	if (!recording_mutations_)
 		return;
 	
-	// allocate and set up the vargen object we'll use to walk through variants
-	vargen_t *vg;
-	
-	vg = (vargen_t *)malloc(sizeof(vargen_t));
-	int ret = vargen_alloc(vg, p_ts, p_ts->samples, p_ts->num_samples, MSP_16_BIT_GENOTYPES);
-	if (ret != 0) handle_error("__AddMutationsFromTreeSequenceToGenomes vargen_alloc()", ret);
-	
-	// set up a map from sample indices in the vargen to Genome objects; the sample
-	// may contain nodes that are ancestral and need to be excluded
-	std::vector<Genome *> indexToGenomeMap;
-	size_t sample_count = vg->num_samples;
-	
-	for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
-	{
-		node_id_t sample_node_id = vg->samples[sample_index];
-		auto sample_nodeToGenome_iter = p_nodeToGenomeMap.find(sample_node_id);
-		
-		if (sample_nodeToGenome_iter != p_nodeToGenomeMap.end())
-		{
-			// we found a genome for this sample, so record it
-			indexToGenomeMap.push_back(sample_nodeToGenome_iter->second);
-		}
-		else
-		{
-			// this sample is not extant; no corresponding genome, so record nullptr
-			indexToGenomeMap.push_back(nullptr);
-		}
-	}
+	// each allele at a site is resolved to MutationIndex values at most once, the first time an extant genome uses it;
+	// allele_resolved_start and allele_resolved_end hold the allele's range in allele_mut_indices, or -1 if unresolved, and
+	// allele_id_counts holds the number of mutation ids in the allele, including fixed mutations that are not added to genomes
+	std::vector<int64_t> allele_resolved_start, allele_resolved_end;
+	std::vector<table_size_t> allele_id_counts;
+	std::vector<MutationIndex> allele_mut_indices;
 	
-	// add mutations to genomes by looping through variants
-	do
-	{
-		variant_t *variant;
+	// The sites are visited in sorted order by position, so we can always add new mutations to the ends of genomes.
+	SLiM_VisitExtantAllelesInTreeSequence(p_ts, p_nodeToGenomeMap, [&](site_t *site, std::vector<std::pair<Genome *, table_size_t>> &genome_alleles) {
+		slim_position_t site_pos_int = (slim_position_t)site->position;
 		
-		ret = vargen_next(vg, &variant);
-		if (ret < 0) handle_error("__AddMutationsFromTreeSequenceToGenomes vargen_next()", ret);
+		allele_resolved_start.assign(site->mutations_length, -1);
+		allele_resolved_end.assign(site->mutations_length, -1);
+		allele_id_counts.assign(site->mutations_length, 0);
+		allele_mut_indices.clear();
 		
-		if (ret == 1)
+		for (auto &genome_allele : genome_alleles)
 		{
-			// We have a new variant; set it into SLiM.  A variant represents a site at which a tracked mutation exists.
-			// The variant_t will tell us all the allelic states involved at that site, what the alleles are, and which genomes
-			// in the sample are using them.  We will then set all the genomes that the variant claims to involve to have
-			// the allele the variant attributes to them.  The variants are returned in sorted order by position, so we can
-			// always add new mutations to the ends of genomes.
-			slim_position_t variant_pos_int = (slim_position_t)variant->site->position;
+			Genome *genome = genome_allele.first;
+			table_size_t mutation_index = genome_allele.second;
 			
-			for (size_t sample_index = 0; sample_index < sample_count; sample_index++)
+			if (allele_resolved_start[mutation_index] == -1)
 			{
-				Genome *genome = indexToGenomeMap[sample_index];
+				mutation_t &mutation = site->mutations[mutation_index];
+				static std::vector<slim_mutationid_t> genome_allele_ids;
+				
+				SLiM_DecodeDerivedState(mutation.derived_state, mutation.derived_state_length, genome_allele_ids);
 				
-				if (genome)
+				allele_resolved_start[mutation_index] = (int64_t)allele_mut_indices.size();
+				allele_id_counts[mutation_index] = (table_size_t)genome_allele_ids.size();
+				
+				for (slim_mutationid_t mut_id : genome_allele_ids)
 				{
-					uint16_t genome_variant = variant->genotypes.u16[sample_index];
-					table_size_t genome_allele_length = variant->allele_lengths[genome_variant];
+					ts_mut_info *mut_info = SLiM_FindTabulatedMutation(p_mutInfo, mut_id);
 					
-					if (genome_allele_length % sizeof(slim_mutationid_t) != 0)
-						EIDOS_TERMINATION << "ERROR (SLiMSim::__AddMutationsFromTreeSequenceToGenomes): (internal error) variant allele had length that was not a multiple of sizeof(slim_mutationid_t)." << EidosTerminate();
-					genome_allele_length /= sizeof(slim_mutationid_t);
+					if (!mut_info)
+						EIDOS_TERMINATION << "ERROR (SLiMSim::__AddMutationsFromTreeSequenceToGenomes): mutation id " << mut_id << " was referenced but does not exist." << EidosTerminate();
 					
-					if (genome_allele_length > 0)
-					{
-						if (genome->IsNull())
-							EIDOS_TERMINATION << "ERROR (SLiMSim::__AddMutationsFromTreeSequenceToGenomes): (internal error) null genome has non-zero treeseq allele length " << genome_allele_length << "." << EidosTerminate();
-						
-						slim_mutationid_t *genome_allele = (slim_mutationid_t *)variant->alleles[genome_variant];
-						slim_mutrun_index_t run_index = (slim_mutrun_index_t)(variant_pos_int / genome->mutrun_length_);
-						
-						genome->WillModifyRun(run_index);
-						
-						MutationRun *mutrun = genome->mutruns_[run_index].get();
-						
-						for (table_size_t mutid_index = 0; mutid_index < genome_allele_length; ++mutid_index)
-						{
-							slim_mutationid_t mut_id = genome_allele[mutid_index];
-							auto mut_index_iter = p_mutIndexMap.find(mut_id);
-							
-							if (mut_index_iter == p_mutIndexMap.end())
-								EIDOS_TERMINATION << "ERROR (SLiMSim::__AddMutationsFromTreeSequenceToGenomes): mutation id " << mut_id << " was referenced but does not exist." << EidosTerminate();
-							
-							// Add the mutation to the genome unless it is fixed (mut_index == -1)
-							MutationIndex mut_index = mut_index_iter->second;
-							
-							if (mut_index != -1)
-								mutrun->emplace_back(mut_index);
-						}
-					}
+					// Add the mutation to the genome unless it is fixed (mut_index == -1)
+					if (mut_info->mut_index != -1)
+						allele_mut_indices.push_back(mut_info->mut_index);
 				}
+				
+				allele_resolved_end[mutation_index] = (int64_t)allele_mut_indices.size();
+			}
+			
+			table_size_t genome_allele_length = allele_id_counts[mutation_index];
+			
+			if (genome_allele_length > 0)
+			{
+				if (genome->IsNull())
+					EIDOS_TERMINATION << "ERROR (SLiMSim::__AddMutationsFromTreeSequenceToGenomes): (internal error) null genome has non-zero treeseq allele length " << genome_allele_length << "." << EidosTerminate();
+				
+				slim_mutrun_index_t run_index = (slim_mutrun_index_t)(site_pos_int / genome->mutrun_length_);
+				
+				genome->WillModifyRun(run_index);
+				
+				MutationRun *mutrun = genome->mutruns_[run_index].get();
+				
+				for (int64_t resolved_index = allele_resolved_start[mutation_index]; resolved_index < allele_resolved_end[mutation_index]; ++resolved_index)
+					mutrun->emplace_back(allele_mut_indices[resolved_index]);
 			}
 		}
-	}
-	while (ret != 0);
-	
-	// free
-	ret = vargen_free(vg);
-	if (ret != 0) handle_error("__AddMutationsFromTreeSequenceToGenomes vargen_free()", ret);
-	free(vg);
+	});
 }
 
 slim_generation_t SLiMSim::_InstantiateSLiMObjectsFromTables(EidosInterpreter *p_interpreter)
@@ -7301,7 +9454,7 @@ slim_generation_t SLiMSim::_InstantiateSLiMObjectsFromTables(EidosInterpreter *p
 	ret = tree_sequence_load_tables(ts, &tables_, MSP_BUILD_INDEXES);
 	if (ret != 0) handle_error("_InstantiateSLiMObjectsFromTables tree_sequence_load_tables()", ret);
 	
-	std::unordered_map<node_id_t, Genome *> nodeToGenomeMap;
+	std::vector<Genome *> nodeToGenomeMap(tables_.nodes->num_rows, nullptr);
 	
 	{
 		std::unordered_map<slim_objectid_t, ts_subpop_info> subpopInfoMap;
@@ -7311,18 +9464,15 @@ slim_generation_t SLiMSim::_InstantiateSLiMObjectsFromTables(EidosInterpreter *p
 		__ConfigureSubpopulationsFromTables(p_interpreter);
 	}
 	
-	std::unordered_map<slim_mutationid_t, MutationIndex> mutIndexMap;
-	
 	{
-		std::unordered_map<slim_mutationid_t, ts_mut_info> mutInfoMap;
+		std::vector<ts_mut_info> mutInfo;
 		
-		__TabulateMutationsFromTables(mutInfoMap);
-		__TallyMutationReferencesWithTreeSequence(mutInfoMap, nodeToGenomeMap, ts);
-		__CreateMutationsFromTabulation(mutInfoMap, mutIndexMap);
+		__TabulateMutationsFromTables(mutInfo);
+		__TallyMutationReferencesWithTreeSequence(mutInfo, nodeToGenomeMap, ts);
+		__CreateMutationsFromTabulation(mutInfo);
+		__AddMutationsFromTreeSequenceToGenomes(mutInfo, nodeToGenomeMap, ts);
 	}
 	
-	__AddMutationsFromTreeSequenceToGenomes(mutIndexMap, nodeToGenomeMap, ts);
-	
 	ret = tree_sequence_free(ts);
 	if (ret != 0) handle_error("_InstantiateSLiMObjectsFromTables tree_sequence_free()", ret);
 	free(ts);
@@ -7364,12 +9514,24 @@ slim_generation_t SLiMSim::_InstantiateSLiMObjectsFromTables(EidosInterpreter *p
     }
     ReorderIndividualTable(&tables_, individual_map, false);
 	
+	// The remembered genomes are the first nodes, as after a simplification; look up the rows of their individuals
+	remembered_genomes_compacted_ = remembered_genomes_.size();
+	
+	for (individual_id_t j = 0; (size_t) j < tables_.individuals->num_rows; j++)
+	{
+		IndividualMetadataRec *metadata_rec = (IndividualMetadataRec *)(tables_.individuals->metadata + tables_.individuals->metadata_offset[j]);
+		
+		remembered_individual_rows_.emplace((slim_pedigreeid_t)metadata_rec->pedigree_id_, j);
+	}
+	
 	// Re-tally mutation references so we have accurate frequency counts for our new mutations
 	population_.UniqueMutationRuns();
 	population_.TallyMutationReferences(nullptr, true);
 	
-	// Do a crosscheck to ensure data integrity
-	CrosscheckTreeSeqIntegrity();
+	// Do a crosscheck to ensure data integrity, if crosschecks are enabled; the genomes were just built from the tree sequence,
+	// so this checks the loading code against itself, and it would otherwise take longer than the whole rest of the load
+	if (running_treeseq_crosschecks_)
+		CrosscheckTreeSeqIntegrity();
 	
 	// Simplification has just been done, in effect
 	simplify_elapsed_ = 0;
@@ -7442,7 +9604,7 @@ slim_generation_t SLiMSim::_InitializePopulationFromMSPrimeBinaryFile(const char
 	ret = table_collection_copy(&immutable_tables, &tables_);
 	if (ret < 0) handle_error("table_collection_copy", ret);
 	
-	// convert ASCII derived-state data, which is the required format on disk, back to our in-memory binary format
+	// convert ASCII derived-state data, which is the required format on disk, back to our compact in-memory encoding
 	DerivedStatesFromAscii(&tables_);
 	
 	// free our private immutable tables
@@ -7591,6 +9753,7 @@ size_t SLiMSim::MemoryUsageForTables(table_collection_t &p_tables)
 	}
 	
 	usage += remembered_genomes_.size() * sizeof(node_id_t);
+	usage += remembered_individual_rows_.size() * (sizeof(slim_pedigreeid_t) + sizeof(individual_id_t) + sizeof(void *));
 	
 	return usage;
 }
@@ -8290,7 +10453,7 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSex(const std::string &p
 	return gStaticEidosValueVOID;
 }
 
-//	*********************	(void)initializeSLiMOptions([logical$ keepPedigrees = F], [string$ dimensionality = ""], [string$ periodicity = ""], [integer$ mutationRuns = 0], [logical$ preventIncidentalSelfing = F])
+//	*********************	(void)initializeSLiMOptions([logical$ keepPedigrees = F], [string$ dimensionality = ""], [string$ periodicity = ""], [integer$ mutationRuns = 0], [logical$ preventIncidentalSelfing = F], [integer$ threads = 1], [logical$ counterRNG = F])
 //
 EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSLiMOptions(const std::string &p_function_name, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter)
 {
@@ -8300,6 +10463,8 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSLiMOptions(const std::s
 	EidosValue *arg_periodicity_value = p_arguments[2].get();
 	EidosValue *arg_mutationRuns_value = p_arguments[3].get();
 	EidosValue *arg_preventIncidentalSelfing_value = p_arguments[4].get();
+	EidosValue *arg_threads_value = p_arguments[5].get();
+	EidosValue *arg_counterRNG_value = p_arguments[6].get();
 	std::ostream &output_stream = p_interpreter.ExecutionOutputStream();
 	
 	if (num_options_declarations_ > 0)
@@ -8402,6 +10567,35 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSLiMOptions(const std::s
 		prevent_incidental_selfing_ = prevent_selfing;
 	}
 	
+	{
+		// [integer$ threads = 1]
+		int64_t thread_count = arg_threads_value->IntAtIndex(0, nullptr);
+		
+		if (thread_count == 0)
+		{
+			// zero means "use all available hardware threads"; the standard allows hardware_concurrency() to return 0 if unknown
+			thread_count = std::thread::hardware_concurrency();
+			
+			if (thread_count < 1)
+				thread_count = 1;
+		}
+		
+		if ((thread_count < 1) || (thread_count > 1024))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteContextFunction_initializeSLiMOptions): in initializeSLiMOptions(), parameter threads must be 0 (meaning all available hardware threads) or between 1 and 1024, inclusive." << EidosTerminate();
+		
+		thread_count_ = (int)thread_count;
+	}
+	
+	{
+		// [logical$ counterRNG = F]
+		bool counter_rng = arg_counterRNG_value->LogicalAtIndex(0, nullptr);
+		
+		if (counter_rng && (model_type_ == SLiMModelType::kModelTypeNonWF))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteContextFunction_initializeSLiMOptions): in initializeSLiMOptions(), counterRNG=T is presently supported only in WF models." << EidosTerminate();
+		
+		counter_rng_ = counter_rng;
+	}
+	
 	if (DEBUG_INPUT)
 	{
 		output_stream << "initializeSLiMOptions(";
@@ -8452,6 +10646,20 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSLiMOptions(const std::s
 			if (previous_params) output_stream << ", ";
 			output_stream << "preventIncidentalSelfing = " << (prevent_incidental_selfing_ ? "T" : "F");
 			previous_params = true;
+		}
+		
+		if (thread_count_ != 1)
+		{
+			if (previous_params) output_stream << ", ";
+			output_stream << "threads = " << thread_count_;
+			previous_params = true;
+		}
+		
+		if (counter_rng_)
+		{
+			if (previous_params) output_stream << ", ";
+			output_stream << "counterRNG = T";
+			previous_params = true;
 			(void)previous_params;	// dead store above is deliberate
 		}
 		
@@ -8464,7 +10672,7 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeSLiMOptions(const std::s
 }
 
 // TREE SEQUENCE RECORDING
-//	*********************	(void)initializeTreeSeq([logical$ recordMutations = T], [float$ simplificationRatio = 10], [logical$ checkCoalescence = F], [logical$ runCrosschecks = F])
+//	*********************	(void)initializeTreeSeq([logical$ recordMutations = T], [float$ simplificationRatio = 10], [logical$ checkCoalescence = F], [logical$ runCrosschecks = F], [Nif$ simplificationMemoryLimit = NULL], [i$ crosscheckInterval = 1])
 //
 EidosValue_SP SLiMSim::ExecuteContextFunction_initializeTreeSeq(const std::string &p_function_name, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter)
 {
@@ -8473,6 +10681,8 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeTreeSeq(const std::strin
 	EidosValue *arg_simplificationRatio_value = p_arguments[1].get();
 	EidosValue *arg_checkCoalescence_value = p_arguments[2].get();
 	EidosValue *arg_runCrosschecks_value = p_arguments[3].get();
+	EidosValue *arg_simplificationMemoryLimit_value = p_arguments[4].get();
+	EidosValue *arg_crosscheckInterval_value = p_arguments[5].get();
 	std::ostream &output_stream = p_interpreter.ExecutionOutputStream();
 	
 	if (num_treeseq_declarations_ > 0)
@@ -8481,12 +10691,32 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeTreeSeq(const std::strin
 	// NOTE: the TSXC_Enable() method also sets up tree-seq recording by setting these sorts of flags;
 	// if the code here changes, that method should probably be updated too.
 	
+	// Validate all arguments before changing any state; if recording_tree_ were set and then an error
+	// were raised, the destructor would try to free tree-sequence tables that were never allocated.
+	double simplification_ratio = arg_simplificationRatio_value->FloatAtIndex(0, nullptr);
+	int64_t crosscheck_interval = arg_crosscheckInterval_value->IntAtIndex(0, nullptr);
+	
+	if ((crosscheck_interval < 1) || (crosscheck_interval > SLIM_MAX_GENERATION))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteContextFunction_initializeTreeSeq): initializeTreeSeq() requires crosscheckInterval to be between 1 and " << SLIM_MAX_GENERATION << ", inclusive." << EidosTerminate();
+	
+	if (arg_simplificationMemoryLimit_value->Type() != EidosValueType::kValueNULL)
+	{
+		double simplification_memory_limit = arg_simplificationMemoryLimit_value->FloatAtIndex(0, nullptr);
+		
+		if (!std::isfinite(simplification_memory_limit) || (simplification_memory_limit <= 0.0))
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteContextFunction_initializeTreeSeq): initializeTreeSeq() requires simplificationMemoryLimit to be greater than 0 and finite." << EidosTerminate();
+		if (simplification_ratio != 10.0)
+			EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteContextFunction_initializeTreeSeq): initializeTreeSeq() does not allow both simplificationRatio and simplificationMemoryLimit to be specified." << EidosTerminate();
+		
+		simplification_memory_limit_ = simplification_memory_limit;
+	}
+	
 	recording_tree_ = true;
 	recording_mutations_ = arg_recordMutations_value->LogicalAtIndex(0, nullptr);
-	simplification_ratio_ = arg_simplificationRatio_value->FloatAtIndex(0, nullptr);
+	simplification_ratio_ = simplification_ratio;
 	running_coalescence_checks_ = arg_checkCoalescence_value->LogicalAtIndex(0, nullptr);
 	running_treeseq_crosschecks_ = arg_runCrosschecks_value->LogicalAtIndex(0, nullptr);
-	treeseq_crosschecks_interval_ = 1;		// this interval is presently not exposed in the Eidos API
+	treeseq_crosschecks_interval_ = (int)crosscheck_interval;
 	
 	// Pedigree recording is turned on as a side effect of tree sequence recording, since we need to
 	// have unique identifiers for every individual; pedigree recording does that for us
@@ -8531,6 +10761,20 @@ EidosValue_SP SLiMSim::ExecuteContextFunction_initializeTreeSeq(const std::strin
 			if (previous_params) output_stream << ", ";
 			output_stream << "runCrosschecks = " << (running_treeseq_crosschecks_ ? "T" : "F");
 			previous_params = true;
+		}
+		
+		if (treeseq_crosschecks_interval_ != 1)
+		{
+			if (previous_params) output_stream << ", ";
+			output_stream << "crosscheckInterval = " << treeseq_crosschecks_interval_;
+			previous_params = true;
+		}
+		
+		if (simplification_memory_limit_ > 0.0)
+		{
+			if (previous_params) output_stream << ", ";
+			output_stream << "simplificationMemoryLimit = " << simplification_memory_limit_;
+			previous_params = true;
 			(void)previous_params;	// dead store above is deliberate
 		}
 		
@@ -8611,9 +10855,9 @@ const std::vector<EidosFunctionSignature_SP> *SLiMSim::ZeroGenerationFunctionSig
 		sim_0_signatures_.emplace_back((EidosFunctionSignature *)(new EidosFunctionSignature(gStr_initializeSex, nullptr, kEidosValueMaskVOID, "SLiM"))
 										->AddString_S("chromosomeType")->AddNumeric_OS("xDominanceCoeff", gStaticEidosValue_Float1));
 		sim_0_signatures_.emplace_back((EidosFunctionSignature *)(new EidosFunctionSignature(gStr_initializeSLiMOptions, nullptr, kEidosValueMaskVOID, "SLiM"))
-									   ->AddLogical_OS("keepPedigrees", gStaticEidosValue_LogicalF)->AddString_OS("dimensionality", gStaticEidosValue_StringEmpty)->AddString_OS("periodicity", gStaticEidosValue_StringEmpty)->AddInt_OS("mutationRuns", gStaticEidosValue_Integer0)->AddLogical_OS("preventIncidentalSelfing", gStaticEidosValue_LogicalF));
+									   ->AddLogical_OS("keepPedigrees", gStaticEidosValue_LogicalF)->AddString_OS("dimensionality", gStaticEidosValue_StringEmpty)->AddString_OS("periodicity", gStaticEidosValue_StringEmpty)->AddInt_OS("mutationRuns", gStaticEidosValue_Integer0)->AddLogical_OS("preventIncidentalSelfing", gStaticEidosValue_LogicalF)->AddInt_OS("threads", gStaticEidosValue_Integer1)->AddLogical_OS("counterRNG", gStaticEidosValue_LogicalF));
 		sim_0_signatures_.emplace_back((EidosFunctionSignature *)(new EidosFunctionSignature(gStr_initializeTreeSeq, nullptr, kEidosValueMaskVOID, "SLiM"))
-									   ->AddLogical_OS("recordMutations", gStaticEidosValue_LogicalT)->AddFloat_OS("simplificationRatio", gStaticEidosValue_Float10)->AddLogical_OS("checkCoalescence", gStaticEidosValue_LogicalF)->AddLogical_OS("runCrosschecks", gStaticEidosValue_LogicalF));
+									   ->AddLogical_OS("recordMutations", gStaticEidosValue_LogicalT)->AddFloat_OS("simplificationRatio", gStaticEidosValue_Float10)->AddLogical_OS("checkCoalescence", gStaticEidosValue_LogicalF)->AddLogical_OS("runCrosschecks", gStaticEidosValue_LogicalF)->AddNumeric_OSN("simplificationMemoryLimit", gStaticEidosValueNULL)->AddInt_OS("crosscheckInterval", gStaticEidosValue_Integer1));
 		sim_0_signatures_.emplace_back((EidosFunctionSignature *)(new EidosFunctionSignature(gStr_initializeSLiMModelType, nullptr, kEidosValueMaskVOID, "SLiM"))
 									   ->AddString_S("modelType"));
 	}
@@ -9100,6 +11344,9 @@ EidosValue_SP SLiMSim::ExecuteInstanceMethod(EidosGlobalStringID p_method_id, co
 		case gID_treeSeqSimplify:				return ExecuteMethod_treeSeqSimplify(p_method_id, p_arguments, p_argument_count, p_interpreter);
 		case gID_treeSeqRememberIndividuals:	return ExecuteMethod_treeSeqRememberIndividuals(p_method_id, p_arguments, p_argument_count, p_interpreter);
 		case gID_treeSeqOutput:					return ExecuteMethod_treeSeqOutput(p_method_id, p_arguments, p_argument_count, p_interpreter);
+		case gID_treeSeqDiversity:
+		case gID_treeSeqTajimasD:
+		case gID_treeSeqAFS:					return ExecuteMethod_treeSeqStatistics(p_method_id, p_arguments, p_argument_count, p_interpreter);
 		default:								return SLiMEidosDictionary::ExecuteInstanceMethod(p_method_id, p_arguments, p_argument_count, p_interpreter);
 	}
 }
@@ -9611,7 +11858,7 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputFixedMutations(EidosGlobalStringID p_
 	return gStaticEidosValueVOID;
 }
 			
-//	*********************	– (void)outputFull([Ns$ filePath = NULL], [logical$ binary = F], [logical$ append=F], [logical$ spatialPositions = T], [logical$ ages = T])
+//	*********************	– (void)outputFull([Ns$ filePath = NULL], [logical$ binary = F], [logical$ append=F], [logical$ spatialPositions = T], [logical$ ages = T], [logical$ checkpoint = F])
 //
 EidosValue_SP SLiMSim::ExecuteMethod_outputFull(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter)
 {
@@ -9621,8 +11868,11 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputFull(EidosGlobalStringID p_method_id,
 	EidosValue *append_value = p_arguments[2].get();
 	EidosValue *spatialPositions_value = p_arguments[3].get();
 	EidosValue *ages_value = p_arguments[4].get();
+	EidosValue *checkpoint_value = p_arguments[5].get();
 	
-	if (!warned_early_output_)
+	bool write_checkpoint = checkpoint_value->LogicalAtIndex(0, nullptr);
+	
+	if (!warned_early_output_ && !write_checkpoint)
 	{
 		if (GenerationStage() == SLiMGenerationStage::kWFStage1ExecuteEarlyScripts)
 		{
@@ -9638,6 +11888,9 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputFull(EidosGlobalStringID p_method_id,
 	bool output_spatial_positions = spatialPositions_value->LogicalAtIndex(0, nullptr);
 	bool output_ages = ages_value->LogicalAtIndex(0, nullptr);
 	
+	if (write_checkpoint && !use_binary)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteMethod_outputFull): outputFull() can write a checkpoint only in binary format (binary=T)." << EidosTerminate();
+	
 	if (filePath_value->Type() == EidosValueType::kValueNULL)
 	{
 		if (use_binary)
@@ -9664,7 +11917,11 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputFull(EidosGlobalStringID p_method_id,
 		
 		if (outfile.is_open())
 		{
-			if (use_binary)
+			if (write_checkpoint)
+			{
+				WriteCheckpoint(outfile);
+			}
+			else if (use_binary)
 			{
 				population_.PrintAllBinary(outfile, output_spatial_positions, output_ages);
 			}
@@ -9881,8 +12138,14 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputUsage(EidosGlobalStringID p_method_id
 		out << "      Refcount buffer: ";
 		PrintBytes(out, usage.mutationRefcountBuffer);
 		
+		out << "      Hot-field buffers: ";
+		PrintBytes(out, usage.mutationHotFieldBuffers);
+		
 		out << "      Unused pool space: ";
 		PrintBytes(out, usage.mutationUnusedPoolSpace);
+		
+		out << "      Resident in physical memory (not additive): ";
+		PrintBytes(out, usage.mutationBlockResident);
 	}
 	
 	// MutationRun
@@ -9918,6 +12181,15 @@ EidosValue_SP SLiMSim::ExecuteMethod_outputUsage(EidosGlobalStringID p_method_id
 		
 		out << "      Tree-sequence tables: ";
 		PrintBytes(out, usage.slimsimTreeSeqTables);
+		
+		out << "      Tree-sequence edge buffer: ";
+		PrintBytes(out, usage.slimsimTreeSeqEdgeBuffer);
+		
+		out << "      Edge sort scratch, last simplify (not additive): ";
+		PrintBytes(out, usage.slimsimTreeSeqSortScratch);
+		
+		out << "      Edge sort scratch, full sort (not additive): ";
+		PrintBytes(out, usage.slimsimTreeSeqFullSortScratch);
 	}
 	
 	// Subpopulation
@@ -10559,6 +12831,107 @@ EidosValue_SP SLiMSim::ExecuteMethod_treeSeqOutput(EidosGlobalStringID p_method_
 }
 
 
+// TREE SEQUENCE RECORDING
+//	*********************	- (float$)treeSeqDiversity([No<Subpopulation> subpops = NULL], [string$ mode = "site"])
+//	*********************	- (float$)treeSeqTajimasD([No<Subpopulation> subpops = NULL], [string$ mode = "site"])
+//	*********************	- (float)treeSeqAFS([No<Subpopulation> subpops = NULL], [string$ mode = "site"])
+//
+EidosValue_SP SLiMSim::ExecuteMethod_treeSeqStatistics(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter)
+{
+#pragma unused (p_method_id, p_argument_count, p_interpreter)
+	EidosValue *subpops_value = p_arguments[0].get();
+	EidosValue *mode_value = p_arguments[1].get();
+	
+	const std::string &method_name = Eidos_StringForGlobalStringID(p_method_id);
+	
+	if (!recording_tree_)
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteMethod_treeSeqStatistics): " << method_name << "() may only be called when tree recording is enabled." << EidosTerminate();
+	
+	SLiMGenerationStage gen_stage = GenerationStage();
+	
+	if ((gen_stage != SLiMGenerationStage::kWFStage1ExecuteEarlyScripts) && (gen_stage != SLiMGenerationStage::kWFStage5ExecuteLateScripts) &&
+		(gen_stage != SLiMGenerationStage::kNonWFStage2ExecuteEarlyScripts) && (gen_stage != SLiMGenerationStage::kNonWFStage6ExecuteLateScripts))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteMethod_treeSeqStatistics): " << method_name << "() may only be called from an early() or late() event." << EidosTerminate();
+	if ((executing_block_type_ != SLiMEidosBlockType::SLiMEidosEventEarly) && (executing_block_type_ != SLiMEidosBlockType::SLiMEidosEventLate))
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteMethod_treeSeqStatistics): " << method_name << "() may not be called from inside a callback." << EidosTerminate();
+	
+	std::string mode_string = mode_value->StringAtIndex(0, nullptr);
+	bool branch_mode = false;
+	
+	if (mode_string == "site")
+		branch_mode = false;
+	else if (mode_string == "branch")
+		branch_mode = true;
+	else
+		EIDOS_TERMINATION << "ERROR (SLiMSim::ExecuteMethod_treeSeqStatistics): " << method_name << "() requires mode to be either \"site\" or \"branch\"." << EidosTerminate();
+	
+	// get the requested subpops, or all subpops; a subpop requested more than once is used only once
+	std::vector<Subpopulation *> subpops;
+	
+	if (subpops_value->Type() == EidosValueType::kValueNULL)
+	{
+		for (auto subpop_pair : population_)
+			subpops.push_back(subpop_pair.second);
+	}
+	else
+	{
+		int requested_subpop_count = subpops_value->Count();
+		
+		for (int requested_subpop_index = 0; requested_subpop_index < requested_subpop_count; ++requested_subpop_index)
+		{
+			Subpopulation *subpop = (Subpopulation *)(subpops_value->ObjectElementAtIndex(requested_subpop_index, nullptr));
+			
+			if (std::find(subpops.begin(), subpops.end(), subpop) == subpops.end())
+				subpops.push_back(subpop);
+		}
+	}
+	
+	size_t sample_count;
+	double diversity, segregating;
+	std::vector<double> afs;
+	
+	TreeSequenceStatistics(subpops, branch_mode, &sample_count, &diversity, &segregating, (p_method_id == gID_treeSeqAFS) ? &afs : nullptr);
+	
+	if (p_method_id == gID_treeSeqAFS)
+	{
+		EidosValue_Float_vector *float_result = (new (gEidosValuePool->AllocateChunk()) EidosValue_Float_vector())->resize_no_initialize(afs.size());
+		
+		for (size_t afs_index = 0; afs_index < afs.size(); ++afs_index)
+			float_result->set_float_no_check(afs[afs_index], afs_index);
+		
+		return EidosValue_SP(float_result);
+	}
+	
+	// diversity is per base position; with fewer than two genomes it is undefined, so we return NAN
+	if (sample_count < 2)
+		return gStaticEidosValue_FloatNAN;
+	
+	if (p_method_id == gID_treeSeqDiversity)
+		return EidosValue_SP(new (gEidosValuePool->AllocateChunk()) EidosValue_Float_singleton(diversity / (chromosome_.last_position_ + 1)));
+	
+	// Tajima's D (Tajima 1989), from the totals over the chromosome; if there are no segregating sites it is undefined
+	double n = (double)sample_count, a1 = 0.0, a2 = 0.0;
+	
+	for (size_t i = 1; i < sample_count; ++i)
+	{
+		a1 += 1.0 / i;
+		a2 += 1.0 / ((double)i * i);
+	}
+	
+	double b1 = (n + 1.0) / (3.0 * (n - 1.0));
+	double b2 = 2.0 * (n * n + n + 3.0) / (9.0 * n * (n - 1.0));
+	double c1 = b1 - 1.0 / a1;
+	double c2 = b2 - (n + 2.0) / (a1 * n) + a2 / (a1 * a1);
+	double e1 = c1 / a1;
+	double e2 = c2 / (a1 * a1 + a2);
+	double denominator = sqrt(e1 * segregating + e2 * segregating * (segregating - 1.0));
+	
+	if (!(denominator > 0.0))
+		return gStaticEidosValue_FloatNAN;
+	
+	return EidosValue_SP(new (gEidosValuePool->AllocateChunk()) EidosValue_Float_singleton((diversity - segregating / a1) / denominator));
+}
+
 //
 //	SLiMSim_Class
 //
@@ -10635,7 +13008,7 @@ const std::vector<const EidosMethodSignature *> *SLiMSim_Class::Methods(void) co
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_mutationCounts, kEidosValueMaskInt))->AddObject_N("subpops", gSLiM_Subpopulation_Class)->AddObject_ON("mutations", gSLiM_Mutation_Class, gStaticEidosValueNULL));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_mutationsOfType, kEidosValueMaskObject, gSLiM_Mutation_Class))->AddIntObject_S("mutType", gSLiM_MutationType_Class));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_outputFixedMutations, kEidosValueMaskVOID))->AddString_OSN("filePath", gStaticEidosValueNULL)->AddLogical_OS("append", gStaticEidosValue_LogicalF));
-		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_outputFull, kEidosValueMaskVOID))->AddString_OSN("filePath", gStaticEidosValueNULL)->AddLogical_OS("binary", gStaticEidosValue_LogicalF)->AddLogical_OS("append", gStaticEidosValue_LogicalF)->AddLogical_OS("spatialPositions", gStaticEidosValue_LogicalT)->AddLogical_OS("ages", gStaticEidosValue_LogicalT));
+		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_outputFull, kEidosValueMaskVOID))->AddString_OSN("filePath", gStaticEidosValueNULL)->AddLogical_OS("binary", gStaticEidosValue_LogicalF)->AddLogical_OS("append", gStaticEidosValue_LogicalF)->AddLogical_OS("spatialPositions", gStaticEidosValue_LogicalT)->AddLogical_OS("ages", gStaticEidosValue_LogicalT)->AddLogical_OS("checkpoint", gStaticEidosValue_LogicalF));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_outputMutations, kEidosValueMaskVOID))->AddObject("mutations", gSLiM_Mutation_Class)->AddString_OSN("filePath", gStaticEidosValueNULL)->AddLogical_OS("append", gStaticEidosValue_LogicalF));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_outputUsage, kEidosValueMaskVOID)));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_readFromPopulationFile, kEidosValueMaskInt | kEidosValueMaskSingleton))->AddString_S("filePath"));
@@ -10654,6 +13027,9 @@ const std::vector<const EidosMethodSignature *> *SLiMSim_Class::Methods(void) co
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqSimplify, kEidosValueMaskVOID)));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqRememberIndividuals, kEidosValueMaskVOID))->AddObject("individuals", gSLiM_Individual_Class));
 		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqOutput, kEidosValueMaskVOID))->AddString_S("path")->AddLogical_OS("simplify", gStaticEidosValue_LogicalT)->AddLogical_OS("_binary", gStaticEidosValue_LogicalT));
+		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqDiversity, kEidosValueMaskFloat | kEidosValueMaskSingleton))->AddObject_ON("subpops", gSLiM_Subpopulation_Class, gStaticEidosValueNULL)->AddString_OS("mode", EidosValue_String_SP(new (gEidosValuePool->AllocateChunk()) EidosValue_String_singleton("site"))));
+		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqTajimasD, kEidosValueMaskFloat | kEidosValueMaskSingleton))->AddObject_ON("subpops", gSLiM_Subpopulation_Class, gStaticEidosValueNULL)->AddString_OS("mode", EidosValue_String_SP(new (gEidosValuePool->AllocateChunk()) EidosValue_String_singleton("site"))));
+		methods->emplace_back((EidosInstanceMethodSignature *)(new EidosInstanceMethodSignature(gStr_treeSeqAFS, kEidosValueMaskFloat))->AddObject_ON("subpops", gSLiM_Subpopulation_Class, gStaticEidosValueNULL)->AddString_OS("mode", EidosValue_String_SP(new (gEidosValuePool->AllocateChunk()) EidosValue_String_singleton("site"))));
 							  
 		std::sort(methods->begin(), methods->end(), CompareEidosCallSignatures);
 	}
@@ -29,8 +29,10 @@
 
 #include <stdio.h>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <iostream>
+#include <ctime>
 
 #include "slim_global.h"
 #include "mutation.h"
@@ -174,6 +176,27 @@ static_assert(sizeof(SubpopulationMigrationMetadataRec) == 12, "SubpopulationMig
 #endif
 #endif
 
+// An edge recorded by RecordNewGenome(), buffered with the other edges of the same parent until the next flush into the edge
+// table; see SLiMSim::FlushEdgeBuffer().  This is not written to files, so it is not packed.
+typedef struct {
+	double left_;
+	double right_;
+	node_id_t child_;						// MSP_NULL_NODE for an edge retracted by RetractNewIndividual()
+	edge_id_t next_;						// the index of the next buffered edge with the same parent, or -1
+} BufferedEdgeRec;
+
+// A run of full-span edges recorded by RecordNewGenome() for genomes inherited without recombination (clonal children, and any
+// child without crossovers), which are most of the edges in clonal and selfing models and need no left/right.  Edge i of the run,
+// for 0 <= i < length_, goes from parent parent_ + (i % width_) to child child_ + i; the children of successive clonal individuals
+// are consecutive, so one run covers the genomes of an individual, and all the clones of a parent made one after another (as by
+// repeated addCloned() calls).  See SLiMSim::BufferNewFullSpanEdge().  This is not written to files, so it is not packed.
+typedef struct {
+	node_id_t parent_;						// the parent of the first edge
+	node_id_t child_;						// the child of the first edge
+	int32_t width_;							// the number of consecutive parents, cycled through by the edges of the run
+	int32_t length_;						// the number of edges in the run
+} BufferedEdgeRunRec;
+
 
 // Memory usage assessment as done by SLiMSim::TabulateMemoryUsage() is placed into this struct
 typedef struct
@@ -208,7 +231,9 @@ typedef struct
 	int64_t mutationObjects_count;
 	size_t mutationObjects;
 	size_t mutationRefcountBuffer;
+	size_t mutationHotFieldBuffers;
 	size_t mutationUnusedPoolSpace;
+	size_t mutationBlockResident;			// not additive; the resident part of the mutation block and its parallel buffers
 	
 	int64_t mutationRunObjects_count;
 	size_t mutationRunObjects;
@@ -223,6 +248,9 @@ typedef struct
 	int64_t slimsimObjects_count;
 	size_t slimsimObjects;
 	size_t slimsimTreeSeqTables;
+	size_t slimsimTreeSeqEdgeBuffer;
+	size_t slimsimTreeSeqSortScratch;		// not additive; the temporary space used by the last sort of the edge table
+	size_t slimsimTreeSeqFullSortScratch;	// not additive; the temporary space a full sort of the same edges would have used
 	
 	int64_t subpopulationObjects_count;
 	size_t subpopulationObjects;
@@ -340,6 +368,8 @@ private:
 	slim_generation_t InitializePopulationFromFile(const std::string &p_file_string, EidosInterpreter *p_interpreter);	// initialize the population from the file
 	slim_generation_t _InitializePopulationFromTextFile(const char *p_file, EidosInterpreter *p_interpreter);			// initialize the population from a SLiM text file
 	slim_generation_t _InitializePopulationFromBinaryFile(const char *p_file, EidosInterpreter *p_interpreter);			// initialize the population from a SLiM binary file
+	slim_generation_t _InitializePopulationFromCheckpoint(const char *p_buf, const char *p_buf_end, EidosInterpreter *p_interpreter);	// restore the simulation from the sections of a checkpoint file
+	void WriteCheckpoint(std::ostream &p_out);																			// write a checkpoint file (binary version 5); see outputFull()
 	
 	// initialization completeness check counts; used only when running initialize() callbacks
 	int num_interaction_types_;
@@ -373,6 +403,12 @@ private:
 	// preventing incidental selfing in hermaphroditic models
 	bool prevent_incidental_selfing_ = false;
 	
+	// the number of threads used for offspring generation; see Population::EvolveSubpopulation()
+	int thread_count_ = 1;
+	
+	// if true, per-gamete mutation and breakpoint counts are drawn from counter-based streams; see Population::GameteCountsRNG()
+	bool counter_rng_ = false;
+	
 	EidosSymbolTableEntry self_symbol_;												// for fast setup of the symbol table
 	
 	slim_usertag_t tag_value_;														// a user-defined tag value
@@ -413,8 +449,28 @@ private:
 	
 	table_collection_t tables_;
 	table_collection_position_t table_position_;
-	
+	table_size_t sorted_edge_count_ = 0;		// the number of leading rows of tables_.edges known to be sorted, as left by the last simplify or sort
+	
+	// edges recorded since the last flush are kept out of tables_.edges, in a linked list for each parent node (or, for full-span
+	// edges, in runs), so that FlushEdgeBuffer() can append them in the order simplify() needs; see BufferNewEdge()
+	std::vector<BufferedEdgeRec> edge_buffer_;
+	std::vector<std::pair<edge_id_t, edge_id_t>> edge_buffer_ends_;	// the first and last edge in edge_buffer_ for each parent node id, or -1
+	std::vector<node_id_t> edge_buffer_parents_;	// the parent node ids with buffered edges, in order of first use
+	size_t edge_buffer_position_ = 0;			// the size of edge_buffer_ at the last RecordTablePosition(), for RetractNewIndividual()
+	size_t edge_buffer_live_count_ = 0;			// the number of buffered edges that have not been retracted, including those in runs
+	std::vector<BufferedEdgeRunRec> edge_runs_;	// runs of full-span edges, in order of child; see BufferNewFullSpanEdge()
+	size_t edge_run_edge_count_ = 0;			// the number of edges in edge_runs_
+	size_t last_sort_scratch_ = 0;				// the temporary space used by the last SortTreeSequenceTables(), for outputUsage()
+	size_t last_full_sort_scratch_ = 0;			// the temporary space a full sort would have used at that point, for comparison
+	
+	// The genomes of remembered (and first-generation) individuals, in the order they were remembered.  Simplification makes
+	// these the first nodes of the node table, so the first remembered_genomes_compacted_ entries are simply 0, 1, 2, ... and
+	// only entries added since the last simplification need to be looked up.  The individual table rows of remembered
+	// individuals are never moved by simplification, since they are all retained in order, so we keep a map from pedigree ID
+	// to row for them; AddIndividualsToTable() uses it instead of searching the whole remembered set for each individual.
     std::vector<node_id_t> remembered_genomes_;
+	size_t remembered_genomes_compacted_ = 0;
+	std::unordered_map<slim_pedigreeid_t, individual_id_t> remembered_individual_rows_;
 	//Individual *current_new_individual_;
 	
 	bool running_coalescence_checks_ = false;	// true if we check for coalescence after each simplification
@@ -426,6 +482,10 @@ private:
 	double simplification_ratio_;				// the pre:post table size ratio we target with our automatic simplification heuristic
 	slim_generation_t simplify_elapsed_ = 0;	// the number of generations elapsed since a simplification was done (automatic or otherwise)
 	double simplify_interval_;					// the number of generations between automatic simplifications
+	double simplification_memory_limit_ = 0.0;	// if > 0, a limit in bytes on the tables, used by the cost-model scheduler instead of simplification_ratio_
+	size_t simplify_last_post_bytes_ = 0;		// the size of the tables just after the last simplification, from TreeSeqTableBytesInUse()
+	double simplify_last_duration_ = 0.0;		// the processor time taken by the last simplification, in seconds
+	clock_t simplify_last_end_clock_ = 0;		// clock() at the end of the last simplification, for measuring the time taken by generations
 	
 	slim_generation_t tree_seq_generation_ = 0;	// the generation for the tree sequence code, incremented after offspring generation
 												// this is needed since addSubpop() in an early() event makes one gen, and then the offspring
@@ -544,6 +604,8 @@ public:
 	inline __attribute__((always_inline)) bool SexEnabled(void) const														{ return sex_enabled_; }
 	inline __attribute__((always_inline)) bool PedigreesEnabled(void) const													{ return pedigrees_enabled_; }
 	inline __attribute__((always_inline)) bool PreventIncidentalSelfing(void) const											{ return prevent_incidental_selfing_; }
+	inline __attribute__((always_inline)) int ThreadCount(void) const														{ return thread_count_; }
+	inline __attribute__((always_inline)) bool UsingCounterRNG(void) const													{ return counter_rng_; }
 	inline __attribute__((always_inline)) GenomeType ModeledChromosomeType(void) const										{ return modeled_chromosome_type_; }
 	inline __attribute__((always_inline)) double XDominanceCoefficient(void) const											{ return x_chromosome_dominance_coeff_; }
 	inline __attribute__((always_inline)) int SpatialDimensionality(void) const												{ return spatial_dimensionality_; }
@@ -569,7 +631,6 @@ public:
 	static void MetadataForIndividual(Individual *p_individual, IndividualMetadataRec *p_metadata);
 	static void TreeSequenceDataToAscii(table_collection_t *p_tables);
 	static void DerivedStatesFromAscii(table_collection_t *p_tables);
-	static void DerivedStatesToAscii(table_collection_t *p_tables);
 	
 	void RecordTablePosition(void);
 	void AllocateTreeSequenceTables(void);
@@ -577,6 +638,9 @@ public:
 	void RecordNewGenome(std::vector<slim_position_t> *p_breakpoints, Genome *p_new_genome, const Genome *p_initial_parental_genome, const Genome *p_second_parental_genome);
 	void RecordNewDerivedState(const Genome *p_genome, slim_position_t p_position, const std::vector<Mutation *> &p_derived_mutations);
 	void RetractNewIndividual(void);
+	void BufferNewEdge(node_id_t p_parent, double p_left, double p_right, node_id_t p_child);
+	void BufferNewFullSpanEdge(node_id_t p_parent, node_id_t p_child);
+	void FlushEdgeBuffer(void);
     void AddIndividualsToTable(Individual * const *p_individual, size_t p_num_individuals, table_collection_t *p_tables, uint32_t p_flags);
 	void AddCurrentGenerationToIndividuals(table_collection_t *p_tables);
 	void UnmarkFirstGenerationSamples(table_collection_t *p_tables);
@@ -586,10 +650,14 @@ public:
 	void WriteProvenanceTable(table_collection_t *p_tables, bool p_use_newlines);
 	void ReadProvenanceTable(table_collection_t *p_tables, slim_generation_t *p_generation, SLiMModelType *p_model_type);
 	void WriteTreeSequence(std::string &p_recording_tree_path, bool p_binary, bool p_simplify);
-    void ReorderIndividualTable(table_collection_t *p_tables, std::vector<int> p_individual_map, bool p_keep_unmapped);
+	void WriteTreeSequenceToKastore(const std::string &p_path);
+    void ReorderIndividualTable(table_collection_t *p_tables, const std::vector<int> &p_individual_map, bool p_keep_unmapped);
+	void SortTreeSequenceTables(table_collection_t *p_tables, table_size_t p_sorted_edge_count);
 	void SimplifyTreeSequence(void);
 	void CheckCoalescenceAfterSimplification(void);
 	void CheckAutoSimplification(void);
+	void CheckCostModelSimplification(void);
+	size_t TreeSeqTableBytesInUse(void);
     void TreeSequenceDataFromAscii(std::string NodeFileName, 
             std::string EdgeFileName, std::string SiteFileName, std::string MutationFileName, 
             std::string IndividualsFileName, std::string PopulationFileName, std::string ProvenanceFileName);
@@ -597,15 +665,16 @@ public:
 	void RecordAllDerivedStatesFromSLiM(void);
 	void DumpMutationTable(void);
 	void CrosscheckTreeSeqIntegrity(void);
+	void TreeSequenceStatistics(std::vector<Subpopulation *> &p_subpops, bool p_branch_mode, size_t *p_sample_count, double *p_diversity, double *p_segregating, std::vector<double> *p_afs);
 	void TSXC_Enable(void);
 	
 	void __TabulateSubpopulationsFromTreeSequence(std::unordered_map<slim_objectid_t, ts_subpop_info> &p_subpopInfoMap, tree_sequence_t *p_ts, SLiMModelType p_file_model_type);
-	void __CreateSubpopulationsFromTabulation(std::unordered_map<slim_objectid_t, ts_subpop_info> &p_subpopInfoMap, EidosInterpreter *p_interpreter, std::unordered_map<node_id_t, Genome *> &p_nodeToGenomeMap);
+	void __CreateSubpopulationsFromTabulation(std::unordered_map<slim_objectid_t, ts_subpop_info> &p_subpopInfoMap, EidosInterpreter *p_interpreter, std::vector<Genome *> &p_nodeToGenomeMap);
 	void __ConfigureSubpopulationsFromTables(EidosInterpreter *p_interpreter);
-	void __TabulateMutationsFromTables(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutMap);
-	void __TallyMutationReferencesWithTreeSequence(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutMap, std::unordered_map<node_id_t, Genome *> p_nodeToGenomeMap, tree_sequence_t *p_ts);
-	void __CreateMutationsFromTabulation(std::unordered_map<slim_mutationid_t, ts_mut_info> &p_mutInfoMap, std::unordered_map<slim_mutationid_t, MutationIndex> &p_mutIndexMap);
-	void __AddMutationsFromTreeSequenceToGenomes(std::unordered_map<slim_mutationid_t, MutationIndex> &p_mutIndexMap, std::unordered_map<node_id_t, Genome *> p_nodeToGenomeMap, tree_sequence_t *p_ts);
+	void __TabulateMutationsFromTables(std::vector<ts_mut_info> &p_mutInfo);
+	void __TallyMutationReferencesWithTreeSequence(std::vector<ts_mut_info> &p_mutInfo, std::vector<Genome *> &p_nodeToGenomeMap, tree_sequence_t *p_ts);
+	void __CreateMutationsFromTabulation(std::vector<ts_mut_info> &p_mutInfo);
+	void __AddMutationsFromTreeSequenceToGenomes(std::vector<ts_mut_info> &p_mutInfo, std::vector<Genome *> &p_nodeToGenomeMap, tree_sequence_t *p_ts);
 	slim_generation_t _InstantiateSLiMObjectsFromTables(EidosInterpreter *p_interpreter);								// given tree-seq tables, makes individuals, genomes, and mutations
 	slim_generation_t _InitializePopulationFromMSPrimeTextFile(const char *p_file, EidosInterpreter *p_interpreter);	// initialize the population from an msprime text file
 	slim_generation_t _InitializePopulationFromMSPrimeBinaryFile(const char *p_file, EidosInterpreter *p_interpreter);	// initialize the population from an msprime binary file
@@ -674,6 +743,7 @@ public:
 	EidosValue_SP ExecuteMethod_treeSeqSimplify(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter);
 	EidosValue_SP ExecuteMethod_treeSeqRememberIndividuals(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter);
 	EidosValue_SP ExecuteMethod_treeSeqOutput(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter);
+	EidosValue_SP ExecuteMethod_treeSeqStatistics(EidosGlobalStringID p_method_id, const EidosValue_SP *const p_arguments, int p_argument_count, EidosInterpreter &p_interpreter);
 };
 
 
@@ -565,7 +565,7 @@ void _RunInitTests(void)
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(); initializeSLiMModelType('WF'); stop(); }", 1, 40, "must be called before", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeMutationRate(0.0); initializeSLiMModelType('WF'); stop(); }", 1, 44, "must be called before", __LINE__);
 	
-	// Test (void)initializeSLiMOptions([logical$ keepPedigrees = F], [string$ dimensionality = ""], [string$ periodicity = ""], [integer$ mutationRuns = 0], [logical$ preventIncidentalSelfing = F])
+	// Test (void)initializeSLiMOptions([logical$ keepPedigrees = F], [string$ dimensionality = ""], [string$ periodicity = ""], [integer$ mutationRuns = 0], [logical$ preventIncidentalSelfing = F], [integer$ threads = 1], [logical$ counterRNG = F])
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(F); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(T); stop(); }", __LINE__);
@@ -598,10 +598,27 @@ void _RunInitTests(void)
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(mutationRuns=100); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(preventIncidentalSelfing=F); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(preventIncidentalSelfing=T); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(threads=0); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(threads=1); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(threads=8); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(counterRNG=F); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMOptions(counterRNG=T); stop(); }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(counterRNG=T); initializeSex('X'); initializeMutationRate(1e-5); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-5); } 1 { sim.addSubpop('p1', 500); p1.setCloningRate(0.2); } 10 late() { n = size(sim.mutations); if ((n < 2000) | (n > 20000)) stop('implausible mutation count ' + n); }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(threads=4); initializeMutationRate(1e-7); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-6); } 1 { sim.addSubpop('p1', 2000); } 1:20 late() { sim.mutations; } 20 late() { if (size(unique(p1.genomes.mutations)) != size(sim.mutations)) stop('mismatch'); }", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(keepPedigrees=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(dimensionality=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(mutationRuns=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(preventIncidentalSelfing=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(threads=4); initializeMutationRate(1e-6); initializeMutationType('m1', 0.5, 'f', -0.01); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-6); } 1 { sim.addSubpop('p1', 2000); } 21 early() { for (ind in p1.individuals) { muts1 = ind.genome1.mutations; muts2 = ind.genome2.mutations; het = setSymmetricDifference(muts1, muts2); hom = setIntersection(muts1, muts2); w = product(1.0 + 0.5 * het.selectionCoeff) * product(1.0 + hom.selectionCoeff); if (abs(w - p1.cachedFitness(ind.index)) > 1e-6) stop('fitness mismatch'); } }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(threads=4); initializeSex('A'); initializeMutationRate(1e-6); initializeMutationType('m1', 0.5, 'f', -0.01); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-6); } 1 { sim.addSubpop('p1', 2000); } 21 early() { for (ind in p1.individuals) { muts1 = ind.genome1.mutations; muts2 = ind.genome2.mutations; het = setSymmetricDifference(muts1, muts2); hom = setIntersection(muts1, muts2); w = product(1.0 + 0.5 * het.selectionCoeff) * product(1.0 + hom.selectionCoeff); if (abs(w - p1.cachedFitness(ind.index)) > 1e-6) stop('fitness mismatch'); } }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(threads=4); initializeMutationRate(1e-6); initializeMutationType('m1', 0.5, 'f', -0.01); initializeMutationType('m2', 0.5, 'f', 0.0); initializeGenomicElementType('g1', c(m1, m2), c(1.0, 1.0)); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-6); } 1 { sim.addSubpop('p1', 2000); } fitness(m2) { return 1.02; } 21 early() { for (ind in p1.individuals) { muts1 = ind.genome1.mutations; muts2 = ind.genome2.mutations; het = setSymmetricDifference(muts1, muts2); hom = setIntersection(muts1, muts2); w = product(1.0 + 0.5 * het[het.mutationType == m1].selectionCoeff) * product(1.0 + hom[hom.mutationType == m1].selectionCoeff) * 1.02 ^ sum(c(het, hom).mutationType == m2); if (abs(w - p1.cachedFitness(ind.index)) > 1e-6) stop('fitness mismatch'); } }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(mutationRuns=20); initializeMutationRate(1e-6); initializeMutationType('m1', 0.5, 'f', -0.01); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-8); } 1 { sim.addSubpop('p1', 500); } 15 late() { for (mut in sim.mutations) mut.setSelectionCoeff(mut.selectionCoeff * 2.0); m1.dominanceCoeff = 0.2; } 16 early() { for (ind in p1.individuals) { muts1 = ind.genome1.mutations; muts2 = ind.genome2.mutations; het = setSymmetricDifference(muts1, muts2); hom = setIntersection(muts1, muts2); w = product(1.0 + 0.2 * het.selectionCoeff) * product(1.0 + hom.selectionCoeff); if (abs(w - p1.cachedFitness(ind.index)) > 1e-6) stop('fitness mismatch'); } }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(threads=4); initializeMutationRate(1e-6); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-6); } 1 { sim.addSubpop('p1', 2000); } 20 late() { muts = sim.mutations; counts = sapply(muts, 'sum(p1.genomes.containsMutations(applyValue));'); if (!identical(sim.mutationCounts(NULL, muts), counts)) stop('tally mismatch'); }", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(threads=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(counterRNG=NULL); stop(); }", 1, 15, "cannot be type NULL", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeSLiMModelType('nonWF'); initializeSLiMOptions(counterRNG=T); stop(); }", 1, 49, "supported only in WF models", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(threads=-1); stop(); }", 1, 15, "parameter threads must be", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(threads=2000); stop(); }", 1, 15, "parameter threads must be", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(dimensionality='foo'); stop(); }", 1, 15, "legal non-empty values", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(dimensionality='y'); stop(); }", 1, 15, "legal non-empty values", __LINE__);
 	SLiMAssertScriptRaise("initialize() { initializeSLiMOptions(dimensionality='z'); stop(); }", 1, 15, "legal non-empty values", __LINE__);
@@ -825,6 +842,7 @@ void _RunSLiMSimTests(void)
 	SLiMAssertScriptSuccess(gen1_setup_p1p2p3 + "1 late() { sim.outputFull('/tmp/slimOutputFullTest.slimbinary', T); }", __LINE__);						// legal, output to file path; this test might work only on Un*x systems
 	SLiMAssertScriptSuccess(gen1_setup_i1x + "1 late() { p1.individuals.x = runif(10); sim.outputFull('/tmp/slimOutputFullTest_POSITIONS.txt'); }", __LINE__);
 	SLiMAssertScriptSuccess(gen1_setup_i1x + "1 late() { p1.individuals.x = runif(10); sim.outputFull('/tmp/slimOutputFullTest_POSITIONS.slimbinary', T); }", __LINE__);
+	SLiMAssertScriptRaise(gen1_setup_p1p2p3 + "1 late() { sim.outputFull('/tmp/slimCheckpointTest.txt', checkpoint=T); }", 1, 308, "only in binary format", __LINE__);
 	
 	// Test sim - (void)outputMutations(object<Mutation> mutations)
 	SLiMAssertScriptSuccess(gen1_setup_highmut_p1 + "5 late() { sim.outputMutations(sim.mutations); }", __LINE__);											// legal; should have some mutations by gen 5
@@ -846,6 +864,12 @@ void _RunSLiMSimTests(void)
 	SLiMAssertScriptSuccess(gen1_setup_p1 + "1 { sim.readFromPopulationFile('/tmp/slimOutputFullTest.txt'); if (size(sim.subpopulations) != 3) stop(); }", __LINE__);			// legal; should wipe previous state
 	SLiMAssertScriptSuccess(gen1_setup_p1 + "1 { sim.readFromPopulationFile('/tmp/slimOutputFullTest.slimbinary'); if (size(sim.subpopulations) != 3) stop(); }", __LINE__);	// legal; should wipe previous state
 	
+	// checkpoints: a run resumed from a checkpoint should continue exactly as the original run did, including the random number stream
+	std::string checkpoint_script("1 late() { if (RESUME) sim.readFromPopulationFile('/tmp/slimCheckpointTest.slimbinary'); } 5 late() { p1.individuals.tag = 1:10; sim.registerLateEvent('s9', '{ sim.tag = sim.generation; }', 12, 14); } 10 late() { sim.outputFull('/tmp/slimCheckpointTest.slimbinary', binary=T, checkpoint=T); } 20 late() { s = paste(c(sim.generation, sim.tag, runif(1), sum(p1.individuals.tag), sim.mutations.id, p1.genomes.mutations.id)); if (!RESUME) writeFile('/tmp/slimCheckpointTest.txt', s); else if (readFile('/tmp/slimCheckpointTest.txt') != s) stop(); }");
+	SLiMAssertScriptSuccess("initialize() { defineConstant('RESUME', F); } " + gen1_setup_highmut_p1 + checkpoint_script, __LINE__);
+	SLiMAssertScriptSuccess("initialize() { defineConstant('RESUME', T); } " + gen1_setup_highmut_p1 + checkpoint_script, __LINE__);												// depends on the test above
+	SLiMAssertScriptRaise("initialize() { initializeSex('A'); } " + gen1_setup_highmut_p1 + "1 late() { sim.readFromPopulationFile('/tmp/slimCheckpointTest.slimbinary'); }", 1, 253, "hermaphroditism mismatch", __LINE__);
+	
 	// Test sim - (object<SLiMEidosBlock>)registerEarlyEvent(Nis$ id, string$ source, [integer$ start], [integer$ end])
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { sim.registerEarlyEvent(NULL, '{ stop(); }', 2, 2); }", __LINE__);
 	SLiMAssertScriptRaise(gen1_setup_p1 + "1 { sim.registerEarlyEvent('s1', '{ stop(); }', 2, 2); } s1 { }", 1, 251, "already defined", __LINE__);
@@ -1623,6 +1647,7 @@ void _RunGenomeTests(void)
 	SLiMAssertScriptRaise(gen1_setup_p1 + "1 { gen = p1.genomes[0]; mut = gen.addNewMutation(1, 0.1, 100000, NULL, 1); p1.genomes.addMutations(mut); stop(); }", 1, 278, "past the end", __LINE__);
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { gen = p1.genomes[0]; mut = gen.addNewMutation(1, 0.1, 5000, NULL, 237); p1.genomes.addMutations(mut); stop(); }", __LINE__);							// bad subpop, but this is legal to allow "tagging" of mutations
 	SLiMAssertScriptRaise(gen1_setup_p1 + "1 { gen = p1.genomes[0]; mut = gen.addNewMutation(1, 0.1, 5000, NULL, -1); p1.genomes.addMutations(mut); stop(); }", 1, 278, "out of range", __LINE__);	// however, such tags must be within range
+	SLiMAssertScriptStop(gen1_setup_p1 + "1 { gen = p1.genomes[0]; mut = gen.addNewMutation(m1, 0.25, 5000); gen.addNewMutation(m1, 0.0, 0:39999); if ((mut.position == 5000) & (mut.selectionCoeff == 0.25) & (size(sim.mutations) == 40001)) stop(); }", __LINE__);			// mut must remain valid while the mutation block grows
 	
 	// Test Genome + (object<Mutation>)addNewDrawnMutation(io<MutationType> mutationType, integer position, [Ni originGeneration], [io<Subpopulation> originSubpop]) with new class method non-multiplex behavior
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { p1.genomes.addNewDrawnMutation(m1, 5000, 10, p1); stop(); }", __LINE__);
@@ -2662,6 +2687,8 @@ void _RunIndividualTests(void)
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { i = p1.individuals; i.fitnessScaling = 0.0; if (all(i.fitnessScaling == 0.0)) stop(); }", __LINE__);
 	SLiMAssertScriptRaise(gen1_setup_p1 + "1 { i = p1.individuals; i.fitnessScaling = -0.01; }", 1, 284, "must be >= 0.0", __LINE__);
 	SLiMAssertScriptRaise(gen1_setup_p1 + "1 { i = p1.individuals; i.fitnessScaling = NAN; }", 1, 284, "must be >= 0.0", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(keepPedigrees=T); initializeMutationRate(0); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 999); initializeRecombinationRate(0); } 1 { sim.addSubpop('p1', 100); } 1:10 late() { i = p1.individuals; if (sim.generation > 1) if (!all(match(i.pedigreeParentIDs, sim.getValue('ids')) >= 0)) stop('parent drawn with zero fitness'); i.fitnessScaling = c(2.0, 1.0, rep(0.0, 98)); sim.setValue('ids', i[0:1].pedigreeID); }", __LINE__);
+	SLiMAssertScriptSuccess("initialize() { initializeSLiMOptions(keepPedigrees=T); initializeSex('A'); initializeMutationRate(0); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 999); initializeRecombinationRate(0); } 1 { sim.addSubpop('p1', 100); } 1:10 late() { i = p1.individuals; if (sim.generation > 1) if (!all(match(i.pedigreeParentIDs, sim.getValue('ids')) >= 0)) stop('parent drawn with zero fitness'); i.fitnessScaling = 0.0; f = i[i.sex == 'F']; m = i[i.sex == 'M']; f[0:1].fitnessScaling = c(1.5, 1.0); m[0].fitnessScaling = 1.0; sim.setValue('ids', c(f[0:1].pedigreeID, m[0].pedigreeID)); }", __LINE__);
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { i = p1.individuals; i.x = 135.0; if (all(i.x == 135.0)) stop(); }", __LINE__);
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { i = p1.individuals; i.y = 135.0; if (all(i.y == 135.0)) stop(); }", __LINE__);
 	SLiMAssertScriptStop(gen1_setup_p1 + "1 { i = p1.individuals; i.z = 135.0; if (all(i.z == 135.0)) stop(); }", __LINE__);
@@ -3606,6 +3633,13 @@ void _RunTreeSeqTests(void)
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(recordMutations=T, simplificationRatio=INF, checkCoalescence=T, runCrosschecks=T); } " + gen1_setup_p1 + "100 { stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(recordMutations=F, simplificationRatio=0.0, checkCoalescence=T, runCrosschecks=T); } " + gen1_setup_p1 + "100 { stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(recordMutations=T, simplificationRatio=0.0, checkCoalescence=T, runCrosschecks=T); } " + gen1_setup_p1 + "100 { stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(simplificationMemoryLimit=1e6); } " + gen1_setup_p1 + "100 { stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T, simplificationMemoryLimit=1000); } " + gen1_setup_highmut_p1 + "100 { stop(); }", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(simplificationMemoryLimit=0); } " + gen1_setup_p1 + "100 { stop(); }", 1, 15, "greater than 0 and finite", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(simplificationMemoryLimit=INF); } " + gen1_setup_p1 + "100 { stop(); }", 1, 15, "greater than 0 and finite", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(simplificationRatio=5.0, simplificationMemoryLimit=1e6); } " + gen1_setup_p1 + "100 { stop(); }", 1, 15, "does not allow both", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T, crosscheckInterval=10); } " + gen1_setup_highmut_p1 + "100 { stop(); }", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(runCrosschecks=T, crosscheckInterval=0); } " + gen1_setup_p1 + "100 { stop(); }", 1, 15, "crosscheckInterval to be between", __LINE__);
 	
 	// treeSeqCoalesced()
 	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "1: { sim.treeSeqCoalesced(); } 100 { stop(); }", 1, 290, "coalescence checking is enabled", __LINE__);
@@ -3614,16 +3648,34 @@ void _RunTreeSeqTests(void)
 	// treeSeqSimplify()
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "50 { sim.treeSeqSimplify(); } 100 { stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "1: { sim.treeSeqSimplify(); } 100 { stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); } " + gen1_setup_highmut_p1 + "1: late() { sim.treeSeqSimplify(); } 30 late() { sim.treeSeqRememberIndividuals(p1.individuals[0:2]); } 100 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_simplify.trees', simplify=F); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMModelType('nonWF'); initializeTreeSeq(runCrosschecks=T); initializeMutationRate(1e-5); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-8); } reproduction() { subpop.addCrossed(individual, subpop.sampleIndividuals(1)); } 1 { sim.addSubpop('p1', 10); } early() { p1.fitnessScaling = 10 / p1.individualCount; } 1: late() { sim.treeSeqSimplify(); } 30 late() { sim.treeSeqRememberIndividuals(p1.individuals[0:2]); } 100 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_simplify_nonWF.trees', simplify=F); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); } " + gen1_setup_highmut_p1 + "modifyChild() { return (runif(1) < 0.7); } 1: late() { if (sim.generation % 7 == 0) sim.treeSeqSimplify(); } 100 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_simplify_retract.trees', simplify=T); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); } " + gen1_setup_highmut_p1 + "1 { p1.setCloningRate(0.6); p1.setSelfingRate(0.5); } modifyChild() { return (runif(1) < 0.8); } 1: late() { if (sim.generation % 7 == 0) sim.treeSeqSimplify(); } 100 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_simplify_clonal.trees', simplify=T); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeSLiMModelType('nonWF'); initializeTreeSeq(runCrosschecks=T); initializeMutationRate(1e-5); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-8); } reproduction() { for (i in 1:3) subpop.addCloned(individual); } modifyChild() { return (runif(1) < 0.8); } 1 { sim.addSubpop('p1', 20); } early() { p1.fitnessScaling = 20 / p1.individualCount; } 1: late() { if (sim.generation % 5 == 0) sim.treeSeqSimplify(); } 60 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_simplify_clonal_nonWF.trees', simplify=T); stop(); }", __LINE__);
 	
 	// treeSeqRememberIndividuals()
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "50 { sim.treeSeqRememberIndividuals(p1.individuals); } 100 { sim.treeSeqSimplify(); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "1: { sim.treeSeqRememberIndividuals(p1.individuals); } 100 { sim.treeSeqSimplify(); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); } " + gen1_setup_p1 + "1: late() { sim.treeSeqRememberIndividuals(p1.sampleIndividuals(2)); if (sim.generation % 10 == 0) sim.treeSeqSimplify(); } 1 { sim.tag = 0; } 30 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_remember.trees', simplify=F); } 35 late() { if (sim.tag == 0) { sim.tag = 1; sim.readFromPopulationFile('/tmp/SLiM_treeSeq_remember.trees'); } } 60 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_remember.trees'); stop(); }", __LINE__);
 	
 	// treeSeqOutput()
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 { sim.treeSeqOutput('/tmp/SLiM_treeSeq_1.trees', simplify=F, _binary=F); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 { sim.treeSeqOutput('/tmp/SLiM_treeSeq_2.trees', simplify=T, _binary=F); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 { sim.treeSeqOutput('/tmp/SLiM_treeSeq_3.trees', simplify=F, _binary=T); stop(); }", __LINE__);
 	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 { sim.treeSeqOutput('/tmp/SLiM_treeSeq_4.trees', simplify=T, _binary=T); stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); } " + gen1_setup_highmut_p1 + "20 late() { sim.treeSeqRememberIndividuals(p1.individuals[0:2]); } 30 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_5.trees', simplify=F); } 60 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_5.trees', simplify=F); } 61 late() { sim.readFromPopulationFile('/tmp/SLiM_treeSeq_5.trees'); if (sim.generation == 60) stop(); }", __LINE__);
+	
+	// round-trip stacked derived states through binary and text output and back, with crosschecks after loading
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); initializeMutationRate(1e-3); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99); initializeRecombinationRate(1e-3); } 1 { sim.addSubpop('p1', 10); } 50 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_stacked.trees', simplify=F); defineConstant('IDS', sort(p1.genomes.mutations.id)); } 51 late() { sim.readFromPopulationFile('/tmp/SLiM_treeSeq_stacked.trees'); if (identical(sort(p1.genomes.mutations.id), IDS)) stop(); else sim.simulationFinished(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(runCrosschecks=T); initializeMutationRate(1e-3); initializeMutationType('m1', 0.5, 'f', 0.0); initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99); initializeRecombinationRate(1e-3); } 1 { sim.addSubpop('p1', 10); } 50 late() { sim.treeSeqOutput('/tmp/SLiM_treeSeq_stacked_text', simplify=F, _binary=F); defineConstant('IDS', sort(p1.genomes.mutations.id)); } 51 late() { sim.readFromPopulationFile('/tmp/SLiM_treeSeq_stacked_text'); if (identical(sort(p1.genomes.mutations.id), IDS)) stop(); else sim.simulationFinished(); }", __LINE__);
+	
+	// treeSeqDiversity(), treeSeqTajimasD(), treeSeqAFS()
+	SLiMAssertScriptRaise(gen1_setup_p1 + "100 late() { sim.treeSeqDiversity(); }", 1, 260, "tree recording is enabled", __LINE__);
+	SLiMAssertScriptRaise("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 late() { sim.treeSeqAFS(mode='sites'); }", 1, 298, "either \"site\" or \"branch\"", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); initializeMutationRate(1e-5); initializeMutationType('m1', 0.5, 'f', 0.0); m1.mutationStackPolicy = 'l'; initializeGenomicElementType('g1', m1, 1.0); initializeGenomicElement(g1, 0, 99999); initializeRecombinationRate(1e-8); } 1 { sim.addSubpop('p1', 10); } 100 late() { m = sim.mutations; c = sim.mutationCounts(p1, m); pi = 0.0; for (pos in unique(m.position)) { k = c[m.position == pos]; k = c(k, 20 - sum(k)); pi = pi + sum(k * (20 - k)); } pi = pi / (20 * 19) / 100000; afs = sim.treeSeqAFS(p1); if ((abs(sim.treeSeqDiversity() - pi) < 1e-12) & (size(afs) == 21) & (sum(afs[1:19]) >= sum(c < 20))) stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_highmut_p1 + "1:100 late() { if (sim.generation % 10 == 0) sim.treeSeqSimplify(); } 100 late() { pi = sim.treeSeqDiversity(mode='branch'); afs = sim.treeSeqAFS(c(p1, p1), mode='branch'); if ((pi > 0) & (size(afs) == 21) & !isNAN(sim.treeSeqTajimasD(p1, mode='branch')) & (sim.treeSeqDiversity(p1) == sim.treeSeqDiversity())) stop(); }", __LINE__);
+	SLiMAssertScriptStop("initialize() { initializeTreeSeq(); } " + gen1_setup_p1 + "100 late() { if (isNAN(sim.treeSeqDiversity(p1[F])) & (size(sim.treeSeqAFS(p1[F])) == 1)) stop(); }", __LINE__);
 }
 
 #pragma mark SLiM timing tests
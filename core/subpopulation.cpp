@@ -34,6 +34,7 @@
 #include <string>
 #include <map>
 #include <utility>
+#include <thread>
 
 extern std::vector<EidosValue_Object *> gEidosValue_Object_Genome_Registry;		// this is in Eidos; see Subpopulation::ExecuteMethod_takeMigrants()
 extern std::vector<EidosValue_Object *> gEidosValue_Object_Individual_Registry;	// this is in Eidos; see Subpopulation::ExecuteMethod_takeMigrants()
@@ -1051,7 +1052,7 @@ Subpopulation::Subpopulation(Population &p_population, slim_objectid_t p_subpopu
 		for (slim_popsize_t i = 0; i < parent_subpop_size_; i++)
 			*(fitness_buffer_ptr++) = 1.0;
 		
-		lookup_parent_ = gsl_ran_discrete_preproc(parent_subpop_size_, cached_parental_fitness_);
+		lookup_parent_.Rebuild(parent_subpop_size_, cached_parental_fitness_);
 	}
 #endif	// SLIM_WF_ONLY
 }
@@ -1115,8 +1116,8 @@ Subpopulation::Subpopulation(Population &p_population, slim_objectid_t p_subpopu
 			*(male_buffer_ptr++) = 1.0;
 		}
 		
-		lookup_female_parent_ = gsl_ran_discrete_preproc(parent_first_male_index_, cached_parental_fitness_);
-		lookup_male_parent_ = gsl_ran_discrete_preproc(num_males, cached_parental_fitness_ + parent_first_male_index_);
+		lookup_female_parent_.Rebuild(parent_first_male_index_, cached_parental_fitness_);
+		lookup_male_parent_.Rebuild(num_males, cached_parental_fitness_ + parent_first_male_index_);
 	}
 #endif	// SLIM_WF_ONLY
 }
@@ -1127,15 +1128,6 @@ Subpopulation::~Subpopulation(void)
 	//std::cout << "Subpopulation::~Subpopulation" << std::endl;
 	
 #ifdef SLIM_WF_ONLY
-	if (lookup_parent_)
-		gsl_ran_discrete_free(lookup_parent_);
-	
-	if (lookup_female_parent_)
-		gsl_ran_discrete_free(lookup_female_parent_);
-	
-	if (lookup_male_parent_)
-		gsl_ran_discrete_free(lookup_male_parent_);
-	
 	if (cached_parental_fitness_)
 		free(cached_parental_fitness_);
 	
@@ -1199,6 +1191,109 @@ Subpopulation::~Subpopulation(void)
 	}
 }
 
+// Check whether the given fitness() callbacks can be applied on worker threads.  That is true only if every active callback is either
+// a constant expression such as "{ return 1.1; }", or a simple expression that SLiMSim::OptimizeScriptBlock() has optimized, so that
+// ApplyFitnessCallbacks() never needs to run the Eidos interpreter, which is not thread-safe.  Callbacks that would raise an error
+// (a constant that is not a float singleton, for example) are rejected here, so that the error is raised on the main thread.
+bool Subpopulation::FitnessCallbacksAreThreadSafe(std::vector<SLiMEidosBlock*> &p_fitness_callbacks)
+{
+#if defined(SLIMGUI) && (SLIMPROFILING == 1)
+	// ApplyFitnessCallbacks() accumulates profiling information, which is not thread-safe
+	(void)p_fitness_callbacks;
+	return false;
+#else
+	for (SLiMEidosBlock *fitness_callback : p_fitness_callbacks)
+	{
+		if (fitness_callback->active_)
+		{
+			const EidosASTNode *compound_statement_node = fitness_callback->compound_statement_node_;
+			
+			if (compound_statement_node->cached_return_value_)
+			{
+				EidosValue *result = compound_statement_node->cached_return_value_.get();
+				
+				if ((result->Type() != EidosValueType::kValueFloat) || (result->Count() != 1))
+					return false;
+			}
+			else if (!fitness_callback->has_cached_optimization_ || !fitness_callback->has_cached_opt_reciprocal)
+			{
+				return false;
+			}
+		}
+	}
+	
+	return true;
+#endif
+}
+
+// Calculate the fitness of every parent, and put it in cached_fitness_UNSAFE_, using up to p_thread_count threads.  The caller is
+// responsible for determining that this is safe; there must be no global fitness() callbacks, and FitnessCallbacksAreThreadSafe()
+// must be true for p_fitness_callbacks.  The work of each individual is independent, except that FitnessOfParent...() validates
+// the nonneutral mutation caches of the mutation runs it visits, and mutation runs are shared between genomes; so we validate all
+// of those caches here first, on the main thread, and the worker threads then only read from shared state.
+#define SLIM_MIN_FITNESS_CALCULATIONS_PER_THREAD	512
+
+void Subpopulation::CalculateParentFitnessThreaded(int p_thread_count, double p_subpop_fitness_scaling, bool p_fitness_callbacks_exist, std::vector<SLiMEidosBlock*> &p_fitness_callbacks, bool p_single_fitness_callback, MutationType *p_single_callback_mut_type)
+{
+	int thread_count = p_thread_count;
+	
+	if (parent_subpop_size_ / SLIM_MIN_FITNESS_CALCULATIONS_PER_THREAD < thread_count)
+		thread_count = std::max(1, parent_subpop_size_ / SLIM_MIN_FITNESS_CALCULATIONS_PER_THREAD);
+	
+#if SLIM_USE_NONNEUTRAL_CACHES
+	SLiMSim &sim = population_.sim_;
+	int32_t nonneutral_change_counter = sim.nonneutral_change_counter_;
+	int32_t nonneutral_regime = sim.last_nonneutral_regime_;
+	
+	for (slim_popsize_t genome_index = 0; genome_index < parent_subpop_size_ * 2; ++genome_index)
+	{
+		Genome *genome = parent_genomes_[genome_index];
+		
+		if (!genome->IsNull())
+		{
+			const int32_t mutrun_count = genome->mutrun_count_;
+			
+			for (int run_index = 0; run_index < mutrun_count; ++run_index)
+				genome->mutruns_[run_index]->validate_nonneutral_cache(nonneutral_change_counter, nonneutral_regime);
+		}
+	}
+#endif
+	
+	auto calculate_chunk = [this, thread_count, p_subpop_fitness_scaling, p_fitness_callbacks_exist, &p_fitness_callbacks, p_single_fitness_callback, p_single_callback_mut_type](int p_thread_index) {
+		slim_popsize_t chunk_start = (slim_popsize_t)(((int64_t)parent_subpop_size_ * p_thread_index) / thread_count);
+		slim_popsize_t chunk_end = (slim_popsize_t)(((int64_t)parent_subpop_size_ * (p_thread_index + 1)) / thread_count);
+		
+		for (slim_popsize_t individual_index = chunk_start; individual_index < chunk_end; individual_index++)
+		{
+			double fitness = p_subpop_fitness_scaling * parent_individuals_[individual_index]->fitness_scaling_;
+			
+			if (fitness > 0)
+			{
+				if (!p_fitness_callbacks_exist)
+					fitness *= FitnessOfParentWithGenomeIndices_NoCallbacks(individual_index);
+				else if (p_single_fitness_callback)
+					fitness *= FitnessOfParentWithGenomeIndices_SingleCallback(individual_index, p_fitness_callbacks, p_single_callback_mut_type);
+				else
+					fitness *= FitnessOfParentWithGenomeIndices_Callbacks(individual_index, p_fitness_callbacks);
+			}
+			
+			parent_individuals_[individual_index]->cached_fitness_UNSAFE_ = fitness;
+		}
+	};
+	
+	std::vector<std::thread> workers;
+	
+	workers.reserve(thread_count - 1);
+	
+	for (int thread_index = 1; thread_index < thread_count; ++thread_index)
+		workers.emplace_back(calculate_chunk, thread_index);
+	
+	calculate_chunk(0);
+	
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
 void Subpopulation::UpdateFitness(std::vector<SLiMEidosBlock*> &p_fitness_callbacks, std::vector<SLiMEidosBlock*> &p_global_fitness_callbacks)
 {
 	const std::map<slim_objectid_t,MutationType*> &mut_types = population_.sim_.MutationTypes();
@@ -1400,6 +1495,20 @@ void Subpopulation::UpdateFitness(std::vector<SLiMEidosBlock*> &p_fitness_callba
 	bool pure_neutral = (!fitness_callbacks_exist && !global_fitness_callbacks_exist && population_.sim_.pure_neutral_);
 	double subpop_fitness_scaling = fitness_scaling_;
 	
+	// Decide whether to calculate fitness values on multiple threads.  We can do so when there are no global fitness() callbacks and
+	// no fitness() callback needs to run Eidos code; see CalculateParentFitnessThreaded().  In that case the cached fitness values are
+	// filled in up front, and the loops below just sum them up serially, in order, so totals do not depend upon the thread count.
+	int thread_count = population_.sim_.ThreadCount();
+	bool fitness_precalculated = false;
+	
+	if ((thread_count > 1) && !pure_neutral && !skip_chromosomal_fitness && !global_fitness_callbacks_exist &&
+		(parent_subpop_size_ >= 2 * SLIM_MIN_FITNESS_CALCULATIONS_PER_THREAD) &&
+		(!fitness_callbacks_exist || FitnessCallbacksAreThreadSafe(p_fitness_callbacks)))
+	{
+		CalculateParentFitnessThreaded(thread_count, subpop_fitness_scaling, fitness_callbacks_exist, p_fitness_callbacks, single_fitness_callback, single_callback_mut_type);
+		fitness_precalculated = true;
+	}
+	
 #if (!defined(SLIMGUI) && defined(SLIM_WF_ONLY))
 	// Reset our override of individual cached fitness values; we make this decision afresh with each UpdateFitness() call.  See
 	// the header for further comments on this mechanism.
@@ -1460,6 +1569,11 @@ void Subpopulation::UpdateFitness(std::vector<SLiMEidosBlock*> &p_fitness_callba
 				totalFemaleFitness += fitness;
 			}
 		}
+		else if (fitness_precalculated)
+		{
+			for (slim_popsize_t female_index = 0; female_index < parent_first_male_index_; female_index++)
+				totalFemaleFitness += parent_individuals_[female_index]->cached_fitness_UNSAFE_;
+		}
 		else
 		{
 			// general case for females
@@ -1539,6 +1653,11 @@ void Subpopulation::UpdateFitness(std::vector<SLiMEidosBlock*> &p_fitness_callba
 				totalMaleFitness += fitness;
 			}
 		}
+		else if (fitness_precalculated)
+		{
+			for (slim_popsize_t male_index = parent_first_male_index_; male_index < parent_subpop_size_; male_index++)
+				totalMaleFitness += parent_individuals_[male_index]->cached_fitness_UNSAFE_;
+		}
 		else
 		{
 			// general case for males
@@ -1621,6 +1740,11 @@ void Subpopulation::UpdateFitness(std::vector<SLiMEidosBlock*> &p_fitness_callba
 				totalFitness += fitness;
 			}
 		}
+		else if (fitness_precalculated)
+		{
+			for (slim_popsize_t individual_index = 0; individual_index < parent_subpop_size_; individual_index++)
+				totalFitness += parent_individuals_[individual_index]->cached_fitness_UNSAFE_;
+		}
 		else
 		{
 			// general case for hermaphrodites
@@ -1730,43 +1854,29 @@ void Subpopulation::UpdateWFFitnessBuffers(bool p_pure_neutral)
 	
 	cached_fitness_size_ = parent_subpop_size_;
 	
-	// Remake our mate-choice lookup tables
+	// Remake our mate-choice lookup tables; the tables keep their buffers, so this does not allocate in the steady state.  When
+	// fitness is uniform (p_pure_neutral, which is exactly when individual_cached_fitness_OVERRIDE_ gets set in WF models outside
+	// SLiMgui) we skip table construction, and the Draw...UsingFitness() methods draw uniformly; Rebuild() also notices uniform
+	// weights by itself (constant fitness() callbacks, for example) and skips building the alias table in that case.
 	if (sex_enabled_)
 	{
-		// throw out the old tables
-		if (lookup_female_parent_)
-		{
-			gsl_ran_discrete_free(lookup_female_parent_);
-			lookup_female_parent_ = nullptr;
-		}
-		
-		if (lookup_male_parent_)
+		if (p_pure_neutral)
 		{
-			gsl_ran_discrete_free(lookup_male_parent_);
-			lookup_male_parent_ = nullptr;
+			lookup_female_parent_.Invalidate();
+			lookup_male_parent_.Invalidate();
 		}
-		
-		// in pure neutral models we don't set up the discrete preproc
-		if (!p_pure_neutral)
+		else
 		{
-			lookup_female_parent_ = gsl_ran_discrete_preproc(parent_first_male_index_, cached_parental_fitness_);
-			lookup_male_parent_ = gsl_ran_discrete_preproc(parent_subpop_size_ - parent_first_male_index_, cached_parental_fitness_ + parent_first_male_index_);
+			lookup_female_parent_.Rebuild(parent_first_male_index_, cached_parental_fitness_);
+			lookup_male_parent_.Rebuild(parent_subpop_size_ - parent_first_male_index_, cached_parental_fitness_ + parent_first_male_index_);
 		}
 	}
 	else
 	{
-		// throw out the old tables
-		if (lookup_parent_)
-		{
-			gsl_ran_discrete_free(lookup_parent_);
-			lookup_parent_ = nullptr;
-		}
-		
-		// in pure neutral models we don't set up the discrete preproc
-		if (!p_pure_neutral)
-		{
-			lookup_parent_ = gsl_ran_discrete_preproc(parent_subpop_size_, cached_parental_fitness_);
-		}
+		if (p_pure_neutral)
+			lookup_parent_.Invalidate();
+		else
+			lookup_parent_.Rebuild(parent_subpop_size_, cached_parental_fitness_);
 	}
 }
 #endif	// SLIM_WF_ONLY
@@ -1796,8 +1906,8 @@ double Subpopulation::ApplyFitnessCallbacks(MutationIndex p_mutation, int p_homo
 				if (compound_statement_node->cached_return_value_)
 				{
 					// The script is a constant expression such as "{ return 1.1; }", so we can short-circuit it completely
-					EidosValue_SP result_SP = compound_statement_node->cached_return_value_;
-					EidosValue *result = result_SP.get();
+					// We don't take a reference to the cached value here, since this may run on a worker thread; see CalculateParentFitnessThreaded()
+					EidosValue *result = compound_statement_node->cached_return_value_.get();
 					
 					if ((result->Type() != EidosValueType::kValueFloat) || (result->Count() != 1))
 						EIDOS_TERMINATION << "ERROR (Subpopulation::ApplyFitnessCallbacks): fitness() callbacks must provide a float singleton return value." << EidosTerminate(fitness_callback->identifier_token_);
@@ -2066,6 +2176,9 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 #endif
 	
 	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	slim_selcoeff_t *one_plus_sel_ptr = gSLiM_Mutation_OnePlusSel;
+	slim_selcoeff_t *one_plus_dom_sel_ptr = gSLiM_Mutation_OnePlusDomSel;
 	Genome *genome1 = parent_genomes_[p_individual_index * 2];
 	Genome *genome2 = parent_genomes_[p_individual_index * 2 + 1];
 	bool genome1_null = genome1->IsNull();
@@ -2119,8 +2232,13 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 			else
 			{
 				// with other types of unpaired chromosomes (like the Y chromosome of a male when we are modeling the Y) there is no dominance coefficient
+#if SLIM_USE_NONNEUTRAL_CACHES
+				// so the effect of the run is the homozygous product cached along with the nonneutral cache
+				w *= mutrun->nonneutral_homozygous_product();
+#else
 				while (genome_iter != genome_max)
-					w *= (mut_block_ptr + *genome_iter++)->cached_one_plus_sel_;
+					w *= one_plus_sel_ptr[*genome_iter++];
+#endif
 			}
 		}
 		
@@ -2142,6 +2260,26 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 			
 			mutrun1->beginend_nonneutral_pointers(&genome1_iter, &genome1_max, nonneutral_change_counter, nonneutral_regime);
 			mutrun2->beginend_nonneutral_pointers(&genome2_iter, &genome2_max, nonneutral_change_counter, nonneutral_regime);
+			
+			// If both genomes share this run, every mutation in it is homozygous; if one run has no nonneutral mutations, every
+			// mutation in the other is heterozygous.  In those cases the product was cached with the nonneutral cache, so we can
+			// skip the merge walk below; it is needed only when the two runs differ and both have nonneutral mutations, since
+			// then the runs may still share mutations, which are homozygous.  See mutation_run.h.
+			if (mutrun1 == mutrun2)
+			{
+				w *= mutrun1->nonneutral_homozygous_product();
+				continue;
+			}
+			if (genome1_iter == genome1_max)
+			{
+				w *= mutrun2->nonneutral_heterozygous_product();
+				continue;
+			}
+			if (genome2_iter == genome2_max)
+			{
+				w *= mutrun1->nonneutral_heterozygous_product();
+				continue;
+			}
 #else
 			// Read directly from the MutationRun buffers
 			const MutationIndex *genome1_iter = mutrun1->begin_pointer_const();
@@ -2155,32 +2293,32 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 			if (genome1_iter != genome1_max && genome2_iter != genome2_max)
 			{
 				MutationIndex genome1_mutation = *genome1_iter, genome2_mutation = *genome2_iter;
-				slim_position_t genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_, genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+				slim_position_t genome1_iter_position = position_ptr[genome1_mutation], genome2_iter_position = position_ptr[genome2_mutation];
 				
 				do
 				{
 					if (genome1_iter_position < genome2_iter_position)
 					{
 						// Process a mutation in genome1 since it is leading
-						w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_;
+						w *= one_plus_dom_sel_ptr[genome1_mutation];
 						
 						if (++genome1_iter == genome1_max)
 							break;
 						else {
 							genome1_mutation = *genome1_iter;
-							genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+							genome1_iter_position = position_ptr[genome1_mutation];
 						}
 					}
 					else if (genome1_iter_position > genome2_iter_position)
 					{
 						// Process a mutation in genome2 since it is leading
-						w *= (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_;
+						w *= one_plus_dom_sel_ptr[genome2_mutation];
 						
 						if (++genome2_iter == genome2_max)
 							break;
 						else {
 							genome2_mutation = *genome2_iter;
-							genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+							genome2_iter_position = position_ptr[genome2_mutation];
 						}
 					}
 					else
@@ -2195,12 +2333,12 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 							const MutationIndex *genome2_matchscan = genome2_iter; 
 							
 							// advance through genome2 with genome2_matchscan, looking for a match for the current mutation in genome1, to determine whether we are homozygous or not
-							while (genome2_matchscan != genome2_max && (mut_block_ptr + *genome2_matchscan)->position_ == position)
+							while (genome2_matchscan != genome2_max && position_ptr[*genome2_matchscan] == position)
 							{
 								if (genome1_mutation == *genome2_matchscan) 		// note pointer equality test
 								{
 									// a match was found, so we multiply our fitness by the full selection coefficient
-									w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_sel_;
+									w *= one_plus_sel_ptr[genome1_mutation];
 									goto homozygousExit1;
 								}
 								
@@ -2208,7 +2346,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 							}
 							
 							// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-							w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_;
+							w *= one_plus_dom_sel_ptr[genome1_mutation];
 							
 						homozygousExit1:
 							
@@ -2216,7 +2354,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 								break;
 							else {
 								genome1_mutation = *genome1_iter;
-								genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+								genome1_iter_position = position_ptr[genome1_mutation];
 							}
 						} while (genome1_iter_position == position);
 						
@@ -2226,7 +2364,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 							const MutationIndex *genome1_matchscan = genome1_start; 
 							
 							// advance through genome1 with genome1_matchscan, looking for a match for the current mutation in genome2, to determine whether we are homozygous or not
-							while (genome1_matchscan != genome1_max && (mut_block_ptr + *genome1_matchscan)->position_ == position)
+							while (genome1_matchscan != genome1_max && position_ptr[*genome1_matchscan] == position)
 							{
 								if (genome2_mutation == *genome1_matchscan)		// note pointer equality test
 								{
@@ -2238,7 +2376,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 							}
 							
 							// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-							w *= (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_;
+							w *= one_plus_dom_sel_ptr[genome2_mutation];
 							
 						homozygousExit2:
 							
@@ -2246,7 +2384,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 								break;
 							else {
 								genome2_mutation = *genome2_iter;
-								genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+								genome2_iter_position = position_ptr[genome2_mutation];
 							}
 						} while (genome2_iter_position == position);
 						
@@ -2264,11 +2402,11 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_NoCallbacks(slim_popsize_
 			
 			// if genome1 is unfinished, finish it
 			while (genome1_iter != genome1_max)
-				w *= (mut_block_ptr + *genome1_iter++)->cached_one_plus_dom_sel_;
+				w *= one_plus_dom_sel_ptr[*genome1_iter++];
 			
 			// if genome2 is unfinished, finish it
 			while (genome2_iter != genome2_max)
-				w *= (mut_block_ptr + *genome2_iter++)->cached_one_plus_dom_sel_;
+				w *= one_plus_dom_sel_ptr[*genome2_iter++];
 		}
 		
 		return w;
@@ -2289,6 +2427,9 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 #endif
 	
 	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	slim_selcoeff_t *one_plus_sel_ptr = gSLiM_Mutation_OnePlusSel;
+	slim_selcoeff_t *one_plus_dom_sel_ptr = gSLiM_Mutation_OnePlusDomSel;
 	Individual *individual = parent_individuals_[p_individual_index];
 	Genome *genome1 = parent_genomes_[p_individual_index * 2];
 	Genome *genome2 = parent_genomes_[p_individual_index * 2 + 1];
@@ -2345,7 +2486,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 				{
 					MutationIndex genome_mutation = *genome_iter;
 					
-					w *= ApplyFitnessCallbacks(genome_mutation, -1, (mut_block_ptr + genome_mutation)->cached_one_plus_sel_, p_fitness_callbacks, individual, genome1, genome2);
+					w *= ApplyFitnessCallbacks(genome_mutation, -1, one_plus_sel_ptr[genome_mutation], p_fitness_callbacks, individual, genome1, genome2);
 					
 					if (w <= 0.0)
 						return 0.0;
@@ -2386,14 +2527,14 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 			if (genome1_iter != genome1_max && genome2_iter != genome2_max)
 			{
 				MutationIndex genome1_mutation = *genome1_iter, genome2_mutation = *genome2_iter;
-				slim_position_t genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_, genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+				slim_position_t genome1_iter_position = position_ptr[genome1_mutation], genome2_iter_position = position_ptr[genome2_mutation];
 				
 				do
 				{
 					if (genome1_iter_position < genome2_iter_position)
 					{
 						// Process a mutation in genome1 since it is leading
-						w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+						w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 						
 						if (w <= 0.0)
 							return 0.0;
@@ -2402,13 +2543,13 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							break;
 						else {
 							genome1_mutation = *genome1_iter;
-							genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+							genome1_iter_position = position_ptr[genome1_mutation];
 						}
 					}
 					else if (genome1_iter_position > genome2_iter_position)
 					{
 						// Process a mutation in genome2 since it is leading
-						w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+						w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 						
 						if (w <= 0.0)
 							return 0.0;
@@ -2417,7 +2558,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							break;
 						else {
 							genome2_mutation = *genome2_iter;
-							genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+							genome2_iter_position = position_ptr[genome2_mutation];
 						}
 					}
 					else
@@ -2432,12 +2573,12 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							const MutationIndex *genome2_matchscan = genome2_iter; 
 							
 							// advance through genome2 with genome2_matchscan, looking for a match for the current mutation in genome1, to determine whether we are homozygous or not
-							while (genome2_matchscan != genome2_max && (mut_block_ptr + *genome2_matchscan)->position_ == position)
+							while (genome2_matchscan != genome2_max && position_ptr[*genome2_matchscan] == position)
 							{
 								if (genome1_mutation == *genome2_matchscan)		// note pointer equality test
 								{
 									// a match was found, so we multiply our fitness by the full selection coefficient
-									w *= ApplyFitnessCallbacks(genome1_mutation, true, (mut_block_ptr + genome1_mutation)->cached_one_plus_sel_, p_fitness_callbacks, individual, genome1, genome2);
+									w *= ApplyFitnessCallbacks(genome1_mutation, true, one_plus_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 									
 									goto homozygousExit3;
 								}
@@ -2446,7 +2587,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							}
 							
 							// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-							w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+							w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 							
 						homozygousExit3:
 							
@@ -2457,7 +2598,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 								break;
 							else {
 								genome1_mutation = *genome1_iter;
-								genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+								genome1_iter_position = position_ptr[genome1_mutation];
 							}
 						} while (genome1_iter_position == position);
 						
@@ -2467,7 +2608,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							const MutationIndex *genome1_matchscan = genome1_start; 
 							
 							// advance through genome1 with genome1_matchscan, looking for a match for the current mutation in genome2, to determine whether we are homozygous or not
-							while (genome1_matchscan != genome1_max && (mut_block_ptr + *genome1_matchscan)->position_ == position)
+							while (genome1_matchscan != genome1_max && position_ptr[*genome1_matchscan] == position)
 							{
 								if (genome2_mutation == *genome1_matchscan)		// note pointer equality test
 								{
@@ -2479,7 +2620,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 							}
 							
 							// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-							w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+							w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 							
 							if (w <= 0.0)
 								return 0.0;
@@ -2490,7 +2631,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 								break;
 							else {
 								genome2_mutation = *genome2_iter;
-								genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+								genome2_iter_position = position_ptr[genome2_mutation];
 							}
 						} while (genome2_iter_position == position);
 						
@@ -2509,7 +2650,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 			{
 				MutationIndex genome1_mutation = *genome1_iter;
 				
-				w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+				w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 				
 				if (w <= 0.0)
 					return 0.0;
@@ -2522,7 +2663,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t
 			{
 				MutationIndex genome2_mutation = *genome2_iter;
 				
-				w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+				w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 				
 				if (w <= 0.0)
 					return 0.0;
@@ -2549,6 +2690,10 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 #endif
 	
 	Mutation *mut_block_ptr = gSLiM_Mutation_Block;
+	slim_position_t *position_ptr = gSLiM_Mutation_Positions;
+	MutationType **mut_type_ptr = gSLiM_Mutation_Types;
+	slim_selcoeff_t *one_plus_sel_ptr = gSLiM_Mutation_OnePlusSel;
+	slim_selcoeff_t *one_plus_dom_sel_ptr = gSLiM_Mutation_OnePlusDomSel;
 	Individual *individual = parent_individuals_[p_individual_index];
 	Genome *genome1 = parent_genomes_[p_individual_index * 2];
 	Genome *genome2 = parent_genomes_[p_individual_index * 2 + 1];
@@ -2590,7 +2735,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 					MutationIndex genome_mutation = *genome_iter;
 					slim_selcoeff_t selection_coeff = (mut_block_ptr + genome_mutation)->selection_coeff_;
 					
-					if ((mut_block_ptr + genome_mutation)->mutation_type_ptr_ == p_single_callback_mut_type)
+					if (mut_type_ptr[genome_mutation] == p_single_callback_mut_type)
 					{
 						w *= ApplyFitnessCallbacks(genome_mutation, -1, 1.0 + x_chromosome_dominance_coeff_ * selection_coeff, p_fitness_callbacks, individual, genome1, genome2);
 						
@@ -2618,16 +2763,16 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 				{
 					MutationIndex genome_mutation = *genome_iter;
 					
-					if ((mut_block_ptr + genome_mutation)->mutation_type_ptr_ == p_single_callback_mut_type)
+					if (mut_type_ptr[genome_mutation] == p_single_callback_mut_type)
 					{
-						w *= ApplyFitnessCallbacks(genome_mutation, -1, (mut_block_ptr + genome_mutation)->cached_one_plus_sel_, p_fitness_callbacks, individual, genome1, genome2);
+						w *= ApplyFitnessCallbacks(genome_mutation, -1, one_plus_sel_ptr[genome_mutation], p_fitness_callbacks, individual, genome1, genome2);
 						
 						if (w <= 0.0)
 							return 0.0;
 					}
 					else
 					{
-						w *= (mut_block_ptr + genome_mutation)->cached_one_plus_sel_;
+						w *= one_plus_sel_ptr[genome_mutation];
 					}
 					
 					genome_iter++;
@@ -2666,56 +2811,56 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 			if (genome1_iter != genome1_max && genome2_iter != genome2_max)
 			{
 				MutationIndex genome1_mutation = *genome1_iter, genome2_mutation = *genome2_iter;
-				slim_position_t genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_, genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+				slim_position_t genome1_iter_position = position_ptr[genome1_mutation], genome2_iter_position = position_ptr[genome2_mutation];
 				
 				do
 				{
 					if (genome1_iter_position < genome2_iter_position)
 					{
 						// Process a mutation in genome1 since it is leading
-						MutationType *genome1_muttype = (mut_block_ptr + genome1_mutation)->mutation_type_ptr_;
+						MutationType *genome1_muttype = mut_type_ptr[genome1_mutation];
 						
 						if (genome1_muttype == p_single_callback_mut_type)
 						{
-							w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+							w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 							
 							if (w <= 0.0)
 								return 0.0;
 						}
 						else
 						{
-							w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_;
+							w *= one_plus_dom_sel_ptr[genome1_mutation];
 						}
 						
 						if (++genome1_iter == genome1_max)
 							break;
 						else {
 							genome1_mutation = *genome1_iter;
-							genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+							genome1_iter_position = position_ptr[genome1_mutation];
 						}
 					}
 					else if (genome1_iter_position > genome2_iter_position)
 					{
 						// Process a mutation in genome2 since it is leading
-						MutationType *genome2_muttype = (mut_block_ptr + genome2_mutation)->mutation_type_ptr_;
+						MutationType *genome2_muttype = mut_type_ptr[genome2_mutation];
 						
 						if (genome2_muttype == p_single_callback_mut_type)
 						{
-							w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+							w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 							
 							if (w <= 0.0)
 								return 0.0;
 						}
 						else
 						{
-							w *= (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_;
+							w *= one_plus_dom_sel_ptr[genome2_mutation];
 						}
 						
 						if (++genome2_iter == genome2_max)
 							break;
 						else {
 							genome2_mutation = *genome2_iter;
-							genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+							genome2_iter_position = position_ptr[genome2_mutation];
 						}
 					}
 					else
@@ -2727,19 +2872,19 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 						// advance through genome1 as long as we remain at the same position, handling one mutation at a time
 						do
 						{
-							MutationType *genome1_muttype = (mut_block_ptr + genome1_mutation)->mutation_type_ptr_;
+							MutationType *genome1_muttype = mut_type_ptr[genome1_mutation];
 							
 							if (genome1_muttype == p_single_callback_mut_type)
 							{
 								const MutationIndex *genome2_matchscan = genome2_iter; 
 								
 								// advance through genome2 with genome2_matchscan, looking for a match for the current mutation in genome1, to determine whether we are homozygous or not
-								while (genome2_matchscan != genome2_max && (mut_block_ptr + *genome2_matchscan)->position_ == position)
+								while (genome2_matchscan != genome2_max && position_ptr[*genome2_matchscan] == position)
 								{
 									if (genome1_mutation == *genome2_matchscan)		// note pointer equality test
 									{
 										// a match was found, so we multiply our fitness by the full selection coefficient
-										w *= ApplyFitnessCallbacks(genome1_mutation, true, (mut_block_ptr + genome1_mutation)->cached_one_plus_sel_, p_fitness_callbacks, individual, genome1, genome2);
+										w *= ApplyFitnessCallbacks(genome1_mutation, true, one_plus_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 										
 										goto homozygousExit5;
 									}
@@ -2748,7 +2893,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								}
 								
 								// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-								w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+								w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 								
 							homozygousExit5:
 								
@@ -2760,12 +2905,12 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								const MutationIndex *genome2_matchscan = genome2_iter; 
 								
 								// advance through genome2 with genome2_matchscan, looking for a match for the current mutation in genome1, to determine whether we are homozygous or not
-								while (genome2_matchscan != genome2_max && (mut_block_ptr + *genome2_matchscan)->position_ == position)
+								while (genome2_matchscan != genome2_max && position_ptr[*genome2_matchscan] == position)
 								{
 									if (genome1_mutation == *genome2_matchscan) 		// note pointer equality test
 									{
 										// a match was found, so we multiply our fitness by the full selection coefficient
-										w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_sel_;
+										w *= one_plus_sel_ptr[genome1_mutation];
 										goto homozygousExit6;
 									}
 									
@@ -2773,7 +2918,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								}
 								
 								// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-								w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_;
+								w *= one_plus_dom_sel_ptr[genome1_mutation];
 								
 							homozygousExit6:
 								;
@@ -2783,21 +2928,21 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								break;
 							else {
 								genome1_mutation = *genome1_iter;
-								genome1_iter_position = (mut_block_ptr + genome1_mutation)->position_;
+								genome1_iter_position = position_ptr[genome1_mutation];
 							}
 						} while (genome1_iter_position == position);
 						
 						// advance through genome2 as long as we remain at the same position, handling one mutation at a time
 						do
 						{
-							MutationType *genome2_muttype = (mut_block_ptr + genome2_mutation)->mutation_type_ptr_;
+							MutationType *genome2_muttype = mut_type_ptr[genome2_mutation];
 							
 							if (genome2_muttype == p_single_callback_mut_type)
 							{
 								const MutationIndex *genome1_matchscan = genome1_start; 
 								
 								// advance through genome1 with genome1_matchscan, looking for a match for the current mutation in genome2, to determine whether we are homozygous or not
-								while (genome1_matchscan != genome1_max && (mut_block_ptr + *genome1_matchscan)->position_ == position)
+								while (genome1_matchscan != genome1_max && position_ptr[*genome1_matchscan] == position)
 								{
 									if (genome2_mutation == *genome1_matchscan)		// note pointer equality test
 									{
@@ -2809,7 +2954,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								}
 								
 								// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-								w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+								w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 								
 								if (w <= 0.0)
 									return 0.0;
@@ -2822,7 +2967,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								const MutationIndex *genome1_matchscan = genome1_start; 
 								
 								// advance through genome1 with genome1_matchscan, looking for a match for the current mutation in genome2, to determine whether we are homozygous or not
-								while (genome1_matchscan != genome1_max && (mut_block_ptr + *genome1_matchscan)->position_ == position)
+								while (genome1_matchscan != genome1_max && position_ptr[*genome1_matchscan] == position)
 								{
 									if (genome2_mutation == *genome1_matchscan)		// note pointer equality test
 									{
@@ -2834,7 +2979,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								}
 								
 								// no match was found, so we are heterozygous; we multiply our fitness by the selection coefficient and the dominance coefficient
-								w *= (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_;
+								w *= one_plus_dom_sel_ptr[genome2_mutation];
 								
 							homozygousExit8:
 								;
@@ -2844,7 +2989,7 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 								break;
 							else {
 								genome2_mutation = *genome2_iter;
-								genome2_iter_position = (mut_block_ptr + genome2_mutation)->position_;
+								genome2_iter_position = position_ptr[genome2_mutation];
 							}
 						} while (genome2_iter_position == position);
 						
@@ -2862,18 +3007,18 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 			while (genome1_iter != genome1_max)
 			{
 				MutationIndex genome1_mutation = *genome1_iter;
-				MutationType *genome1_muttype = (mut_block_ptr + genome1_mutation)->mutation_type_ptr_;
+				MutationType *genome1_muttype = mut_type_ptr[genome1_mutation];
 				
 				if (genome1_muttype == p_single_callback_mut_type)
 				{
-					w *= ApplyFitnessCallbacks(genome1_mutation, false, (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+					w *= ApplyFitnessCallbacks(genome1_mutation, false, one_plus_dom_sel_ptr[genome1_mutation], p_fitness_callbacks, individual, genome1, genome2);
 					
 					if (w <= 0.0)
 						return 0.0;
 				}
 				else
 				{
-					w *= (mut_block_ptr + genome1_mutation)->cached_one_plus_dom_sel_;
+					w *= one_plus_dom_sel_ptr[genome1_mutation];
 				}
 				
 				genome1_iter++;
@@ -2883,18 +3028,18 @@ double Subpopulation::FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsi
 			while (genome2_iter != genome2_max)
 			{
 				MutationIndex genome2_mutation = *genome2_iter;
-				MutationType *genome2_muttype = (mut_block_ptr + genome2_mutation)->mutation_type_ptr_;
+				MutationType *genome2_muttype = mut_type_ptr[genome2_mutation];
 				
 				if (genome2_muttype == p_single_callback_mut_type)
 				{
-					w *= ApplyFitnessCallbacks(genome2_mutation, false, (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_, p_fitness_callbacks, individual, genome1, genome2);
+					w *= ApplyFitnessCallbacks(genome2_mutation, false, one_plus_dom_sel_ptr[genome2_mutation], p_fitness_callbacks, individual, genome1, genome2);
 					
 					if (w <= 0.0)
 						return 0.0;
 				}
 				else
 				{
-					w *= (mut_block_ptr + genome2_mutation)->cached_one_plus_dom_sel_;
+					w *= one_plus_dom_sel_ptr[genome2_mutation];
 				}
 				
 				genome2_iter++;
@@ -3226,14 +3371,9 @@ size_t Subpopulation::MemoryUsageForParentTables(void)
 {
 	size_t usage = 0;
 	
-	if (lookup_parent_)
-		usage += lookup_parent_->K * (sizeof(size_t) + sizeof(double));
-	
-	if (lookup_female_parent_)
-		usage += lookup_female_parent_->K * (sizeof(size_t) + sizeof(double));
-	
-	if (lookup_male_parent_)
-		usage += lookup_male_parent_->K * (sizeof(size_t) + sizeof(double));
+	usage += lookup_parent_.MemoryUsage();
+	usage += lookup_female_parent_.MemoryUsage();
+	usage += lookup_male_parent_.MemoryUsage();
 	
 	return usage;
 }
@@ -121,9 +121,9 @@ class Subpopulation : public SLiMEidosDictionary
 private:
 	
 #ifdef SLIM_WF_ONLY
-	gsl_ran_discrete_t *lookup_parent_ = nullptr;			// OWNED POINTER: lookup table for drawing a parent based upon fitness
-	gsl_ran_discrete_t *lookup_female_parent_ = nullptr;	// OWNED POINTER: lookup table for drawing a female parent based upon fitness, SEX ONLY
-	gsl_ran_discrete_t *lookup_male_parent_ = nullptr;		// OWNED POINTER: lookup table for drawing a male parent based upon fitness, SEX ONLY
+	Eidos_AliasTable lookup_parent_;						// lookup table for drawing a parent based upon fitness; reused across generations
+	Eidos_AliasTable lookup_female_parent_;					// lookup table for drawing a female parent based upon fitness, SEX ONLY
+	Eidos_AliasTable lookup_male_parent_;					// lookup table for drawing a male parent based upon fitness, SEX ONLY
 #endif	// SLIM_WF_ONLY
 	
 	EidosSymbolTableEntry self_symbol_;						// for fast setup of the symbol table
@@ -351,6 +351,10 @@ public:
 	double FitnessOfParentWithGenomeIndices_Callbacks(slim_popsize_t p_individual_index, std::vector<SLiMEidosBlock*> &p_fitness_callbacks);
 	double FitnessOfParentWithGenomeIndices_SingleCallback(slim_popsize_t p_individual_index, std::vector<SLiMEidosBlock*> &p_fitness_callbacks, MutationType *p_single_callback_mut_type);
 	
+	// calculate and cache the fitness of all parents on multiple threads; only valid when no callback would need to run Eidos code
+	bool FitnessCallbacksAreThreadSafe(std::vector<SLiMEidosBlock*> &p_fitness_callbacks);
+	void CalculateParentFitnessThreaded(int p_thread_count, double p_subpop_fitness_scaling, bool p_fitness_callbacks_exist, std::vector<SLiMEidosBlock*> &p_fitness_callbacks, bool p_single_fitness_callback, MutationType *p_single_callback_mut_type);
+	
 	double ApplyFitnessCallbacks(MutationIndex p_mutation, int p_homozygous, double p_computed_fitness, std::vector<SLiMEidosBlock*> &p_fitness_callbacks, Individual *p_individual, Genome *p_genome1, Genome *p_genome2);
 	double ApplyGlobalFitnessCallbacks(std::vector<SLiMEidosBlock*> &p_fitness_callbacks, slim_popsize_t p_individual_index);
 	
@@ -515,8 +519,8 @@ inline __attribute__((always_inline)) slim_popsize_t Subpopulation::DrawParentUs
 		EIDOS_TERMINATION << "ERROR (Subpopulation::DrawParentUsingFitness): (internal error) called on a population for which sex is enabled." << EidosTerminate();
 #endif
 	
-	if (lookup_parent_)
-		return static_cast<slim_popsize_t>(gsl_ran_discrete(EIDOS_GSL_RNG, lookup_parent_));
+	if (lookup_parent_.IsBuilt())
+		return static_cast<slim_popsize_t>(lookup_parent_.Draw(EIDOS_GSL_RNG));
 	else
 		return static_cast<slim_popsize_t>(Eidos_rng_uniform_int(EIDOS_GSL_RNG, parent_subpop_size_));
 }
@@ -541,8 +545,8 @@ inline __attribute__((always_inline)) slim_popsize_t Subpopulation::DrawFemalePa
 		EIDOS_TERMINATION << "ERROR (Subpopulation::DrawFemaleParentUsingFitness): (internal error) called on a population for which sex is not enabled." << EidosTerminate();
 #endif
 	
-	if (lookup_female_parent_)
-		return static_cast<slim_popsize_t>(gsl_ran_discrete(EIDOS_GSL_RNG, lookup_female_parent_));
+	if (lookup_female_parent_.IsBuilt())
+		return static_cast<slim_popsize_t>(lookup_female_parent_.Draw(EIDOS_GSL_RNG));
 	else
 		return static_cast<slim_popsize_t>(Eidos_rng_uniform_int(EIDOS_GSL_RNG, parent_first_male_index_));
 }
@@ -568,8 +572,8 @@ inline __attribute__((always_inline)) slim_popsize_t Subpopulation::DrawMalePare
 		EIDOS_TERMINATION << "ERROR (Subpopulation::DrawMaleParentUsingFitness): (internal error) called on a population for which sex is not enabled." << EidosTerminate();
 #endif
 	
-	if (lookup_male_parent_)
-		return static_cast<slim_popsize_t>(gsl_ran_discrete(EIDOS_GSL_RNG, lookup_male_parent_)) + parent_first_male_index_;
+	if (lookup_male_parent_.IsBuilt())
+		return static_cast<slim_popsize_t>(lookup_male_parent_.Draw(EIDOS_GSL_RNG)) + parent_first_male_index_;
 	else
 		return static_cast<slim_popsize_t>(Eidos_rng_uniform_int(EIDOS_GSL_RNG, parent_subpop_size_ - parent_first_male_index_) + parent_first_male_index_);
 }
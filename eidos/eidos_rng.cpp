@@ -22,6 +22,7 @@
 
 #include <unistd.h>
 #include <sys/time.h>
+#include <algorithm>
 
 
 Eidos_RNG_State gEidos_RNG;
@@ -121,6 +122,355 @@ double Eidos_FastRandomPoisson_PRECALCULATE(double p_mu)
 #endif
 
 
+#pragma mark -
+#pragma mark Eidos_AliasTable
+#pragma mark -
+
+Eidos_AliasTable::~Eidos_AliasTable(void)
+{
+	if (F_)
+		free(F_);
+	if (A_)
+		free(A_);
+	if (E_)
+		free(E_);
+	if (stacks_)
+		free(stacks_);
+}
+
+void Eidos_AliasTable::Rebuild(size_t p_count, const double *p_weights)
+{
+	// This follows gsl_ran_discrete_preproc() step by step, so that the table built is identical; see the header
+	if ((p_count < 1) || (p_count > UINT32_MAX))
+		EIDOS_TERMINATION << "ERROR (Eidos_AliasTable::Rebuild): (internal error) the number of events must be in [1, " << UINT32_MAX << "]." << EidosTerminate(nullptr);
+	
+	double pTotal = 0.0;
+	bool uniform = true;
+	double first_weight = p_weights[0];
+	
+	for (size_t k = 0; k < p_count; ++k)
+	{
+		double weight = p_weights[k];
+		
+		if (weight < 0)
+			EIDOS_TERMINATION << "ERROR (Eidos_AliasTable::Rebuild): (internal error) weights must be non-negative." << EidosTerminate(nullptr);
+		if (weight != first_weight)
+			uniform = false;
+		
+		pTotal += weight;
+	}
+	
+	if (!(pTotal > 0.0))
+		EIDOS_TERMINATION << "ERROR (Eidos_AliasTable::Rebuild): (internal error) weights must sum to a positive number." << EidosTerminate(nullptr);
+	
+	K_ = p_count;
+	uniform_ = uniform;
+	
+	if (uniform)
+		return;
+	
+	if (p_count > capacity_)
+	{
+		capacity_ = p_count;
+		F_ = (double *)realloc(F_, capacity_ * sizeof(double));
+		A_ = (uint32_t *)realloc(A_, capacity_ * sizeof(uint32_t));
+		E_ = (double *)realloc(E_, capacity_ * sizeof(double));
+		stacks_ = (uint32_t *)realloc(stacks_, capacity_ * sizeof(uint32_t));
+	}
+	
+	double *F = F_;
+	uint32_t *A = A_;
+	double *E = E_;
+	double mean = 1.0 / p_count;
+	
+	for (size_t k = 0; k < p_count; ++k)
+		E[k] = p_weights[k] / pTotal;
+	
+	// An index is on at most one stack at a time, so the two stacks share one buffer of size K; the small stack grows up from
+	// the bottom and the big stack grows down from the top, and both are LIFO exactly as in the GSL
+	uint32_t *smalls_bottom = stacks_, *smalls_top = stacks_;
+	uint32_t *bigs_bottom = stacks_ + p_count, *bigs_top = stacks_ + p_count;
+	
+	for (size_t k = 0; k < p_count; ++k)
+	{
+		if (E[k] < mean)
+			*(smalls_top++) = (uint32_t)k;
+		else
+			*(--bigs_top) = (uint32_t)k;
+	}
+	
+	while (smalls_top != smalls_bottom)
+	{
+		uint32_t s = *(--smalls_top);
+		
+		if (bigs_top == bigs_bottom)
+		{
+			A[s] = s;
+			F[s] = 1.0;
+			continue;
+		}
+		
+		uint32_t b = *(bigs_top++);
+		
+		A[s] = b;
+		F[s] = p_count * E[s];
+		
+		double d = mean - E[s];
+		
+		E[s] += d;
+		E[b] -= d;
+		
+		if (E[b] < mean)
+			*(smalls_top++) = b;
+		else if (E[b] > mean)
+			*(--bigs_top) = b;
+		else
+		{
+			A[b] = b;
+			F[b] = 1.0;
+		}
+	}
+	
+	while (bigs_top != bigs_bottom)
+	{
+		uint32_t b = *(bigs_top++);
+		
+		A[b] = b;
+		F[b] = 1.0;
+	}
+	
+	// Knuth's convention, as in the GSL: F'[k] = (k + F[k]) / K, which saves some arithmetic in Draw()
+	for (size_t k = 0; k < p_count; ++k)
+	{
+		F[k] += k;
+		F[k] /= p_count;
+	}
+}
+
+size_t Eidos_AliasTable::MemoryUsage(void) const
+{
+	return capacity_ * (sizeof(double) + sizeof(uint32_t) + sizeof(double) + sizeof(uint32_t));
+}
+
+
+#pragma mark -
+#pragma mark Eidos_CounterRNG
+#pragma mark -
+
+// The GSL's random distributions take a gsl_rng, so we provide a gsl_rng_type that draws from an Eidos_CounterRNG; this is used
+// for the Poisson and binomial draws with large means, where inversion would be slow, so that the GSL's algorithms can be used
+static unsigned long int Eidos_CounterRNG_gsl_get(void *p_state)
+{
+	return ((Eidos_CounterRNG *)p_state)->Next32();
+}
+
+static double Eidos_CounterRNG_gsl_get_double(void *p_state)
+{
+	return ((Eidos_CounterRNG *)p_state)->Uniform();
+}
+
+static void Eidos_CounterRNG_gsl_set(__attribute__((unused)) void *p_state, __attribute__((unused)) unsigned long int p_seed)
+{
+	// Eidos_CounterRNG is keyed at construction, and cannot be reseeded through the GSL
+}
+
+static const gsl_rng_type Eidos_CounterRNG_gsl_type = { "eidos_philox4x32_10", 0xffffffffUL, 0, 0, &Eidos_CounterRNG_gsl_set, &Eidos_CounterRNG_gsl_get, &Eidos_CounterRNG_gsl_get_double };
+
+Eidos_CounterRNG::Eidos_CounterRNG(uint64_t p_seed, uint32_t p_purpose, uint32_t p_id1, uint32_t p_id2, uint32_t p_id3) : buffer_index_(4)
+{
+	// Derive the key from the seed and purpose with the splitmix64 finalizer, so that similar seeds give unrelated keys
+	uint64_t z = p_seed + 0x9E3779B97F4A7C15ULL * ((uint64_t)p_purpose + 1);
+	
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	
+	key_[0] = (uint32_t)z;
+	key_[1] = (uint32_t)(z >> 32);
+	
+	counter_[0] = 0;
+	counter_[1] = p_id1;
+	counter_[2] = p_id2;
+	counter_[3] = p_id3;
+}
+
+void Eidos_CounterRNG::Philox4x32_10(const uint32_t *p_counter, const uint32_t *p_key, uint32_t *p_output)
+{
+	for (int i = 0; i < 4; ++i)
+		p_output[i] = p_counter[i];
+	
+	PhiloxRounds(p_output, p_key);
+}
+
+unsigned int Eidos_CounterRNG::PoissonLargeMean(double p_mu)
+{
+	gsl_rng adapter = { &Eidos_CounterRNG_gsl_type, this };
+	
+	return gsl_ran_poisson(&adapter, p_mu);
+}
+
+unsigned int Eidos_CounterRNG::BinomialLargeMean(unsigned int p_n, double p_p)
+{
+	gsl_rng adapter = { &Eidos_CounterRNG_gsl_type, this };
+	
+	return gsl_ran_binomial(&adapter, p_p, p_n);
+}
+
+// Below this mean (of the less likely outcome), binomial draws are done by inversion; this is the same crossover the GSL uses
+#define EIDOS_COUNTER_RNG_BINOMIAL_INVERSION_LIMIT	14
+
+static inline __attribute__((always_inline)) unsigned int Eidos_BinomialByInversion(double p_u, unsigned int p_n, double p_p)
+{
+	// BINV (Kachitvichyanukul & Schmeiser 1988), for p <= 0.5; one uniform per draw
+	double q = 1.0 - p_p;
+	double s = p_p / q;
+	double a = (p_n + 1) * s;
+	double r = pow(q, (double)p_n);
+	unsigned int x = 0;
+	
+	while (p_u > r)
+	{
+		p_u -= r;
+		++x;
+		
+		if (x >= p_n)
+			break;		// guard against roundoff in the cumulative sum
+		
+		r *= (a / x - s);
+	}
+	
+	return x;
+}
+
+unsigned int Eidos_CounterRNG::Binomial(unsigned int p_n, double p_p)
+{
+	if ((p_n == 0) || (p_p <= 0.0))
+		return 0;
+	if (p_p >= 1.0)
+		return p_n;
+	
+	bool flipped = (p_p > 0.5);
+	double p = (flipped ? 1.0 - p_p : p_p);
+	unsigned int x;
+	
+	if (p_n * p < EIDOS_COUNTER_RNG_BINOMIAL_INVERSION_LIMIT)
+		x = Eidos_BinomialByInversion(Uniform(), p_n, p);
+	else
+		x = BinomialLargeMean(p_n, p);
+	
+	return (flipped ? p_n - x : x);
+}
+
+void Eidos_CounterRNG::FillUniform(double *p_values, size_t p_count)
+{
+	// use up whatever is left in the current block first
+	while (p_count && (buffer_index_ < 4))
+	{
+		*(p_values++) = buffer_[buffer_index_++] / 4294967296.0;
+		--p_count;
+	}
+	
+	// then generate whole blocks straight into the output; each block depends only on its counter, not on the previous block
+	size_t block_count = p_count / 4;
+	uint32_t first_block = counter_[0];
+	
+	for (size_t block_index = 0; block_index < block_count; ++block_index)
+	{
+		uint32_t block[4];
+		
+		GenerateBlock(first_block + (uint32_t)block_index, block);
+		
+		p_values[block_index * 4] = block[0] / 4294967296.0;
+		p_values[block_index * 4 + 1] = block[1] / 4294967296.0;
+		p_values[block_index * 4 + 2] = block[2] / 4294967296.0;
+		p_values[block_index * 4 + 3] = block[3] / 4294967296.0;
+	}
+	
+	counter_[0] = first_block + (uint32_t)block_count;
+	p_values += block_count * 4;
+	p_count -= block_count * 4;
+	
+	// and finish off from a new block, leaving the rest of it buffered
+	while (p_count--)
+		*(p_values++) = Uniform();
+}
+
+// the bulk Poisson and binomial fills draw their uniforms in chunks of this size
+#define EIDOS_COUNTER_RNG_FILL_CHUNK	256
+
+void Eidos_CounterRNG::FillPoisson(unsigned int *p_values, size_t p_count, double p_mu)
+{
+	if (p_mu > 250)
+	{
+		for (size_t index = 0; index < p_count; ++index)
+			p_values[index] = PoissonLargeMean(p_mu);
+		return;
+	}
+	
+	double exp_neg_mu = exp(-p_mu);
+	double uniforms[EIDOS_COUNTER_RNG_FILL_CHUNK];
+	
+	while (p_count)
+	{
+		size_t chunk_count = std::min(p_count, (size_t)EIDOS_COUNTER_RNG_FILL_CHUNK);
+		
+		FillUniform(uniforms, chunk_count);
+		
+		for (size_t index = 0; index < chunk_count; ++index)
+		{
+			unsigned int x = 0;
+			double p = exp_neg_mu;
+			double s = p;
+			double u = uniforms[index];
+			
+			while (u > s)
+			{
+				++x;
+				p *= (p_mu / x);
+				s += p;
+			}
+			
+			p_values[index] = x;
+		}
+		
+		p_values += chunk_count;
+		p_count -= chunk_count;
+	}
+}
+
+void Eidos_CounterRNG::FillBinomial(unsigned int *p_values, size_t p_count, unsigned int p_n, double p_p)
+{
+	bool flipped = (p_p > 0.5);
+	double p = (flipped ? 1.0 - p_p : p_p);
+	
+	if ((p_n == 0) || (p_p <= 0.0) || (p_p >= 1.0) || (p_n * p >= EIDOS_COUNTER_RNG_BINOMIAL_INVERSION_LIMIT))
+	{
+		for (size_t index = 0; index < p_count; ++index)
+			p_values[index] = Binomial(p_n, p_p);
+		return;
+	}
+	
+	double uniforms[EIDOS_COUNTER_RNG_FILL_CHUNK];
+	
+	while (p_count)
+	{
+		size_t chunk_count = std::min(p_count, (size_t)EIDOS_COUNTER_RNG_FILL_CHUNK);
+		
+		FillUniform(uniforms, chunk_count);
+		
+		for (size_t index = 0; index < chunk_count; ++index)
+		{
+			unsigned int x = Eidos_BinomialByInversion(uniforms[index], p_n, p);
+			
+			p_values[index] = (flipped ? p_n - x : x);
+		}
+		
+		p_values += chunk_count;
+		p_count -= chunk_count;
+	}
+}
+
+
 #pragma mark -
 #pragma mark 64-bit MT
 #pragma mark -
@@ -282,6 +282,185 @@ double Eidos_FastRandomPoisson_PRECALCULATE(double p_mu);	// exp(-mu); can under
 #endif // USE_GSL_POISSON
 
 
+// Eidos_AliasTable draws from a discrete distribution over [0, K-1] in O(1) time per draw, using Walker's alias method.
+// It does the same job as gsl_ran_discrete_preproc() / gsl_ran_discrete(), and builds exactly the same table as the GSL
+// (the same stack discipline, the same Knuth convention for F), so for a given RNG state it draws exactly the same values.
+// The differences are that it keeps its buffers across calls to Rebuild(), rather than doing six mallocs and frees each
+// time a table is made, and that Draw() is inline and reads the taus2 state directly instead of going through the GSL's
+// function-pointer indirection.  If all weights are equal, Rebuild() skips table construction entirely and Draw() just
+// scales a single uniform deviate; the GSL's table for equal weights maps every slot to itself, so this is also exact.
+class Eidos_AliasTable
+{
+private:
+	size_t K_ = 0;				// number of events in the current table; 0 if the table has not been built
+	size_t capacity_ = 0;		// allocated size of the buffers below
+	bool uniform_ = false;		// if true, all weights are equal and F_ / A_ are not used
+	double *F_ = nullptr;		// OWNED POINTER: (k + F[k]) / K, where F[k] is the probability of keeping slot k
+	uint32_t *A_ = nullptr;		// OWNED POINTER: the alias for slot k
+	double *E_ = nullptr;		// OWNED POINTER: scratch space used by Rebuild() for normalized weights
+	uint32_t *stacks_ = nullptr;	// OWNED POINTER: scratch space used by Rebuild(); smalls grow up from the bottom, bigs down from the top
+	
+public:
+	Eidos_AliasTable(const Eidos_AliasTable&) = delete;					// no copying
+	Eidos_AliasTable& operator=(const Eidos_AliasTable&) = delete;		// no copying
+	Eidos_AliasTable(void) { }
+	~Eidos_AliasTable(void);
+	
+	void Rebuild(size_t p_count, const double *p_weights);				// set up the table for the given weights, which must be >= 0 and sum to > 0
+	inline void Invalidate(void) { K_ = 0; }							// mark the table as not built; IsBuilt() will return false
+	inline __attribute__((always_inline)) bool IsBuilt(void) const { return (K_ != 0); }
+	size_t MemoryUsage(void) const;
+	
+	inline __attribute__((always_inline)) size_t Draw(gsl_rng *p_r) const
+	{
+		// Note that gsl_ran_discrete() also returns c when F[c] == 1.0, but u < 1.0 always, so that check is redundant
+		double u = Eidos_rng_uniform(p_r);
+		size_t c = (size_t)(u * K_);
+		
+		if (uniform_ || (u < F_[c]))
+			return c;
+		
+		return A_[c];
+	}
+};
+
+
+// Eidos_CounterRNG is a counter-based random number generator, Philox4x32-10 (Salmon et al. 2011, "Parallel random numbers:
+// as easy as 1, 2, 3"), offered as an alternative to the shared taus2 generator above for code that needs to make draws
+// without shared state.  A counter-based generator is just a keyed bijection applied to a counter; a stream is identified by a
+// key derived from the seed and a "purpose" value, plus three 32-bit words identifying what the draws are for (in SLiM, e.g.,
+// a generation, a subpopulation, and a genome), and the fourth counter word then counts blocks of four 32-bit outputs within
+// that stream.  Any two streams with different identifiers are independent, and the draws made in a stream do not depend on
+// what draws have been made in any other stream, or in what order, so streams can be drawn from on any thread, reproducibly.
+// The bulk Fill methods are written so that successive blocks do not depend on each other, which lets the compiler vectorize
+// the Philox rounds across blocks.  The Poisson and binomial draws use inversion, consuming exactly one uniform per draw,
+// except for large means, for which the GSL's algorithms are used through a gsl_rng adapter that draws from this stream.
+class Eidos_CounterRNG
+{
+private:
+	uint32_t key_[2];			// derived from the seed and purpose
+	uint32_t counter_[4];		// counter_[0] is the next block to generate; counter_[1..3] identify the stream
+	uint32_t buffer_[4];		// the current block of output
+	int buffer_index_;			// the next unused word of buffer_; 4 if the buffer is exhausted
+	
+	static inline __attribute__((always_inline)) void PhiloxRound(uint32_t *p_ctr, uint32_t p_k0, uint32_t p_k1)
+	{
+		uint64_t product0 = (uint64_t)0xD2511F53U * p_ctr[0];
+		uint64_t product1 = (uint64_t)0xCD9E8D57U * p_ctr[2];
+		uint32_t out0 = (uint32_t)(product1 >> 32) ^ p_ctr[1] ^ p_k0;
+		uint32_t out1 = (uint32_t)product1;
+		uint32_t out2 = (uint32_t)(product0 >> 32) ^ p_ctr[3] ^ p_k1;
+		uint32_t out3 = (uint32_t)product0;
+		
+		p_ctr[0] = out0;
+		p_ctr[1] = out1;
+		p_ctr[2] = out2;
+		p_ctr[3] = out3;
+	}
+	
+	static inline __attribute__((always_inline)) void PhiloxRounds(uint32_t *p_ctr, const uint32_t *p_key)
+	{
+		uint32_t k0 = p_key[0], k1 = p_key[1];
+		
+		for (int round = 0; round < 10; ++round)
+		{
+			if (round)
+			{
+				k0 += 0x9E3779B9U;
+				k1 += 0xBB67AE85U;
+			}
+			
+			PhiloxRound(p_ctr, k0, k1);
+		}
+	}
+	
+	inline __attribute__((always_inline)) void GenerateBlock(uint32_t p_block, uint32_t *p_output) const
+	{
+		p_output[0] = p_block;
+		p_output[1] = counter_[1];
+		p_output[2] = counter_[2];
+		p_output[3] = counter_[3];
+		
+		PhiloxRounds(p_output, key_);
+	}
+	
+	unsigned int PoissonLargeMean(double p_mu);
+	unsigned int BinomialLargeMean(unsigned int p_n, double p_p);
+	
+public:
+	Eidos_CounterRNG(void) = delete;
+	Eidos_CounterRNG(uint64_t p_seed, uint32_t p_purpose, uint32_t p_id1, uint32_t p_id2, uint32_t p_id3);
+	
+	// the raw Philox4x32-10 bijection, exposed for testing against published known-answer vectors
+	static void Philox4x32_10(const uint32_t *p_counter, const uint32_t *p_key, uint32_t *p_output);
+	
+	inline __attribute__((always_inline)) uint32_t Next32(void)
+	{
+		if (buffer_index_ == 4)
+		{
+			GenerateBlock(counter_[0]++, buffer_);
+			buffer_index_ = 0;
+		}
+		
+		return buffer_[buffer_index_++];
+	}
+	
+	inline __attribute__((always_inline)) uint64_t Next64(void)
+	{
+		uint64_t high = Next32();
+		
+		return (high << 32) | Next32();
+	}
+	
+	// [0, 1) and (0, 1), with the same 32-bit resolution as Eidos_rng_uniform()
+	inline __attribute__((always_inline)) double Uniform(void) { return Next32() / 4294967296.0; }
+	inline __attribute__((always_inline)) double UniformPos(void) { return (Next32() + 0.5) / 4294967296.0; }
+	
+	// [0, p_n - 1] for p_n >= 1, without modulo bias
+	inline __attribute__((always_inline)) uint64_t UniformInt(uint64_t p_n)
+	{
+		uint64_t scale = UINT64_MAX / p_n;
+		uint64_t k;
+		
+		do
+		{
+			k = Next64() / scale;
+		}
+		while (k >= p_n);
+		
+		return k;
+	}
+	
+	// Poisson draws by inversion; p_exp_neg_mu must be exp(-p_mu), as from Eidos_FastRandomPoisson_PRECALCULATE()
+	inline unsigned int Poisson(double p_mu, double p_exp_neg_mu)
+	{
+		if (p_mu > 250)
+			return PoissonLargeMean(p_mu);
+		
+		unsigned int x = 0;
+		double p = p_exp_neg_mu;
+		double s = p;
+		double u = Uniform();
+		
+		while (u > s)
+		{
+			++x;
+			p *= (p_mu / x);
+			s += p;
+		}
+		
+		return x;
+	}
+	
+	unsigned int Binomial(unsigned int p_n, double p_p);
+	
+	// bulk fills; each is equivalent to the corresponding single draw made p_count times in succession
+	void FillUniform(double *p_values, size_t p_count);
+	void FillPoisson(unsigned int *p_values, size_t p_count, double p_mu);
+	void FillBinomial(unsigned int *p_values, size_t p_count, unsigned int p_n, double p_p);
+};
+
+
 #pragma mark -
 #pragma mark 64-bit MT
 #pragma mark -
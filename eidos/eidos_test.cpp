@@ -274,6 +274,7 @@ static void _RunMethodTests(void);
 static void _RunCodeExampleTests(void);
 static void _RunUserDefinedFunctionTests(void);
 static void _RunVoidEidosValueTests(void);
+static void _RunCounterRNGTests(void);
 
 
 int RunEidosTests(void)
@@ -342,6 +343,7 @@ int RunEidosTests(void)
 	_RunCodeExampleTests();
 	_RunUserDefinedFunctionTests();
 	_RunVoidEidosValueTests();
+	_RunCounterRNGTests();
 	
 	// ************************************************************************************
 	//
@@ -1933,7 +1935,7 @@ void _RunOperatorPlusTests2(void)
 	EidosAssertScriptRaise("identical(array(1:6,c(1,2,3)) + array(1:6,c(3,2,1)), array(2:7, c(1,2,3)));", 30, "non-conformable");
 }
 
-#pragma mark operator −
+#pragma mark operator -
 void _RunOperatorMinusTests(void)
 {
 	// operator -
@@ -7701,6 +7703,129 @@ void _RunVoidEidosValueTests(void)
 	EidosAssertScriptRaise("for (x in citation()) T;", 0, "does not allow void");
 }
 
+#pragma mark counter-based RNG
+void _RunCounterRNGTests(void)
+{
+	// Eidos_CounterRNG is not accessible from script, so these tests call it directly
+	auto check = [](bool p_passed, const char *p_description) {
+		if (p_passed)
+		{
+			gEidosTestSuccessCount++;
+		}
+		else
+		{
+			gEidosTestFailureCount++;
+			std::cerr << "Eidos_CounterRNG: " << p_description << " : " << EIDOS_OUTPUT_FAILURE_TAG << std::endl;
+		}
+	};
+	
+	// Philox4x32-10 known-answer vectors from the Random123 distribution
+	{
+		const uint32_t counters[3][4] = {{0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+		const uint32_t keys[3][2] = {{0x00000000, 0x00000000}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+		const uint32_t expected[3][4] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+		
+		for (int vector_index = 0; vector_index < 3; ++vector_index)
+		{
+			uint32_t output[4];
+			
+			Eidos_CounterRNG::Philox4x32_10(counters[vector_index], keys[vector_index], output);
+			check((output[0] == expected[vector_index][0]) && (output[1] == expected[vector_index][1]) && (output[2] == expected[vector_index][2]) && (output[3] == expected[vector_index][3]), "Philox4x32_10 known-answer vector");
+		}
+	}
+	
+	// streams are determined by their identifiers, and differ when any identifier differs
+	{
+		Eidos_CounterRNG rng1(17, 1, 2, 3, 4), rng2(17, 1, 2, 3, 4), rng3(17, 1, 2, 3, 5), rng4(18, 1, 2, 3, 4), rng5(17, 2, 2, 3, 4);
+		uint32_t draw1 = rng1.Next32();
+		
+		check(draw1 == rng2.Next32(), "identical streams");
+		check(draw1 != rng3.Next32(), "streams with different ids");
+		check(draw1 != rng4.Next32(), "streams with different seeds");
+		check(draw1 != rng5.Next32(), "streams with different purposes");
+	}
+	
+	// the bulk fills are equivalent to successive single draws, including when they start partway through a block
+	{
+		for (size_t skip = 0; skip < 4; ++skip)
+		{
+			Eidos_CounterRNG bulk_rng(5, 0, 0, 0, 0), single_rng(5, 0, 0, 0, 0);
+			std::vector<double> values(37);
+			bool same = true;
+			
+			for (size_t index = 0; index < skip; ++index)
+				same = same && (bulk_rng.Next32() == single_rng.Next32());
+			
+			bulk_rng.FillUniform(values.data(), values.size());
+			
+			for (double value : values)
+				same = same && (value == single_rng.Uniform());
+			
+			same = same && (bulk_rng.Next32() == single_rng.Next32());
+			check(same, "FillUniform() matches Uniform()");
+		}
+		
+		Eidos_CounterRNG bulk_rng(6, 0, 0, 0, 0), single_rng(6, 0, 0, 0, 0);
+		std::vector<unsigned int> counts(1000);
+		bool same = true;
+		
+		bulk_rng.FillPoisson(counts.data(), counts.size(), 2.5);
+		for (unsigned int count : counts)
+			same = same && (count == single_rng.Poisson(2.5, exp(-2.5)));
+		check(same, "FillPoisson() matches Poisson()");
+		
+		same = true;
+		bulk_rng.FillBinomial(counts.data(), counts.size(), 20, 0.3);
+		for (unsigned int count : counts)
+			same = same && (count == single_rng.Binomial(20, 0.3));
+		check(same, "FillBinomial() matches Binomial()");
+		
+		same = true;
+		bulk_rng.FillBinomial(counts.data(), counts.size(), 20, 0.8);
+		for (unsigned int count : counts)
+			same = same && (count == single_rng.Binomial(20, 0.8));
+		check(same, "FillBinomial() matches Binomial() for p > 0.5");
+	}
+	
+	// the draws have the right means, both by inversion and through the GSL for large means
+	{
+		Eidos_CounterRNG rng(7, 0, 0, 0, 0);
+		std::vector<double> uniforms(100000);
+		std::vector<unsigned int> counts(100000);
+		double total;
+		
+		rng.FillUniform(uniforms.data(), uniforms.size());
+		total = 0.0;
+		for (double uniform : uniforms)
+			total += uniform;
+		check(std::abs(total / uniforms.size() - 0.5) < 0.005, "FillUniform() mean");
+		
+		rng.FillPoisson(counts.data(), counts.size(), 1.0);
+		total = 0.0;
+		for (unsigned int count : counts)
+			total += count;
+		check(std::abs(total / counts.size() - 1.0) < 0.02, "FillPoisson() mean, small mu");
+		
+		rng.FillPoisson(counts.data(), 10000, 300.0);
+		total = 0.0;
+		for (size_t index = 0; index < 10000; ++index)
+			total += counts[index];
+		check(std::abs(total / 10000 - 300.0) < 1.0, "FillPoisson() mean, large mu");
+		
+		rng.FillBinomial(counts.data(), counts.size(), 10, 0.2);
+		total = 0.0;
+		for (unsigned int count : counts)
+			total += count;
+		check(std::abs(total / counts.size() - 2.0) < 0.03, "FillBinomial() mean, small n*p");
+		
+		rng.FillBinomial(counts.data(), 10000, 1000, 0.4);
+		total = 0.0;
+		for (size_t index = 0; index < 10000; ++index)
+			total += counts[index];
+		check(std::abs(total / 10000 - 400.0) < 1.0, "FillBinomial() mean, large n*p");
+	}
+}
+
 
 
 